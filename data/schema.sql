@@ -1,4 +1,6 @@
 -- Drop existing tables (with CASCADE to handle foreign keys)
+DROP TABLE IF EXISTS room_leases CASCADE;
+DROP TABLE IF EXISTS transactions CASCADE;
 DROP TABLE IF EXISTS chat_messages CASCADE;
 DROP TABLE IF EXISTS activity_logs CASCADE;
 DROP TABLE IF EXISTS bids CASCADE;
@@ -18,6 +20,7 @@ CREATE TABLE users (
     bank_account VARCHAR(50),
     bank_name VARCHAR(100),
     balance DECIMAL(15, 2) DEFAULT 0,
+    held DECIMAL(15, 2) DEFAULT 0,      -- Reserved by leading bids on every node (cluster)
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
 );
@@ -30,6 +33,9 @@ CREATE TABLE auction_rooms (
     room_name VARCHAR(255) NOT NULL,
     created_by INT NOT NULL,
     description TEXT,
+    status VARCHAR(50) DEFAULT 'active' CHECK (status IN ('active', 'closed')),
+    start_time TIMESTAMP,
+    end_time TIMESTAMP,
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     FOREIGN KEY (created_by) REFERENCES users(user_id) ON DELETE CASCADE
 );
@@ -49,9 +55,13 @@ CREATE TABLE auction_items (
     status VARCHAR(50) DEFAULT 'scheduled' CHECK (status IN ('scheduled', 'active', 'available', 'sold', 'cancelled')),
     created_by INT NOT NULL,
     queue_position INT,
+    winner_id INT,
+    win_amount DECIMAL(15, 2),
+    win_type VARCHAR(20) CHECK (win_type IN ('bid', 'buy_now')),
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     FOREIGN KEY (room_id) REFERENCES auction_rooms(room_id) ON DELETE CASCADE,
-    FOREIGN KEY (created_by) REFERENCES users(user_id) ON DELETE CASCADE
+    FOREIGN KEY (created_by) REFERENCES users(user_id) ON DELETE CASCADE,
+    FOREIGN KEY (winner_id) REFERENCES users(user_id) ON DELETE SET NULL
 );
 
 -- ============================
@@ -62,6 +72,7 @@ CREATE TABLE bids (
     item_id INT NOT NULL,
     user_id INT NOT NULL,
     bid_amount DECIMAL(15, 2) NOT NULL,
+    is_proxy BOOLEAN NOT NULL DEFAULT FALSE,
     bid_time TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     FOREIGN KEY (item_id) REFERENCES auction_items(item_id) ON DELETE CASCADE,
     FOREIGN KEY (user_id) REFERENCES users(user_id) ON DELETE CASCADE
@@ -104,3 +115,27 @@ CREATE TABLE chat_messages (
     FOREIGN KEY (room_id) REFERENCES auction_rooms(room_id) ON DELETE CASCADE,
     FOREIGN KEY (user_id) REFERENCES users(user_id) ON DELETE CASCADE
 );
+
+-- ============================
+-- Create Transactions Table (balance changes written by the server ledger)
+-- ============================
+CREATE TABLE transactions (
+    transaction_id SERIAL PRIMARY KEY,
+    user_id INT NOT NULL,
+    amount DECIMAL(15, 2) NOT NULL,
+    type VARCHAR(50) NOT NULL CHECK (type IN ('deposit', 'redeem', 'bid_win', 'buy_now')),
+    related_item_id INT,
+    status VARCHAR(20) NOT NULL DEFAULT 'completed',
+    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    FOREIGN KEY (user_id) REFERENCES users(user_id) ON DELETE CASCADE,
+    FOREIGN KEY (related_item_id) REFERENCES auction_items(item_id) ON DELETE SET NULL
+);
+
+-- ============================
+-- Create Room Leases Table (which server node runs each room's timer and bidding)
+-- ============================
+CREATE TABLE room_leases (
+    room_id INT PRIMARY KEY,
+    node_id VARCHAR(32) NOT NULL,
+    expires_at TIMESTAMP NOT NULL
+);
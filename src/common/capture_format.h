@@ -0,0 +1,41 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <stdint.h>
+#include "protocol_header.h"
+
+// ========== Wire Capture File Format ==========
+// Written by the server's recorder (wire_capture.h) and read / written by
+// the replay tool (tools/wire_replay.c). A capture is a CaptureFileHeader
+// followed by records; every record is a CaptureRecord, and frame records
+// continue with the MessageHeader and payload exactly as on the wire.
+// All fields are little-endian, as on the wire.
+//
+// Connections are numbered in the order they opened (fds are reused), so a
+// replay can open one socket per recorded connection.
+
+#define CAPTURE_MAGIC       "AUCTCAP1"
+#define CAPTURE_VERSION     1
+
+typedef enum {
+    CAPTURE_OPEN = 1,       // Client connected
+    CAPTURE_REQUEST,        // Inbound frame (server capture)
+    CAPTURE_CLOSE,          // Client disconnected
+    CAPTURE_RESPONSE        // Outbound frame (replay output)
+} CaptureRecordKind;
+
+typedef struct __attribute__((packed)) {
+    char magic[8];          // CAPTURE_MAGIC, not terminated
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t start_unix_us; // Wall clock at offset 0
+} CaptureFileHeader;
+
+typedef struct __attribute__((packed)) {
+    uint64_t offset_us;     // Since the start of the capture
+    uint32_t conn_id;
+    uint8_t kind;           // CaptureRecordKind
+    uint8_t reserved[3];
+} CaptureRecord;
+
+#endif
@@ -1,9 +1,10 @@
-#ifndef PROTOCOL_H
-#define PROTOCOL_H
-
-#include "protocol_types.h"
-#include "protocol_header.h"
-#include "protocol_helpers.h"
-#include "protocol_payloads.h"
-
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "protocol_types.h"
+#include "protocol_header.h"
+#include "protocol_helpers.h"
+#include "protocol_payloads.h"
+#include "protocol_codec.h"
+
 #endif
\ No newline at end of file
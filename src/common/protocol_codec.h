@@ -0,0 +1,158 @@
+#ifndef PROTOCOL_CODEC_H
+#define PROTOCOL_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "protocol_types.h"
+#include "protocol_payloads.h"
+
+// ========== Payload Codec ==========
+// Length rules and encode/decode helpers for every row of PROTOCOL_MESSAGES
+// (protocol_types.h). Payload structs are packed and may sit unaligned in a
+// receive buffer, so decoding copies them out.
+//
+//   decode_<TYPE>(payload, len, &msg)   false if len breaks the size rule
+//   encode_<TYPE>(&msg, out, cap)       FIXED: bytes written, 0 if it doesn't fit
+//   encode_<TYPE>(&msg, entries, entries_len, out, cap)    VAR
+//   decode_<TYPE>(len)                  NONE: true if the payload is empty
+
+// Accepted payload lengths per size rule
+#define PROTOCOL_MIN_FIXED(body)    sizeof(body)
+#define PROTOCOL_MAX_FIXED(body)    sizeof(body)
+#define PROTOCOL_MIN_VAR(body)      sizeof(body)
+#define PROTOCOL_MAX_VAR(body)      BUFF_SIZE
+#define PROTOCOL_MIN_NONE(body)     0
+#define PROTOCOL_MAX_NONE(body)     0
+
+#define PROTOCOL_CODEC_FIXED(type, body) \
+    static inline bool decode_##type(const char* payload, uint32_t len, body* out) \
+    { \
+        if (len != sizeof(body)) return false; \
+        memcpy(out, payload, sizeof(body)); \
+        return true; \
+    } \
+    static inline uint32_t encode_##type(const body* msg, char* out, size_t cap) \
+    { \
+        if (cap < sizeof(body)) return 0; \
+        memcpy(out, msg, sizeof(body)); \
+        return sizeof(body); \
+    }
+
+// Only the head struct is decoded; entries start at payload + sizeof(body)
+#define PROTOCOL_CODEC_VAR(type, body) \
+    static inline bool decode_##type(const char* payload, uint32_t len, body* out) \
+    { \
+        if (len < sizeof(body) || len > BUFF_SIZE) return false; \
+        memcpy(out, payload, sizeof(body)); \
+        return true; \
+    } \
+    static inline uint32_t encode_##type(const body* msg, const void* entries, \
+                                         uint32_t entries_len, char* out, size_t cap) \
+    { \
+        if (cap < sizeof(body) + entries_len) return 0; \
+        memcpy(out, msg, sizeof(body)); \
+        if (entries_len) memcpy(out + sizeof(body), entries, entries_len); \
+        return (uint32_t)(sizeof(body) + entries_len); \
+    }
+
+#define PROTOCOL_CODEC_NONE(type, body) \
+    static inline bool decode_##type(uint32_t len) \
+    { \
+        return len == 0; \
+    }
+
+#define PROTOCOL_CODEC_REQ(type, value, body, size, handler) PROTOCOL_CODEC_##size(type, body)
+#define PROTOCOL_CODEC_MSG(type, value, body, size) PROTOCOL_CODEC_##size(type, body)
+
+PROTOCOL_MESSAGES(PROTOCOL_CODEC_REQ, PROTOCOL_CODEC_MSG)
+
+// === STATIC CHECKS ===
+// Every type fits the uint8_t header field and every payload fits a frame
+#define PROTOCOL_CHECK_MSG(type, value, body, size) \
+    _Static_assert((value) > 0 && (value) <= 0xFF, #type " does not fit MessageHeader.type"); \
+    _Static_assert(PROTOCOL_MIN_##size(body) <= BUFF_SIZE, #type " payload exceeds BUFF_SIZE");
+#define PROTOCOL_CHECK_REQ(type, value, body, size, handler) \
+    PROTOCOL_CHECK_MSG(type, value, body, size)
+
+PROTOCOL_MESSAGES(PROTOCOL_CHECK_REQ, PROTOCOL_CHECK_MSG)
+
+// Two rows with the same value fail to compile here (duplicate case label)
+#define PROTOCOL_CASE_REQ(type, value, body, size, handler) case type:
+#define PROTOCOL_CASE_MSG(type, value, body, size) case type:
+
+static inline bool protocol_type_known(uint8_t type)
+{
+    switch (type) {
+        PROTOCOL_MESSAGES(PROTOCOL_CASE_REQ, PROTOCOL_CASE_MSG)
+            return true;
+        default:
+            return false;
+    }
+}
+
+// === CREATE_ITEMS_REQ ROWS ===
+// Size of the row at p, or 0 if it runs past end or a text field does not
+// fit CreateItemReq
+static inline uint32_t create_items_row_size(const char* p, const char* end)
+{
+    CreateItemRow row;
+    if (end - p < (ptrdiff_t)sizeof(row)) return 0;
+    memcpy(&row, p, sizeof(row));
+    // desc_len is a uint8_t: always short of the 256-byte description
+    if (row.name_len == 0 || row.name_len >= sizeof(((CreateItemReq*)0)->name)) return 0;
+    uint32_t size = (uint32_t)sizeof(row) + row.name_len + row.desc_len;
+    return end - p < (ptrdiff_t)size ? 0 : size;
+}
+
+// True if the head's `count` rows fill the payload exactly
+static inline bool create_items_rows_valid(const char* payload, uint32_t len)
+{
+    CreateItemsReq head;
+    if (!decode_CREATE_ITEMS_REQ(payload, len, &head)) return false;
+    if (head.count == 0 || head.count > CREATE_ITEMS_MAX) return false;
+    const char* p = payload + sizeof(head);
+    const char* end = payload + len;
+    for (uint16_t i = 0; i < head.count; i++) {
+        uint32_t size = create_items_row_size(p, end);
+        if (size == 0) return false;
+        p += size;
+    }
+    return p == end;
+}
+
+// Expand a checked row into a NUL-terminated CreateItemReq; returns its size
+static inline uint32_t decode_create_items_row(const char* p, CreateItemReq* out)
+{
+    CreateItemRow row;
+    memcpy(&row, p, sizeof(row));
+    memset(out, 0, sizeof(*out));
+    out->start_price = row.start_price;
+    out->buy_now_price = row.buy_now_price;
+    out->duration_sec = row.duration_sec;
+    memcpy(out->name, p + sizeof(row), row.name_len);
+    memcpy(out->description, p + sizeof(row) + row.name_len, row.desc_len);
+    return (uint32_t)sizeof(row) + row.name_len + row.desc_len;
+}
+
+// Append one item as a row: bytes written, 0 if it doesn't fit in cap or
+// its name is empty
+static inline uint32_t encode_create_items_row(const CreateItemReq* item, char* out, size_t cap)
+{
+    size_t name_len = strnlen(item->name, sizeof(item->name) - 1);
+    size_t desc_len = strnlen(item->description, sizeof(item->description) - 1);
+    CreateItemRow row = {
+        .start_price = item->start_price, .buy_now_price = item->buy_now_price,
+        .duration_sec = item->duration_sec,
+        .name_len = (uint8_t)name_len, .desc_len = (uint8_t)desc_len,
+    };
+    size_t size = sizeof(row) + name_len + desc_len;
+    if (name_len == 0 || cap < size) return 0;
+    memcpy(out, &row, sizeof(row));
+    memcpy(out + sizeof(row), item->name, name_len);
+    memcpy(out + sizeof(row) + name_len, item->description, desc_len);
+    return (uint32_t)size;
+}
+
+#endif
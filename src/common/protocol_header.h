@@ -7,10 +7,17 @@
 #define BUFF_SIZE 2048
 #define PORT 5500
 
+// Header flags (MessageHeader.flags), see helpers in protocol_helpers.h
+#define FLAG_REQUIRES_ACK   0x0001
+#define FLAG_IS_ACK         0x0002
+#define FLAG_RETRANSMISSION 0x0004
+#define FLAG_BROADCAST      0x0008
+#define FLAG_PRIORITY_HIGH  0x0010  // Scheduled ahead of normal requests (bids)
 
 typedef struct __attribute__((packed)) {
     uint8_t type;           
-    uint32_t request_id;    
+    uint16_t flags;
+    uint32_t request_id;    // Echoed in the response; responses may arrive out of order
     uint32_t payload_length;
 } MessageHeader;
 
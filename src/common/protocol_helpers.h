@@ -10,29 +10,17 @@ typedef struct __attribute__((packed)) {
     char message[100];  // Optional error or info message, null-terminated
 } BaseResponse;
 
-// Room info for lists
-typedef struct __attribute__((packed)) {
-    uint32_t room_id;
-    char name[100];
-    char description[256];
-    uint16_t user_count;
-    uint8_t is_active;  // 1 if auction ongoing
-} RoomInfo;
-
-// Item info for lists and views
-typedef struct __attribute__((packed)) {
-    uint32_t item_id;
-    uint32_t room_id;
-    char name[100];
-    char description[256];
-    int64_t start_price;   // In cents
-    int64_t current_price; // In cents
-    int64_t buy_now_price; // In cents, 0 if not applicable
-    uint32_t seller_id;
-    char seller_name[50];
-    uint64_t end_timestamp; // Unix time when auction ends
-    uint8_t status;         // 0: pending, 1: active, 2: sold
-} ItemInfo;
+// BaseResponse.status values
+#define STATUS_SUCCESS             1
+#define STATUS_FAIL                0
+#define STATUS_INVALID            -1
+#define STATUS_INSUFFICIENT_FUNDS -2
+#define STATUS_BUSY               -3  // Too many outstanding requests on this connection
+#define STATUS_RATE_LIMITED       -4  // Request rate over the limit for this message class
+#define STATUS_OVERLOADED         -5  // Low-priority request shed while the server is overloaded
+#define STATUS_WRONG_NODE         -6  // Room is run by another server node (cluster)
+
+// RoomInfo / ItemInfo list entries are defined in protocol_payloads.h
 
 // History entry
 typedef struct __attribute__((packed)) {
@@ -44,6 +32,22 @@ typedef struct __attribute__((packed)) {
     uint64_t timestamp;
 } HistoryEntry;
 
+// Per-user auction statistics (VIEW_HISTORY_RES)
+typedef struct __attribute__((packed)) {
+    uint32_t auctions_joined;
+    uint32_t bids_placed;
+    uint32_t items_won;
+    int64_t total_spent;
+    uint16_t win_rate_bp;   // items_won / auctions_joined, in 1/100 of a percent
+} AuctionStatsSummary;
+
+// One bucket of an item's downsampled bid history (PRICE_HISTORY_RES)
+typedef struct __attribute__((packed)) {
+    uint32_t offset_ms;     // Bucket start, from PriceHistoryRes.first_ts_ms
+    int64_t price;          // Price after the bucket's last bid
+    uint32_t bids;          // Bids in the bucket
+} PricePoint;
+
 // ========== Flag Helper Functions ==========
 
 // Set a flag bit in the flags field
@@ -2,6 +2,7 @@
 #define PROTOCOL_PAYLOADS_H
 
 #include <stdint.h>
+#include "protocol_helpers.h"
 
 
 // Auth
@@ -54,12 +55,16 @@ typedef struct __attribute__((packed)) {
 
 
 typedef struct __attribute__((packed)) {
-
+    uint16_t offset;    // Entries to skip, newest first
+    uint16_t limit;     // 0 = as many as fit in one frame
 } ViewHistoryReq;
 
+// Followed by `count` HistoryEntry
 typedef struct __attribute__((packed)) {
     int32_t status;
     char message[100];
+    AuctionStatsSummary summary;
+    uint16_t total;     // Entries available for paging
     uint16_t count;  
 } ViewHistoryRes;
 
@@ -77,12 +82,23 @@ typedef struct __attribute__((packed)) {
 
 typedef struct __attribute__((packed)) {
     char query[100];  
+    uint64_t since_version;  // Version from the last ListRoomsRes, 0 = full list
+    uint16_t offset;         // Next snapshot page: next_offset of the last page (with its version)
 } ListRoomsReq;
 
+// Followed by `count` RoomInfo, then `removed_count` uint32_t room ids.
+// A snapshot that does not fit one frame comes in pages: keep asking with
+// since_version = version and offset = next_offset until next_offset is 0,
+// and only then poll for deltas. A page with offset 0 starts over.
 typedef struct __attribute__((packed)) {
     int32_t status;
     char message[100];
     uint16_t count;  
+    uint64_t version;        // Send back as since_version on the next poll
+    uint8_t is_delta;        // 1: only entries changed since since_version; 0: full snapshot
+    uint16_t removed_count;
+    uint16_t offset;         // Snapshot: index of this page's first row
+    uint16_t next_offset;    // Snapshot: rows received so far, 0 = list complete
 } ListRoomsRes;
 
 typedef struct __attribute__((packed)) {
@@ -105,12 +121,20 @@ typedef struct __attribute__((packed)) {
 
 // In-Room Actions
 typedef struct __attribute__((packed)) {
+    uint64_t since_version;  // Version from the last ViewItemsRes, 0 = full list
+    uint16_t offset;         // Next snapshot page (see ListRoomsRes)
 } ViewItemsReq;
 
+// Followed by `count` ItemInfo, then `removed_count` uint32_t item ids
 typedef struct __attribute__((packed)) {
     int32_t status;
     char message[100];
     uint16_t count;
+    uint64_t version;
+    uint8_t is_delta;
+    uint16_t removed_count;
+    uint16_t offset;
+    uint16_t next_offset;
 } ViewItemsRes;
 
 typedef struct __attribute__((packed)) {
@@ -139,6 +163,20 @@ typedef struct __attribute__((packed)) {
     char message[100];
 } BuyNowRes;
 
+// Register (or change) a maximum bid; the server bids for the user up to it.
+// max_amount = 0 withdraws the proxy.
+typedef struct __attribute__((packed)) {
+    uint32_t item_id;
+    int64_t max_amount; // in VND
+} ProxyBidReq;
+
+typedef struct __attribute__((packed)) {
+    int32_t status;
+    char message[100];
+    int64_t current_price;  // After the proxies were resolved
+    uint32_t leader_id;
+} ProxyBidRes;
+
 typedef struct __attribute__((packed)) {
     char text[256];
     uint32_t user_id;
@@ -165,6 +203,65 @@ typedef struct __attribute__((packed)) {
     uint32_t item_id;
 } CreateItemRes;
 
+// Bulk CREATE_ITEM. A batch may span several frames: they share batch_id,
+// are numbered from seq 0 and the frame with `last` set creates the items
+// of the whole batch (up to CREATE_ITEMS_MAX). Each frame is followed by
+// `count` rows packed back to back: a CreateItemRow, then name_len bytes of
+// name and desc_len bytes of description, without terminators (see
+// encode_create_items_row in protocol_codec.h). A row with a 30-byte name
+// and an 80-byte description takes 132 bytes, so a frame carries ~15.
+#define CREATE_ITEMS_MAX 1000
+
+typedef struct __attribute__((packed)) {
+    uint32_t batch_id;      // Chosen by the client, unique per connection
+    uint16_t seq;
+    uint8_t last;
+    uint16_t count;
+} CreateItemsReq;
+
+typedef struct __attribute__((packed)) {
+    int64_t start_price;
+    int64_t buy_now_price;
+    uint32_t duration_sec;
+    uint8_t name_len;       // 1..99 (CreateItemReq.name)
+    uint8_t desc_len;       // 0..255 (CreateItemReq.description)
+} CreateItemRow;
+
+// Frames before the last are answered with count 0. The last frame is
+// answered with the batch's results in as many CREATE_ITEMS_RES as needed,
+// all with its request_id, paged like ListRoomsRes.
+typedef struct __attribute__((packed)) {
+    int32_t status;         // SUCCESS only if every row was created
+    char message[100];
+    uint32_t batch_id;
+    uint32_t created;       // Items of the whole batch
+    uint16_t count;         // CreateItemResult entries that follow, in row order
+    uint16_t offset;        // Batch row of the first entry
+    uint16_t next_offset;   // Rows answered so far, 0 = last page
+} CreateItemsRes;
+
+typedef struct __attribute__((packed)) {
+    int32_t status;         // SUCCESS, INVALID (row rejected) or FAIL (insert failed)
+    uint32_t item_id;
+} CreateItemResult;
+
+typedef struct __attribute__((packed)) {
+    uint32_t item_id;
+    uint32_t resolution_ms;     // Bucket width, at least a second; 0 = fit the whole series in one frame
+} PriceHistoryReq;
+
+// Followed by `count` PricePoint, oldest first. Buckets without bids are
+// left out; resolution_ms is widened when the requested one would not fit.
+typedef struct __attribute__((packed)) {
+    int32_t status;
+    char message[100];
+    uint32_t item_id;
+    uint32_t total_bids;
+    uint64_t first_ts_ms;       // Unix ms of the first bid
+    uint32_t resolution_ms;     // Bucket width used
+    uint16_t count;
+} PriceHistoryRes;
+
 typedef struct __attribute__((packed)) {
     uint32_t item_id;
 } DeleteItemReq;
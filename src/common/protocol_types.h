@@ -1,55 +1,76 @@
 #ifndef PROTOCOL_TYPES_H
 #define PROTOCOL_TYPES_H
 
-// Enum for all Message Types (grouped for clarity)
-typedef enum {
-    // Auth (0x01-0x0F)
-    LOGIN_REQ = 0x01,
-    LOGIN_RES,
-    REGISTER_REQ,
-    REGISTER_RES,
-    LOGOUT_REQ,
-    LOGOUT_RES,
-    
-    // Account Management (0x10-0x1F)
-    DEPOSIT_REQ = 0x10,
-    DEPOSIT_RES,
-    REDEEM_REQ,
-    REDEEM_RES,
-    VIEW_HISTORY_REQ,
-    VIEW_HISTORY_RES,
-    
-    // Outside-Room Actions (0x20-0x3F)
-    JOIN_ROOM_REQ = 0x20,
-    JOIN_ROOM_RES,
-    LEAVE_ROOM_REQ,
-    LEAVE_ROOM_RES,
-    LIST_ROOMS_REQ,
-    LIST_ROOMS_RES,
-    SEARCH_ITEM_REQ,
-    SEARCH_ITEM_RES,
-    CREATE_ROOM_REQ,
-    CREATE_ROOM_RES,
-    
-    // In-Room Actions (0x40-0x5F)
-    VIEW_ITEMS_REQ = 0x40,
-    VIEW_ITEMS_RES,
-    BID_REQ,
-    BID_RES,
-    BID_NOTIFY,     
-    BUY_NOW_REQ,
-    BUY_NOW_RES,
-    CHAT_REQ,
-    CHAT_NOTIFY,    
-    CREATE_ITEM_REQ,
-    CREATE_ITEM_RES,
-    DELETE_ITEM_REQ,
-    DELETE_ITEM_RES,
-    TIMER_UPDATE  
-    ITEM_SOLD           
+// ========== Message Table ==========
+// Every message type, in one place. The MessageType enum below, the
+// server's dispatch array (message_dispatch.c), the accepted payload
+// lengths and the encode/decode helpers (protocol_codec.h) are all
+// generated from it, so a type cannot exist without a size rule and a
+// request cannot exist without a handler.
+//
+//   REQ(type, value, payload struct, size rule, handler)   client -> server
+//   MSG(type, value, payload struct, size rule)            server -> client
+//
+// Size rules: FIXED = exactly the struct, VAR = the struct followed by
+// entries (up to BUFF_SIZE), NONE = empty payload (struct column unused).
+#define PROTOCOL_MESSAGES(REQ, MSG) \
+    /* Auth (0x01-0x0F) */ \
+    REQ(LOGIN_REQ,          0x01, LoginReq,         FIXED, handle_login) \
+    MSG(LOGIN_RES,          0x02, LoginRes,         FIXED) \
+    REQ(REGISTER_REQ,       0x03, RegisterReq,      FIXED, handle_register) \
+    MSG(REGISTER_RES,       0x04, RegisterRes,      FIXED) \
+    REQ(LOGOUT_REQ,         0x05, LogoutReq,        FIXED, handle_logout) \
+    MSG(LOGOUT_RES,         0x06, LogoutRes,        FIXED) \
+    /* Account Management (0x10-0x1F) */ \
+    REQ(DEPOSIT_REQ,        0x10, MoneyReq,         FIXED, handle_deposit) \
+    MSG(DEPOSIT_RES,        0x11, MoneyRes,         FIXED) \
+    REQ(REDEEM_REQ,         0x12, MoneyReq,         FIXED, handle_redeem) \
+    MSG(REDEEM_RES,         0x13, MoneyRes,         FIXED) \
+    REQ(VIEW_HISTORY_REQ,   0x14, ViewHistoryReq,   FIXED, handle_view_history) \
+    MSG(VIEW_HISTORY_RES,   0x15, ViewHistoryRes,   VAR) \
+    /* Outside-Room Actions (0x20-0x3F) */ \
+    REQ(JOIN_ROOM_REQ,      0x20, JoinRoomReq,      FIXED, handle_join_room) \
+    MSG(JOIN_ROOM_RES,      0x21, JoinRoomRes,      FIXED) \
+    REQ(LEAVE_ROOM_REQ,     0x22, void,             NONE,  handle_leave_room) \
+    MSG(LEAVE_ROOM_RES,     0x23, BaseResponse,     FIXED) \
+    REQ(LIST_ROOMS_REQ,     0x24, ListRoomsReq,     FIXED, handle_list_rooms) \
+    MSG(LIST_ROOMS_RES,     0x25, ListRoomsRes,     VAR) \
+    REQ(SEARCH_ITEM_REQ,    0x26, SearchItemReq,    FIXED, handle_search_item) \
+    MSG(SEARCH_ITEM_RES,    0x27, SearchItemRes,    VAR) \
+    REQ(CREATE_ROOM_REQ,    0x28, CreateRoomReq,    FIXED, handle_create_room) \
+    MSG(CREATE_ROOM_RES,    0x29, CreateRoomRes,    FIXED) \
+    /* In-Room Actions (0x40-0x5F) */ \
+    REQ(VIEW_ITEMS_REQ,     0x40, ViewItemsReq,     FIXED, handle_view_items) \
+    MSG(VIEW_ITEMS_RES,     0x41, ViewItemsRes,     VAR) \
+    REQ(BID_REQ,            0x42, BidReq,           FIXED, handle_bid) \
+    MSG(BID_RES,            0x43, BidRes,           FIXED) \
+    MSG(BID_NOTIFY,         0x44, BidNotify,        FIXED) \
+    REQ(BUY_NOW_REQ,        0x45, BuyNowReq,        FIXED, handle_buy_now) \
+    MSG(BUY_NOW_RES,        0x46, BuyNowRes,        FIXED) \
+    REQ(CHAT_REQ,           0x47, ChatReq,          FIXED, handle_chat) \
+    MSG(CHAT_NOTIFY,        0x48, ChatNotify,       FIXED) \
+    REQ(CREATE_ITEM_REQ,    0x49, CreateItemReq,    FIXED, handle_create_item) \
+    MSG(CREATE_ITEM_RES,    0x4A, CreateItemRes,    FIXED) \
+    REQ(DELETE_ITEM_REQ,    0x4B, DeleteItemReq,    FIXED, handle_delete_item) \
+    MSG(DELETE_ITEM_RES,    0x4C, DeleteItemRes,    FIXED) \
+    MSG(TIMER_UPDATE,       0x4D, TimerUpdate,      FIXED) \
+    MSG(ITEM_SOLD,          0x4E, ItemSold,         FIXED) \
+    REQ(PROXY_BID_REQ,      0x4F, ProxyBidReq,      FIXED, handle_proxy_bid) \
+    MSG(PROXY_BID_RES,      0x50, ProxyBidRes,      FIXED) \
+    REQ(CREATE_ITEMS_REQ,   0x51, CreateItemsReq,   VAR,   handle_create_items) \
+    MSG(CREATE_ITEMS_RES,   0x52, CreateItemsRes,   VAR) \
+    REQ(PRICE_HISTORY_REQ,  0x53, PriceHistoryReq,  FIXED, handle_price_history) \
+    MSG(PRICE_HISTORY_RES,  0x54, PriceHistoryRes,  VAR) \
+    /* Server status & error (0xF0-0xFF) */ \
+    /* BaseResponse, sent when a request is rejected before its handler runs */ \
+    MSG(ERROR_RES,          0xF0, BaseResponse,     FIXED)
 
-    // Server status & error (0xF0-0xFF)
+#define PROTOCOL_ENUM_REQ(type, value, body, size, handler) type = value,
+#define PROTOCOL_ENUM_MSG(type, value, body, size) type = value,
 
+// Enum for all Message Types (grouped for clarity)
+typedef enum {
+    PROTOCOL_MESSAGES(PROTOCOL_ENUM_REQ, PROTOCOL_ENUM_MSG)
 } MessageType;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,297 @@
+#include "admission.h"
+#include "protocol_types.h"
+#include "protocol_helpers.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef struct {
+    uint32_t rate;      // Tokens per second
+    uint32_t burst;     // Bucket size
+} BucketLimit;
+
+// Per connection
+static const BucketLimit conn_limits[ADMIT_CLASS_COUNT] = {
+    [ADMIT_AUTH]  = { 2,  5 },
+    [ADMIT_BID]   = { 20, 40 },
+    [ADMIT_CHAT]  = { 5,  10 },
+    [ADMIT_READ]  = { 20, 40 },
+    [ADMIT_WRITE] = { 5,  10 },
+    [ADMIT_BULK]  = { 40, 80 },     // A CREATE_ITEMS_MAX batch of typical rows is ~70 frames
+    [ADMIT_LOW]   = { 5,  10 },
+};
+
+// Per user, across all of their connections: bids (bid_service.c) and
+// chat (room_service.c). Classes without a row have no per-user limit.
+static const BucketLimit user_limits[ADMIT_CLASS_COUNT] = {
+    [ADMIT_BID]   = { 10, 20 },
+    [ADMIT_CHAT]  = { 3,  6 },
+};
+
+typedef struct UserBuckets {
+    struct UserBuckets* next;
+    int32_t user_id;
+    uint64_t last_ns;
+    AdmitBuckets b;
+} UserBuckets;
+
+typedef struct {
+    pthread_mutex_t lock;
+    UserBuckets* buckets[ADMIT_USER_BUCKETS];
+    uint32_t sweep;         // Next hash bucket checked for idle users
+} UserShard;
+
+static UserShard user_shards[ADMIT_USER_SHARDS];
+static pthread_once_t shards_once = PTHREAD_ONCE_INIT;
+
+// Counters and overload state are atomics: they are touched on every
+// admission check and every dequeue
+static _Atomic uint64_t admitted;
+static _Atomic uint64_t limited_conn[ADMIT_CLASS_COUNT];
+static _Atomic uint64_t limited_user[ADMIT_CLASS_COUNT];
+static _Atomic uint64_t shed[ADMIT_CLASS_COUNT];
+static _Atomic uint64_t overload_entries;
+static _Atomic uint64_t user_entries;
+static _Atomic uint64_t user_evictions;
+static _Atomic uint64_t queue_wait_us;      // Smoothed
+static _Atomic uint64_t last_sample_ns;
+static _Atomic bool queue_idle;             // The workers found the queue empty since the last job
+static _Atomic bool overloaded;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+AdmitClass admission_classify(uint8_t msg_type)
+{
+    switch (msg_type) {
+        case LOGIN_REQ:
+        case REGISTER_REQ:
+        case LOGOUT_REQ:
+            return ADMIT_AUTH;
+        case BID_REQ:
+        case BUY_NOW_REQ:
+        case PROXY_BID_REQ:
+            return ADMIT_BID;
+        case CHAT_REQ:
+            return ADMIT_CHAT;
+        case SEARCH_ITEM_REQ:
+        case VIEW_HISTORY_REQ:
+            return ADMIT_LOW;
+        case DEPOSIT_REQ:
+        case REDEEM_REQ:
+        case CREATE_ROOM_REQ:
+        case CREATE_ITEM_REQ:
+        case DELETE_ITEM_REQ:
+            return ADMIT_WRITE;
+        case CREATE_ITEMS_REQ:
+            return ADMIT_BULK;
+        default:
+            return ADMIT_READ;
+    }
+}
+
+// === TOKEN BUCKETS ===
+static void fill_buckets(AdmitBuckets* b, const BucketLimit* limits)
+{
+    uint64_t now = now_ns();
+    for (int c = 0; c < ADMIT_CLASS_COUNT; c++) {
+        b->bucket[c].tokens_milli = (int64_t)limits[c].burst * 1000;
+        b->bucket[c].last_ns = now;
+    }
+}
+
+static bool take_token(TokenBucket* tb, const BucketLimit* limit, uint64_t now)
+{
+    if (now > tb->last_ns) {
+        // rate tokens/s = rate milli-tokens/ms
+        int64_t refill = (int64_t)((now - tb->last_ns) / 1000000ull) * limit->rate;
+        if (refill > 0) {
+            int64_t cap = (int64_t)limit->burst * 1000;
+            tb->tokens_milli = tb->tokens_milli + refill > cap ? cap : tb->tokens_milli + refill;
+            // Only advance by whole milliseconds so no refill is lost
+            tb->last_ns += ((now - tb->last_ns) / 1000000ull) * 1000000ull;
+        }
+    }
+    if (tb->tokens_milli < 1000) return false;
+    tb->tokens_milli -= 1000;
+    return true;
+}
+
+void admission_conn_init(AdmitBuckets* b)
+{
+    fill_buckets(b, conn_limits);
+}
+
+int32_t admission_check_conn(AdmitBuckets* b, uint8_t msg_type)
+{
+    AdmitClass cls = admission_classify(msg_type);
+    int32_t status = STATUS_SUCCESS;
+
+    if (cls == ADMIT_LOW && admission_overloaded()) {
+        status = STATUS_OVERLOADED;
+    } else if (!take_token(&b->bucket[cls], &conn_limits[cls], now_ns())) {
+        status = STATUS_RATE_LIMITED;
+    }
+
+    if (status == STATUS_SUCCESS) atomic_fetch_add(&admitted, 1);
+    else if (status == STATUS_OVERLOADED) atomic_fetch_add(&shed[cls], 1);
+    else atomic_fetch_add(&limited_conn[cls], 1);
+    return status;
+}
+
+static void init_shards(void)
+{
+    for (int i = 0; i < ADMIT_USER_SHARDS; i++) {
+        pthread_mutex_init(&user_shards[i].lock, NULL);
+    }
+}
+
+// Free the idle users of one hash bucket; each check advances the shard's
+// cursor, so every bucket is visited once per ADMIT_USER_BUCKETS checks.
+// Caller holds shard->lock; returns the number freed.
+static uint64_t sweep_idle(UserShard* shard, uint64_t now)
+{
+    uint64_t freed = 0;
+    UserBuckets** pp = &shard->buckets[shard->sweep];
+    shard->sweep = (shard->sweep + 1) % ADMIT_USER_BUCKETS;
+    while (*pp) {
+        UserBuckets* u = *pp;
+        if (now - u->last_ns >= (uint64_t)ADMIT_USER_IDLE_MS * 1000000ull) {
+            *pp = u->next;
+            free(u);
+            freed++;
+        } else {
+            pp = &u->next;
+        }
+    }
+    return freed;
+}
+
+int32_t admission_check_user(int32_t user_id, AdmitClass cls)
+{
+    if (user_id <= 0 || cls >= ADMIT_CLASS_COUNT || user_limits[cls].burst == 0) {
+        return STATUS_SUCCESS;
+    }
+    pthread_once(&shards_once, init_shards);
+
+    uint64_t now = now_ns();
+    bool created = false;
+    UserShard* shard = &user_shards[(uint32_t)user_id % ADMIT_USER_SHARDS];
+    pthread_mutex_lock(&shard->lock);
+    uint64_t evicted = sweep_idle(shard, now);
+    UserBuckets** head = &shard->buckets[((uint32_t)user_id / ADMIT_USER_SHARDS) % ADMIT_USER_BUCKETS];
+    UserBuckets* u = *head;
+    while (u && u->user_id != user_id) u = u->next;
+    if (!u) {
+        u = calloc(1, sizeof(*u));
+        if (!u) {
+            // Fail open: a missing bucket is not the client's fault
+            pthread_mutex_unlock(&shard->lock);
+            return STATUS_SUCCESS;
+        }
+        u->user_id = user_id;
+        fill_buckets(&u->b, user_limits);
+        u->next = *head;
+        *head = u;
+        created = true;
+    }
+    u->last_ns = now;
+    bool ok = take_token(&u->b.bucket[cls], &user_limits[cls], now);
+    pthread_mutex_unlock(&shard->lock);
+
+    if (!ok) atomic_fetch_add(&limited_user[cls], 1);
+    if (created) atomic_fetch_add(&user_entries, 1);
+    if (evicted) {
+        atomic_fetch_sub(&user_entries, evicted);
+        atomic_fetch_add(&user_evictions, evicted);
+    }
+    return ok ? STATUS_SUCCESS : STATUS_RATE_LIMITED;
+}
+
+// === OVERLOAD ===
+// Fold `samples` waits of `wait_us` into the EWMA (alpha = 1/8) and flip
+// overload mode when it crosses a threshold
+static void add_samples(uint64_t wait_us, uint64_t samples)
+{
+    uint64_t old = atomic_load(&queue_wait_us);
+    uint64_t avg;
+    do {
+        avg = old;
+        for (uint64_t i = 0; i < samples && avg != wait_us; i++) {
+            avg = avg - avg / 8 + wait_us / 8;
+            if (wait_us == 0 && avg < 8) avg = 0;
+        }
+    } while (!atomic_compare_exchange_weak(&queue_wait_us, &old, avg));
+
+    if (avg > ADMIT_OVERLOAD_ENTER_US && !atomic_exchange(&overloaded, true)) {
+        atomic_fetch_add(&overload_entries, 1);
+        LOG_WARN("admission: entering overload mode (queue wait %llu us)", (unsigned long long)avg);
+    } else if (avg < ADMIT_OVERLOAD_EXIT_US && atomic_exchange(&overloaded, false)) {
+        LOG_INFO("admission: leaving overload mode (queue wait %llu us)", (unsigned long long)avg);
+    }
+}
+
+// While the queue sits empty no job is dequeued, so no wait is reported:
+// count every ADMIT_IDLE_SAMPLE_MS of it as a zero-wait sample. Otherwise
+// shedding LOW requests before they are queued would keep overload on.
+static void decay_idle(void)
+{
+    if (!atomic_load(&queue_idle)) return;
+    uint64_t now = now_ns();
+    uint64_t last = atomic_load(&last_sample_ns);
+    uint64_t period_ns = (uint64_t)ADMIT_IDLE_SAMPLE_MS * 1000000ull;
+    if (now - last < period_ns) return;
+    uint64_t samples = (now - last) / period_ns;
+    // One thread applies each idle period
+    if (!atomic_compare_exchange_strong(&last_sample_ns, &last, last + samples * period_ns)) return;
+    add_samples(0, samples < 64 ? samples : 64);
+}
+
+void admission_record_queue_wait(uint64_t wait_us)
+{
+    atomic_store(&queue_idle, false);
+    atomic_store(&last_sample_ns, now_ns());
+    add_samples(wait_us, 1);
+}
+
+void admission_record_queue_idle(void)
+{
+    if (atomic_exchange(&queue_idle, true)) return;
+    atomic_store(&last_sample_ns, now_ns());
+}
+
+void admission_record_shed(AdmitClass cls)
+{
+    if (cls >= ADMIT_CLASS_COUNT) return;
+    atomic_fetch_add(&shed[cls], 1);
+}
+
+bool admission_overloaded(void)
+{
+    if (atomic_load(&overloaded)) decay_idle();
+    return atomic_load(&overloaded);
+}
+
+void admission_get_stats(AdmissionStats* out)
+{
+    decay_idle();
+    memset(out, 0, sizeof(*out));
+    out->admitted = atomic_load(&admitted);
+    for (int c = 0; c < ADMIT_CLASS_COUNT; c++) {
+        out->limited_conn[c] = atomic_load(&limited_conn[c]);
+        out->limited_user[c] = atomic_load(&limited_user[c]);
+        out->shed[c] = atomic_load(&shed[c]);
+    }
+    out->overload_entries = atomic_load(&overload_entries);
+    out->queue_wait_us = atomic_load(&queue_wait_us);
+    out->user_entries = atomic_load(&user_entries);
+    out->user_evictions = atomic_load(&user_evictions);
+    out->overloaded = atomic_load(&overloaded);
+}
@@ -0,0 +1,86 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Admission Control ==========
+// Token buckets per message class, kept per connection (checked when a
+// frame is submitted to the pipeline) and per user (checked by the services
+// once the user is known, so several connections cannot add up). Requests
+// over the limit get STATUS_RATE_LIMITED.
+//
+// The pipeline reports how long each job waited in the queue. When the
+// smoothed wait crosses ADMIT_OVERLOAD_ENTER_US the server enters overload
+// mode: low-priority requests (search, history) are shed with
+// STATUS_OVERLOADED and chat is delivered but not persisted, until the wait
+// drops below ADMIT_OVERLOAD_EXIT_US. Low-priority jobs that were already
+// queued when overload began are shed by the worker that picks them up.
+// While the workers find the queue empty, every ADMIT_IDLE_SAMPLE_MS
+// counts as a zero wait, so overload ends even if only shed requests come.
+//
+// A user's buckets are freed once idle for ADMIT_USER_IDLE_MS; by then they
+// have refilled, so a user that comes back starts from the same state.
+
+#define ADMIT_OVERLOAD_ENTER_US   200000
+#define ADMIT_OVERLOAD_EXIT_US    50000
+#define ADMIT_IDLE_SAMPLE_MS      10    // ~110 ms of empty queue from ENTER to EXIT
+#define ADMIT_USER_SHARDS         32
+#define ADMIT_USER_BUCKETS        128   // Hash buckets per shard
+#define ADMIT_USER_IDLE_MS        30000 // Longer than any bucket takes to refill
+
+typedef enum {
+    ADMIT_AUTH = 0,     // Login / register / logout
+    ADMIT_BID,          // Bid / buy now
+    ADMIT_CHAT,
+    ADMIT_READ,         // Room / item lists, join / leave
+    ADMIT_WRITE,        // Create / delete, deposit / redeem
+    ADMIT_BULK,         // Frames of a bulk item batch (item_batch.h)
+    ADMIT_LOW,          // Search, history: first to be shed
+    ADMIT_CLASS_COUNT
+} AdmitClass;
+
+typedef struct {
+    int64_t tokens_milli;   // Thousandths of a token
+    uint64_t last_ns;
+} TokenBucket;
+
+typedef struct {
+    TokenBucket bucket[ADMIT_CLASS_COUNT];
+} AdmitBuckets;
+
+AdmitClass admission_classify(uint8_t msg_type);
+
+// Fill a connection's buckets (call once when the connection opens)
+void admission_conn_init(AdmitBuckets* b);
+
+// Returns STATUS_SUCCESS, STATUS_RATE_LIMITED or STATUS_OVERLOADED.
+// `b` is owned by the caller (not thread-safe on its own).
+int32_t admission_check_conn(AdmitBuckets* b, uint8_t msg_type);
+
+// Per-user limit for one class. STATUS_SUCCESS or STATUS_RATE_LIMITED.
+int32_t admission_check_user(int32_t user_id, AdmitClass cls);
+
+// Fed by the pipeline workers with each job's queue wait, and told when
+// they find the queue empty
+void admission_record_queue_wait(uint64_t wait_us);
+void admission_record_queue_idle(void);
+bool admission_overloaded(void);
+// Count a request of `cls` dropped or degraded because of overload
+void admission_record_shed(AdmitClass cls);
+
+typedef struct {
+    uint64_t admitted;
+    uint64_t limited_conn[ADMIT_CLASS_COUNT];
+    uint64_t limited_user[ADMIT_CLASS_COUNT];
+    uint64_t shed[ADMIT_CLASS_COUNT];
+    uint64_t overload_entries;
+    uint64_t queue_wait_us;     // Smoothed
+    uint64_t user_entries;      // Users with buckets in memory
+    uint64_t user_evictions;
+    bool overloaded;
+} AdmissionStats;
+
+void admission_get_stats(AdmissionStats* out);
+
+#endif
@@ -0,0 +1,35 @@
+#include "auction_events.h"
+#include <time.h>
+
+typedef struct {
+    AuctionEventListener fn;
+    void* ctx;
+} Listener;
+
+static Listener listeners[AUCTION_EVENTS_MAX_LISTENERS];
+static int listener_count;
+
+bool auction_events_subscribe(AuctionEventListener fn, void* ctx)
+{
+    if (!fn || listener_count >= AUCTION_EVENTS_MAX_LISTENERS) return false;
+    listeners[listener_count].fn = fn;
+    listeners[listener_count].ctx = ctx;
+    listener_count++;
+    return true;
+}
+
+void auction_events_publish(const AuctionEvent* ev)
+{
+    AuctionEvent stamped = *ev;
+    if (stamped.timestamp_ms == 0) stamped.timestamp_ms = auction_events_now_ms();
+    for (int i = 0; i < listener_count; i++) {
+        listeners[i].fn(&stamped, listeners[i].ctx);
+    }
+}
+
+uint64_t auction_events_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,45 @@
+#ifndef AUCTION_EVENTS_H
+#define AUCTION_EVENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Auction State Events ==========
+// Every change to a room or item that other modules may mirror (delta sync
+// log, caches, statistics) is published here by the service that made it.
+// Listeners run synchronously on the publishing thread and must be quick.
+
+typedef enum {
+    EVENT_ROOM_CREATED,
+    EVENT_ROOM_CLOSED,
+    EVENT_ITEM_CREATED,
+    EVENT_ITEM_ACTIVATED,   // Auction started, amount = remaining seconds
+    EVENT_ITEM_CLOSING,     // 30-second warning, amount = remaining seconds
+    EVENT_ITEM_BID,         // amount = new current price, user_id = bidder
+    EVENT_ITEM_SOLD,        // amount = final price, user_id = winner
+    EVENT_ITEM_UNSOLD,      // Timer ran out without a bid
+    EVENT_ITEM_DELETED,
+    EVENT_ITEM_EXPIRED      // Owner's timer ran out; the node holding the leading bid settles
+} AuctionEventType;
+
+typedef struct {
+    AuctionEventType type;
+    int32_t room_id;
+    int32_t item_id;        // 0 for room events
+    int32_t user_id;
+    int64_t amount;
+    uint64_t timestamp_ms;  // Filled in by auction_events_publish if 0
+    bool remote;            // Relayed from another node (cluster.h), not to be relayed again
+} AuctionEvent;
+
+typedef void (*AuctionEventListener)(const AuctionEvent* ev, void* ctx);
+
+#define AUCTION_EVENTS_MAX_LISTENERS 16
+
+// Subscribe during startup, before worker threads start publishing
+bool auction_events_subscribe(AuctionEventListener fn, void* ctx);
+void auction_events_publish(const AuctionEvent* ev);
+
+uint64_t auction_events_now_ms(void);
+
+#endif
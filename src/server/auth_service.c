@@ -0,0 +1,292 @@
+#include "auth_service.h"
+#include "db_adapter.h"
+#include "ledger.h"
+#include "user_stats.h"
+#include "mem_pool.h"
+#include "protocol_helpers.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <crypt.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define AUTH_WORKER_NICE 5      // Yield the CPU to request threads under load
+
+typedef enum {
+    AUTH_LOGIN = 0,
+    AUTH_REGISTER
+} AuthOp;
+
+typedef struct {
+    AuthOp op;
+    char username[64];
+    char password[64];
+    char email[128];
+    AuthCallback cb;
+    void* ctx;
+    uint64_t queued_us;
+} AuthJob;
+
+static AuthJob queue[AUTH_QUEUE_CAP];
+static uint32_t queue_head;
+static uint32_t queue_len;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_idle = PTHREAD_COND_INITIALIZER;
+static uint32_t busy;           // Jobs taken off the queue, callback not yet returned
+static pthread_t workers[AUTH_HASH_WORKERS];
+static bool running;
+static AuthStats stats;         // Protected by queue_lock
+// Verified against when the username is unknown, so a failed login costs
+// one bcrypt run either way and does not reveal which accounts exist
+static char dummy_hash[AUTH_HASH_MAX];
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Compare without leaking the position of the first mismatch
+static bool const_time_equal(const char* a, const char* b)
+{
+    size_t la = strlen(a), lb = strlen(b);
+    unsigned char diff = (unsigned char)(la != lb);
+    size_t n = la < lb ? la : lb;
+    for (size_t i = 0; i < n; i++) diff |= (unsigned char)(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+// === HASHING ===
+bool auth_hash_password(const char* password, char* out, size_t cap)
+{
+    char salt[CRYPT_GENSALT_OUTPUT_SIZE];
+    if (!crypt_gensalt_rn("$2b$", AUTH_BCRYPT_COST, NULL, 0, salt, sizeof(salt))) {
+        LOG_ERROR("auth: crypt_gensalt failed");
+        return false;
+    }
+
+    struct crypt_data* cd = calloc(1, sizeof(*cd));
+    if (!cd) return false;
+    const char* hash = crypt_rn(password, salt, cd, sizeof(*cd));
+    bool ok = hash && hash[0] == '$' && strlen(hash) < cap;
+    if (ok) memcpy(out, hash, strlen(hash) + 1);
+    explicit_bzero(cd, sizeof(*cd));
+    free(cd);
+    return ok;
+}
+
+bool auth_verify_password(const char* password, const char* stored, bool* needs_rehash)
+{
+    *needs_rehash = false;
+    if (stored[0] != '$') {
+        // Legacy plaintext row
+        bool ok = const_time_equal(password, stored);
+        *needs_rehash = ok;
+        return ok;
+    }
+
+    struct crypt_data* cd = calloc(1, sizeof(*cd));
+    if (!cd) return false;
+    const char* hash = crypt_rn(password, stored, cd, sizeof(*cd));
+    bool ok = hash && hash[0] == '$' && const_time_equal(hash, stored);
+    explicit_bzero(cd, sizeof(*cd));
+    free(cd);
+
+    if (ok) {
+        char prefix[16];
+        snprintf(prefix, sizeof(prefix), "$2b$%02d$", AUTH_BCRYPT_COST);
+        *needs_rehash = strncmp(stored, prefix, strlen(prefix)) != 0;
+    }
+    return ok;
+}
+
+// === WORKERS ===
+static void run_login(const AuthJob* job, AuthResult* result)
+{
+    char stored[AUTH_HASH_MAX];
+    bool rehash = false;
+
+    bool found = db_get_user_credentials(job->username, stored, sizeof(stored),
+                                         &result->user_id, &result->balance);
+    if (!found) snprintf(stored, sizeof(stored), "%s", dummy_hash);
+    if (!auth_verify_password(job->password, stored, &rehash) || !found) {
+        result->status = STATUS_FAIL;
+        result->user_id = 0;
+        result->balance = 0;
+        return;
+    }
+    result->status = STATUS_SUCCESS;
+    ledger_load_user(result->user_id, result->balance);
+    user_stats_load(result->user_id);
+
+    char upgraded[AUTH_HASH_MAX];
+    if (rehash && auth_hash_password(job->password, upgraded, sizeof(upgraded)) &&
+        db_set_password_hash(result->user_id, upgraded)) {
+        pthread_mutex_lock(&queue_lock);
+        stats.rehashed++;
+        pthread_mutex_unlock(&queue_lock);
+    }
+}
+
+static void run_register(const AuthJob* job, AuthResult* result)
+{
+    char hash[AUTH_HASH_MAX];
+    if (!auth_hash_password(job->password, hash, sizeof(hash))) {
+        result->status = STATUS_FAIL;
+        return;
+    }
+    int32_t user_id = db_register_user(job->username, hash, job->email);
+    result->status = user_id > 0 ? STATUS_SUCCESS : STATUS_FAIL;
+    result->user_id = user_id > 0 ? user_id : 0;
+}
+
+static void* worker_main(void* arg)
+{
+    (void)arg;
+    // Per-thread nice value (Linux): hashing loses to request threads for CPU
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), AUTH_WORKER_NICE);
+
+    pthread_mutex_lock(&queue_lock);
+    while (1) {
+        while (running && queue_len == 0) pthread_cond_wait(&queue_ready, &queue_lock);
+        if (!running) break;
+
+        AuthJob job = queue[queue_head];
+        explicit_bzero(&queue[queue_head], sizeof(AuthJob));
+        queue_head = (queue_head + 1) % AUTH_QUEUE_CAP;
+        queue_len--;
+        busy++;
+        uint64_t start = now_us();
+        if (start - job.queued_us > stats.max_queue_wait_us) {
+            stats.max_queue_wait_us = start - job.queued_us;
+        }
+        pthread_mutex_unlock(&queue_lock);
+
+        AuthResult result = { .status = STATUS_FAIL };
+        if (job.op == AUTH_LOGIN) run_login(&job, &result);
+        else run_register(&job, &result);
+        uint64_t elapsed = now_us() - start;
+        explicit_bzero(job.password, sizeof(job.password));
+
+        job.cb(&result, job.ctx);
+
+        pthread_mutex_lock(&queue_lock);
+        if (--busy == 0 && queue_len == 0) pthread_cond_broadcast(&queue_idle);
+        stats.hash_us_total += elapsed;
+        if (job.op == AUTH_REGISTER) {
+            if (result.status == STATUS_SUCCESS) stats.registrations++;
+        } else if (result.status == STATUS_SUCCESS) {
+            stats.logins_ok++;
+        } else {
+            stats.logins_failed++;
+        }
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+static bool submit(AuthOp op, const char* username, const char* password, const char* email,
+                   AuthCallback cb, void* ctx)
+{
+    if (!username || !password || !cb) return false;
+
+    pthread_mutex_lock(&queue_lock);
+    if (!running || queue_len == AUTH_QUEUE_CAP) {
+        stats.rejected_full++;
+        pthread_mutex_unlock(&queue_lock);
+        return false;
+    }
+    AuthJob* job = &queue[(queue_head + queue_len) % AUTH_QUEUE_CAP];
+    job->op = op;
+    snprintf(job->username, sizeof(job->username), "%s", username);
+    snprintf(job->password, sizeof(job->password), "%s", password);
+    snprintf(job->email, sizeof(job->email), "%s", email ? email : "");
+    job->cb = cb;
+    job->ctx = ctx;
+    job->queued_us = now_us();
+    queue_len++;
+    stats.queued++;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    return true;
+}
+
+bool auth_service_login(const char* username, const char* password,
+                        AuthCallback cb, void* ctx)
+{
+    return submit(AUTH_LOGIN, username, password, NULL, cb, ctx);
+}
+
+bool auth_service_register(const char* username, const char* password, const char* email,
+                           AuthCallback cb, void* ctx)
+{
+    if (!email) return false;
+    return submit(AUTH_REGISTER, username, password, email, cb, ctx);
+}
+
+bool auth_service_init(void)
+{
+    // Same cost as real hashes. The password does not matter: an unknown
+    // user fails whatever the verification says.
+    if (!auth_hash_password("unknown-user", dummy_hash, sizeof(dummy_hash))) {
+        LOG_ERROR("auth: failed to create the unknown-user hash");
+        return false;
+    }
+
+    running = true;
+    for (int i = 0; i < AUTH_HASH_WORKERS; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0) {
+            LOG_ERROR("auth: failed to start hashing worker %d", i);
+            return false;
+        }
+    }
+    LOG_INFO("auth: %d hashing workers, bcrypt cost %d", AUTH_HASH_WORKERS, AUTH_BCRYPT_COST);
+    return true;
+}
+
+void auth_service_shutdown(void)
+{
+    pthread_mutex_lock(&queue_lock);
+    running = false;
+    pthread_cond_broadcast(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    for (int i = 0; i < AUTH_HASH_WORKERS; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+bool auth_service_wait_idle(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+
+    pthread_mutex_lock(&queue_lock);
+    int rc = 0;
+    while ((queue_len > 0 || busy > 0) && rc == 0) {
+        rc = pthread_cond_timedwait(&queue_idle, &queue_lock, &deadline);
+    }
+    bool idle = queue_len == 0 && busy == 0;
+    pthread_mutex_unlock(&queue_lock);
+    return idle;
+}
+
+void auth_service_get_stats(AuthStats* out)
+{
+    pthread_mutex_lock(&queue_lock);
+    *out = stats;
+    out->queue_len = queue_len;
+    pthread_mutex_unlock(&queue_lock);
+}
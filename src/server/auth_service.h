@@ -0,0 +1,65 @@
+#ifndef AUTH_SERVICE_H
+#define AUTH_SERVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ========== Auth Service (password hashing pool) ==========
+// Passwords are stored as salted bcrypt hashes. Hashing and verifying is
+// deliberately slow, so LOGIN / REGISTER requests are queued to a small
+// pool of dedicated, lower-priority threads instead of running on the
+// pipeline workers: a login burst fills this queue, not the bid path.
+// When the queue is full the request is refused right away (STATUS_BUSY).
+//
+// Rows still holding a plaintext password (seed data) are accepted once
+// and rehashed in place. A login for an unknown username is checked
+// against a dummy hash of the same cost, so it takes as long as a wrong
+// password.
+
+#define AUTH_HASH_WORKERS    2
+#define AUTH_QUEUE_CAP       256
+#define AUTH_BCRYPT_COST     10     // 2^cost rounds, tens of ms per hash
+#define AUTH_HASH_MAX        128
+
+typedef struct {
+    int32_t status;         // STATUS_SUCCESS / STATUS_FAIL / STATUS_INVALID
+    int32_t user_id;
+    int64_t balance;
+} AuthResult;
+
+// Called on a hashing thread once the request is done; `ctx` is passed through
+typedef void (*AuthCallback)(const AuthResult* result, void* ctx);
+
+bool auth_service_init(void);
+void auth_service_shutdown(void);
+// Wait until queued logins / registrations have run and answered
+bool auth_service_wait_idle(uint32_t timeout_ms);
+
+// Queue a login / registration. Returns false (callback not called) if the
+// queue is full. Logged-in accounts are loaded into the ledger and their
+// auction statistics into user_stats.
+bool auth_service_login(const char* username, const char* password,
+                        AuthCallback cb, void* ctx);
+bool auth_service_register(const char* username, const char* password, const char* email,
+                           AuthCallback cb, void* ctx);
+
+// Synchronous helpers (slow: do not call on a request thread)
+bool auth_hash_password(const char* password, char* out, size_t cap);
+bool auth_verify_password(const char* password, const char* stored, bool* needs_rehash);
+
+typedef struct {
+    uint64_t queued;
+    uint64_t rejected_full;
+    uint64_t logins_ok;
+    uint64_t logins_failed;
+    uint64_t registrations;
+    uint64_t rehashed;          // Plaintext / old-cost hashes upgraded on login
+    uint64_t hash_us_total;     // CPU spent hashing, for the average per request
+    uint64_t max_queue_wait_us;
+    uint32_t queue_len;
+} AuthStats;
+
+void auth_service_get_stats(AuthStats* out);
+
+#endif
@@ -0,0 +1,451 @@
+#include "bid_series.h"
+#include "auction_events.h"
+#include "protocol.h"
+#include "protocol_helpers.h"
+#include "message_dispatch.h"
+#include "network_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define VARINT_MAX 10
+#define TIME_CODE_FAR 3         // 2-bit time code: 0-2 ticks, or look in `gaps`
+
+typedef struct {
+    uint8_t* data;
+    uint32_t len;
+    uint32_t cap;
+} ByteColumn;
+
+typedef struct BidSeries {
+    struct BidSeries* next;
+    int32_t item_id;
+    uint32_t count;
+    uint64_t first_ms;
+    uint64_t last_tick;         // Last bid, in BID_SERIES_TICK_MS ticks
+    int64_t first_price;
+    int64_t last_price;
+    int64_t price_unit;         // Divides every step (0 until the first non-zero step)
+    int64_t run_step;           // Open run of equal steps (VND), not yet in `steps`
+    uint32_t run_len;
+    uint64_t closed_ms;         // 0 while the auction runs
+    ByteColumn times;           // 2-bit tick deltas, four per byte
+    ByteColumn gaps;            // Deltas of TIME_CODE_FAR ticks or more
+    ByteColumn steps;
+} BidSeries;
+
+typedef struct {
+    pthread_mutex_t lock;
+    BidSeries* buckets[BID_SERIES_BUCKETS];
+} SeriesShard;
+
+static SeriesShard shards[BID_SERIES_SHARDS];
+static _Atomic uint32_t series_count;
+static _Atomic uint64_t bid_count, column_bytes, evicted;
+
+#define SHARD_OF(id)  (&shards[(uint32_t)(id) % BID_SERIES_SHARDS])
+#define BUCKET_OF(id) (((uint32_t)(id) / BID_SERIES_SHARDS) % BID_SERIES_BUCKETS)
+
+// === COLUMNS ===
+static bool column_reserve(ByteColumn* c, uint32_t extra)
+{
+    if (c->len + extra <= c->cap) return true;
+    uint32_t cap = c->cap ? c->cap : 32;
+    while (cap < c->len + extra) cap *= 2;
+    uint8_t* grown = realloc(c->data, cap);
+    if (!grown) return false;
+    atomic_fetch_add(&column_bytes, cap - c->cap);
+    c->data = grown;
+    c->cap = cap;
+    return true;
+}
+
+// Give back the slack once a series stops growing
+static void column_shrink(ByteColumn* c)
+{
+    if (c->len == c->cap || c->len == 0) return;
+    uint8_t* fit = realloc(c->data, c->len);
+    if (!fit) return;
+    atomic_fetch_sub(&column_bytes, c->cap - c->len);
+    c->data = fit;
+    c->cap = c->len;
+}
+
+static void column_free(ByteColumn* c)
+{
+    atomic_fetch_sub(&column_bytes, c->cap);
+    free(c->data);
+    memset(c, 0, sizeof(*c));
+}
+
+// Room for VARINT_MAX bytes must have been reserved
+static void put_varint(ByteColumn* c, uint64_t v)
+{
+    while (v >= 0x80) {
+        c->data[c->len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    c->data[c->len++] = (uint8_t)v;
+}
+
+static uint64_t get_varint(const ByteColumn* c, uint32_t* pos)
+{
+    uint64_t v = 0;
+    for (int shift = 0; *pos < c->len && shift < 64; shift += 7) {
+        uint8_t b = c->data[(*pos)++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static uint64_t zigzag(int64_t v)   { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// A run of `len` equal steps: zigzag(step) << 1, with the low bit set when
+// a varint (len - 2) follows; a lone step costs a single varint
+static void put_run(ByteColumn* c, int64_t step, uint64_t len)
+{
+    put_varint(c, zigzag(step) << 1 | (len > 1));
+    if (len > 1) put_varint(c, len - 2);
+}
+
+static int64_t get_run(const ByteColumn* c, uint32_t* pos, uint64_t* len)
+{
+    uint64_t v = get_varint(c, pos);
+    *len = (v & 1) ? get_varint(c, pos) + 2 : 1;
+    return unzigzag(v >> 1);
+}
+
+// Delta `n` (between bid n and n + 1) of a series whose times column has
+// room for one more byte and whose gaps column has room for VARINT_MAX
+static void put_delta(ByteColumn* times, ByteColumn* gaps, uint32_t n, uint64_t delta)
+{
+    uint8_t code = delta < TIME_CODE_FAR ? (uint8_t)delta : TIME_CODE_FAR;
+    if (n % 4 == 0) times->data[times->len++] = 0;
+    times->data[times->len - 1] |= (uint8_t)(code << (2 * (n % 4)));
+    if (code == TIME_CODE_FAR) put_varint(gaps, delta - TIME_CODE_FAR);
+}
+
+static uint64_t get_delta(const ByteColumn* times, const ByteColumn* gaps, uint32_t n,
+                          uint32_t* gap_pos)
+{
+    uint8_t code = (times->data[n / 4] >> (2 * (n % 4))) & 3;
+    return code < TIME_CODE_FAR ? code : get_varint(gaps, gap_pos) + TIME_CODE_FAR;
+}
+
+// === ENCODING (caller holds the shard lock) ===
+// Largest power of ten dividing v (v != 0)
+static int64_t pow10_unit(int64_t v)
+{
+    if (v < 0) v = -v;
+    int64_t unit = 1;
+    while (unit < 1000000000000LL && v % (unit * 10) == 0) unit *= 10;
+    return unit;
+}
+
+// Re-encode the step column in a smaller unit. Rare: only when a bid
+// breaks the pattern of round increments seen so far.
+static bool rescale_steps(BidSeries* s, int64_t unit)
+{
+    int64_t factor = s->price_unit / unit;
+    ByteColumn next = {0};
+    uint32_t pos = 0;
+    while (pos < s->steps.len) {
+        uint64_t len;
+        int64_t step = get_run(&s->steps, &pos, &len);
+        if (!column_reserve(&next, 2 * VARINT_MAX)) {
+            column_free(&next);
+            return false;
+        }
+        put_run(&next, step * factor, len);
+    }
+    column_free(&s->steps);
+    s->steps = next;
+    s->price_unit = unit;
+    return true;
+}
+
+static bool series_append(BidSeries* s, uint64_t ts_ms, int64_t price)
+{
+    uint64_t tick = ts_ms / BID_SERIES_TICK_MS;
+    if (s->count == 0) {
+        s->first_ms = ts_ms;
+        s->last_tick = tick;
+        s->first_price = s->last_price = price;
+        s->count = 1;
+        return true;
+    }
+
+    int64_t step = price - s->last_price;
+    if (step != 0) {
+        if (s->price_unit == 0) {
+            s->price_unit = pow10_unit(step);
+        } else if (step % s->price_unit != 0) {
+            int64_t unit = s->price_unit;
+            while (step % unit != 0) unit /= 10;
+            if (!rescale_steps(s, unit)) return false;
+        }
+    }
+    // Reserve first so the columns never get out of step
+    if (!column_reserve(&s->times, 1) || !column_reserve(&s->gaps, VARINT_MAX) ||
+        !column_reserve(&s->steps, 2 * VARINT_MAX)) {
+        return false;
+    }
+
+    // Relayed bids can arrive slightly out of order: keep time monotonic
+    put_delta(&s->times, &s->gaps, s->count - 1, tick > s->last_tick ? tick - s->last_tick : 0);
+    if (tick > s->last_tick) s->last_tick = tick;
+
+    if (s->run_len > 0 && step == s->run_step) {
+        s->run_len++;
+    } else {
+        if (s->run_len > 0) {
+            int64_t unit = s->price_unit ? s->price_unit : 1;
+            put_run(&s->steps, s->run_step / unit, s->run_len);
+        }
+        s->run_step = step;
+        s->run_len = 1;
+    }
+    s->last_price = price;
+    s->count++;
+    return true;
+}
+
+// Walks a series bid by bid
+typedef struct {
+    const BidSeries* s;
+    uint32_t index;
+    uint32_t gap_pos;
+    uint32_t step_pos;
+    int64_t step;
+    uint64_t repeat_left;
+    uint64_t tick;
+    int64_t price;
+} SeriesCursor;
+
+static void cursor_start(SeriesCursor* c, const BidSeries* s)
+{
+    memset(c, 0, sizeof(*c));
+    c->s = s;
+    c->tick = s->first_ms / BID_SERIES_TICK_MS;
+    c->price = s->first_price;
+}
+
+// Offset of the current bid from the first one, in ms
+static uint64_t cursor_offset(const SeriesCursor* c)
+{
+    if (c->index == 0) return 0;
+    uint64_t ts = c->tick * BID_SERIES_TICK_MS;
+    return ts > c->s->first_ms ? ts - c->s->first_ms : 0;
+}
+
+static bool cursor_next(SeriesCursor* c)
+{
+    const BidSeries* s = c->s;
+    if (c->index + 1 >= s->count) return false;
+    c->tick += get_delta(&s->times, &s->gaps, c->index, &c->gap_pos);
+    if (c->repeat_left == 0) {
+        if (c->step_pos < s->steps.len) {
+            int64_t unit = s->price_unit ? s->price_unit : 1;
+            c->step = get_run(&s->steps, &c->step_pos, &c->repeat_left) * unit;
+        } else {
+            c->step = s->run_step;      // The open run
+            c->repeat_left = s->run_len;
+        }
+    }
+    c->repeat_left--;
+    c->price += c->step;
+    c->index++;
+    return true;
+}
+
+// === SERIES TABLE (caller holds the shard lock) ===
+static BidSeries* find_series(SeriesShard* shard, int32_t item_id)
+{
+    for (BidSeries* s = shard->buckets[BUCKET_OF(item_id)]; s; s = s->next) {
+        if (s->item_id == item_id) return s;
+    }
+    return NULL;
+}
+
+static void free_series(BidSeries* s)
+{
+    column_free(&s->times);
+    column_free(&s->gaps);
+    column_free(&s->steps);
+    free(s);
+    atomic_fetch_sub(&series_count, 1);
+}
+
+static void remove_series(SeriesShard* shard, int32_t item_id)
+{
+    BidSeries** pp = &shard->buckets[BUCKET_OF(item_id)];
+    while (*pp && (*pp)->item_id != item_id) pp = &(*pp)->next;
+    BidSeries* s = *pp;
+    if (!s) return;
+    *pp = s->next;
+    free_series(s);
+}
+
+// Drop the shard's series that ended more than BID_SERIES_RETAIN_SEC ago
+static void sweep_shard(SeriesShard* shard, uint64_t now_ms)
+{
+    uint64_t retain_ms = (uint64_t)BID_SERIES_RETAIN_SEC * 1000;
+    for (int b = 0; b < BID_SERIES_BUCKETS; b++) {
+        BidSeries** pp = &shard->buckets[b];
+        while (*pp) {
+            BidSeries* s = *pp;
+            if (s->closed_ms && s->closed_ms + retain_ms < now_ms) {
+                *pp = s->next;
+                free_series(s);
+                atomic_fetch_add(&evicted, 1);
+            } else {
+                pp = &s->next;
+            }
+        }
+    }
+}
+
+// === EVENTS ===
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    if (ev->item_id <= 0) return;
+    SeriesShard* shard = SHARD_OF(ev->item_id);
+
+    switch (ev->type) {
+        case EVENT_ITEM_BID: {
+            pthread_mutex_lock(&shard->lock);
+            BidSeries* s = find_series(shard, ev->item_id);
+            if (!s && (s = calloc(1, sizeof(*s)))) {
+                s->item_id = ev->item_id;
+                s->next = shard->buckets[BUCKET_OF(ev->item_id)];
+                shard->buckets[BUCKET_OF(ev->item_id)] = s;
+                atomic_fetch_add(&series_count, 1);
+            }
+            if (s && series_append(s, ev->timestamp_ms, ev->amount)) {
+                s->closed_ms = 0;
+                atomic_fetch_add(&bid_count, 1);
+            }
+            pthread_mutex_unlock(&shard->lock);
+            break;
+        }
+        case EVENT_ITEM_SOLD:
+        case EVENT_ITEM_UNSOLD: {
+            pthread_mutex_lock(&shard->lock);
+            BidSeries* s = find_series(shard, ev->item_id);
+            if (s) {
+                s->closed_ms = ev->timestamp_ms;
+                column_shrink(&s->times);
+                column_shrink(&s->gaps);
+                column_shrink(&s->steps);
+            }
+            sweep_shard(shard, ev->timestamp_ms);
+            pthread_mutex_unlock(&shard->lock);
+            break;
+        }
+        case EVENT_ITEM_DELETED:
+            pthread_mutex_lock(&shard->lock);
+            remove_series(shard, ev->item_id);
+            pthread_mutex_unlock(&shard->lock);
+            break;
+        default:
+            break;
+    }
+}
+
+bool bid_series_init(void)
+{
+    for (int i = 0; i < BID_SERIES_SHARDS; i++) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+    return auction_events_subscribe(on_auction_event, NULL);
+}
+
+// === QUERIES ===
+int bid_series_build_history(int32_t item_id, uint32_t resolution_ms, char* out, size_t cap)
+{
+    if (cap < sizeof(PriceHistoryRes) + sizeof(PricePoint)) return -1;
+    uint64_t fit = (cap - sizeof(PriceHistoryRes)) / sizeof(PricePoint);
+
+    PriceHistoryRes head;
+    memset(&head, 0, sizeof(head));
+
+    SeriesShard* shard = SHARD_OF(item_id);
+    pthread_mutex_lock(&shard->lock);
+    BidSeries* s = find_series(shard, item_id);
+    if (!s || s->count == 0) {
+        pthread_mutex_unlock(&shard->lock);
+        return -1;
+    }
+
+    // Widen the buckets until span / resolution + 1 of them fit
+    uint64_t last_ms = s->last_tick * BID_SERIES_TICK_MS;
+    uint64_t span = last_ms > s->first_ms ? last_ms - s->first_ms : 0;
+    uint64_t resolution = resolution_ms > BID_SERIES_TICK_MS ? resolution_ms : BID_SERIES_TICK_MS;
+    if (resolution < span / fit + 1) resolution = span / fit + 1;
+    if (resolution > UINT32_MAX) resolution = UINT32_MAX;
+
+    size_t len = sizeof(head);
+    PricePoint point = {0};
+    uint64_t bucket = 0;
+    SeriesCursor cur;
+    cursor_start(&cur, s);
+    do {
+        uint64_t b = cursor_offset(&cur) / resolution;
+        if (point.bids > 0 && b != bucket) {
+            memcpy(out + len, &point, sizeof(point));
+            len += sizeof(point);
+            head.count++;
+            point.bids = 0;
+        }
+        bucket = b;
+        point.offset_ms = (uint32_t)(b * resolution);
+        point.price = cur.price;
+        point.bids++;
+    } while (cursor_next(&cur));
+    memcpy(out + len, &point, sizeof(point));
+    len += sizeof(point);
+    head.count++;
+
+    head.item_id = (uint32_t)item_id;
+    head.total_bids = s->count;
+    head.first_ts_ms = s->first_ms;
+    head.resolution_ms = (uint32_t)resolution;
+    pthread_mutex_unlock(&shard->lock);
+
+    head.status = STATUS_SUCCESS;
+    snprintf(head.message, sizeof(head.message), "OK");
+    memcpy(out, &head, sizeof(head));
+    return (int)len;
+}
+
+void handle_price_history(int sockfd, const MessageHeader* header, const char* payload)
+{
+    PriceHistoryReq req;
+    if (!decode_PRICE_HISTORY_REQ(payload, header->payload_length, &req)) return;
+
+    char out[BUFF_SIZE];
+    int len = bid_series_build_history((int32_t)req.item_id, req.resolution_ms, out, sizeof(out));
+    if (len < 0) {
+        PriceHistoryRes res;
+        memset(&res, 0, sizeof(res));
+        res.status = STATUS_INVALID;
+        res.item_id = req.item_id;
+        snprintf(res.message, sizeof(res.message), "No bids recorded for this item");
+        send_response(sockfd, PRICE_HISTORY_RES, header->request_id, &res, sizeof(res));
+        return;
+    }
+    send_response(sockfd, PRICE_HISTORY_RES, header->request_id, out, (uint32_t)len);
+}
+
+void bid_series_get_stats(BidSeriesStats* out)
+{
+    out->series = atomic_load(&series_count);
+    out->bids = atomic_load(&bid_count);
+    out->bytes = atomic_load(&column_bytes);
+    out->evicted = atomic_load(&evicted);
+}
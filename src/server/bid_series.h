@@ -0,0 +1,52 @@
+#ifndef BID_SERIES_H
+#define BID_SERIES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ========== Per-Item Bid Time Series ==========
+// Every bid on an item is appended (from EVENT_ITEM_BID) to a compact,
+// columnar series kept in memory while the auction runs and for
+// BID_SERIES_RETAIN_SEC after it ends. PRICE_HISTORY_REQ is answered from
+// here (handle_price_history), downsampled to the requested resolution,
+// without touching the database.
+//
+// Three byte columns per item:
+//   times  time deltas in BID_SERIES_TICK_MS ticks, a 2-bit code per bid
+//          (0-2 ticks, or 3 = see gaps)
+//   gaps   varint deltas of 3 ticks or more
+//   steps  runs of equal price increments (zigzag varint, plus a varint
+//          length for runs longer than one), in units of the largest power
+//          of ten dividing every increment
+// Bids a second or so apart cost a quarter byte of time; a run of minimum
+// increments costs two bytes whatever its length. 10,000 bids at the
+// minimum increment fit in ~2.5 KB, with one bid in five raised further
+// in ~7.5 KB (src/tools/bid_series_bench.c).
+//
+// The series starts with the first bid this node sees (bids placed before
+// a restart are not reloaded).
+
+#define BID_SERIES_SHARDS       32
+#define BID_SERIES_BUCKETS      256     // Hash buckets per shard
+#define BID_SERIES_TICK_MS      1000    // Time resolution of the series
+#define BID_SERIES_RETAIN_SEC   3600    // Kept this long after the auction ends
+
+// Subscribes to auction events; call once at startup
+bool bid_series_init(void);
+
+// Build a PRICE_HISTORY_RES payload (header + points) into `out`. Returns
+// the payload length, or -1 if the item has no series or `cap` cannot hold
+// the header.
+int bid_series_build_history(int32_t item_id, uint32_t resolution_ms, char* out, size_t cap);
+
+typedef struct {
+    uint32_t series;
+    uint64_t bids;
+    uint64_t bytes;             // Encoded columns (allocated)
+    uint64_t evicted;
+} BidSeriesStats;
+
+void bid_series_get_stats(BidSeriesStats* out);
+
+#endif
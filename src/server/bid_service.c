@@ -0,0 +1,160 @@
+#include "bid_service.h"
+#include "ledger.h"
+#include "admission.h"
+#include "auction_events.h"
+#include "db_adapter.h"
+#include "cluster.h"
+#include "protocol_helpers.h"
+#include "utils.h"
+#include <inttypes.h>
+
+static int32_t status_from_ledger(LedgerStatus st)
+{
+    switch (st) {
+        case LEDGER_OK:                 return STATUS_SUCCESS;
+        case LEDGER_INSUFFICIENT_FUNDS: return STATUS_INSUFFICIENT_FUNDS;
+        case LEDGER_OUTBID:             return STATUS_FAIL;
+        case LEDGER_DB_ERROR:           return STATUS_FAIL;
+        default:                        return STATUS_INVALID;
+    }
+}
+
+static void publish(AuctionEventType type, int32_t room_id, int32_t item_id,
+                    int32_t user_id, int64_t amount)
+{
+    AuctionEvent ev = {
+        .type = type, .room_id = room_id, .item_id = item_id,
+        .user_id = user_id, .amount = amount,
+    };
+    auction_events_publish(&ev);
+}
+
+static int32_t place_bid(int32_t room_id, int32_t item_id, int32_t bidder_id,
+                         int64_t bid_amount, bool is_proxy, int64_t* new_price)
+{
+    LedgerHold prev;
+    LedgerStatus st = ledger_place_hold(item_id, bidder_id, bid_amount, BID_MIN_INCREMENT_VND, &prev);
+    if (st != LEDGER_OK) return status_from_ledger(st);
+
+    if (!db_place_bid(item_id, bidder_id, bid_amount, is_proxy, new_price)) {
+        // Price too low or item closed: give the hold back to whoever had it
+        ledger_revert_hold(item_id, bidder_id, bid_amount, &prev);
+        return STATUS_FAIL;
+    }
+    publish(EVENT_ITEM_BID, room_id, item_id, bidder_id, *new_price);
+    return STATUS_SUCCESS;
+}
+
+int32_t bid_service_place(int32_t room_id, int32_t item_id, int32_t bidder_id,
+                          int64_t bid_amount, int64_t* new_price)
+{
+    int32_t admit = admission_check_user(bidder_id, ADMIT_BID);
+    if (admit != STATUS_SUCCESS) return admit;
+    return place_bid(room_id, item_id, bidder_id, bid_amount, false, new_price);
+}
+
+int32_t bid_service_place_proxy(int32_t room_id, int32_t item_id, int32_t bidder_id,
+                                int64_t bid_amount, int64_t* new_price)
+{
+    return place_bid(room_id, item_id, bidder_id, bid_amount, true, new_price);
+}
+
+int32_t bid_service_item_sold(int32_t room_id, int32_t item_id,
+                              int32_t* winner_id, int64_t* final_price)
+{
+    LedgerHold lead;
+    if (!ledger_get_hold(item_id, &lead)) return STATUS_FAIL;
+
+    // Claim the sale before charging: after its expiry timeout the owner
+    // node may already have sold the item from the DB
+    int claimed = db_claim_item_winner(item_id, lead.user_id, lead.amount, "bid");
+    if (claimed == 0) {
+        ledger_release(item_id);
+        return STATUS_FAIL;
+    }
+    LedgerHold won;
+    if (ledger_settle(item_id, "bid_win", &won) != LEDGER_OK) return STATUS_FAIL;
+    if (claimed < 0) {
+        LOG_ERROR("item %d sold to user %d but winner update failed", item_id, won.user_id);
+    }
+    *winner_id = won.user_id;
+    *final_price = won.amount;
+    publish(EVENT_ITEM_SOLD, room_id, item_id, won.user_id, won.amount);
+    return STATUS_SUCCESS;
+}
+
+int32_t bid_service_settle_from_db(int32_t room_id, int32_t item_id,
+                                   int32_t* winner_id, int64_t* final_price)
+{
+    if (!db_get_leading_bid(item_id, winner_id, final_price)) return STATUS_BUSY;
+    if (*winner_id == 0) return STATUS_FAIL;
+
+    int claimed = db_claim_item_winner(item_id, *winner_id, *final_price, "bid");
+    if (claimed < 0) return STATUS_BUSY;
+    if (claimed == 0) return STATUS_SUCCESS;    // The holding node settled it after all
+
+    // No hold to settle here: charge the winner in the DB directly, and
+    // release what the silent node had reserved for the bid
+    BalanceChange debit = {
+        .user_id = *winner_id, .amount_vnd = -*final_price,
+        .held_vnd = cluster_enabled() ? -*final_price : 0,
+        .related_item_id = item_id, .type = "bid_win",
+    };
+    if (!db_apply_balance_changes(&debit, 1)) {
+        LOG_ERROR("item %d sold to user %d but the %" PRId64 " VND debit failed",
+                  item_id, *winner_id, *final_price);
+    }
+    publish(EVENT_ITEM_SOLD, room_id, item_id, *winner_id, *final_price);
+    return STATUS_SUCCESS;
+}
+
+int32_t bid_service_buy_now(int32_t room_id, int32_t item_id, int32_t buyer_id,
+                            int64_t buy_now_price)
+{
+    int32_t admit = admission_check_user(buyer_id, ADMIT_BID);
+    if (admit != STATUS_SUCCESS) return admit;
+
+    // Buy-now is a hold at the buy-now price (releasing the current leader)
+    // that is settled immediately once the DB accepts the sale
+    LedgerHold prev;
+    LedgerStatus st = ledger_place_hold(item_id, buyer_id, buy_now_price, 1, &prev);
+    if (st != LEDGER_OK) return status_from_ledger(st);
+
+    if (!db_buy_now(item_id, buyer_id, buy_now_price)) {
+        ledger_revert_hold(item_id, buyer_id, buy_now_price, &prev);
+        return STATUS_FAIL;
+    }
+    ledger_settle(item_id, "buy_now", NULL);
+    publish(EVENT_ITEM_SOLD, room_id, item_id, buyer_id, buy_now_price);
+    return STATUS_SUCCESS;
+}
+
+// Keep the local ledger in line with bids and sales made on other nodes
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    if (!ev->remote) return;
+
+    int32_t winner_id;
+    int64_t final_price;
+    switch (ev->type) {
+        case EVENT_ITEM_BID:
+            ledger_release_below(ev->item_id, ev->amount);
+            break;
+        case EVENT_ITEM_SOLD:
+        case EVENT_ITEM_DELETED:
+            ledger_release(ev->item_id);
+            break;
+        case EVENT_ITEM_EXPIRED:
+            // No-op unless the leading bid was placed on this node
+            bid_service_item_sold(ev->room_id, ev->item_id, &winner_id, &final_price);
+            break;
+        default:
+            break;
+    }
+}
+
+bool bid_service_init(void)
+{
+    return auction_events_subscribe(on_auction_event, NULL);
+}
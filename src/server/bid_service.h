@@ -0,0 +1,45 @@
+#ifndef BID_SERVICE_H
+#define BID_SERVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Bid / Sale Service ==========
+// Orchestrates the bid path for the request handlers: funds are checked and
+// held in the ledger first (no DB round trip), then db_place_bid validates
+// the price. All functions return a STATUS_* code from protocol_helpers.h;
+// bids and buy-nows over the per-user rate get STATUS_RATE_LIMITED.
+// Successful bids and sales are published as auction events.
+//
+// With several nodes (cluster.h) each node only holds funds for bids it
+// accepted itself: a higher bid on another node releases the local hold,
+// and the node holding the leading bid settles the item when the owner's
+// timer expires (EVENT_ITEM_EXPIRED).
+
+// Subscribes to relayed events; call during startup
+bool bid_service_init(void);
+
+int32_t bid_service_place(int32_t room_id, int32_t item_id, int32_t bidder_id,
+                          int64_t bid_amount, int64_t* new_price);
+
+// Bid placed by the proxy engine on the user's behalf: flagged is_proxy in
+// the bids table and not counted against the user's request rate
+int32_t bid_service_place_proxy(int32_t room_id, int32_t item_id, int32_t bidder_id,
+                                int64_t bid_amount, int64_t* new_price);
+
+// Auction timer expired: charge the leading bidder and mark the item sold.
+// Returns STATUS_FAIL when nobody bid here, or the item was already sold.
+int32_t bid_service_item_sold(int32_t room_id, int32_t item_id,
+                              int32_t* winner_id, int64_t* final_price);
+
+// Fallback when the node holding the leading bid never settled: sell to
+// the highest bid in the DB and charge it there. STATUS_SUCCESS once the
+// item is sold (by this call or already), STATUS_FAIL if nobody bid,
+// STATUS_BUSY if the DB could not be reached.
+int32_t bid_service_settle_from_db(int32_t room_id, int32_t item_id,
+                                   int32_t* winner_id, int64_t* final_price);
+
+int32_t bid_service_buy_now(int32_t room_id, int32_t item_id, int32_t buyer_id,
+                            int64_t buy_now_price);
+
+#endif
@@ -0,0 +1,465 @@
+#include "cluster.h"
+#include "auction_events.h"
+#include "mem_pool.h"
+#include "utils.h"
+#include <libpq-fe.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#define LEASE_BUCKETS 256
+
+typedef struct LeaseRoom {
+    struct LeaseRoom* next;
+    int32_t room_id;
+    bool owned;
+    uint64_t valid_until_ms;    // Monotonic; we stop acting as owner after this
+} LeaseRoom;
+
+static bool enabled;
+static char node_id[CLUSTER_NODE_ID_MAX + 1];
+static char* conninfo_copy;
+static PGconn* listen_conn;
+static PGconn* notify_conn;
+static pthread_t listen_thread, send_thread;
+static volatile bool running;
+static RoomFrameHandler frame_handler;
+
+// Outgoing notifications (text payloads, buf_pool buffers)
+static char* outbox[CLUSTER_OUTBOX_CAP];
+static uint32_t outbox_head;
+static uint32_t outbox_len;
+static pthread_mutex_t outbox_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t outbox_ready = PTHREAD_COND_INITIALIZER;
+
+static LeaseRoom* leases[LEASE_BUCKETS];
+static uint32_t lease_count;
+static pthread_mutex_t lease_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ClusterStats stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void count(uint64_t* counter, uint64_t n)
+{
+    pthread_mutex_lock(&stats_lock);
+    *counter += n;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// === OUTBOX ===
+static bool outbox_push(const char* text)
+{
+    size_t len = strlen(text) + 1;
+    char* copy = buf_pool_alloc(len);
+    if (!copy) return false;
+    memcpy(copy, text, len);
+
+    pthread_mutex_lock(&outbox_lock);
+    if (outbox_len == CLUSTER_OUTBOX_CAP) {
+        pthread_mutex_unlock(&outbox_lock);
+        buf_pool_free(copy);
+        count(&stats.dropped, 1);
+        return false;
+    }
+    outbox[(outbox_head + outbox_len) % CLUSTER_OUTBOX_CAP] = copy;
+    outbox_len++;
+    pthread_cond_signal(&outbox_ready);
+    pthread_mutex_unlock(&outbox_lock);
+    return true;
+}
+
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    if (ev->remote) return;
+
+    char text[160];
+    snprintf(text, sizeof(text), "E|%s|%d|%d|%d|%d|%" PRId64 "|%" PRIu64,
+             node_id, (int)ev->type, ev->room_id, ev->item_id, ev->user_id,
+             ev->amount, ev->timestamp_ms);
+    outbox_push(text);
+}
+
+bool cluster_publish_frame(int32_t room_id, uint8_t msg_type, const char* payload, uint32_t len)
+{
+    if (!enabled) return true;
+
+    // NOTIFY payloads are text and limited to 8000 bytes: hex-encode
+    size_t need = 64 + CLUSTER_NODE_ID_MAX + (size_t)len * 2;
+    if (need > 7900) {
+        count(&stats.dropped, 1);
+        return false;
+    }
+    char* text = buf_pool_alloc(need);
+    if (!text) return false;
+    int n = snprintf(text, need, "F|%s|%d|%u|", node_id, room_id, (unsigned)msg_type);
+    static const char hex[] = "0123456789abcdef";
+    for (uint32_t i = 0; i < len; i++) {
+        text[n++] = hex[(unsigned char)payload[i] >> 4];
+        text[n++] = hex[(unsigned char)payload[i] & 0xF];
+    }
+    text[n] = '\0';
+    bool ok = outbox_push(text);
+    buf_pool_free(text);
+    return ok;
+}
+
+void cluster_set_frame_handler(RoomFrameHandler fn)
+{
+    frame_handler = fn;
+}
+
+// === LEASES ===
+bool cluster_owns_room(int32_t room_id)
+{
+    if (!enabled) return true;
+
+    pthread_mutex_lock(&lease_lock);
+    LeaseRoom** pp = &leases[(uint32_t)room_id % LEASE_BUCKETS];
+    while (*pp && (*pp)->room_id != room_id) pp = &(*pp)->next;
+    LeaseRoom* lr = *pp;
+    if (!lr && lease_count < CLUSTER_LEASE_ROOMS && (lr = calloc(1, sizeof(*lr)))) {
+        lr->room_id = room_id;
+        *pp = lr;
+        lease_count++;
+    }
+    bool owned = lr && lr->owned && mono_ms() < lr->valid_until_ms;
+    pthread_mutex_unlock(&lease_lock);
+    return owned;
+}
+
+// Renew held leases and try to take free / expired ones, in one statement
+static void renew_leases(void)
+{
+    pthread_mutex_lock(&lease_lock);
+    if (lease_count == 0) {
+        pthread_mutex_unlock(&lease_lock);
+        return;
+    }
+    size_t cap = (size_t)lease_count * 12 + 3;
+    char* ids = malloc(cap);
+    if (!ids) {
+        pthread_mutex_unlock(&lease_lock);
+        return;
+    }
+    size_t off = 0;
+    ids[off++] = '{';
+    for (int b = 0; b < LEASE_BUCKETS; b++) {
+        for (LeaseRoom* lr = leases[b]; lr; lr = lr->next) {
+            off += (size_t)snprintf(ids + off, cap - off, "%s%d", off > 1 ? "," : "", lr->room_id);
+        }
+    }
+    ids[off++] = '}';
+    ids[off] = '\0';
+    pthread_mutex_unlock(&lease_lock);
+
+    char ttl[16];
+    snprintf(ttl, sizeof(ttl), "%d", CLUSTER_LEASE_TTL_SEC);
+    const char* params[3] = { node_id, ids, ttl };
+    // Local validity starts before the statement runs, so it always ends
+    // before the DB would let another node take over
+    uint64_t started = mono_ms();
+    PGresult* res = PQexecParams(notify_conn,
+        "INSERT INTO room_leases (room_id, node_id, expires_at) "
+        "SELECT r, $1, now() + make_interval(secs => $3::int) FROM unnest($2::int[]) AS r "
+        "ON CONFLICT (room_id) DO UPDATE SET node_id = EXCLUDED.node_id, expires_at = EXCLUDED.expires_at "
+        "WHERE room_leases.node_id = EXCLUDED.node_id OR room_leases.expires_at < now() "
+        "RETURNING room_id",
+        3, NULL, params, NULL, NULL, 0);
+    free(ids);
+
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        // Leases run out on their own; nothing to undo
+        LOG_ERROR("cluster: lease renewal failed: %s", PQerrorMessage(notify_conn));
+        PQclear(res);
+        return;
+    }
+
+    uint32_t gained = 0, lost = 0, owned = 0;
+    pthread_mutex_lock(&lease_lock);
+    for (int b = 0; b < LEASE_BUCKETS; b++) {
+        for (LeaseRoom* lr = leases[b]; lr; lr = lr->next) {
+            bool now_owned = false;
+            for (int r = 0; r < PQntuples(res) && !now_owned; r++) {
+                now_owned = atoi(PQgetvalue(res, r, 0)) == lr->room_id;
+            }
+            if (now_owned && !lr->owned) gained++;
+            if (!now_owned && lr->owned) lost++;
+            lr->owned = now_owned;
+            if (now_owned) {
+                lr->valid_until_ms = started + (uint64_t)CLUSTER_LEASE_TTL_SEC * 1000 - CLUSTER_LEASE_RENEW_MS;
+                owned++;
+            }
+        }
+    }
+    uint32_t tracked = lease_count;
+    pthread_mutex_unlock(&lease_lock);
+    PQclear(res);
+
+    pthread_mutex_lock(&stats_lock);
+    stats.leases_gained += gained;
+    stats.leases_lost += lost;
+    stats.rooms_owned = owned;
+    stats.rooms_tracked = tracked;
+    pthread_mutex_unlock(&stats_lock);
+    if (gained || lost) {
+        LOG_INFO("cluster: node %s gained %u / lost %u room leases", node_id, gained, lost);
+    }
+}
+
+// === SENDER ===
+static void send_batch(char** batch, int n)
+{
+    // Build a text[] literal; payloads never contain quotes or backslashes
+    size_t cap = 3;
+    for (int i = 0; i < n; i++) cap += strlen(batch[i]) + 3;
+    char* arr = malloc(cap);
+    if (!arr) {
+        count(&stats.dropped, (uint64_t)n);
+        return;
+    }
+    size_t off = 0;
+    arr[off++] = '{';
+    for (int i = 0; i < n; i++) {
+        off += (size_t)snprintf(arr + off, cap - off, "%s\"%s\"", i ? "," : "", batch[i]);
+    }
+    arr[off++] = '}';
+    arr[off] = '\0';
+
+    const char* params[2] = { CLUSTER_CHANNEL, arr };
+    PGresult* res = PQexecParams(notify_conn,
+        "SELECT pg_notify($1, m) FROM unnest($2::text[]) WITH ORDINALITY AS t(m, i) ORDER BY i",
+        2, NULL, params, NULL, NULL, 0);
+    bool ok = PQresultStatus(res) == PGRES_TUPLES_OK;
+    if (!ok) LOG_ERROR("cluster: notify failed: %s", PQerrorMessage(notify_conn));
+    PQclear(res);
+    free(arr);
+
+    pthread_mutex_lock(&stats_lock);
+    if (ok) {
+        stats.sent += (uint64_t)n;
+        stats.send_batches++;
+    } else {
+        stats.send_failures++;
+        stats.dropped += (uint64_t)n;
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void* send_main(void* arg)
+{
+    (void)arg;
+    char* batch[CLUSTER_BATCH_MAX];
+    uint64_t next_renew = 0;
+
+    while (running) {
+        int n = 0;
+        pthread_mutex_lock(&outbox_lock);
+        if (outbox_len == 0 && running) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 100 * 1000000L;
+            if (until.tv_nsec >= 1000000000L) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&outbox_ready, &outbox_lock, &until);
+        }
+        while (outbox_len > 0 && n < CLUSTER_BATCH_MAX) {
+            batch[n++] = outbox[outbox_head];
+            outbox_head = (outbox_head + 1) % CLUSTER_OUTBOX_CAP;
+            outbox_len--;
+        }
+        pthread_mutex_unlock(&outbox_lock);
+
+        if (PQstatus(notify_conn) != CONNECTION_OK) PQreset(notify_conn);
+        if (n > 0) {
+            send_batch(batch, n);
+            for (int i = 0; i < n; i++) buf_pool_free(batch[i]);
+        }
+        if (mono_ms() >= next_renew) {
+            renew_leases();
+            next_renew = mono_ms() + CLUSTER_LEASE_RENEW_MS;
+        }
+    }
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+// === LISTENER ===
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static void handle_notification(const char* text)
+{
+    // "<kind>|<node>|..."
+    if (!text[0] || text[1] != '|') return;
+    const char* node = text + 2;
+    const char* rest = strchr(node, '|');
+    if (!rest) return;
+    if ((size_t)(rest - node) == strlen(node_id) && strncmp(node, node_id, (size_t)(rest - node)) == 0) {
+        return;     // Our own notification
+    }
+    rest++;
+
+    if (text[0] == 'E') {
+        AuctionEvent ev;
+        memset(&ev, 0, sizeof(ev));
+        int type;
+        if (sscanf(rest, "%d|%d|%d|%d|%" SCNd64 "|%" SCNu64, &type, &ev.room_id, &ev.item_id,
+                   &ev.user_id, &ev.amount, &ev.timestamp_ms) != 6) {
+            return;
+        }
+        ev.type = (AuctionEventType)type;
+        ev.remote = true;
+        count(&stats.received, 1);
+        auction_events_publish(&ev);
+    } else if (text[0] == 'F' && frame_handler) {
+        int room_id;
+        unsigned msg_type;
+        int consumed = 0;
+        if (sscanf(rest, "%d|%u|%n", &room_id, &msg_type, &consumed) != 2 || consumed == 0) return;
+        const char* hex = rest + consumed;
+        size_t len = strlen(hex) / 2;
+        char* payload = buf_pool_alloc(len ? len : 1);
+        if (!payload) return;
+        for (size_t i = 0; i < len; i++) {
+            int hi = hex_value(hex[2 * i]), lo = hex_value(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) {
+                buf_pool_free(payload);
+                return;
+            }
+            payload[i] = (char)(hi << 4 | lo);
+        }
+        count(&stats.received, 1);
+        frame_handler(room_id, (uint8_t)msg_type, payload, (uint32_t)len);
+        buf_pool_free(payload);
+    }
+}
+
+static bool start_listening(void)
+{
+    PGresult* res = PQexec(listen_conn, "LISTEN " CLUSTER_CHANNEL);
+    bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    PQclear(res);
+    return ok;
+}
+
+static void* listen_main(void* arg)
+{
+    (void)arg;
+    while (running) {
+        if (PQstatus(listen_conn) != CONNECTION_OK) {
+            PQreset(listen_conn);
+            if (PQstatus(listen_conn) != CONNECTION_OK || !start_listening()) {
+                sleep(1);
+                continue;
+            }
+            LOG_WARN("cluster: listen connection re-established (notifications may have been missed)");
+        }
+
+        struct pollfd pfd = { .fd = PQsocket(listen_conn), .events = POLLIN };
+        int ready = poll(&pfd, 1, 250);
+        if (ready < 0 && errno != EINTR) {
+            sleep(1);
+            continue;
+        }
+        if (ready <= 0) continue;
+        if (!PQconsumeInput(listen_conn)) continue;
+
+        PGnotify* note;
+        while ((note = PQnotifies(listen_conn)) != NULL) {
+            handle_notification(note->extra);
+            PQfreemem(note);
+        }
+    }
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+// === LIFECYCLE ===
+bool cluster_init(const char* conninfo, const char* id)
+{
+    if (!conninfo || !id || !id[0] || strlen(id) > CLUSTER_NODE_ID_MAX) return false;
+    for (const char* p = id; *p; p++) {
+        // Keeps the NOTIFY text format unambiguous
+        if (!isalnum((unsigned char)*p) && *p != '-' && *p != '_' && *p != '.' && *p != ':') {
+            fprintf(stderr, "Invalid node id '%s'\n", id);
+            return false;
+        }
+    }
+    snprintf(node_id, sizeof(node_id), "%s", id);
+    conninfo_copy = strdup(conninfo);
+
+    listen_conn = PQconnectdb(conninfo);
+    notify_conn = PQconnectdb(conninfo);
+    if (PQstatus(listen_conn) != CONNECTION_OK || PQstatus(notify_conn) != CONNECTION_OK ||
+        !start_listening()) {
+        fprintf(stderr, "Cluster connection failed: %s\n", PQerrorMessage(listen_conn));
+        PQfinish(listen_conn);
+        PQfinish(notify_conn);
+        listen_conn = notify_conn = NULL;
+        return false;
+    }
+    if (!auction_events_subscribe(on_auction_event, NULL)) return false;
+
+    enabled = true;
+    running = true;
+    if (pthread_create(&listen_thread, NULL, listen_main, NULL) != 0 ||
+        pthread_create(&send_thread, NULL, send_main, NULL) != 0) {
+        running = false;
+        return false;
+    }
+    LOG_INFO("cluster: node %s listening on channel %s", node_id, CLUSTER_CHANNEL);
+    return true;
+}
+
+void cluster_shutdown(void)
+{
+    if (!enabled) return;
+    running = false;
+    pthread_mutex_lock(&outbox_lock);
+    pthread_cond_broadcast(&outbox_ready);
+    pthread_mutex_unlock(&outbox_lock);
+    pthread_join(send_thread, NULL);
+    pthread_join(listen_thread, NULL);
+    PQfinish(listen_conn);
+    PQfinish(notify_conn);
+    free(conninfo_copy);
+    enabled = false;
+}
+
+bool cluster_enabled(void)
+{
+    return enabled;
+}
+
+const char* cluster_node_id(void)
+{
+    return enabled ? node_id : "local";
+}
+
+void cluster_get_stats(ClusterStats* out)
+{
+    pthread_mutex_lock(&stats_lock);
+    *out = stats;
+    pthread_mutex_unlock(&stats_lock);
+}
@@ -0,0 +1,63 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ========== Multi-Node Cluster (Postgres LISTEN/NOTIFY) ==========
+// Several server processes can share one database. Each node relays its
+// auction events and room broadcast frames (BID_NOTIFY, ITEM_SOLD,
+// CHAT_NOTIFY, TIMER_UPDATE, ...) on one NOTIFY channel and re-publishes
+// what the other nodes send, so mirrors (delta sync, caches, stats) and
+// room members on every node see every change.
+//
+// Each room is run by exactly one node at a time: the holder of its row in
+// room_leases. The owner runs the room's item timer and proxy bidding;
+// leases are renewed every CLUSTER_LEASE_RENEW_MS and taken over by another
+// node once they have been expired for CLUSTER_LEASE_TTL_SEC.
+//
+// Without cluster_init (single node) every room is owned locally.
+
+#define CLUSTER_CHANNEL           "auction_cluster"
+#define CLUSTER_NODE_ID_MAX       32
+#define CLUSTER_LEASE_TTL_SEC     5
+#define CLUSTER_LEASE_RENEW_MS    1000
+#define CLUSTER_LEASE_ROOMS       1024  // Rooms a node tracks leases for
+#define CLUSTER_OUTBOX_CAP        4096
+#define CLUSTER_BATCH_MAX         64    // Notifications per round trip
+
+// Delivers a frame relayed from another node to this node's members of the room
+typedef void (*RoomFrameHandler)(int32_t room_id, uint8_t msg_type,
+                                 const char* payload, uint32_t len);
+
+// Opens the listen / notify connections and starts the cluster threads.
+// `node_id` must be unique per process.
+bool cluster_init(const char* conninfo, const char* node_id);
+void cluster_shutdown(void);
+bool cluster_enabled(void);
+const char* cluster_node_id(void);
+
+// Relay a frame sent to a room's members on this node to the other nodes
+bool cluster_publish_frame(int32_t room_id, uint8_t msg_type, const char* payload, uint32_t len);
+void cluster_set_frame_handler(RoomFrameHandler fn);
+
+// Whether this node currently holds the room's lease. The first call for a
+// room registers interest; the lease is acquired in the background.
+bool cluster_owns_room(int32_t room_id);
+
+typedef struct {
+    uint64_t sent;
+    uint64_t received;
+    uint64_t dropped;           // Outbox full or payload too large
+    uint64_t send_batches;
+    uint64_t send_failures;
+    uint32_t rooms_owned;
+    uint32_t rooms_tracked;
+    uint64_t leases_gained;
+    uint64_t leases_lost;
+} ClusterStats;
+
+void cluster_get_stats(ClusterStats* out);
+
+#endif
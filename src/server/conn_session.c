@@ -0,0 +1,61 @@
+#include "conn_session.h"
+#include <string.h>
+#include <pthread.h>
+
+static ConnSession sessions[CONN_SESSION_MAX_FDS];
+static pthread_mutex_t locks[CONN_SESSION_STRIPES] = {
+    [0 ... CONN_SESSION_STRIPES - 1] = PTHREAD_MUTEX_INITIALIZER
+};
+
+#define LOCK_OF(fd) (&locks[(unsigned)(fd) % CONN_SESSION_STRIPES])
+
+static bool valid_fd(int sockfd)
+{
+    return sockfd >= 0 && sockfd < CONN_SESSION_MAX_FDS;
+}
+
+void conn_session_login(int sockfd, int32_t user_id, const char* session_token)
+{
+    if (!valid_fd(sockfd)) return;
+    pthread_mutex_lock(LOCK_OF(sockfd));
+    ConnSession* s = &sessions[sockfd];
+    s->user_id = user_id;
+    s->room_id = 0;
+    memset(s->session_token, 0, sizeof(s->session_token));
+    if (session_token) strncpy(s->session_token, session_token, sizeof(s->session_token) - 1);
+    pthread_mutex_unlock(LOCK_OF(sockfd));
+}
+
+void conn_session_join_room(int sockfd, int32_t room_id)
+{
+    if (!valid_fd(sockfd)) return;
+    pthread_mutex_lock(LOCK_OF(sockfd));
+    sessions[sockfd].room_id = room_id;
+    pthread_mutex_unlock(LOCK_OF(sockfd));
+}
+
+void conn_session_clear(int sockfd)
+{
+    if (!valid_fd(sockfd)) return;
+    pthread_mutex_lock(LOCK_OF(sockfd));
+    memset(&sessions[sockfd], 0, sizeof(ConnSession));
+    pthread_mutex_unlock(LOCK_OF(sockfd));
+}
+
+bool conn_session_get(int sockfd, ConnSession* out)
+{
+    if (!valid_fd(sockfd)) return false;
+    pthread_mutex_lock(LOCK_OF(sockfd));
+    *out = sessions[sockfd];
+    pthread_mutex_unlock(LOCK_OF(sockfd));
+    return out->user_id != 0;
+}
+
+void conn_session_set(int sockfd, const ConnSession* session)
+{
+    if (!valid_fd(sockfd)) return;
+    pthread_mutex_lock(LOCK_OF(sockfd));
+    sessions[sockfd] = *session;
+    sessions[sockfd].session_token[CONN_SESSION_TOKEN_LEN - 1] = '\0';
+    pthread_mutex_unlock(LOCK_OF(sockfd));
+}
@@ -0,0 +1,32 @@
+#ifndef CONN_SESSION_H
+#define CONN_SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Per-Connection Session ==========
+// Who is logged in on a socket and which room it has joined. The LOGIN /
+// LOGOUT and JOIN_ROOM / LEAVE_ROOM handlers record it here; room broadcasts
+// and the zero-downtime restart (hot_upgrade.h) read it back. Entries are
+// indexed by fd and cleared when the connection opens and closes.
+
+#define CONN_SESSION_MAX_FDS     65536
+#define CONN_SESSION_STRIPES     64
+#define CONN_SESSION_TOKEN_LEN   64      // LoginRes.session_token
+
+typedef struct {
+    int32_t user_id;            // 0 = not logged in
+    int32_t room_id;            // 0 = not in a room
+    char session_token[CONN_SESSION_TOKEN_LEN];
+} ConnSession;
+
+void conn_session_login(int sockfd, int32_t user_id, const char* session_token);
+void conn_session_join_room(int sockfd, int32_t room_id);   // 0 = left the room
+void conn_session_clear(int sockfd);                         // Logout / open / close
+
+// False if nobody is logged in on the socket
+bool conn_session_get(int sockfd, ConnSession* out);
+// Restore a session handed over by the previous process
+void conn_session_set(int sockfd, const ConnSession* session);
+
+#endif
@@ -4,62 +4,271 @@
 #include <string.h>
 #include <time.h>
 #include <inttypes.h>
+#include <pthread.h>
+
+// Replica lag in ms; 0 when it has replayed everything it received (an idle
+// primary would otherwise look more and more behind) or is not a standby
+#define REPLICA_LAG_SQL \
+    "SELECT CASE WHEN NOT pg_is_in_recovery() " \
+    "OR pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 " \
+    "ELSE COALESCE((EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000)::bigint, " \
+    "2147483647) END"
+
+typedef struct DbPool DbPool;
+
+typedef struct {
+    Database db;                // First member: the Database* handed to callers
+    DbPool* pool;
+    bool busy;
+    bool needs_setup;           // Reconnected, but the pool's settings are not applied yet
+    uint64_t retry_ms;          // No reconnect attempt before this after a failure
+    uint64_t lag_ms;            // Replica lag at the last check
+    uint64_t checked_ms;        // When it was checked (0 = never)
+} PoolSlot;
+
+struct DbPool {
+    PoolSlot slots[DB_POOL_MAX];
+    int size;
+    const char* setup_sql;      // Session settings, re-applied after every reconnect
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+};
+
+static DbPool primary = { .lock = PTHREAD_MUTEX_INITIALIZER, .available = PTHREAD_COND_INITIALIZER };
+static DbPool replica = { .lock = PTHREAD_MUTEX_INITIALIZER, .available = PTHREAD_COND_INITIALIZER };
+static uint32_t replica_max_lag_ms;
+static DbStats stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// === CONNECTION POOLS ===
+// A libpq connection serves one thread at a time: every query (or BEGIN ..
+// COMMIT sequence) runs on a connection taken from a pool for its duration
+// Apply the pool's session settings to a fresh connection
+static bool slot_setup(PoolSlot* s)
+{
+    if (!s->pool->setup_sql) return true;
+    PGresult* res = PQexec(s->db.conn, s->pool->setup_sql);
+    bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) fprintf(stderr, "DB session setup failed: %s\n", PQerrorMessage(s->db.conn));
+    PQclear(res);
+    return ok;
+}
+
+static bool pool_open(DbPool* pool, const char* conninfo, int size, const char* setup_sql)
+{
+    if (size > DB_POOL_MAX) size = DB_POOL_MAX;
+    pool->setup_sql = setup_sql;
+    for (int i = 0; i < size; i++) {
+        PoolSlot* s = &pool->slots[i];
+        s->pool = pool;
+        s->db.conn = PQconnectdb(conninfo);
+        bool ok = PQstatus(s->db.conn) == CONNECTION_OK;
+        if (!ok) fprintf(stderr, "DB Connection failed: %s\n", PQerrorMessage(s->db.conn));
+        if (!ok || !slot_setup(s)) {
+            for (int j = 0; j <= i; j++) {
+                PQfinish(pool->slots[j].db.conn);
+                pool->slots[j].db.conn = NULL;
+            }
+            return false;
+        }
+    }
+    pool->size = size;
+    return true;
+}
+
+static void pool_close(DbPool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->size; i++) {
+        PQfinish(pool->slots[i].db.conn);
+        pool->slots[i].db.conn = NULL;
+    }
+    pool->size = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
 
-static Database db = {0};
+// Reconnect a broken connection, at most once per DB_RECONNECT_MS. PQreset
+// opens a new session, so the pool's settings are applied again; a replica
+// connection that is not read-only is never handed out.
+static bool slot_connected(PoolSlot* s)
+{
+    if (PQstatus(s->db.conn) == CONNECTION_OK && !s->needs_setup) return true;
+    uint64_t now = mono_ms();
+    if (now < s->retry_ms) return false;
+    if (PQstatus(s->db.conn) != CONNECTION_OK) {
+        PQreset(s->db.conn);
+        s->needs_setup = true;
+    }
+    if (PQstatus(s->db.conn) == CONNECTION_OK && slot_setup(s)) {
+        s->needs_setup = false;
+        s->checked_ms = 0;
+        return true;
+    }
+    s->retry_ms = now + DB_RECONNECT_MS;
+    return false;
+}
+
+static void db_release(Database* db)
+{
+    PoolSlot* s = (PoolSlot*)db;
+    pthread_mutex_lock(&s->pool->lock);
+    s->busy = false;
+    pthread_cond_signal(&s->pool->available);
+    pthread_mutex_unlock(&s->pool->lock);
+}
+
+// Waits for a free connection; NULL if the pool is not open or the
+// connection is down
+static Database* db_acquire(DbPool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    PoolSlot* s = NULL;
+    bool waited = false;
+    while (pool->size > 0) {
+        for (int i = 0; i < pool->size && !s; i++) {
+            if (!pool->slots[i].busy) s = &pool->slots[i];
+        }
+        if (s) break;
+        waited = true;
+        pthread_cond_wait(&pool->available, &pool->lock);
+    }
+    if (s) s->busy = true;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (waited && pool == &primary) {
+        pthread_mutex_lock(&stats_lock);
+        stats.primary_waits++;
+        pthread_mutex_unlock(&stats_lock);
+    }
+    if (!s) return NULL;
+    if (!slot_connected(s)) {
+        db_release(&s->db);
+        return NULL;
+    }
+    return &s->db;
+}
+
+// Whether the replica behind `s` is within the lag tolerance. The lag is
+// re-measured only once the last measurement plus the time since could
+// exceed it.
+static bool replica_fresh(PoolSlot* s)
+{
+    uint64_t now = mono_ms();
+    if (s->checked_ms && s->lag_ms + (now - s->checked_ms) <= replica_max_lag_ms) return true;
+
+    PGresult* res = PQexec(s->db.conn, REPLICA_LAG_SQL);
+    bool ok = PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) == 1;
+    if (ok) {
+        s->lag_ms = strtoull(PQgetvalue(res, 0, 0), NULL, 10);
+        s->checked_ms = now;
+    }
+    PQclear(res);
+
+    pthread_mutex_lock(&stats_lock);
+    stats.replica_lag_checks++;
+    if (ok) stats.replica_lag_ms = s->lag_ms;
+    pthread_mutex_unlock(&stats_lock);
+    return ok && s->lag_ms <= replica_max_lag_ms;
+}
+
+// Connection for a read-only query: a replica connection when allowed and
+// fresh enough, the primary otherwise
+static Database* db_acquire_read(DbReadRoute route)
+{
+    if (route == DB_READ_REPLICA && replica.size > 0) {
+        Database* db = db_acquire(&replica);
+        bool fresh = db && replica_fresh((PoolSlot*)db);
+
+        pthread_mutex_lock(&stats_lock);
+        if (fresh) stats.replica_reads++;
+        else stats.replica_fallbacks++;
+        pthread_mutex_unlock(&stats_lock);
+        if (fresh) return db;
+        if (db) db_release(db);
+    }
+    return db_acquire(&primary);
+}
 
 bool db_init(const char* conninfo)
 {
-    db.conn = PQconnectdb(conninfo);
-    if (PQstatus(db.conn) != CONNECTION_OK) {
-        fprintf(stderr, "DB Connection failed: %s\n", PQerrorMessage(db.conn));
-        PQfinish(db.conn);
-        db.conn = NULL;
+    if (!pool_open(&primary, conninfo, DB_PRIMARY_POOL_SIZE, NULL)) return false;
+    fprintf(stdout, "Database connected successfully\n");
+    return true;
+}
+
+bool db_init_replica(const char* conninfo, uint32_t max_lag_ms)
+{
+    // Read-only sessions: a misrouted write fails instead of diverging
+    if (!pool_open(&replica, conninfo, DB_REPLICA_POOL_SIZE,
+                   "SET default_transaction_read_only = on")) {
         return false;
     }
-    fprintf(stdout, "Database connected successfully\n");
+    replica_max_lag_ms = max_lag_ms;
+    fprintf(stdout, "Read replica connected (max lag %u ms)\n", max_lag_ms);
     return true;
 }
 
 void db_cleanup(void)
 {
-    if (db.conn) {
-        PQfinish(db.conn);
-        db.conn = NULL;
-    }
+    pool_close(&replica);
+    pool_close(&primary);
+}
+
+void db_get_stats(DbStats* out)
+{
+    pthread_mutex_lock(&stats_lock);
+    *out = stats;
+    pthread_mutex_unlock(&stats_lock);
 }
 
 // === USER OPERATIONS ===
 int32_t db_register_user(const char* username, const char* password_hash, const char* email)
 {
-    if (!db.conn || !username || !password_hash || !email) return -1;
+    if (!username || !password_hash || !email) return -1;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return -1;
 
     const char* paramValues[3] = { username, password_hash, email };
-    PGresult* res = PQexecParams(db.conn,
+    PGresult* res = PQexecParams(db->conn,
         "INSERT INTO users (username, password_hash, email, balance) "
         "VALUES ($1, $2, $3, 0) RETURNING user_id",
         3, NULL, paramValues, NULL, NULL, 0);
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
-        fprintf(stderr, "Register failed: %s\n", PQerrorMessage(db.conn));
+        fprintf(stderr, "Register failed: %s\n", PQerrorMessage(db->conn));
         PQclear(res);
+        db_release(db);
         return -1;
     }
     int32_t user_id = atoi(PQgetvalue(res, 0, 0));
     PQclear(res);
+    db_release(db);
     return user_id;
 }
 
 int32_t db_login_user(const char* username, const char* password_hash, int32_t* user_id, int64_t* balance)
 {
-    if (!db.conn || !username || !password_hash) return 0;
+    if (!username || !password_hash) return 0;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return 0;
 
     const char* paramValues[2] = { username, password_hash };
-    PGresult* res = PQexecParams(db.conn,
+    PGresult* res = PQexecParams(db->conn,
         "SELECT user_id, balance FROM users WHERE username=$1 AND password_hash=$2",
         2, NULL, paramValues, NULL, NULL, 0);
 
     if (PQntuples(res) == 0) {
         PQclear(res);
+        db_release(db);
         return 0; // fail
     }
     *user_id = atoi(PQgetvalue(res, 0, 0));
@@ -73,38 +282,98 @@ int32_t db_login_user(const char* username, const char* password_hash, int32_t*
     // Note: schema doesn't have last_login column, so we skip this update
     // PQexecParams(db.conn, "UPDATE users SET last_login=CURRENT_TIMESTAMP WHERE user_id=$1",
     //              1, NULL, uid_param, NULL, NULL, 0);
+    db_release(db);
     return 1; // success
 }
 
+bool db_get_user_credentials(const char* username, char* hash_out, size_t hash_cap,
+                             int32_t* user_id, int64_t* balance)
+{
+    if (!username || !hash_out || hash_cap == 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    const char* paramValues[1] = { username };
+    PGresult* res = PQexecParams(db->conn,
+        "SELECT user_id, balance, password_hash FROM users WHERE username=$1",
+        1, NULL, paramValues, NULL, NULL, 0);
+
+    if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
+        PQclear(res);
+        db_release(db);
+        return false;
+    }
+    *user_id = atoi(PQgetvalue(res, 0, 0));
+    *balance = atoll(PQgetvalue(res, 0, 1));
+    snprintf(hash_out, hash_cap, "%s", PQgetvalue(res, 0, 2));
+    PQclear(res);
+    db_release(db);
+    return true;
+}
+
+bool db_set_password_hash(int32_t user_id, const char* password_hash)
+{
+    if (user_id <= 0 || !password_hash) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    char uid_str[32];
+    snprintf(uid_str, sizeof(uid_str), "%d", user_id);
+    const char* paramValues[2] = { password_hash, uid_str };
+    PGresult* res = PQexecParams(db->conn,
+        "UPDATE users SET password_hash=$1 WHERE user_id=$2",
+        2, NULL, paramValues, NULL, NULL, 0);
+
+    bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
+    if (!success) fprintf(stderr, "Set password hash failed: %s\n", PQerrorMessage(db->conn));
+    PQclear(res);
+    db_release(db);
+    return success;
+}
+
 bool db_update_balance(int32_t user_id, int64_t amount_change)
 {
-    if (!db.conn || user_id <= 0) return false;
+    if (user_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     char uid_str[32], amt_str[64];
     snprintf(uid_str, sizeof(uid_str), "%d", user_id);
     snprintf(amt_str, sizeof(amt_str), "%" PRId64, amount_change);
 
     const char* paramValues[2] = { amt_str, uid_str };
-    PGresult* res = PQexecParams(db.conn,
+    PGresult* res = PQexecParams(db->conn,
         "UPDATE users SET balance = balance + $1 WHERE user_id = $2 AND balance + $1 >= 0 "
         "RETURNING user_id",
         2, NULL, paramValues, NULL, NULL, 0);
 
     bool success = (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0);
     PQclear(res);
+    db_release(db);
     return success;
 }
 
 bool db_get_user_balance(int32_t user_id, int64_t* balance)
 {
-    if (!db.conn || user_id <= 0) return false;
+    if (user_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     char query[128];
     snprintf(query, sizeof(query), "SELECT balance FROM users WHERE user_id = %d", user_id);
-    PGresult* res = PQexec(db.conn, query);
-    if (PQntuples(res) == 0) { PQclear(res); return false; }
+    PGresult* res = PQexec(db->conn, query);
+    if (PQntuples(res) == 0) {
+        PQclear(res);
+        db_release(db);
+        return false;
+    }
     *balance = atoll(PQgetvalue(res, 0, 0));
     PQclear(res);
+    db_release(db);
     return true;
 }
 
@@ -112,7 +381,10 @@ bool db_get_user_balance(int32_t user_id, int64_t* balance)
 int32_t db_create_room(const char* name, const char* desc, int32_t creator_id,
                        uint64_t start_time, uint64_t end_time)
 {
-    if (!db.conn || !name || creator_id <= 0) return -1;
+    if (!name || creator_id <= 0) return -1;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return -1;
 
     char start_str[32], end_str[32], creator_str[32];
     snprintf(start_str, sizeof(start_str), "%" PRIu64, start_time);
@@ -120,48 +392,120 @@ int32_t db_create_room(const char* name, const char* desc, int32_t creator_id,
     snprintf(creator_str, sizeof(creator_str), "%d", creator_id);
 
     const char* paramValues[5] = { name, desc ? desc : "", start_str, end_str, creator_str };
-    PGresult* res = PQexecParams(db.conn,
-        "INSERT INTO \"AuctionRoom\" (name, description, start_time, end_time, creator_id, status) "
+    PGresult* res = PQexecParams(db->conn,
+        "INSERT INTO auction_rooms (room_name, description, start_time, end_time, created_by, status) "
         "VALUES ($1, $2, to_timestamp($3), to_timestamp($4), $5, 'active') RETURNING room_id",
         5, NULL, paramValues, NULL, NULL, 0);
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
-        fprintf(stderr, "Create room failed: %s\n", PQerrorMessage(db.conn));
+        fprintf(stderr, "Create room failed: %s\n", PQerrorMessage(db->conn));
         PQclear(res);
+        db_release(db);
         return -1;
     }
     int32_t id = atoi(PQgetvalue(res, 0, 0));
     PQclear(res);
+    db_release(db);
     return id;
 }
 
-bool db_get_active_rooms(PGresult** res)
+bool db_get_active_rooms(DbReadRoute route, PGresult** res)
 {
-    if (!db.conn) return false;
-    *res = PQexec(db.conn,
-        "SELECT room_id, name, description FROM \"AuctionRoom\" WHERE status='active' "
+    Database* db = db_acquire_read(route);
+    if (!db) return false;
+    *res = PQexec(db->conn,
+        "SELECT room_id, room_name, description FROM auction_rooms WHERE status='active' "
         "ORDER BY room_id");
+    db_release(db);
     return (PQresultStatus(*res) == PGRES_TUPLES_OK);
 }
 
-bool db_get_room_items(int32_t room_id, PGresult** res)
+bool db_get_room_items(int32_t room_id, DbReadRoute route, PGresult** res)
 {
-    if (!db.conn || room_id <= 0) return false;
+    if (room_id <= 0) return false;
+
+    Database* db = db_acquire_read(route);
+    if (!db) return false;
 
     char query[256];
     snprintf(query, sizeof(query),
-        "SELECT item_id, name, starting_price, current_price, buy_now_price, status, "
-        "seller_id, queue_position FROM \"Item\" WHERE room_id=%d ORDER BY queue_position",
+        "SELECT item_id, item_name, starting_price, current_price, buy_now_price, status, "
+        "created_by, queue_position FROM auction_items WHERE room_id=%d ORDER BY queue_position",
         room_id);
-    *res = PQexec(db.conn, query);
+    *res = PQexec(db->conn, query);
+    db_release(db);
+    return (PQresultStatus(*res) == PGRES_TUPLES_OK);
+}
+
+// Format ids as a Postgres array literal: {1,2,3}
+static char* format_id_array(const int32_t* ids, int count)
+{
+    size_t cap = (size_t)count * 12 + 3;
+    char* buf = malloc(cap);
+    if (!buf) return NULL;
+    size_t len = 0;
+    buf[len++] = '{';
+    for (int i = 0; i < count; i++) {
+        len += snprintf(buf + len, cap - len, "%s%d", i ? "," : "", ids[i]);
+    }
+    snprintf(buf + len, cap - len, "}");
+    return buf;
+}
+
+bool db_get_rooms_by_ids(const int32_t* ids, int count, PGresult** res)
+{
+    if (!ids || count <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    char* id_array = format_id_array(ids, count);
+    if (!id_array) {
+        db_release(db);
+        return false;
+    }
+    const char* params[1] = { id_array };
+    *res = PQexecParams(db->conn,
+        "SELECT room_id, room_name, description FROM auction_rooms WHERE room_id = ANY($1::int[]) "
+        "ORDER BY room_id",
+        1, NULL, params, NULL, NULL, 0);
+    free(id_array);
+    db_release(db);
+    return (PQresultStatus(*res) == PGRES_TUPLES_OK);
+}
+
+bool db_get_items_by_ids(const int32_t* ids, int count, PGresult** res)
+{
+    if (!ids || count <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    char* id_array = format_id_array(ids, count);
+    if (!id_array) {
+        db_release(db);
+        return false;
+    }
+    const char* params[1] = { id_array };
+    *res = PQexecParams(db->conn,
+        "SELECT item_id, item_name, starting_price, current_price, buy_now_price, status, "
+        "created_by, queue_position FROM auction_items WHERE item_id = ANY($1::int[]) "
+        "ORDER BY queue_position",
+        1, NULL, params, NULL, NULL, 0);
+    free(id_array);
+    db_release(db);
     return (PQresultStatus(*res) == PGRES_TUPLES_OK);
 }
 
 // === ITEM OPERATIONS ===
 int32_t db_create_item(int32_t room_id, int32_t seller_id, const char* name, const char* desc,
-                       int64_t start_price_vnd, int64_t buy_now_price_vnd, uint32_t duration_sec)
+                       int64_t start_price_vnd, int64_t buy_now_price_vnd, uint32_t duration_sec,
+                       int32_t queue_position)
 {
-    if (!db.conn || room_id <= 0 || seller_id <= 0 || !name || start_price_vnd < 0) return -1;
+    if (room_id <= 0 || seller_id <= 0 || !name || start_price_vnd < 0) return -1;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return -1;
 
     char room_str[32], seller_str[32], start_str[64], buy_now_str[64], dur_str[32];
     snprintf(room_str, sizeof(room_str), "%d", room_id);
@@ -170,85 +514,154 @@ int32_t db_create_item(int32_t room_id, int32_t seller_id, const char* name, con
     snprintf(buy_now_str, sizeof(buy_now_str), "%" PRId64, buy_now_price_vnd);
     snprintf(dur_str, sizeof(dur_str), "%u", duration_sec);
 
-    // Get next queue position
-    char queue_query[256];
-    snprintf(queue_query, sizeof(queue_query),
-        "SELECT COALESCE(MAX(queue_position), 0) + 1 FROM \"Item\" WHERE room_id=%d", room_id);
-    PGresult* queue_res = PQexec(db.conn, queue_query);
-    int queue_pos = 0;
-    if (PQntuples(queue_res) > 0) {
-        queue_pos = atoi(PQgetvalue(queue_res, 0, 0));
-    }
-    PQclear(queue_res);
-
     char queue_str[32];
-    snprintf(queue_str, sizeof(queue_str), "%d", queue_pos);
+    snprintf(queue_str, sizeof(queue_str), "%d", queue_position);
 
     const char* paramValues[9] = {
         name, desc ? desc : "", start_str, start_str, buy_now_str, 
-        "pending", room_str, seller_str, queue_str
+        "scheduled", room_str, seller_str, queue_str
     };
 
-    PGresult* res = PQexecParams(db.conn,
-        "INSERT INTO \"Item\" (name, description, starting_price, current_price, buy_now_price, "
-        "status, room_id, seller_id, queue_position) "
+    PGresult* res = PQexecParams(db->conn,
+        "INSERT INTO auction_items (item_name, description, starting_price, current_price, buy_now_price, "
+        "status, room_id, created_by, queue_position) "
         "VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9) RETURNING item_id",
         9, NULL, paramValues, NULL, NULL, 0);
 
     if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) == 0) {
-        fprintf(stderr, "Create item failed: %s\n", PQerrorMessage(db.conn));
+        fprintf(stderr, "Create item failed: %s\n", PQerrorMessage(db->conn));
         PQclear(res);
+        db_release(db);
         return -1;
     }
     int32_t item_id = atoi(PQgetvalue(res, 0, 0));
     PQclear(res);
+    db_release(db);
     return item_id;
 }
 
+bool db_create_items(int32_t room_id, int32_t seller_id, const ItemInsert* rows, int count,
+                     int32_t* item_ids_out)
+{
+    if (room_id <= 0 || seller_id <= 0 || !rows || count <= 0 || count > DB_ITEM_INSERT_BATCH) {
+        return false;
+    }
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    // $1 room, $2 seller, then five parameters per row
+    int nparams = 2 + count * 5;
+    size_t cap = (size_t)count * 96 + 256;
+    char* query = malloc(cap);
+    const char** params = malloc(sizeof(char*) * (size_t)nparams);
+    char* numbers = malloc((size_t)count * 3 * 24 + 64);
+    if (!query || !params || !numbers) {
+        free(query); free(params); free(numbers);
+        db_release(db);
+        return false;
+    }
+
+    char* num = numbers;
+    params[0] = num; num += sprintf(num, "%d", room_id) + 1;
+    params[1] = num; num += sprintf(num, "%d", seller_id) + 1;
+
+    size_t len = (size_t)snprintf(query, cap,
+        "INSERT INTO auction_items (item_name, description, starting_price, current_price, buy_now_price, "
+        "status, room_id, created_by, queue_position) VALUES ");
+    for (int i = 0; i < count; i++) {
+        int p = 2 + i * 5;
+        params[p] = rows[i].name;
+        params[p + 1] = rows[i].description ? rows[i].description : "";
+        params[p + 2] = num; num += sprintf(num, "%" PRId64, rows[i].start_price_vnd) + 1;
+        params[p + 3] = num; num += sprintf(num, "%" PRId64, rows[i].buy_now_price_vnd) + 1;
+        params[p + 4] = num; num += sprintf(num, "%d", rows[i].queue_position) + 1;
+        len += (size_t)snprintf(query + len, cap - len,
+                                "%s($%d, $%d, $%d, $%d, $%d, 'scheduled', $1, $2, $%d)",
+                                i ? ", " : "", p + 1, p + 2, p + 3, p + 3, p + 4, p + 5);
+    }
+    snprintf(query + len, cap - len, " RETURNING item_id, queue_position");
+
+    PGresult* res = PQexecParams(db->conn, query, nparams, NULL, params, NULL, NULL, 0);
+    bool success = (PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) == count);
+    if (success) {
+        // RETURNING order is not guaranteed; match rows by queue position
+        for (int row = 0; row < count; row++) {
+            int32_t item_id = atoi(PQgetvalue(res, row, 0));
+            int32_t position = atoi(PQgetvalue(res, row, 1));
+            for (int i = 0; i < count; i++) {
+                if (rows[i].queue_position == position) {
+                    item_ids_out[i] = item_id;
+                    break;
+                }
+            }
+        }
+    } else {
+        fprintf(stderr, "Create items failed: %s\n", PQerrorMessage(db->conn));
+    }
+    PQclear(res);
+    free(query); free(params); free(numbers);
+    db_release(db);
+    return success;
+}
+
 bool db_delete_item(int32_t item_id)
 {
-    if (!db.conn || item_id <= 0) return false;
+    if (item_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     char query[128];
-    snprintf(query, sizeof(query), "UPDATE \"Item\" SET status='deleted' WHERE item_id=%d", item_id);
-    PGresult* res = PQexec(db.conn, query);
+    snprintf(query, sizeof(query), "UPDATE auction_items SET status='cancelled' WHERE item_id=%d", item_id);
+    PGresult* res = PQexec(db->conn, query);
     bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
     PQclear(res);
+    db_release(db);
     return success;
 }
 
 bool db_get_item_details(int32_t item_id, PGresult** res)
 {
-    if (!db.conn || item_id <= 0) return false;
+    if (item_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     char query[256];
     snprintf(query, sizeof(query),
-        "SELECT item_id, name, description, starting_price, current_price, buy_now_price, "
-        "status, seller_id, room_id FROM \"Item\" WHERE item_id=%d", item_id);
-    *res = PQexec(db.conn, query);
+        "SELECT item_id, item_name, description, starting_price, current_price, buy_now_price, "
+        "status, created_by, room_id FROM auction_items WHERE item_id=%d", item_id);
+    *res = PQexec(db->conn, query);
+    db_release(db);
     return (PQresultStatus(*res) == PGRES_TUPLES_OK && PQntuples(*res) > 0);
 }
 
 // === BIDDING OPERATIONS ===
-bool db_place_bid(int32_t item_id, int32_t bidder_id, int64_t bid_amount_vnd, int64_t* new_current_price_vnd)
+bool db_place_bid(int32_t item_id, int32_t bidder_id, int64_t bid_amount_vnd, bool is_proxy,
+                  int64_t* new_current_price_vnd)
 {
-    if (!db.conn || item_id <= 0 || bidder_id <= 0 || bid_amount_vnd <= 0) return false;
+    if (item_id <= 0 || bidder_id <= 0 || bid_amount_vnd <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     // Start transaction
-    PQexec(db.conn, "BEGIN");
+    PQexec(db->conn, "BEGIN");
 
     // Get current price with lock
     char item_str[32];
     snprintf(item_str, sizeof(item_str), "%d", item_id);
     const char* param[1] = { item_str };
 
-    PGresult* res = PQexecParams(db.conn,
-        "SELECT current_price FROM \"Item\" WHERE item_id=$1 FOR UPDATE",
+    PGresult* res = PQexecParams(db->conn,
+        "SELECT current_price FROM auction_items WHERE item_id=$1 FOR UPDATE",
         1, NULL, param, NULL, NULL, 0);
 
     if (PQntuples(res) == 0) {
         PQclear(res);
-        PQexec(db.conn, "ROLLBACK");
+        PQexec(db->conn, "ROLLBACK");
+        db_release(db);
         return false;
     }
 
@@ -256,8 +669,9 @@ bool db_place_bid(int32_t item_id, int32_t bidder_id, int64_t bid_amount_vnd, in
     PQclear(res);
 
     // Check if bid is valid (at least 10000 VND higher)
-    if (bid_amount_vnd <= current_price || bid_amount_vnd - current_price < 10000) {
-        PQexec(db.conn, "ROLLBACK");
+    if (bid_amount_vnd <= current_price || bid_amount_vnd - current_price < BID_MIN_INCREMENT_VND) {
+        PQexec(db->conn, "ROLLBACK");
+        db_release(db);
         return false;
     }
 
@@ -265,28 +679,43 @@ bool db_place_bid(int32_t item_id, int32_t bidder_id, int64_t bid_amount_vnd, in
     snprintf(bidder_str, sizeof(bidder_str), "%d", bidder_id);
     snprintf(bid_str, sizeof(bid_str), "%" PRId64, bid_amount_vnd);
 
-    const char* params[3] = { bid_str, item_str, bidder_str };
-
-    res = PQexecParams(db.conn,
-        "UPDATE \"Item\" SET current_price = $1 WHERE item_id = $2; "
-        "INSERT INTO \"Bid\" (item_id, bidder_id, bid_amount) VALUES ($2, $3, $1)",
-        3, NULL, params, NULL, NULL, 0);
+    // PQexecParams takes a single statement: the price update and the bid
+    // row go separately, inside the transaction opened above
+    const char* update_params[2] = { bid_str, item_str };
+    res = PQexecParams(db->conn,
+        "UPDATE auction_items SET current_price = $1 WHERE item_id = $2",
+        2, NULL, update_params, NULL, NULL, 0);
+    bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
+    PQclear(res);
 
-    if (PQresultStatus(res) == PGRES_COMMAND_OK) {
+    if (success) {
+        const char* insert_params[4] = { item_str, bidder_str, bid_str, is_proxy ? "true" : "false" };
+        res = PQexecParams(db->conn,
+            "INSERT INTO bids (item_id, user_id, bid_amount, is_proxy) VALUES ($1, $2, $3, $4)",
+            4, NULL, insert_params, NULL, NULL, 0);
+        success = (PQresultStatus(res) == PGRES_COMMAND_OK);
         PQclear(res);
-        PQexec(db.conn, "COMMIT");
+    }
+
+    if (success) {
+        PQexec(db->conn, "COMMIT");
         *new_current_price_vnd = bid_amount_vnd;
+        db_release(db);
         return true;
     } else {
-        PQclear(res);
-        PQexec(db.conn, "ROLLBACK");
+        fprintf(stderr, "Place bid failed: %s\n", PQerrorMessage(db->conn));
+        PQexec(db->conn, "ROLLBACK");
+        db_release(db);
         return false;
     }
 }
 
 bool db_buy_now(int32_t item_id, int32_t buyer_id, int64_t buy_now_price_vnd)
 {
-    if (!db.conn || item_id <= 0 || buyer_id <= 0) return false;
+    if (item_id <= 0 || buyer_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     char item_str[32], buyer_str[32], price_str[64];
     snprintf(item_str, sizeof(item_str), "%d", item_id);
@@ -295,19 +724,23 @@ bool db_buy_now(int32_t item_id, int32_t buyer_id, int64_t buy_now_price_vnd)
 
     const char* params[3] = { item_str, buyer_str, price_str };
 
-    PGresult* res = PQexecParams(db.conn,
-        "UPDATE \"Item\" SET status='sold', winner_id=$2, win_amount=$3, win_type='buy_now' "
-        "WHERE item_id=$1 AND status IN ('pending', 'bidding')",
+    PGresult* res = PQexecParams(db->conn,
+        "UPDATE auction_items SET status='sold', winner_id=$2, win_amount=$3, win_type='buy_now' "
+        "WHERE item_id=$1 AND status IN ('scheduled', 'active')",
         3, NULL, params, NULL, NULL, 0);
 
     bool success = (PQresultStatus(res) == PGRES_COMMAND_OK && atoi(PQcmdTuples(res)) > 0);
     PQclear(res);
+    db_release(db);
     return success;
 }
 
-bool db_update_item_winner(int32_t item_id, int32_t winner_id, int64_t final_price_vnd, const char* win_type)
+int db_claim_item_winner(int32_t item_id, int32_t winner_id, int64_t final_price_vnd, const char* win_type)
 {
-    if (!db.conn || item_id <= 0 || winner_id <= 0 || !win_type) return false;
+    if (item_id <= 0 || winner_id <= 0 || !win_type) return -1;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return -1;
 
     char item_str[32], winner_str[32], price_str[64];
     snprintf(item_str, sizeof(item_str), "%d", item_id);
@@ -316,20 +749,53 @@ bool db_update_item_winner(int32_t item_id, int32_t winner_id, int64_t final_pri
 
     const char* params[4] = { winner_str, price_str, win_type, item_str };
 
-    PGresult* res = PQexecParams(db.conn,
-        "UPDATE \"Item\" SET status='sold', winner_id=$1, win_amount=$2, win_type=$3 "
-        "WHERE item_id=$4",
+    // Conditional so that two nodes settling the same item cannot both win
+    PGresult* res = PQexecParams(db->conn,
+        "UPDATE auction_items SET status='sold', winner_id=$1, win_amount=$2, win_type=$3 "
+        "WHERE item_id=$4 AND status <> 'sold'",
         4, NULL, params, NULL, NULL, 0);
 
-    bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
+    int claimed = -1;
+    if (PQresultStatus(res) == PGRES_COMMAND_OK) claimed = atoi(PQcmdTuples(res)) > 0 ? 1 : 0;
     PQclear(res);
+    db_release(db);
+    return claimed;
+}
+
+bool db_get_leading_bid(int32_t item_id, int32_t* user_id, int64_t* amount_vnd)
+{
+    if (item_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    char item_str[32];
+    snprintf(item_str, sizeof(item_str), "%d", item_id);
+    const char* params[1] = { item_str };
+    PGresult* res = PQexecParams(db->conn,
+        "SELECT user_id, bid_amount FROM bids WHERE item_id=$1 "
+        "ORDER BY bid_amount DESC, bid_time ASC LIMIT 1",
+        1, NULL, params, NULL, NULL, 0);
+
+    bool success = (PQresultStatus(res) == PGRES_TUPLES_OK);
+    *user_id = 0;
+    *amount_vnd = 0;
+    if (success && PQntuples(res) > 0) {
+        *user_id = atoi(PQgetvalue(res, 0, 0));
+        *amount_vnd = atoll(PQgetvalue(res, 0, 1));
+    }
+    PQclear(res);
+    db_release(db);
     return success;
 }
 
 // === TRANSACTION OPERATIONS ===
 bool db_add_transaction(int32_t user_id, int64_t amount_vnd, const char* type, int32_t related_item_id, const char* status)
 {
-    if (!db.conn || user_id <= 0 || !type || !status) return false;
+    if (user_id <= 0 || !type || !status) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
 
     char uid_str[32], amt_str[64], item_str[32];
     snprintf(uid_str, sizeof(uid_str), "%d", user_id);
@@ -345,54 +811,250 @@ bool db_add_transaction(int32_t user_id, int64_t amount_vnd, const char* type, i
     };
 
     const char* query_str = (related_item_id > 0) ?
-        "INSERT INTO \"Transaction\" (user_id, amount, type, related_item_id, status) "
+        "INSERT INTO transactions (user_id, amount, type, related_item_id, status) "
         "VALUES ($1, $2, $3, $4, $5)" :
-        "INSERT INTO \"Transaction\" (user_id, amount, type, status) "
+        "INSERT INTO transactions (user_id, amount, type, status) "
         "VALUES ($1, $2, $3, $5)";
 
     int nparams = (related_item_id > 0) ? 5 : 4;
-    PGresult* res = PQexecParams(db.conn, query_str, nparams, NULL, params, NULL, NULL, 0);
+    PGresult* res = PQexecParams(db->conn, query_str, nparams, NULL, params, NULL, NULL, 0);
 
     bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
     PQclear(res);
+    db_release(db);
     return success;
 }
 
-bool db_get_user_history(int32_t user_id, PGresult** res)
+bool db_get_user_history(int32_t user_id, DbReadRoute route, PGresult** res)
 {
-    if (!db.conn || user_id <= 0) return false;
+    if (user_id <= 0) return false;
+
+    Database* db = db_acquire_read(route);
+    if (!db) return false;
 
     char query[512];
     snprintf(query, sizeof(query),
-        "SELECT t.transaction_id, t.timestamp, t.type, t.amount, "
-        "COALESCE(i.name, 'N/A') as item_name, t.status "
-        "FROM \"Transaction\" t "
-        "LEFT JOIN \"Item\" i ON t.related_item_id = i.item_id "
-        "WHERE t.user_id = %d ORDER BY t.timestamp DESC LIMIT 50", user_id);
-    *res = PQexec(db.conn, query);
+        "SELECT t.transaction_id, t.created_at, t.type, t.amount, "
+        "COALESCE(i.item_name, 'N/A') as item_name, t.status "
+        "FROM transactions t "
+        "LEFT JOIN auction_items i ON t.related_item_id = i.item_id "
+        "WHERE t.user_id = %d ORDER BY t.created_at DESC LIMIT 50", user_id);
+    *res = PQexec(db->conn, query);
+    db_release(db);
     return (PQresultStatus(*res) == PGRES_TUPLES_OK);
 }
 
+bool db_get_user_participation(int32_t user_id, PGresult** res)
+{
+    if (user_id <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    char uid_str[32];
+    snprintf(uid_str, sizeof(uid_str), "%d", user_id);
+    const char* paramValues[1] = { uid_str };
+    *res = PQexecParams(db->conn,
+        "SELECT i.item_id, i.item_name, "
+        "CASE WHEN i.winner_id = $1 THEN i.win_amount ELSE MAX(b.bid_amount) END, "
+        "COUNT(b.item_id), (i.winner_id IS NOT DISTINCT FROM $1::int), "
+        "EXTRACT(EPOCH FROM COALESCE(MAX(b.bid_time), CURRENT_TIMESTAMP))::bigint AS last_ts "
+        "FROM auction_items i LEFT JOIN bids b ON b.item_id = i.item_id AND b.user_id = $1 "
+        "WHERE i.winner_id = $1 OR b.user_id IS NOT NULL "
+        "GROUP BY i.item_id ORDER BY last_ts DESC",
+        1, NULL, paramValues, NULL, NULL, 0);
+    db_release(db);
+    return (PQresultStatus(*res) == PGRES_TUPLES_OK);
+}
+
+bool db_apply_balance_changes(const BalanceChange* changes, int count)
+{
+    if (!changes || count <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    // Ship the batch as five parallel arrays and unnest them server-side
+    size_t cap = (size_t)count * 24 + 3;
+    char* users = malloc(cap);
+    char* amounts = malloc(cap);
+    char* helds = malloc(cap);
+    char* types = malloc(cap);
+    char* items = malloc(cap);
+    if (!users || !amounts || !helds || !types || !items) {
+        free(users); free(amounts); free(helds); free(types); free(items);
+        db_release(db);
+        return false;
+    }
+
+    size_t ul = 0, al = 0, hl = 0, tl = 0, il = 0;
+    users[ul++] = '{'; amounts[al++] = '{'; helds[hl++] = '{'; types[tl++] = '{'; items[il++] = '{';
+    for (int i = 0; i < count; i++) {
+        const char* sep = (i + 1 < count) ? "," : "}";
+        ul += snprintf(users + ul, cap - ul, "%d%s", changes[i].user_id, sep);
+        al += snprintf(amounts + al, cap - al, "%" PRId64 "%s", changes[i].amount_vnd, sep);
+        hl += snprintf(helds + hl, cap - hl, "%" PRId64 "%s", changes[i].held_vnd, sep);
+        tl += snprintf(types + tl, cap - tl, "%s%s",
+                       changes[i].type ? changes[i].type : "NULL", sep);
+        if (changes[i].related_item_id > 0) {
+            il += snprintf(items + il, cap - il, "%d%s", changes[i].related_item_id, sep);
+        } else {
+            il += snprintf(items + il, cap - il, "NULL%s", sep);
+        }
+    }
+
+    // A debit and the release of its reservation land in the same UPDATE,
+    // so another node never sees the funds free before they are spent
+    const char* params[5] = { users, amounts, helds, types, items };
+    PGresult* res = PQexecParams(db->conn,
+        "WITH changes AS ("
+        "  SELECT * FROM unnest($1::int[], $2::numeric[], $3::numeric[], $4::text[], $5::int[]) "
+        "  AS c(user_id, amount, held, type, related_item_id)), "
+        "upd AS ("
+        "  UPDATE users u SET balance = u.balance + d.delta, "
+        "    held = GREATEST(u.held + d.held_delta, 0), updated_at = CURRENT_TIMESTAMP "
+        "  FROM (SELECT user_id, SUM(amount) AS delta, SUM(held) AS held_delta "
+        "        FROM changes GROUP BY user_id) d "
+        "  WHERE u.user_id = d.user_id) "
+        "INSERT INTO transactions (user_id, amount, type, related_item_id) "
+        "SELECT user_id, amount, type, related_item_id FROM changes WHERE type IS NOT NULL",
+        5, NULL, params, NULL, NULL, 0);
+
+    bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
+    if (!success) {
+        fprintf(stderr, "Apply balance changes failed: %s\n", PQerrorMessage(db->conn));
+    }
+    PQclear(res);
+    free(users); free(amounts); free(helds); free(types); free(items);
+    db_release(db);
+    return success;
+}
+
+int db_reserve_funds(int32_t user_id, int64_t amount_vnd, int64_t* balance_vnd)
+{
+    if (user_id <= 0 || amount_vnd < 0) return -1;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return -1;
+
+    char user_str[32], amount_str[64];
+    snprintf(user_str, sizeof(user_str), "%d", user_id);
+    snprintf(amount_str, sizeof(amount_str), "%" PRId64, amount_vnd);
+    const char* params[2] = { user_str, amount_str };
+
+    // The row lock makes the check and the reservation one step for every node
+    PGresult* res = PQexecParams(db->conn,
+        "UPDATE users SET held = held + $2 "
+        "WHERE user_id = $1 AND balance - held >= $2 "
+        "RETURNING balance::bigint",
+        2, NULL, params, NULL, NULL, 0);
+
+    int reserved = -1;
+    if (PQresultStatus(res) == PGRES_TUPLES_OK) {
+        reserved = PQntuples(res) > 0 ? 1 : 0;
+        if (reserved && balance_vnd) *balance_vnd = atoll(PQgetvalue(res, 0, 0));
+    } else {
+        fprintf(stderr, "Reserve funds failed: %s\n", PQerrorMessage(db->conn));
+    }
+    PQclear(res);
+    db_release(db);
+    return reserved;
+}
+
+bool db_apply_item_queue_changes(const ItemQueueChange* changes, int count)
+{
+    if (!changes || count <= 0) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    size_t cap = (size_t)count * 16 + 3;
+    char* items = malloc(cap);
+    char* statuses = malloc(cap);
+    char* positions = malloc(cap);
+    if (!items || !statuses || !positions) {
+        free(items); free(statuses); free(positions);
+        db_release(db);
+        return false;
+    }
+
+    size_t il = 0, sl = 0, pl = 0;
+    items[il++] = '{'; statuses[sl++] = '{'; positions[pl++] = '{';
+    for (int i = 0; i < count; i++) {
+        const char* sep = (i + 1 < count) ? "," : "}";
+        il += snprintf(items + il, cap - il, "%d%s", changes[i].item_id, sep);
+        sl += snprintf(statuses + sl, cap - sl, "%s%s",
+                       changes[i].status ? changes[i].status : "NULL", sep);
+        if (changes[i].queue_position > 0) {
+            pl += snprintf(positions + pl, cap - pl, "%d%s", changes[i].queue_position, sep);
+        } else {
+            pl += snprintf(positions + pl, cap - pl, "NULL%s", sep);
+        }
+    }
+
+    const char* params[3] = { items, statuses, positions };
+    PGresult* res = PQexecParams(db->conn,
+        "UPDATE auction_items a SET "
+        "  status = COALESCE(c.status, a.status), "
+        "  queue_position = COALESCE(c.queue_position, a.queue_position) "
+        "FROM unnest($1::int[], $2::text[], $3::int[]) AS c(item_id, status, queue_position) "
+        "WHERE a.item_id = c.item_id",
+        3, NULL, params, NULL, NULL, 0);
+
+    bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
+    if (!success) {
+        fprintf(stderr, "Apply item queue changes failed: %s\n", PQerrorMessage(db->conn));
+    }
+    PQclear(res);
+    free(items); free(statuses); free(positions);
+    db_release(db);
+    return success;
+}
+
+// === CHAT OPERATIONS ===
+bool db_save_chat_message(int32_t room_id, int32_t user_id, const char* text)
+{
+    if (room_id <= 0 || user_id <= 0 || !text) return false;
+
+    Database* db = db_acquire(&primary);
+    if (!db) return false;
+
+    char room_str[32], uid_str[32];
+    snprintf(room_str, sizeof(room_str), "%d", room_id);
+    snprintf(uid_str, sizeof(uid_str), "%d", user_id);
+
+    const char* params[3] = { room_str, uid_str, text };
+    PGresult* res = PQexecParams(db->conn,
+        "INSERT INTO chat_messages (room_id, user_id, message) VALUES ($1, $2, $3)",
+        3, NULL, params, NULL, NULL, 0);
+
+    bool success = (PQresultStatus(res) == PGRES_COMMAND_OK);
+    if (!success) fprintf(stderr, "Save chat failed: %s\n", PQerrorMessage(db->conn));
+    PQclear(res);
+    db_release(db);
+    return success;
+}
+
 // === SEARCH OPERATIONS ===
-bool db_search_items(const char* search_term, PGresult** res)
+bool db_search_items(const char* search_term, DbReadRoute route, PGresult** res)
 {
-    if (!db.conn) return false;
+    Database* db = db_acquire_read(route);
+    if (!db) return false;
 
-    char query[512];
     if (search_term && strlen(search_term) > 0) {
-        // Escape for SQL injection protection
-        snprintf(query, sizeof(query),
-            "SELECT item_id, name, description, starting_price, current_price, "
-            "buy_now_price, status, room_id FROM \"Item\" "
-            "WHERE (name ILIKE '%%' || '%s' || '%%' OR description ILIKE '%%' || '%s' || '%%') "
-            "AND status IN ('pending', 'bidding') ORDER BY item_id DESC",
-            search_term, search_term);
+        const char* params[1] = { search_term };
+        *res = PQexecParams(db->conn,
+            "SELECT item_id, item_name, description, starting_price, current_price, "
+            "buy_now_price, status, room_id FROM auction_items "
+            "WHERE (item_name ILIKE '%' || $1 || '%' OR description ILIKE '%' || $1 || '%') "
+            "AND status IN ('scheduled', 'active') ORDER BY item_id DESC",
+            1, NULL, params, NULL, NULL, 0);
     } else {
-        snprintf(query, sizeof(query),
-            "SELECT item_id, name, description, starting_price, current_price, "
-            "buy_now_price, status, room_id FROM \"Item\" "
-            "WHERE status IN ('pending', 'bidding') ORDER BY item_id DESC");
+        *res = PQexec(db->conn,
+            "SELECT item_id, item_name, description, starting_price, current_price, "
+            "buy_now_price, status, room_id FROM auction_items "
+            "WHERE status IN ('scheduled', 'active') ORDER BY item_id DESC");
     }
-    *res = PQexec(db.conn, query);
+    db_release(db);
     return (PQresultStatus(*res) == PGRES_TUPLES_OK);
 }
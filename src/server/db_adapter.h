@@ -9,33 +9,135 @@ typedef struct {
     PGconn* conn;
 } Database;
 
+// Each query runs on a connection taken from a pool for its duration.
+// Writes, transactions and bid validation use the primary; reads marked
+// DB_READ_REPLICA go to the read replica (db_init_replica) while its lag is
+// within the configured tolerance, and fall back to the primary otherwise.
+#define DB_PRIMARY_POOL_SIZE        4
+#define DB_REPLICA_POOL_SIZE        4
+#define DB_POOL_MAX                 8
+#define DB_RECONNECT_MS             1000    // Min delay between reconnect attempts
+#define DB_REPLICA_DEFAULT_LAG_MS   1000
+
+typedef enum {
+    DB_READ_PRIMARY,    // Must see this server's latest writes
+    DB_READ_REPLICA     // May be up to the replica lag tolerance behind
+} DbReadRoute;
+
+// One queued status / queue change from a room's item scheduler
+typedef struct {
+    int32_t item_id;
+    const char* status;         // NULL = unchanged ('active', 'available', 'cancelled')
+    int32_t queue_position;     // 0 = unchanged
+} ItemQueueChange;
+
+// One queued balance change from the in-memory ledger
+typedef struct {
+    int32_t user_id;
+    int64_t amount_vnd;         // Signed: deposits > 0, debits < 0
+    int64_t held_vnd;           // Signed change to users.held (cluster reservations)
+    int32_t related_item_id;    // 0 if none
+    const char* type;           // 'deposit', 'redeem', 'bid_win', 'buy_now' (static string);
+                                // NULL = users.held only, no transactions row
+} BalanceChange;
+
+// One row of a bulk item insert (db_create_items)
+typedef struct {
+    const char* name;
+    const char* description;
+    int64_t start_price_vnd;
+    int64_t buy_now_price_vnd;
+    int32_t queue_position;     // Unique within the batch
+} ItemInsert;
+
+// Rows per multi-row INSERT: 5 parameters each, well under libpq's 65535
+#define DB_ITEM_INSERT_BATCH 1000
+
+// Smallest raise over the current price a bid must make
+#define BID_MIN_INCREMENT_VND 10000
+
 // Core
 bool db_init(const char* conninfo);
+// Optional read-only connections (a streaming replica or any other copy)
+bool db_init_replica(const char* conninfo, uint32_t max_lag_ms);
 void db_cleanup(void);
 
+typedef struct {
+    uint64_t replica_reads;
+    uint64_t replica_fallbacks;     // Replica reads served by the primary (lagging / down)
+    uint64_t replica_lag_checks;
+    uint64_t replica_lag_ms;        // Last measured
+    uint64_t primary_waits;         // Queries that waited for a free primary connection
+} DbStats;
+
+void db_get_stats(DbStats* out);
+
 // User operations
 int32_t db_register_user(const char* username, const char* password_hash, const char* email);
 int32_t db_login_user(const char* username, const char* password_hash, int32_t* user_id, int64_t* balance_vnd);
+// Stored hash for verification outside SQL (auth_service); false if no such user
+bool db_get_user_credentials(const char* username, char* hash_out, size_t hash_cap,
+                             int32_t* user_id, int64_t* balance_vnd);
+bool db_set_password_hash(int32_t user_id, const char* password_hash);
 bool db_update_balance(int32_t user_id, int64_t vnd_change);           
 bool db_get_user_balance(int32_t user_id, int64_t* balance_vnd);
 
 // Room operations
 int32_t db_create_room(const char* name, const char* desc, int32_t creator_id,
                        uint64_t start_time, uint64_t end_time);
-bool db_get_active_rooms(PGresult** res);        // Caller must PQclear()
-bool db_get_room_items(int32_t room_id, PGresult** res);
+bool db_get_active_rooms(DbReadRoute route, PGresult** res);     // Caller must PQclear()
+bool db_get_room_items(int32_t room_id, DbReadRoute route, PGresult** res);
+// Same columns as db_get_active_rooms / db_get_room_items, limited to `ids`
+// (rows whose room is no longer active are still returned)
+bool db_get_rooms_by_ids(const int32_t* ids, int count, PGresult** res);
+bool db_get_items_by_ids(const int32_t* ids, int count, PGresult** res);
 
 // Item operations
+// queue_position is assigned by the room's item scheduler
 int32_t db_create_item(int32_t room_id, int32_t seller_id, const char* name, const char* desc,
-                       int64_t start_price_vnd, int64_t buy_now_price_vnd, uint32_t duration_sec);
+                       int64_t start_price_vnd, int64_t buy_now_price_vnd, uint32_t duration_sec,
+                       int32_t queue_position);
+// Insert up to DB_ITEM_INSERT_BATCH items of one room and seller with a
+// single multi-row INSERT (all or nothing). item_ids_out[i] gets the id of
+// rows[i].
+bool db_create_items(int32_t room_id, int32_t seller_id, const ItemInsert* rows, int count,
+                     int32_t* item_ids_out);
 
-bool db_place_bid(int32_t item_id, int32_t bidder_id, int64_t bid_amount_vnd, int64_t* new_current_price_vnd);
+bool db_place_bid(int32_t item_id, int32_t bidder_id, int64_t bid_amount_vnd, bool is_proxy,
+                  int64_t* new_current_price_vnd);
 bool db_buy_now(int32_t item_id, int32_t buyer_id, int64_t buy_now_price_vnd);
+bool db_delete_item(int32_t item_id);
 bool db_get_item_details(int32_t item_id, PGresult** res);
-bool db_update_item_winner(int32_t item_id, int32_t winner_id, int64_t final_price_vnd, const char* win_type);
+// Mark the item sold to `winner_id` unless it already is. Returns 1 if this
+// call sold it, 0 if it was already sold, -1 on a DB error.
+int db_claim_item_winner(int32_t item_id, int32_t winner_id, int64_t final_price_vnd, const char* win_type);
+// Highest bid recorded for the item; *user_id = 0 if there is none.
+// False on a DB error.
+bool db_get_leading_bid(int32_t item_id, int32_t* user_id, int64_t* amount_vnd);
 
 // Transaction & History
 bool db_add_transaction(int32_t user_id, int64_t amount_vnd, const char* type, int32_t related_item_id, const char* status);
-bool db_get_user_history(int32_t user_id, PGresult** res);
+bool db_get_user_history(int32_t user_id, DbReadRoute route, PGresult** res);
+// One row per item the user bid on or won, most recent first:
+// item_id, name, amount, bid_count, won, last_ts (epoch seconds)
+bool db_get_user_participation(int32_t user_id, PGresult** res);
+bool db_search_items(const char* search_term, DbReadRoute route, PGresult** res);
+
+// Chat
+bool db_save_chat_message(int32_t room_id, int32_t user_id, const char* text);
+
+// Apply a batch of ledger changes to users.balance / users.held and the
+// transactions table in one statement (all or nothing)
+bool db_apply_balance_changes(const BalanceChange* changes, int count);
+
+// Reserve `amount_vnd` of the user's free balance (balance - held) in
+// users.held, so that nodes sharing the database cannot spend the same
+// funds. Returns 1 if reserved (with the DB balance in *balance_vnd), 0 if
+// the free balance is short, -1 on a DB error.
+int db_reserve_funds(int32_t user_id, int64_t amount_vnd, int64_t* balance_vnd);
+
+// Apply scheduler status/position changes to auction_items in one statement
+// (at most one entry per item)
+bool db_apply_item_queue_changes(const ItemQueueChange* changes, int count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "delta_sync.h"
+#include "auction_events.h"
+#include "db_adapter.h"
+#include "listing_cache.h"
+#include "mem_pool.h"
+#include "protocol_helpers.h"
+#include "protocol_payloads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+typedef struct {
+    uint64_t version;
+    int32_t id;
+    int32_t room_id;
+    uint8_t kind;
+    uint8_t removed;
+} ChangeEntry;
+
+typedef struct {
+    int32_t id;
+    bool removed;
+} Change;
+
+static ChangeEntry change_log[DELTA_LOG_CAP];
+static uint32_t log_head;       // Oldest entry
+static uint32_t log_count;
+static uint64_t current_version;
+static uint64_t log_floor;      // Changes at or below this version are no longer in the log
+static DeltaSyncStats stats;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ListRoomsRes and ViewItemsRes share one layout; the builder fills either
+_Static_assert(sizeof(ListRoomsRes) == sizeof(ViewItemsRes), "list response layouts differ");
+
+// === CHANGE LOG ===
+uint64_t delta_sync_record(SyncKind kind, int32_t id, int32_t room_id, bool removed)
+{
+    pthread_mutex_lock(&log_lock);
+    if (log_count == DELTA_LOG_CAP) {
+        log_floor = change_log[log_head].version;
+        log_head = (log_head + 1) % DELTA_LOG_CAP;
+        log_count--;
+    }
+    ChangeEntry* e = &change_log[(log_head + log_count) % DELTA_LOG_CAP];
+    e->version = ++current_version;
+    e->id = id;
+    e->room_id = room_id;
+    e->kind = (uint8_t)kind;
+    e->removed = removed;
+    log_count++;
+    uint64_t version = current_version;
+    pthread_mutex_unlock(&log_lock);
+    return version;
+}
+
+uint64_t delta_sync_version(void)
+{
+    pthread_mutex_lock(&log_lock);
+    uint64_t v = current_version;
+    pthread_mutex_unlock(&log_lock);
+    return v;
+}
+
+// Collect the newest state of each entity changed after `since`.
+// Returns -1 when the caller has to fall back to a snapshot.
+static int changes_since(SyncKind kind, int32_t room_id, uint64_t since,
+                         Change* out, uint64_t* version)
+{
+    int n = 0;
+    pthread_mutex_lock(&log_lock);
+    *version = current_version;
+    if (since < log_floor || since > current_version) {
+        pthread_mutex_unlock(&log_lock);
+        return -1;
+    }
+
+    for (uint32_t i = log_count; i-- > 0;) {
+        const ChangeEntry* e = &change_log[(log_head + i) % DELTA_LOG_CAP];
+        if (e->version <= since) break;
+        if (e->kind != kind || (kind == SYNC_ITEM && e->room_id != room_id)) continue;
+
+        bool seen = false;
+        for (int j = 0; j < n && !seen; j++) seen = (out[j].id == e->id);
+        if (seen) continue;
+
+        if (n == DELTA_MAX_CHANGES) {
+            n = -1;
+            break;
+        }
+        out[n].id = e->id;
+        out[n].removed = e->removed;
+        n++;
+    }
+    pthread_mutex_unlock(&log_lock);
+    return n;
+}
+
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    switch (ev->type) {
+        case EVENT_ROOM_CREATED:
+            delta_sync_record(SYNC_ROOM, ev->room_id, ev->room_id, false);
+            break;
+        case EVENT_ROOM_CLOSED:
+            delta_sync_record(SYNC_ROOM, ev->room_id, ev->room_id, true);
+            break;
+        case EVENT_ITEM_CREATED:
+        case EVENT_ITEM_ACTIVATED:
+        case EVENT_ITEM_BID:
+        case EVENT_ITEM_SOLD:
+        case EVENT_ITEM_UNSOLD:
+            delta_sync_record(SYNC_ITEM, ev->item_id, ev->room_id, false);
+            break;
+        case EVENT_ITEM_DELETED:
+            delta_sync_record(SYNC_ITEM, ev->item_id, ev->room_id, true);
+            break;
+        case EVENT_ITEM_CLOSING:
+        case EVENT_ITEM_EXPIRED:
+            break;
+    }
+}
+
+bool delta_sync_init(void)
+{
+    // Start from wall-clock time so a restarted server never hands out a
+    // version a client has already seen; everything older is below the floor
+    pthread_mutex_lock(&log_lock);
+    current_version = (uint64_t)time(NULL) << 20;
+    log_floor = current_version;
+    pthread_mutex_unlock(&log_lock);
+    return auction_events_subscribe(on_auction_event, NULL);
+}
+
+// === RESPONSE BUILDING ===
+static void encode_room(PGresult* res, int row, char* dst)
+{
+    RoomInfo info;
+    memset(&info, 0, sizeof(info));
+    info.room_id = (uint32_t)atoi(PQgetvalue(res, row, 0));
+    snprintf(info.room_name, sizeof(info.room_name), "%s", PQgetvalue(res, row, 1));
+    snprintf(info.description, sizeof(info.description), "%s", PQgetvalue(res, row, 2));
+    memcpy(dst, &info, sizeof(info));
+}
+
+static void encode_item(PGresult* res, int row, int32_t room_id, char* dst)
+{
+    ItemInfo info;
+    memset(&info, 0, sizeof(info));
+    info.item_id = (uint32_t)atoi(PQgetvalue(res, row, 0));
+    info.room_id = (uint32_t)room_id;
+    snprintf(info.item_name, sizeof(info.item_name), "%s", PQgetvalue(res, row, 1));
+    info.current_price = atoll(PQgetvalue(res, row, 3));
+    info.buy_now_price = atoll(PQgetvalue(res, row, 4));
+    snprintf(info.status, sizeof(info.status), "%s", PQgetvalue(res, row, 5));
+    memcpy(dst, &info, sizeof(info));
+}
+
+// Shared tail of both builders: rows from `res`, then removed ids
+static int build_list(SyncKind kind, int32_t room_id, PGresult* res, const Change* changes,
+                      int nchanges, uint64_t version, bool is_delta, char* out, size_t cap,
+                      bool* truncated)
+{
+    size_t entry_size = (kind == SYNC_ROOM) ? sizeof(RoomInfo) : sizeof(ItemInfo);
+    size_t len = sizeof(ListRoomsRes);
+    if (cap < len) return -1;
+
+    uint16_t count = 0, removed = 0;
+    bool partial = false;
+    int rows = res ? PQntuples(res) : 0;
+    for (int r = 0; r < rows; r++) {
+        if (len + entry_size > cap) {
+            partial = true;
+            break;
+        }
+        if (kind == SYNC_ROOM) encode_room(res, r, out + len);
+        else encode_item(res, r, room_id, out + len);
+        len += entry_size;
+        count++;
+    }
+    for (int i = 0; i < nchanges; i++) {
+        if (!changes[i].removed) continue;
+        if (len + sizeof(uint32_t) > cap) {
+            partial = true;
+            break;
+        }
+        uint32_t id = (uint32_t)changes[i].id;
+        memcpy(out + len, &id, sizeof(id));
+        len += sizeof(id);
+        removed++;
+    }
+
+    ListRoomsRes head;
+    memset(&head, 0, sizeof(head));
+    head.status = STATUS_SUCCESS;
+    snprintf(head.message, sizeof(head.message), "%s", partial ? "Partial list" : "OK");
+    head.count = count;
+    // A delta that did not fit cannot be resumed: version 0 makes the
+    // client ask for a snapshot next time (snapshots are paged instead)
+    head.version = partial && is_delta ? 0 : version;
+    head.is_delta = is_delta;
+    head.removed_count = removed;
+    memcpy(out, &head, sizeof(head));
+    *truncated = partial;
+    return (int)len;
+}
+
+// Full snapshot at `version`, paged from row 0. Cached whole so the later
+// pages come from the same rows.
+static int build_snapshot(SyncKind kind, int32_t room_id, uint64_t version, char* out, size_t cap)
+{
+    uint64_t gen = listing_cache_begin(kind, room_id);
+    int len = listing_cache_lookup(kind, room_id, 0, 0, out, cap);
+    if (len >= 0) return len;
+
+    // Primary: the snapshot is tagged with `version` and must include
+    // every change up to it
+    PGresult* res = NULL;
+    bool ok = (kind == SYNC_ROOM) ? db_get_active_rooms(DB_READ_PRIMARY, &res)
+                                  : db_get_room_items(room_id, DB_READ_PRIMARY, &res);
+    if (!ok) {
+        if (res) PQclear(res);
+        return -1;
+    }
+
+    size_t entry_size = (kind == SYNC_ROOM) ? sizeof(RoomInfo) : sizeof(ItemInfo);
+    size_t snap_cap = sizeof(ListRoomsRes) + (size_t)PQntuples(res) * entry_size;
+    char* snap = buf_pool_alloc(snap_cap);
+    if (!snap) {
+        PQclear(res);
+        return -1;
+    }
+    bool partial = false;
+    int snap_len = build_list(kind, room_id, res, NULL, 0, version, false, snap, snap_cap, &partial);
+    PQclear(res);
+    if (snap_len > 0) {
+        listing_cache_store(kind, room_id, gen, snap, (size_t)snap_len);
+        len = listing_cache_page(kind, snap, (size_t)snap_len, 0, out, cap);
+    }
+    buf_pool_free(snap);
+    return len;
+}
+
+static int build(SyncKind kind, int32_t room_id, uint64_t since, uint16_t offset,
+                 char* out, size_t cap)
+{
+    // Next page of a snapshot: only from the snapshot the client started on
+    if (since != 0 && offset > 0) {
+        int len = listing_cache_lookup(kind, room_id, since, offset, out, cap);
+        pthread_mutex_lock(&log_lock);
+        if (len >= 0) stats.pages_served++;
+        else stats.page_restarts++;
+        pthread_mutex_unlock(&log_lock);
+        if (len >= 0) return len;
+        since = 0;  // Rebuilt meanwhile: start over from the first page
+    }
+
+    Change changes[DELTA_MAX_CHANGES];
+    uint64_t version;
+    int n = (since == 0) ? -1 : changes_since(kind, room_id, since, changes, &version);
+    bool is_delta = n >= 0;
+
+    pthread_mutex_lock(&log_lock);
+    if (is_delta) stats.deltas_served++;
+    else {
+        stats.snapshots_served++;
+        if (since != 0) stats.truncated_fallbacks++;
+        version = current_version;
+    }
+    pthread_mutex_unlock(&log_lock);
+
+    if (!is_delta) return build_snapshot(kind, room_id, version, out, cap);
+
+    PGresult* res = NULL;
+    int32_t ids[DELTA_MAX_CHANGES];
+    int nids = 0;
+    for (int i = 0; i < n; i++) {
+        if (!changes[i].removed) ids[nids++] = changes[i].id;
+    }
+    if (nids > 0) {
+        bool ok = (kind == SYNC_ROOM) ? db_get_rooms_by_ids(ids, nids, &res)
+                                      : db_get_items_by_ids(ids, nids, &res);
+        if (!ok) {
+            if (res) PQclear(res);
+            return -1;
+        }
+    }
+
+    bool partial = false;
+    int len = build_list(kind, room_id, res, changes, n, version, true, out, cap, &partial);
+    if (res) PQclear(res);
+    return len;
+}
+
+int delta_sync_build_room_list(uint64_t since_version, uint16_t offset, char* out, size_t cap)
+{
+    return build(SYNC_ROOM, 0, since_version, offset, out, cap);
+}
+
+int delta_sync_build_item_list(int32_t room_id, uint64_t since_version, uint16_t offset,
+                               char* out, size_t cap)
+{
+    return build(SYNC_ITEM, room_id, since_version, offset, out, cap);
+}
+
+void delta_sync_get_stats(DeltaSyncStats* out)
+{
+    pthread_mutex_lock(&log_lock);
+    *out = stats;
+    out->version = current_version;
+    pthread_mutex_unlock(&log_lock);
+}
@@ -0,0 +1,52 @@
+#ifndef DELTA_SYNC_H
+#define DELTA_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ========== Versioned Delta Sync (LIST_ROOMS / VIEW_ITEMS) ==========
+// Every room/item change gets the next value of one global, monotonically
+// increasing version and is appended to a bounded in-memory change log.
+// A poll carrying since_version is answered with only the entries changed
+// (or removed) after it. When the log no longer reaches back that far, or
+// too much changed, a full snapshot is sent instead.
+//
+// Snapshots larger than one frame are paged (ListRoomsRes.next_offset).
+// Every page is cut from the same cached snapshot, so the pages add up to
+// the state at its version; if the snapshot was rebuilt in between (rows
+// added or removed) the client is sent back to the first page.
+
+#define DELTA_LOG_CAP       4096    // Changes kept in memory
+#define DELTA_MAX_CHANGES   64      // Larger deltas fall back to a snapshot
+
+typedef enum {
+    SYNC_ROOM = 0,
+    SYNC_ITEM
+} SyncKind;
+
+// Subscribes to auction events; call once at startup
+bool delta_sync_init(void);
+
+uint64_t delta_sync_record(SyncKind kind, int32_t id, int32_t room_id, bool removed);
+uint64_t delta_sync_version(void);
+
+// Build a LIST_ROOMS_RES / VIEW_ITEMS_RES payload into `out`.
+// Returns the payload length, or -1 on error.
+// `offset` is the request's snapshot page offset (0 for a poll).
+int delta_sync_build_room_list(uint64_t since_version, uint16_t offset, char* out, size_t cap);
+int delta_sync_build_item_list(int32_t room_id, uint64_t since_version, uint16_t offset,
+                               char* out, size_t cap);
+
+typedef struct {
+    uint64_t version;
+    uint64_t deltas_served;
+    uint64_t snapshots_served;
+    uint64_t truncated_fallbacks;   // Client was behind the log floor or delta too large
+    uint64_t pages_served;          // Snapshot pages after the first
+    uint64_t page_restarts;         // Snapshot changed under a paging client
+} DeltaSyncStats;
+
+void delta_sync_get_stats(DeltaSyncStats* out);
+
+#endif
@@ -0,0 +1,718 @@
+#include "hot_upgrade.h"
+#include "conn_session.h"
+#include "request_pipeline.h"
+#include "auth_service.h"
+#include "item_scheduler.h"
+#include "proxy_bid.h"
+#include "ledger.h"
+#include "user_stats.h"
+#include "cluster.h"
+#include "wire_capture.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#define UPGRADE_MAGIC     "AUCTUPG1"
+#define UPGRADE_VERSION   2
+
+typedef enum {
+    UPGRADE_HELLO = 1,      // new -> old
+    UPGRADE_STATE,          // old -> new: totals, listening socket attached
+    UPGRADE_CONNS,          // old -> new: UpgradeConn records, their fds attached
+    UPGRADE_AUCTIONS,       // old -> new: UpgradeAuction records
+    UPGRADE_PROXIES,        // old -> new: UpgradeProxy records
+    UPGRADE_ACK,            // new -> old: everything received
+    UPGRADE_COMMIT          // old -> new: exiting, the sockets are yours
+} UpgradeMsgType;
+
+// Every message on the (SOCK_SEQPACKET) upgrade socket starts with this
+typedef struct __attribute__((packed)) {
+    char magic[8];
+    uint16_t version;
+    uint8_t type;
+    uint8_t refused;        // STATE: the old process could not drain
+    uint32_t conns;         // STATE: total; CONNS: in this message; ACK: received
+    uint32_t auctions;      // STATE: total; AUCTIONS: in this message
+    uint32_t proxies;       // STATE: total; PROXIES: in this message
+} UpgradeMsg;
+
+typedef struct __attribute__((packed)) {
+    int32_t user_id;        // 0 = not logged in
+    int32_t room_id;
+    int64_t balance;        // Ledger balance of user_id, -1 if not loaded
+    char session_token[CONN_SESSION_TOKEN_LEN];
+} UpgradeConn;
+
+typedef struct __attribute__((packed)) {
+    int32_t room_id;
+    int32_t item_id;
+    uint32_t remaining_ms;
+    uint8_t warned;
+    int32_t leader_id;      // 0 = no bid yet
+    int64_t leader_amount;
+    int64_t leader_balance;
+} UpgradeAuction;
+
+typedef struct __attribute__((packed)) {
+    int32_t room_id;
+    int32_t item_id;
+    int32_t user_id;
+    int64_t max_amount;
+    uint64_t seq;           // Registration order
+    int64_t balance;        // Ledger balance of user_id, -1 if not loaded
+} UpgradeProxy;
+
+// One slot per fd with a thread blocked on it
+typedef struct {
+    pthread_t tid;
+    bool used;
+    bool has_tid;           // Set by the owner at its first checkpoint
+    bool parked;
+} ReaderSlot;
+
+static ReaderSlot readers[HOT_UPGRADE_MAX_FDS];
+static int max_fd = -1;
+static uint32_t registered, parked;
+static atomic_bool frozen;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parked_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t resume_cv = PTHREAD_COND_INITIALIZER;
+
+static int unix_sock = -1;
+static int tcp_listen = -1;
+static pthread_t listener_thread;
+static HotUpgradeStats stats;   // Protected by lock
+
+static uint64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint32_t ms_left(uint64_t deadline)
+{
+    uint64_t now = mono_ms();
+    return now < deadline ? (uint32_t)(deadline - now) : 0;
+}
+
+static void set_recv_timeout(int sock, uint32_t ms)
+{
+    struct timeval tv = { .tv_sec = ms / 1000, .tv_usec = (suseconds_t)(ms % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static bool unix_addr(const char* path, struct sockaddr_un* addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        LOG_ERROR("upgrade: socket path too long: %s", path);
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+static void close_fds(const int* fds, int count)
+{
+    for (int i = 0; i < count; i++) close(fds[i]);
+}
+
+// === MESSAGES ===
+typedef union {
+    char buf[CMSG_SPACE(HOT_UPGRADE_BATCH * sizeof(int))];
+    struct cmsghdr align;
+} FdControl;
+
+static void init_msg(UpgradeMsg* msg, UpgradeMsgType type)
+{
+    memset(msg, 0, sizeof(*msg));
+    memcpy(msg->magic, UPGRADE_MAGIC, sizeof(msg->magic));
+    msg->version = UPGRADE_VERSION;
+    msg->type = (uint8_t)type;
+}
+
+static bool send_msg(int sock, const UpgradeMsg* msg, const void* body, size_t body_len,
+                     const int* fds, int nfds)
+{
+    struct iovec iov[2] = {
+        { .iov_base = (void*)msg, .iov_len = sizeof(*msg) },
+        { .iov_base = (void*)body, .iov_len = body_len },
+    };
+    struct msghdr mh = { .msg_iov = iov, .msg_iovlen = body_len ? 2 : 1 };
+    FdControl ctl;
+    if (nfds > 0) {
+        memset(&ctl, 0, sizeof(ctl));
+        mh.msg_control = ctl.buf;
+        mh.msg_controllen = CMSG_SPACE((size_t)nfds * sizeof(int));
+        struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN((size_t)nfds * sizeof(int));
+        memcpy(CMSG_DATA(cm), fds, (size_t)nfds * sizeof(int));
+    }
+    ssize_t n;
+    do n = sendmsg(sock, &mh, MSG_NOSIGNAL); while (n < 0 && errno == EINTR);
+    return n == (ssize_t)(sizeof(*msg) + body_len);
+}
+
+// Receive one message of `type` (bounded by the socket's SO_RCVTIMEO).
+// Attached fds go to `fds` (HOT_UPGRADE_BATCH slots), or are closed when
+// `fds` is NULL. Returns the body length, or -1 (received fds closed).
+static ssize_t recv_msg(int sock, UpgradeMsgType type, UpgradeMsg* msg, void* body, size_t cap,
+                        int* fds, int* nfds)
+{
+    struct iovec iov[2] = {
+        { .iov_base = msg, .iov_len = sizeof(*msg) },
+        { .iov_base = body, .iov_len = cap },
+    };
+    FdControl ctl;
+    struct msghdr mh = {
+        .msg_iov = iov, .msg_iovlen = 2,
+        .msg_control = ctl.buf, .msg_controllen = sizeof(ctl.buf),
+    };
+    ssize_t n;
+    do n = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC); while (n < 0 && errno == EINTR);
+
+    int got = 0;
+    int received[HOT_UPGRADE_BATCH];
+    if (n >= 0) {
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+            if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+            int k = (int)((cm->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            if (got + k > HOT_UPGRADE_BATCH) k = HOT_UPGRADE_BATCH - got;
+            memcpy(received + got, CMSG_DATA(cm), (size_t)k * sizeof(int));
+            got += k;
+        }
+    }
+    bool ok = n >= (ssize_t)sizeof(*msg) && !(mh.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) &&
+              memcmp(msg->magic, UPGRADE_MAGIC, sizeof(msg->magic)) == 0 &&
+              msg->version == UPGRADE_VERSION && msg->type == type;
+    if (!ok || !fds) {
+        close_fds(received, got);
+        got = 0;
+    } else {
+        memcpy(fds, received, (size_t)got * sizeof(int));
+    }
+    if (nfds) *nfds = got;
+    return ok ? n - (ssize_t)sizeof(*msg) : -1;
+}
+
+// === READER THREADS ===
+void hot_upgrade_register(int fd)
+{
+    if (fd < 0 || fd >= HOT_UPGRADE_MAX_FDS) return;
+    pthread_mutex_lock(&lock);
+    ReaderSlot* r = &readers[fd];
+    if (!r->used) {
+        r->used = true;
+        r->has_tid = false;
+        r->parked = false;
+        registered++;
+        if (fd > max_fd) max_fd = fd;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void hot_upgrade_unregister(int fd)
+{
+    if (fd < 0 || fd >= HOT_UPGRADE_MAX_FDS) return;
+    pthread_mutex_lock(&lock);
+    ReaderSlot* r = &readers[fd];
+    if (r->used) {
+        r->used = false;
+        r->has_tid = false;
+        registered--;
+        pthread_cond_broadcast(&parked_cv);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void hot_upgrade_checkpoint(int fd)
+{
+    if (fd < 0 || fd >= HOT_UPGRADE_MAX_FDS) return;
+    ReaderSlot* r = &readers[fd];
+    // has_tid is only written by this thread once the slot is registered
+    if (r->has_tid && !atomic_load_explicit(&frozen, memory_order_acquire)) return;
+
+    pthread_mutex_lock(&lock);
+    if (r->used && !r->has_tid) {
+        r->tid = pthread_self();
+        r->has_tid = true;
+    }
+    if (r->used && atomic_load(&frozen)) {
+        r->parked = true;
+        parked++;
+        pthread_cond_broadcast(&parked_cv);
+        while (atomic_load(&frozen)) pthread_cond_wait(&resume_cv, &lock);
+        r->parked = false;
+        parked--;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+static void on_wake_signal(int sig)
+{
+    (void)sig;
+}
+
+// Stop every registered thread at its checkpoint. Threads blocked in recv /
+// accept are signalled (again every HOT_UPGRADE_KICK_MS, in case the signal
+// landed just before the call); a thread in the middle of a frame finishes
+// reading and submitting it first.
+static bool freeze_readers(uint64_t deadline)
+{
+    pthread_mutex_lock(&lock);
+    atomic_store(&frozen, true);
+    while (parked < registered && mono_ms() < deadline) {
+        for (int fd = 0; fd <= max_fd; fd++) {
+            ReaderSlot* r = &readers[fd];
+            if (r->used && r->has_tid && !r->parked) pthread_kill(r->tid, HOT_UPGRADE_WAKE_SIGNAL);
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += (long)HOT_UPGRADE_KICK_MS * 1000000;
+        ts.tv_sec += ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&parked_cv, &lock, &ts);
+    }
+    bool all = parked == registered;
+    pthread_mutex_unlock(&lock);
+    return all;
+}
+
+static void thaw_readers(void)
+{
+    pthread_mutex_lock(&lock);
+    atomic_store(&frozen, false);
+    pthread_cond_broadcast(&resume_cv);
+    pthread_mutex_unlock(&lock);
+}
+
+// Client fds of the parked readers (malloc'd)
+static int* collect_conns(int* count)
+{
+    pthread_mutex_lock(&lock);
+    int* fds = malloc(((size_t)registered + 1) * sizeof(int));
+    *count = 0;
+    for (int fd = 0; fds && fd <= max_fd; fd++) {
+        if (readers[fd].used && fd != tcp_listen) fds[(*count)++] = fd;
+    }
+    pthread_mutex_unlock(&lock);
+    return fds;
+}
+
+// === OLD PROCESS ===
+static bool send_conns(int peer, const int* fds, int count)
+{
+    UpgradeConn batch[HOT_UPGRADE_BATCH];
+    for (int i = 0; i < count; i += HOT_UPGRADE_BATCH) {
+        int n = count - i < HOT_UPGRADE_BATCH ? count - i : HOT_UPGRADE_BATCH;
+        memset(batch, 0, sizeof(batch));
+        for (int j = 0; j < n; j++) {
+            ConnSession s;
+            if (!conn_session_get(fds[i + j], &s)) continue;
+            int64_t balance = -1;
+            ledger_get_balance(s.user_id, &balance, NULL);
+            batch[j].user_id = s.user_id;
+            batch[j].room_id = s.room_id;
+            batch[j].balance = balance;
+            memcpy(batch[j].session_token, s.session_token, sizeof(batch[j].session_token));
+        }
+        UpgradeMsg msg;
+        init_msg(&msg, UPGRADE_CONNS);
+        msg.conns = (uint32_t)n;
+        if (!send_msg(peer, &msg, batch, (size_t)n * sizeof(UpgradeConn), fds + i, n)) return false;
+    }
+    return true;
+}
+
+static bool send_auctions(int peer, const ScheduledAuction* auctions, int count)
+{
+    UpgradeAuction batch[HOT_UPGRADE_BATCH];
+    for (int i = 0; i < count; i += HOT_UPGRADE_BATCH) {
+        int n = count - i < HOT_UPGRADE_BATCH ? count - i : HOT_UPGRADE_BATCH;
+        memset(batch, 0, sizeof(batch));
+        for (int j = 0; j < n; j++) {
+            const ScheduledAuction* a = &auctions[i + j];
+            UpgradeAuction* u = &batch[j];
+            u->room_id = a->room_id;
+            u->item_id = a->item_id;
+            u->remaining_ms = a->remaining_ms;
+            u->warned = a->warned;
+            LedgerHold hold;
+            int64_t balance;
+            if (ledger_get_hold(a->item_id, &hold) &&
+                ledger_get_balance(hold.user_id, &balance, NULL)) {
+                u->leader_id = hold.user_id;
+                u->leader_amount = hold.amount;
+                u->leader_balance = balance;
+            }
+        }
+        UpgradeMsg msg;
+        init_msg(&msg, UPGRADE_AUCTIONS);
+        msg.auctions = (uint32_t)n;
+        if (!send_msg(peer, &msg, batch, (size_t)n * sizeof(UpgradeAuction), NULL, 0)) return false;
+    }
+    return true;
+}
+
+static bool send_proxies(int peer, const ProxyRegistration* proxies, int count)
+{
+    UpgradeProxy batch[HOT_UPGRADE_BATCH];
+    for (int i = 0; i < count; i += HOT_UPGRADE_BATCH) {
+        int n = count - i < HOT_UPGRADE_BATCH ? count - i : HOT_UPGRADE_BATCH;
+        memset(batch, 0, sizeof(batch));
+        for (int j = 0; j < n; j++) {
+            const ProxyRegistration* p = &proxies[i + j];
+            UpgradeProxy* u = &batch[j];
+            u->room_id = p->room_id;
+            u->item_id = p->item_id;
+            u->user_id = p->user_id;
+            u->max_amount = p->max_amount;
+            u->seq = p->seq;
+            int64_t balance = -1;
+            ledger_get_balance(p->user_id, &balance, NULL);
+            u->balance = balance;
+        }
+        UpgradeMsg msg;
+        init_msg(&msg, UPGRADE_PROXIES);
+        msg.proxies = (uint32_t)n;
+        if (!send_msg(peer, &msg, batch, (size_t)n * sizeof(UpgradeProxy), NULL, 0)) return false;
+    }
+    return true;
+}
+
+// Returns true once the new process owns the sockets
+static bool serve_takeover(int peer)
+{
+    UpgradeMsg msg;
+    set_recv_timeout(peer, HOT_UPGRADE_CONFIRM_MS);
+    if (recv_msg(peer, UPGRADE_HELLO, &msg, NULL, 0, NULL, NULL) < 0) {
+        LOG_WARN("upgrade: dropping a connection that did not say hello");
+        return false;
+    }
+
+    LOG_INFO("upgrade: new process connected, handing over");
+    uint64_t start = mono_ms();
+    uint64_t deadline = start + HOT_UPGRADE_DRAIN_MS;
+    bool drained = freeze_readers(deadline) &&
+                   pipeline_wait_idle(ms_left(deadline)) &&
+                   auth_service_wait_idle(ms_left(deadline));
+
+    int nauctions = 0, nconns = 0, nproxies = 0;
+    ScheduledAuction* auctions = drained ? item_scheduler_pause(&nauctions) : NULL;
+    ProxyRegistration* proxies = drained ? proxy_bid_export(&nproxies) : NULL;
+    int* fds = drained ? collect_conns(&nconns) : NULL;
+
+    init_msg(&msg, UPGRADE_STATE);
+    msg.refused = !fds;
+    msg.conns = (uint32_t)nconns;
+    msg.auctions = (uint32_t)nauctions;
+    msg.proxies = (uint32_t)nproxies;
+    bool ok = send_msg(peer, &msg, NULL, 0, &tcp_listen, fds ? 1 : 0) && fds &&
+              send_conns(peer, fds, nconns) &&
+              send_auctions(peer, auctions, nauctions) &&
+              send_proxies(peer, proxies, nproxies);
+    if (ok) {
+        ok = recv_msg(peer, UPGRADE_ACK, &msg, NULL, 0, NULL, NULL) >= 0 &&
+             msg.conns == (uint32_t)nconns;
+    }
+    if (ok) {
+        init_msg(&msg, UPGRADE_COMMIT);
+        ok = send_msg(peer, &msg, NULL, 0, NULL, 0);
+    }
+    free(fds);
+    free(auctions);
+    free(proxies);
+
+    uint64_t paused_ms = mono_ms() - start;
+    if (!ok) {
+        LOG_WARN("upgrade: handoff %s after %llu ms, resuming",
+                 drained ? "not confirmed" : "could not drain", (unsigned long long)paused_ms);
+        if (drained) item_scheduler_resume();
+        thaw_readers();
+        pthread_mutex_lock(&lock);
+        stats.aborted++;
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    LOG_INFO("upgrade: handed over %d connections, %d auctions and %d proxy bids, paused %llu ms",
+             nconns, nauctions, nproxies, (unsigned long long)paused_ms);
+    return true;
+}
+
+// The new process owns the sockets: write out what is still buffered and
+// exit, leaving the parked threads where they are
+static void finish(void)
+{
+    wire_capture_close();
+    ledger_shutdown();
+    cluster_shutdown();
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+}
+
+static void* listener_main(void* arg)
+{
+    (void)arg;
+    for (;;) {
+        int peer = accept(unix_sock, NULL, NULL);
+        if (peer < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            LOG_ERROR("upgrade: accept failed: %s", strerror(errno));
+            return NULL;
+        }
+        if (serve_takeover(peer)) finish();
+        close(peer);
+    }
+}
+
+bool hot_upgrade_listen(const char* path, int listen_fd)
+{
+    struct sockaddr_un addr;
+    if (!unix_addr(path, &addr)) return false;
+
+    // No SA_RESTART: a blocking recv / accept returns EINTR
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_wake_signal;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(HOT_UPGRADE_WAKE_SIGNAL, &sa, NULL) != 0) return false;
+
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) return false;
+    // Left behind by the process we took over from, or by a crash
+    unlink(path);
+    // Whoever connects gets every client socket: owner only
+    mode_t old_mask = umask(0077);
+    int rc = bind(sock, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc < 0 || listen(sock, 1) < 0) {
+        LOG_ERROR("upgrade: cannot listen on %s: %s", path, strerror(errno));
+        close(sock);
+        return false;
+    }
+
+    unix_sock = sock;
+    tcp_listen = listen_fd;
+    if (pthread_create(&listener_thread, NULL, listener_main, NULL) != 0) {
+        close(sock);
+        unix_sock = -1;
+        return false;
+    }
+    pthread_detach(listener_thread);
+    LOG_INFO("upgrade: waiting for takeovers on %s", path);
+    return true;
+}
+
+// === NEW PROCESS ===
+typedef struct {
+    int count;
+    int32_t users[];
+} WarmList;
+
+// Statistics are loaded from the DB like at login, off the startup path
+static void* warm_main(void* arg)
+{
+    WarmList* w = arg;
+    for (int i = 0; i < w->count; i++) user_stats_load(w->users[i]);
+    free(w);
+    return NULL;
+}
+
+static void start_warmup(const UpgradeConn* conns, uint32_t count)
+{
+    WarmList* w = malloc(sizeof(*w) + (size_t)count * sizeof(int32_t));
+    if (!w) return;
+    w->count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (conns[i].user_id > 0) w->users[w->count++] = conns[i].user_id;
+    }
+    pthread_t tid;
+    if (w->count == 0 || pthread_create(&tid, NULL, warm_main, w) != 0) {
+        free(w);
+        return;
+    }
+    pthread_detach(tid);
+}
+
+// Accounts first, then the holds on them and the clocks, all before the
+// first adopted frame is read: no bid can race a restored leader. Proxy
+// bids come last, once the sessions are back to receive what they place.
+static void restore_state(const int* fds, const UpgradeConn* conns, uint32_t nconns,
+                          const UpgradeAuction* auctions, uint32_t nauctions,
+                          const UpgradeProxy* proxies, uint32_t nproxies,
+                          HotUpgradeAdopt adopt)
+{
+    for (uint32_t i = 0; i < nconns; i++) {
+        if (conns[i].user_id > 0 && conns[i].balance >= 0) {
+            ledger_load_user(conns[i].user_id, conns[i].balance);
+        }
+    }
+    for (uint32_t i = 0; i < nauctions; i++) {
+        const UpgradeAuction* u = &auctions[i];
+        if (u->leader_id > 0) {
+            ledger_load_user(u->leader_id, u->leader_balance);
+            if (ledger_restore_hold(u->item_id, u->leader_id, u->leader_amount) != LEDGER_OK) {
+                LOG_WARN("upgrade: could not restore the hold of user %d on item %d",
+                         u->leader_id, u->item_id);
+            }
+        }
+        ScheduledAuction a = {
+            .room_id = u->room_id, .item_id = u->item_id,
+            .remaining_ms = u->remaining_ms, .warned = u->warned != 0,
+        };
+        if (!item_scheduler_restore(&a)) {
+            LOG_WARN("upgrade: could not restore the clock of item %d", u->item_id);
+        }
+    }
+    for (uint32_t i = 0; i < nconns; i++) {
+        ConnSession s = { .user_id = conns[i].user_id, .room_id = conns[i].room_id };
+        memcpy(s.session_token, conns[i].session_token, sizeof(s.session_token));
+        if (s.user_id > 0) conn_session_set(fds[i], &s);
+        adopt(fds[i]);
+    }
+    for (uint32_t i = 0; i < nproxies; i++) {
+        const UpgradeProxy* u = &proxies[i];
+        int64_t balance;
+        // A bidder who logged out keeps the proxy; the account comes along
+        if (u->balance >= 0 && !ledger_get_balance(u->user_id, &balance, NULL)) {
+            ledger_load_user(u->user_id, u->balance);
+        }
+        ProxyRegistration reg = {
+            .room_id = u->room_id, .item_id = u->item_id, .user_id = u->user_id,
+            .max_amount = u->max_amount, .seq = u->seq,
+        };
+        if (!proxy_bid_restore(&reg)) {
+            LOG_WARN("upgrade: could not restore the proxy bid of user %d on item %d",
+                     u->user_id, u->item_id);
+        }
+    }
+    start_warmup(conns, nconns);
+}
+
+bool hot_upgrade_takeover(const char* path, int* listen_fd, HotUpgradeAdopt adopt)
+{
+    *listen_fd = -1;
+    struct sockaddr_un addr;
+    if (!unix_addr(path, &addr)) return false;
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) return false;
+
+    uint64_t start = mono_ms();
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        int err = errno;
+        close(sock);
+        if (err == ENOENT || err == ECONNREFUSED) return true;     // Cold start
+        LOG_ERROR("upgrade: cannot connect to %s: %s", path, strerror(err));
+        return false;
+    }
+    // The old process drains before it answers
+    set_recv_timeout(sock, HOT_UPGRADE_DRAIN_MS + HOT_UPGRADE_CONFIRM_MS);
+
+    UpgradeMsg msg;
+    int lfd = -1, nfd = 0;
+    int batch_fds[HOT_UPGRADE_BATCH];
+    init_msg(&msg, UPGRADE_HELLO);
+    bool ok = send_msg(sock, &msg, NULL, 0, NULL, 0) &&
+              recv_msg(sock, UPGRADE_STATE, &msg, NULL, 0, batch_fds, &nfd) >= 0;
+    if (ok && nfd == 1 && !msg.refused) {
+        lfd = batch_fds[0];
+    } else {
+        close_fds(batch_fds, nfd);
+        close(sock);
+        LOG_ERROR("upgrade: the running server refused the handoff");
+        return false;
+    }
+
+    uint32_t total_conns = msg.conns, total_auctions = msg.auctions, total_proxies = msg.proxies;
+    int* fds = calloc((size_t)total_conns + 1, sizeof(int));
+    UpgradeConn* conns = calloc((size_t)total_conns + 1, sizeof(UpgradeConn));
+    UpgradeAuction* auctions = calloc((size_t)total_auctions + 1, sizeof(UpgradeAuction));
+    UpgradeProxy* proxies = calloc((size_t)total_proxies + 1, sizeof(UpgradeProxy));
+    ok = fds && conns && auctions && proxies;
+
+    uint32_t got = 0;
+    while (ok && got < total_conns) {
+        UpgradeConn batch[HOT_UPGRADE_BATCH];
+        ssize_t len = recv_msg(sock, UPGRADE_CONNS, &msg, batch, sizeof(batch), batch_fds, &nfd);
+        if (len < 0 || (uint32_t)nfd != msg.conns || got + msg.conns > total_conns ||
+            (size_t)len != msg.conns * sizeof(UpgradeConn)) {
+            close_fds(batch_fds, nfd);
+            ok = false;
+            break;
+        }
+        memcpy(fds + got, batch_fds, (size_t)nfd * sizeof(int));
+        memcpy(conns + got, batch, (size_t)len);
+        got += msg.conns;
+    }
+    uint32_t got_auctions = 0;
+    while (ok && got_auctions < total_auctions) {
+        ssize_t len = recv_msg(sock, UPGRADE_AUCTIONS, &msg, auctions + got_auctions,
+                               (total_auctions - got_auctions) * sizeof(UpgradeAuction), NULL, NULL);
+        if (len < 0 || (size_t)len != msg.auctions * sizeof(UpgradeAuction)) {
+            ok = false;
+            break;
+        }
+        got_auctions += msg.auctions;
+    }
+    uint32_t got_proxies = 0;
+    while (ok && got_proxies < total_proxies) {
+        ssize_t len = recv_msg(sock, UPGRADE_PROXIES, &msg, proxies + got_proxies,
+                               (total_proxies - got_proxies) * sizeof(UpgradeProxy), NULL, NULL);
+        if (len < 0 || (size_t)len != msg.proxies * sizeof(UpgradeProxy)) {
+            ok = false;
+            break;
+        }
+        got_proxies += msg.proxies;
+    }
+    if (ok) {
+        init_msg(&msg, UPGRADE_ACK);
+        msg.conns = got;
+        ok = send_msg(sock, &msg, NULL, 0, NULL, 0) &&
+             recv_msg(sock, UPGRADE_COMMIT, &msg, NULL, 0, NULL, NULL) >= 0;
+    }
+    close(sock);
+
+    if (!ok) {
+        // Our copies only: the old process still serves these sockets
+        LOG_ERROR("upgrade: handoff from %s failed", path);
+        if (fds) close_fds(fds, (int)got);
+        close(lfd);
+    } else {
+        restore_state(fds, conns, got, auctions, got_auctions, proxies, got_proxies, adopt);
+        *listen_fd = lfd;
+        pthread_mutex_lock(&lock);
+        stats.adopted_conns = got;
+        stats.adopted_auctions = got_auctions;
+        stats.adopted_proxies = got_proxies;
+        stats.takeover_ms = (uint32_t)(mono_ms() - start);
+        pthread_mutex_unlock(&lock);
+        LOG_INFO("upgrade: took over %u connections, %u auctions and %u proxy bids in %u ms",
+                 got, got_auctions, got_proxies, stats.takeover_ms);
+    }
+    free(fds);
+    free(conns);
+    free(auctions);
+    free(proxies);
+    return ok;
+}
+
+void hot_upgrade_get_stats(HotUpgradeStats* out)
+{
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
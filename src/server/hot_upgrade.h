@@ -0,0 +1,66 @@
+#ifndef HOT_UPGRADE_H
+#define HOT_UPGRADE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+
+// ========== Zero-Downtime Restart ==========
+// To deploy, start the new binary with the same --upgrade-sock=<path> as the
+// running one. It initializes as usual, except that the item timer stays
+// paused and --import-items waits (both would act on auctions the old
+// process still runs), then connects to <path> and the old process:
+//   1. stops accepting and parks every reader thread between two frames,
+//   2. waits until in-flight requests and queued logins are answered, and
+//      pauses the item timer (pending queue changes are written first),
+//   3. sends the listening socket and every client fd over the Unix socket
+//      (SCM_RIGHTS, HOT_UPGRADE_BATCH per message) with each connection's
+//      session (conn_session.h), the running auction clocks, the leading
+//      bidders' holds and the proxy bid registrations (proxy_bid.h),
+// then exits once the new process confirms. Clients stay connected: what
+// they send meanwhile waits in the socket buffers for the new process. The
+// restart gap runs from step 1 to the new process's first read.
+//
+// If the old process cannot drain within HOT_UPGRADE_DRAIN_MS, or the new
+// one does not confirm, the old process resumes serving and the new one
+// exits. With nobody listening on <path> the new process starts cold.
+// Threaded I/O backend only.
+
+#define HOT_UPGRADE_MAX_FDS       65536
+#define HOT_UPGRADE_BATCH         64        // fds / records per message (kernel limit 253)
+#define HOT_UPGRADE_DRAIN_MS      3000
+#define HOT_UPGRADE_CONFIRM_MS    5000
+#define HOT_UPGRADE_KICK_MS       5         // Re-signal readers that have not parked yet
+#define HOT_UPGRADE_WAKE_SIGNAL   SIGURG    // Interrupts a blocking recv / accept
+
+// Called for every client fd taken over, after its session is restored
+typedef void (*HotUpgradeAdopt)(int sockfd);
+
+// New process. Returns false if a process answered on `path` but the handoff
+// failed (it keeps serving). On success *listen_fd is the inherited listening
+// socket, or -1 if nobody answered (cold start: bind one yourself).
+bool hot_upgrade_takeover(const char* path, int* listen_fd, HotUpgradeAdopt adopt);
+
+// Serve the next takeover on `path` from a background thread
+bool hot_upgrade_listen(const char* path, int listen_fd);
+
+// Threads blocking on a socket: one per client, plus the accept loop.
+// Register the fd before its thread starts and unregister it before the
+// fd is closed.
+void hot_upgrade_register(int fd);
+void hot_upgrade_unregister(int fd);
+// Called by the owning thread before each blocking read and again when the
+// read fails with EINTR: parks the thread while a handoff is in progress
+void hot_upgrade_checkpoint(int fd);
+
+typedef struct {
+    uint32_t adopted_conns;     // Taken over at startup
+    uint32_t adopted_auctions;
+    uint32_t adopted_proxies;
+    uint32_t takeover_ms;       // Connect to confirmed, in the new process
+    uint32_t aborted;           // Handoffs this process gave up on
+} HotUpgradeStats;
+
+void hot_upgrade_get_stats(HotUpgradeStats* out);
+
+#endif
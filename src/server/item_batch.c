@@ -0,0 +1,203 @@
+#include "item_batch.h"
+#include "protocol.h"
+#include "message_dispatch.h"
+#include "network_utils.h"
+#include "conn_session.h"
+#include "room_service.h"
+#include "auction_events.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct {
+    int sockfd;             // -1 = free slot
+    uint32_t batch_id;
+    uint16_t next_seq;
+    int32_t room_id;
+    int32_t seller_id;
+    uint64_t last_ms;
+    CreateItemReq* rows;    // CREATE_ITEMS_MAX
+    int count;
+} OpenBatch;
+
+static OpenBatch batches[ITEM_BATCH_OPEN_MAX] = {
+    [0 ... ITEM_BATCH_OPEN_MAX - 1] = { .sockfd = -1 }
+};
+static ItemBatchStats stats;
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Caller holds batch_lock
+static void drop(OpenBatch* b)
+{
+    free(b->rows);
+    memset(b, 0, sizeof(*b));
+    b->sockfd = -1;
+    stats.open--;
+}
+
+// Caller holds batch_lock
+static void expire_idle(uint64_t now)
+{
+    for (int i = 0; i < ITEM_BATCH_OPEN_MAX; i++) {
+        if (batches[i].sockfd >= 0 && now - batches[i].last_ms > ITEM_BATCH_IDLE_MS) {
+            LOG_WARN("Client %d: bulk item batch %u idle, dropped",
+                     batches[i].sockfd, batches[i].batch_id);
+            drop(&batches[i]);
+            stats.expired++;
+        }
+    }
+}
+
+// Caller holds batch_lock. A connection has at most one batch open: a new
+// seq 0 replaces whatever it left unfinished.
+static OpenBatch* find(int sockfd)
+{
+    for (int i = 0; i < ITEM_BATCH_OPEN_MAX; i++) {
+        if (batches[i].sockfd == sockfd) return &batches[i];
+    }
+    return NULL;
+}
+
+static OpenBatch* claim(int sockfd)
+{
+    OpenBatch* b = find(sockfd);
+    if (b) {
+        drop(b);
+        stats.expired++;
+    } else {
+        b = find(-1);
+        if (!b) return NULL;
+    }
+    b->rows = malloc(sizeof(CreateItemReq) * CREATE_ITEMS_MAX);
+    if (!b->rows) return NULL;
+    b->sockfd = sockfd;
+    stats.open++;
+    return b;
+}
+
+static void reply(int sockfd, uint32_t request_id, int32_t status, uint32_t batch_id,
+                  const char* message)
+{
+    CreateItemsRes res = { .status = status, .batch_id = batch_id };
+    snprintf(res.message, sizeof(res.message), "%s", message);
+    send_response(sockfd, CREATE_ITEMS_RES, request_id, &res, sizeof(res));
+}
+
+// Results of the whole batch, as many pages as it takes
+static void reply_results(int sockfd, uint32_t request_id, uint32_t batch_id,
+                          const CreateItemResult* results, int count, int created)
+{
+    char out[BUFF_SIZE];
+    const int per_page = (int)((sizeof(out) - sizeof(CreateItemsRes)) / sizeof(CreateItemResult));
+    int offset = 0;
+    do {
+        int n = count - offset < per_page ? count - offset : per_page;
+        CreateItemsRes res = {
+            .status = created == count ? STATUS_SUCCESS : STATUS_FAIL,
+            .batch_id = batch_id, .created = (uint32_t)created,
+            .count = (uint16_t)n, .offset = (uint16_t)offset,
+            .next_offset = offset + n < count ? (uint16_t)(offset + n) : 0,
+        };
+        snprintf(res.message, sizeof(res.message), "Created %d of %d items", created, count);
+        uint32_t len = encode_CREATE_ITEMS_RES(&res, results + offset,
+                                               (uint32_t)(n * sizeof(CreateItemResult)),
+                                               out, sizeof(out));
+        send_response(sockfd, CREATE_ITEMS_RES, request_id, out, len);
+        offset += n;
+    } while (offset < count);
+}
+
+void handle_create_items(int sockfd, const MessageHeader* header, const char* payload)
+{
+    // message_accept has checked that the rows fill the payload
+    CreateItemsReq req;
+    if (!decode_CREATE_ITEMS_REQ(payload, header->payload_length, &req)) return;
+
+    ConnSession session;
+    if (!conn_session_get(sockfd, &session) || session.room_id <= 0) {
+        reply(sockfd, header->request_id, STATUS_INVALID, req.batch_id, "Join a room first");
+        return;
+    }
+
+    uint64_t now = auction_events_now_ms();
+    const char* error = NULL;
+    pthread_mutex_lock(&batch_lock);
+    stats.frames++;
+    expire_idle(now);
+
+    OpenBatch* b = find(sockfd);
+    if (req.seq == 0) {
+        b = claim(sockfd);
+        if (!b) error = "Too many open batches";
+        else {
+            b->batch_id = req.batch_id;
+            b->room_id = session.room_id;
+            b->seller_id = session.user_id;
+        }
+    } else if (!b || b->batch_id != req.batch_id || req.seq != b->next_seq) {
+        error = "Batch frame out of sequence";
+    } else if (b->room_id != session.room_id) {
+        error = "Room changed during the batch";
+    }
+    if (!error && b->count + req.count > CREATE_ITEMS_MAX) error = "Batch too large";
+    if (error) {
+        if (b && b->batch_id == req.batch_id) drop(b);
+        stats.rejected++;
+        pthread_mutex_unlock(&batch_lock);
+        reply(sockfd, header->request_id, STATUS_INVALID, req.batch_id, error);
+        return;
+    }
+
+    const char* p = payload + sizeof(req);
+    for (uint16_t i = 0; i < req.count; i++) p += decode_create_items_row(p, &b->rows[b->count++]);
+    b->next_seq++;
+    b->last_ms = now;
+    if (!req.last) {
+        pthread_mutex_unlock(&batch_lock);
+        reply(sockfd, header->request_id, STATUS_SUCCESS, req.batch_id, "Queued");
+        return;
+    }
+
+    // Detach the batch; the inserts run without the lock
+    OpenBatch done = *b;
+    b->rows = NULL;
+    drop(b);
+    stats.batches++;
+    pthread_mutex_unlock(&batch_lock);
+
+    CreateItemResult* results = malloc(sizeof(CreateItemResult) * (size_t)done.count);
+    if (!results) {
+        free(done.rows);
+        reply(sockfd, header->request_id, STATUS_FAIL, req.batch_id, "Out of memory");
+        return;
+    }
+    int created = room_service_create_items(done.room_id, done.seller_id, done.rows,
+                                            done.count, results);
+    reply_results(sockfd, header->request_id, req.batch_id, results, done.count, created);
+
+    pthread_mutex_lock(&batch_lock);
+    stats.items_created += (uint64_t)created;
+    pthread_mutex_unlock(&batch_lock);
+    free(results);
+    free(done.rows);
+}
+
+void item_batch_conn_close(int sockfd)
+{
+    pthread_mutex_lock(&batch_lock);
+    OpenBatch* b = find(sockfd);
+    if (b) {
+        drop(b);
+        stats.expired++;
+    }
+    pthread_mutex_unlock(&batch_lock);
+}
+
+void item_batch_get_stats(ItemBatchStats* out)
+{
+    pthread_mutex_lock(&batch_lock);
+    *out = stats;
+    pthread_mutex_unlock(&batch_lock);
+}
@@ -0,0 +1,36 @@
+#ifndef ITEM_BATCH_H
+#define ITEM_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Bulk Item Batches (CREATE_ITEMS_REQ) ==========
+// A seller listing hundreds of items sends them as one batch spread over
+// several frames (protocol_payloads.h). Frames of a connection run in
+// arrival order (request_pipeline.h), so rows are appended as they come;
+// the last frame hands the whole batch to room_service_create_items, which
+// inserts it DB_ITEM_INSERT_BATCH rows per statement. The items go to the
+// room the seller has joined (conn_session.h).
+//
+// A batch that skips a seq number or grows past CREATE_ITEMS_MAX is
+// dropped and answered with STATUS_INVALID. Batches left open are dropped
+// when their connection closes or after ITEM_BATCH_IDLE_MS without a frame.
+
+#define ITEM_BATCH_OPEN_MAX   64        // Batches being received, server-wide
+#define ITEM_BATCH_IDLE_MS    30000
+
+// Drop the batch a closed connection left open
+void item_batch_conn_close(int sockfd);
+
+typedef struct {
+    uint64_t frames;
+    uint64_t batches;           // Completed (last frame received)
+    uint64_t items_created;
+    uint64_t rejected;          // Out of sequence, too large, or no free slot
+    uint64_t expired;           // Dropped idle, replaced, or with their connection
+    uint32_t open;
+} ItemBatchStats;
+
+void item_batch_get_stats(ItemBatchStats* out);
+
+#endif
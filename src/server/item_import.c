@@ -0,0 +1,189 @@
+#include "item_import.h"
+#include "room_service.h"
+#include "db_adapter.h"
+#include "protocol_helpers.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+
+#define CSV_FIELD_MAX 256   // Longest column (description), terminator included
+
+typedef struct {
+    char field[ITEM_IMPORT_FIELDS][CSV_FIELD_MAX];
+    size_t len[ITEM_IMPORT_FIELDS];
+    int count;              // Fields seen, may exceed ITEM_IMPORT_FIELDS
+    bool too_long;
+    uint32_t line;          // Line the record starts on
+} CsvRecord;
+
+static uint64_t mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void record_put(CsvRecord* rec, int c)
+{
+    int i = rec->count - 1;
+    if (i >= ITEM_IMPORT_FIELDS) return;
+    if (rec->len[i] + 1 >= CSV_FIELD_MAX) {
+        rec->too_long = true;
+        return;
+    }
+    rec->field[i][rec->len[i]++] = (char)c;
+    rec->field[i][rec->len[i]] = '\0';
+}
+
+// Read one record; false at end of file. `line` is the current line number.
+static bool read_record(FILE* f, CsvRecord* rec, uint32_t* line)
+{
+    int c = getc(f);
+    if (c == EOF) return false;
+
+    memset(rec->len, 0, sizeof(rec->len));
+    for (int i = 0; i < ITEM_IMPORT_FIELDS; i++) rec->field[i][0] = '\0';
+    rec->count = 1;
+    rec->too_long = false;
+    rec->line = *line;
+
+    bool quoted = false;
+    for (; c != EOF; c = getc(f)) {
+        if (quoted) {
+            if (c != '"') {
+                if (c == '\n') (*line)++;
+                record_put(rec, c);
+                continue;
+            }
+            c = getc(f);
+            if (c == '"') {
+                record_put(rec, c);     // "" inside quotes
+                continue;
+            }
+            quoted = false;
+            if (c == EOF) break;
+            // Fall through: the character after the closing quote
+        }
+        int i = rec->count - 1;
+        if (c == '"' && (i >= ITEM_IMPORT_FIELDS || rec->len[i] == 0)) {
+            quoted = true;
+        } else if (c == ',') {
+            rec->count++;
+        } else if (c == '\n') {
+            (*line)++;
+            break;
+        } else if (c != '\r') {
+            record_put(rec, c);
+        }
+    }
+    return true;
+}
+
+static bool parse_i64(const char* s, int64_t* out)
+{
+    char* end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10);
+    if (errno || end == s || *end != '\0') return false;
+    *out = v;
+    return true;
+}
+
+// Fill `row` from a record; returns the reason if the row is unusable
+static const char* parse_row(const CsvRecord* rec, CreateItemReq* row)
+{
+    if (rec->count != ITEM_IMPORT_FIELDS) return "expected 5 columns";
+    if (rec->too_long ||
+        rec->len[0] >= sizeof(row->name) || rec->len[1] >= sizeof(row->description)) {
+        return "field too long";
+    }
+
+    int64_t start, buy_now, duration;
+    if (!parse_i64(rec->field[2], &start)) return "bad start_price";
+    if (!parse_i64(rec->field[3], &buy_now)) return "bad buy_now_price";
+    if (!parse_i64(rec->field[4], &duration) || duration < 0 || duration > UINT32_MAX) {
+        return "bad duration_sec";
+    }
+
+    memset(row, 0, sizeof(*row));
+    memcpy(row->name, rec->field[0], rec->len[0]);
+    memcpy(row->description, rec->field[1], rec->len[1]);
+    row->start_price = start;
+    row->buy_now_price = buy_now;
+    row->duration_sec = (uint32_t)duration;
+    return NULL;
+}
+
+static void import_batch(const char* path, int32_t room_id, int32_t seller_id,
+                         CreateItemReq* rows, CreateItemResult* results,
+                         const uint32_t* lines, int count, ItemImportReport* out)
+{
+    out->created += (uint32_t)room_service_create_items(room_id, seller_id, rows, count, results);
+    for (int i = 0; i < count; i++) {
+        if (results[i].status == STATUS_INVALID) {
+            out->rejected++;
+            LOG_WARN("import %s:%u: invalid name, text or prices", path, lines[i]);
+        } else if (results[i].status != STATUS_SUCCESS) {
+            out->failed++;
+            LOG_WARN("import %s:%u: insert failed", path, lines[i]);
+        }
+    }
+}
+
+bool item_import_csv(const char* path, int32_t room_id, int32_t seller_id,
+                     ItemImportReport* out)
+{
+    memset(out, 0, sizeof(*out));
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        LOG_ERROR("import: cannot open %s", path);
+        return false;
+    }
+
+    CreateItemReq* rows = malloc(sizeof(CreateItemReq) * DB_ITEM_INSERT_BATCH);
+    CreateItemResult* results = malloc(sizeof(CreateItemResult) * DB_ITEM_INSERT_BATCH);
+    uint32_t* lines = malloc(sizeof(uint32_t) * DB_ITEM_INSERT_BATCH);
+    CsvRecord* rec = malloc(sizeof(CsvRecord));
+    if (!rows || !results || !lines || !rec) {
+        free(rows); free(results); free(lines); free(rec);
+        fclose(f);
+        return false;
+    }
+
+    uint64_t start = mono_ms();
+    uint32_t line = 1;
+    bool first = true;
+    int n = 0;
+    while (read_record(f, rec, &line)) {
+        if (rec->count == 1 && rec->len[0] == 0) continue;     // Blank line
+        if (first) {
+            first = false;
+            if (rec->count == ITEM_IMPORT_FIELDS && strcmp(rec->field[0], "name") == 0) continue;
+        }
+        out->rows++;
+
+        const char* err = parse_row(rec, &rows[n]);
+        if (err) {
+            out->rejected++;
+            LOG_WARN("import %s:%u: %s", path, rec->line, err);
+            continue;
+        }
+        lines[n++] = rec->line;
+        if (n == DB_ITEM_INSERT_BATCH) {
+            import_batch(path, room_id, seller_id, rows, results, lines, n, out);
+            n = 0;
+        }
+    }
+    if (n > 0) import_batch(path, room_id, seller_id, rows, results, lines, n, out);
+    out->elapsed_ms = mono_ms() - start;
+
+    LOG_INFO("import %s: %u rows, %u created, %u rejected, %u failed in %" PRIu64 " ms",
+             path, out->rows, out->created, out->rejected, out->failed, out->elapsed_ms);
+
+    free(rows); free(results); free(lines); free(rec);
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef ITEM_IMPORT_H
+#define ITEM_IMPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== CSV Item Import ==========
+// Loads a seller's listing (an estate sale, a catalogue) into a room from a
+// CSV file, through room_service_create_items: rows are parsed and checked,
+// get consecutive queue positions, and are inserted DB_ITEM_INSERT_BATCH
+// per statement. One line per bad row is logged with its line number; the
+// other rows are still imported.
+//
+// Columns: name,description,start_price,buy_now_price,duration_sec
+// (prices in VND, buy_now_price 0 = none, duration 0 = default). Fields
+// may be quoted ("" for a quote, newlines allowed inside quotes). A first
+// line starting with "name," is taken as a header and skipped.
+
+#define ITEM_IMPORT_FIELDS  5
+
+typedef struct {
+    uint32_t rows;          // Data rows read
+    uint32_t created;
+    uint32_t rejected;      // Unparseable or failed validation
+    uint32_t failed;        // Valid, but their batch insert failed
+    uint64_t elapsed_ms;
+} ItemImportReport;
+
+bool item_import_csv(const char* path, int32_t room_id, int32_t seller_id,
+                     ItemImportReport* out);
+
+#endif
@@ -0,0 +1,785 @@
+#include "item_scheduler.h"
+#include "auction_events.h"
+#include "bid_service.h"
+#include "cluster.h"
+#include "db_adapter.h"
+#include "mem_pool.h"
+#include "protocol_helpers.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct QueuedItem {
+    struct QueuedItem* hash_next;
+    int32_t item_id;
+    int32_t room_id;
+    int32_t position;
+    uint32_t duration_sec;
+    int32_t heap_index;
+} QueuedItem;
+
+typedef struct RoomSched {
+    struct RoomSched* next;         // Room hash chain
+    struct RoomSched* all_next;     // List walked by the timer
+    int32_t room_id;
+    bool loaded;
+    bool owned;                     // This node holds the room lease (cluster.h)
+    bool reload;                    // Another node changed the queue
+    pthread_mutex_t lock;
+
+    QueuedItem** heap;              // Min-heap on (position, item_id)
+    int32_t heap_len;
+    int32_t heap_cap;
+    int32_t next_position;
+
+    int32_t active_item;            // 0 = idle
+    uint64_t end_ms;
+    bool warned;
+} RoomSched;
+
+static RoomSched* room_buckets[SCHED_ROOM_BUCKETS];
+static RoomSched* all_rooms;
+static pthread_mutex_t room_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Queued items by id, for O(1) lookup before an O(log n) heap removal
+static QueuedItem* item_buckets[SCHED_ITEM_BUCKETS];
+static pthread_mutex_t item_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static Slab item_slab;
+
+static ItemQueueChange journal[SCHED_JOURNAL_CAP];
+static uint32_t journal_head;
+static uint32_t journal_count;
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Auctions expired here whose leading bid is held on another node
+typedef struct {
+    int32_t room_id;
+    int32_t item_id;
+    uint64_t deadline_ms;
+} PendingExpiry;
+
+static PendingExpiry expiring[SCHED_EXPIRY_MAX];
+static int expiring_count;
+static pthread_mutex_t expiry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t timer_thread;
+static atomic_bool running;
+static atomic_bool paused;
+static pthread_mutex_t tick_lock = PTHREAD_MUTEX_INITIALIZER;   // Held for one timer pass
+static _Atomic uint64_t activations, extensions, flush_batches, journal_stalls, expiry_timeouts;
+static _Atomic uint64_t load_failures;
+
+// === HEAP ===
+static bool heap_less(const QueuedItem* a, const QueuedItem* b)
+{
+    if (a->position != b->position) return a->position < b->position;
+    return a->item_id < b->item_id;
+}
+
+static void heap_set(RoomSched* r, int32_t i, QueuedItem* it)
+{
+    r->heap[i] = it;
+    it->heap_index = i;
+}
+
+static void sift_up(RoomSched* r, int32_t i)
+{
+    QueuedItem* it = r->heap[i];
+    while (i > 0) {
+        int32_t parent = (i - 1) / 2;
+        if (!heap_less(it, r->heap[parent])) break;
+        heap_set(r, i, r->heap[parent]);
+        i = parent;
+    }
+    heap_set(r, i, it);
+}
+
+static void sift_down(RoomSched* r, int32_t i)
+{
+    QueuedItem* it = r->heap[i];
+    for (;;) {
+        int32_t child = 2 * i + 1;
+        if (child >= r->heap_len) break;
+        if (child + 1 < r->heap_len && heap_less(r->heap[child + 1], r->heap[child])) child++;
+        if (!heap_less(r->heap[child], it)) break;
+        heap_set(r, i, r->heap[child]);
+        i = child;
+    }
+    heap_set(r, i, it);
+}
+
+static bool heap_push(RoomSched* r, QueuedItem* it)
+{
+    if (r->heap_len == r->heap_cap) {
+        int32_t cap = r->heap_cap ? r->heap_cap * 2 : 16;
+        QueuedItem** grown = realloc(r->heap, (size_t)cap * sizeof(*grown));
+        if (!grown) return false;
+        r->heap = grown;
+        r->heap_cap = cap;
+    }
+    heap_set(r, r->heap_len++, it);
+    sift_up(r, it->heap_index);
+    return true;
+}
+
+static void heap_remove_at(RoomSched* r, int32_t i)
+{
+    QueuedItem* last = r->heap[--r->heap_len];
+    if (i == r->heap_len) return;
+    heap_set(r, i, last);
+    sift_down(r, i);
+    sift_up(r, last->heap_index);
+}
+
+// === ITEM TABLE ===
+#define ITEM_BUCKET(id) ((uint32_t)(id) % SCHED_ITEM_BUCKETS)
+
+static void item_table_insert(QueuedItem* it)
+{
+    pthread_mutex_lock(&item_table_lock);
+    it->hash_next = item_buckets[ITEM_BUCKET(it->item_id)];
+    item_buckets[ITEM_BUCKET(it->item_id)] = it;
+    pthread_mutex_unlock(&item_table_lock);
+}
+
+static QueuedItem* item_table_take(int32_t item_id, bool remove)
+{
+    pthread_mutex_lock(&item_table_lock);
+    QueuedItem** pp = &item_buckets[ITEM_BUCKET(item_id)];
+    while (*pp && (*pp)->item_id != item_id) pp = &(*pp)->hash_next;
+    QueuedItem* it = *pp;
+    if (it && remove) *pp = it->hash_next;
+    pthread_mutex_unlock(&item_table_lock);
+    return it;
+}
+
+// === JOURNAL ===
+// Returns the number of journal entries written (0: nothing pending, or the
+// write failed)
+static uint32_t flush_journal(void)
+{
+    ItemQueueChange batch[256];
+    int merged = 0;
+
+    // One writer at a time: the timer, a handoff or a room stalled on a
+    // full journal; each drops the entries it wrote from the head
+    pthread_mutex_lock(&flush_lock);
+    pthread_mutex_lock(&journal_lock);
+    uint32_t n = journal_count < 256 ? journal_count : 256;
+    for (uint32_t i = 0; i < n; i++) {
+        const ItemQueueChange* c = &journal[(journal_head + i) % SCHED_JOURNAL_CAP];
+        // One row per item: later changes override earlier fields
+        int j = 0;
+        while (j < merged && batch[j].item_id != c->item_id) j++;
+        if (j == merged) {
+            batch[merged++] = *c;
+        } else {
+            if (c->status) batch[j].status = c->status;
+            if (c->queue_position > 0) batch[j].queue_position = c->queue_position;
+        }
+    }
+    pthread_mutex_unlock(&journal_lock);
+    if (n == 0) {
+        pthread_mutex_unlock(&flush_lock);
+        return 0;
+    }
+
+    if (!db_apply_item_queue_changes(batch, merged)) {
+        pthread_mutex_unlock(&flush_lock);
+        LOG_ERROR("scheduler: failed to persist %d item changes, will retry", merged);
+        return 0;
+    }
+    pthread_mutex_lock(&journal_lock);
+    journal_head = (journal_head + n) % SCHED_JOURNAL_CAP;
+    journal_count -= n;
+    pthread_mutex_unlock(&journal_lock);
+    pthread_mutex_unlock(&flush_lock);
+    atomic_fetch_add(&flush_batches, 1);
+    return n;
+}
+
+// A full journal is written out by the caller before it adds its change;
+// while the DB is down the caller waits, so no status or position change
+// is ever lost
+static void journal_push(int32_t item_id, const char* status, int32_t position)
+{
+    pthread_mutex_lock(&journal_lock);
+    while (journal_count == SCHED_JOURNAL_CAP) {
+        pthread_mutex_unlock(&journal_lock);
+        atomic_fetch_add(&journal_stalls, 1);
+        if (flush_journal() == 0) usleep(SCHED_FLUSH_MS * 1000);
+        pthread_mutex_lock(&journal_lock);
+    }
+    ItemQueueChange* c = &journal[(journal_head + journal_count) % SCHED_JOURNAL_CAP];
+    c->item_id = item_id;
+    c->status = status;
+    c->queue_position = position;
+    journal_count++;
+    pthread_mutex_unlock(&journal_lock);
+}
+
+// === ROOMS ===
+static void publish(AuctionEventType type, int32_t room_id, int32_t item_id, int64_t amount)
+{
+    AuctionEvent ev = { .type = type, .room_id = room_id, .item_id = item_id, .amount = amount };
+    auction_events_publish(&ev);
+}
+
+// Pull room state from the DB the first time the room is touched.
+// Caller holds r->lock. On a failed read the room stays unloaded (empty
+// queue, positions unknown) and the next lock_room or tick tries again.
+static bool load_room(RoomSched* r)
+{
+    PGresult* res = NULL;
+    if (!db_get_room_items(r->room_id, DB_READ_PRIMARY, &res)) {
+        if (res) PQclear(res);
+        atomic_fetch_add(&load_failures, 1);
+        return false;
+    }
+    r->loaded = true;
+    r->next_position = 1;
+    uint64_t now = auction_events_now_ms();
+    for (int row = 0; row < PQntuples(res); row++) {
+        int32_t item_id = atoi(PQgetvalue(res, row, 0));
+        const char* status = PQgetvalue(res, row, 5);
+        int32_t position = atoi(PQgetvalue(res, row, 7));
+        if (position >= r->next_position) r->next_position = position + 1;
+        if (item_id == r->active_item) continue;    // Status change not flushed yet
+
+        if (strcmp(status, "pending") == 0 || strcmp(status, "scheduled") == 0) {
+            QueuedItem* it = slab_alloc(&item_slab);
+            if (!it) break;
+            it->item_id = item_id;
+            it->room_id = r->room_id;
+            it->position = position;
+            it->duration_sec = SCHED_DEFAULT_DURATION;
+            if (!heap_push(r, it)) {
+                slab_free(&item_slab, it);
+                break;
+            }
+            item_table_insert(it);
+        } else if (!r->active_item &&
+                   (strcmp(status, "bidding") == 0 || strcmp(status, "active") == 0)) {
+            // The end time is not stored; restart the clock
+            r->active_item = item_id;
+            r->end_ms = now + (uint64_t)SCHED_DEFAULT_DURATION * 1000;
+        }
+    }
+    PQclear(res);
+    return true;
+}
+
+// Drop the queue so the next lock_room reloads it. Caller holds r->lock.
+static void reset_room(RoomSched* r)
+{
+    while (r->heap_len > 0) {
+        QueuedItem* it = r->heap[--r->heap_len];
+        item_table_take(it->item_id, true);
+        slab_free(&item_slab, it);
+    }
+    r->loaded = false;
+    r->reload = false;
+}
+
+// Returns the room locked, creating and loading it on first use. With
+// `need_queue` (positions, queue changes) NULL if the room cannot be
+// loaded; the active item alone does not need the queue.
+static RoomSched* lock_room(int32_t room_id, bool need_queue)
+{
+    uint32_t b = (uint32_t)room_id % SCHED_ROOM_BUCKETS;
+    pthread_mutex_lock(&room_table_lock);
+    RoomSched* r = room_buckets[b];
+    while (r && r->room_id != room_id) r = r->next;
+    if (!r) {
+        r = calloc(1, sizeof(*r));
+        if (!r) {
+            pthread_mutex_unlock(&room_table_lock);
+            return NULL;
+        }
+        r->room_id = room_id;
+        r->owned = !cluster_enabled();
+        pthread_mutex_init(&r->lock, NULL);
+        r->next = room_buckets[b];
+        room_buckets[b] = r;
+        r->all_next = all_rooms;
+        all_rooms = r;
+    }
+    pthread_mutex_unlock(&room_table_lock);
+
+    pthread_mutex_lock(&r->lock);
+    if (!r->loaded && !load_room(r) && need_queue) {
+        pthread_mutex_unlock(&r->lock);
+        return NULL;
+    }
+    return r;
+}
+
+// Start the next queued item if the room is idle and run by this node.
+// Caller holds r->lock; returns the activated item (0 if none) for
+// publishing after unlock.
+static int32_t activate_next(RoomSched* r, uint32_t* duration)
+{
+    if (!r->owned || r->active_item || r->heap_len == 0) return 0;
+
+    QueuedItem* it = r->heap[0];
+    heap_remove_at(r, 0);
+    item_table_take(it->item_id, true);
+
+    r->active_item = it->item_id;
+    r->end_ms = auction_events_now_ms() + (uint64_t)it->duration_sec * 1000;
+    r->warned = false;
+    *duration = it->duration_sec;
+    journal_push(it->item_id, "active", 0);
+    slab_free(&item_slab, it);
+    atomic_fetch_add(&activations, 1);
+    return r->active_item;
+}
+
+static void activate_and_publish(RoomSched* r)
+{
+    uint32_t duration = 0;
+    int32_t started = activate_next(r, &duration);
+    pthread_mutex_unlock(&r->lock);
+    if (started) publish(EVENT_ITEM_ACTIVATED, r->room_id, started, duration);
+}
+
+// === PUBLIC API ===
+int32_t item_scheduler_next_position(int32_t room_id)
+{
+    RoomSched* r = lock_room(room_id, true);
+    if (!r) return -1;
+    int32_t pos = r->next_position++;
+    pthread_mutex_unlock(&r->lock);
+    return pos;
+}
+
+int32_t item_scheduler_reserve_positions(int32_t room_id, int32_t count)
+{
+    if (count <= 0) return -1;
+    RoomSched* r = lock_room(room_id, true);
+    if (!r) return -1;
+    int32_t first = r->next_position;
+    r->next_position += count;
+    pthread_mutex_unlock(&r->lock);
+    return first;
+}
+
+bool item_scheduler_enqueue(int32_t room_id, int32_t item_id, int32_t queue_position,
+                            uint32_t duration_sec)
+{
+    RoomSched* r = lock_room(room_id, true);
+    if (!r) return false;
+
+    QueuedItem* it = slab_alloc(&item_slab);
+    if (!it) {
+        pthread_mutex_unlock(&r->lock);
+        return false;
+    }
+    it->item_id = item_id;
+    it->room_id = room_id;
+    it->position = queue_position;
+    it->duration_sec = duration_sec ? duration_sec : SCHED_DEFAULT_DURATION;
+    if (queue_position >= r->next_position) r->next_position = queue_position + 1;
+    if (!heap_push(r, it)) {
+        slab_free(&item_slab, it);
+        pthread_mutex_unlock(&r->lock);
+        return false;
+    }
+    item_table_insert(it);
+    activate_and_publish(r);
+    return true;
+}
+
+bool item_scheduler_remove(int32_t room_id, int32_t item_id)
+{
+    RoomSched* r = lock_room(room_id, false);
+    if (!r) return false;
+
+    if (r->active_item == item_id) {
+        // Auction withdrawn mid-way: move straight on to the next item
+        r->active_item = 0;
+        activate_and_publish(r);
+        return true;
+    }
+
+    QueuedItem* it = item_table_take(item_id, false);
+    if (!it || it->room_id != room_id) {
+        pthread_mutex_unlock(&r->lock);
+        return false;
+    }
+    item_table_take(item_id, true);
+    heap_remove_at(r, it->heap_index);
+    slab_free(&item_slab, it);
+    pthread_mutex_unlock(&r->lock);
+    return true;
+}
+
+bool item_scheduler_reorder(int32_t room_id, int32_t item_id, int32_t new_position)
+{
+    if (new_position <= 0) return false;
+    RoomSched* r = lock_room(room_id, true);
+    if (!r) return false;
+
+    QueuedItem* it = item_table_take(item_id, false);
+    if (!it || it->room_id != room_id) {
+        pthread_mutex_unlock(&r->lock);
+        return false;
+    }
+    it->position = new_position;
+    sift_up(r, it->heap_index);
+    sift_down(r, it->heap_index);
+    if (new_position >= r->next_position) r->next_position = new_position + 1;
+    journal_push(item_id, NULL, new_position);
+    pthread_mutex_unlock(&r->lock);
+    return true;
+}
+
+bool item_scheduler_current(int32_t room_id, int32_t* item_id, uint32_t* remaining_sec)
+{
+    RoomSched* r = lock_room(room_id, false);
+    if (!r) return false;
+    bool active = r->active_item != 0;
+    if (active) {
+        uint64_t now = auction_events_now_ms();
+        *item_id = r->active_item;
+        *remaining_sec = r->end_ms > now ? (uint32_t)((r->end_ms - now + 999) / 1000) : 0;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return active;
+}
+
+// === TIMER ===
+// Whether the item has a bid in the DB (current price above the starting
+// price), i.e. its leading bid was placed on another node
+static bool has_remote_bid(int32_t item_id)
+{
+    PGresult* res = NULL;
+    if (!db_get_item_details(item_id, &res)) {
+        if (res) PQclear(res);
+        return false;
+    }
+    bool bid = atoll(PQgetvalue(res, 0, 4)) > atoll(PQgetvalue(res, 0, 3));
+    PQclear(res);
+    return bid;
+}
+
+static void mark_unsold(int32_t room_id, int32_t item_id)
+{
+    journal_push(item_id, "available", 0);
+    publish(EVENT_ITEM_UNSOLD, room_id, item_id, 0);
+}
+
+// Sell from the DB's bids, or give up on the item; false if the DB could
+// not be reached and the caller should try again later
+static bool settle_expired(int32_t room_id, int32_t item_id)
+{
+    int32_t winner;
+    int64_t price;
+    int32_t st = bid_service_settle_from_db(room_id, item_id, &winner, &price);
+    if (st == STATUS_BUSY) return false;
+    if (st != STATUS_SUCCESS) mark_unsold(room_id, item_id);
+    return true;
+}
+
+static void close_auction(int32_t room_id, int32_t item_id)
+{
+    int32_t winner;
+    int64_t price;
+    if (bid_service_item_sold(room_id, item_id, &winner, &price) == STATUS_SUCCESS) return;
+
+    if (cluster_enabled() && has_remote_bid(item_id)) {
+        // The node holding the leader's funds settles and publishes the sale;
+        // wait for it, up to SCHED_EXPIRY_TIMEOUT_MS
+        pthread_mutex_lock(&expiry_lock);
+        bool tracked = expiring_count < SCHED_EXPIRY_MAX;
+        if (tracked) {
+            expiring[expiring_count++] = (PendingExpiry){
+                .room_id = room_id, .item_id = item_id,
+                .deadline_ms = auction_events_now_ms() + SCHED_EXPIRY_TIMEOUT_MS,
+            };
+        }
+        pthread_mutex_unlock(&expiry_lock);
+        publish(EVENT_ITEM_EXPIRED, room_id, item_id, 0);
+        if (!tracked) {
+            LOG_WARN("scheduler: %d sales pending, settling item %d without waiting",
+                     SCHED_EXPIRY_MAX, item_id);
+            settle_expired(room_id, item_id);
+        }
+        return;
+    }
+    mark_unsold(room_id, item_id);
+}
+
+// The sale of an expired item arrived (from its holding node or our own
+// fallback): stop waiting for it
+static void expiry_done(int32_t item_id)
+{
+    pthread_mutex_lock(&expiry_lock);
+    for (int i = 0; i < expiring_count; i++) {
+        if (expiring[i].item_id != item_id) continue;
+        expiring[i] = expiring[--expiring_count];
+        break;
+    }
+    pthread_mutex_unlock(&expiry_lock);
+}
+
+// Settle the expired items whose holding node stayed silent
+static void check_expiries(uint64_t now)
+{
+    PendingExpiry due[SCHED_EXPIRY_MAX];
+    int n = 0;
+    pthread_mutex_lock(&expiry_lock);
+    for (int i = 0; i < expiring_count; i++) {
+        if (now >= expiring[i].deadline_ms) due[n++] = expiring[i];
+    }
+    pthread_mutex_unlock(&expiry_lock);
+
+    for (int i = 0; i < n; i++) {
+        LOG_WARN("scheduler: no sale for expired item %d after %d ms, settling from the DB",
+                 due[i].item_id, SCHED_EXPIRY_TIMEOUT_MS);
+        if (!settle_expired(due[i].room_id, due[i].item_id)) continue;   // DB down: next pass
+        atomic_fetch_add(&expiry_timeouts, 1);
+        expiry_done(due[i].item_id);
+    }
+}
+
+static void tick_room(RoomSched* r, uint64_t now)
+{
+    bool owned = cluster_owns_room(r->room_id);
+    pthread_mutex_lock(&r->lock);
+    if (r->reload || (owned && !r->owned) || !r->loaded) {
+        // Lease just gained, queue changed elsewhere or an earlier load
+        // failed: rebuild from the DB, after our own pending changes are in
+        flush_journal();
+        reset_room(r);
+        load_room(r);
+    }
+    r->owned = owned;
+    if (!owned) {
+        // Another node runs this room; we only mirror its events
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    if (!r->active_item) {
+        activate_and_publish(r);
+        return;
+    }
+
+    int32_t item_id = r->active_item;
+    if (now >= r->end_ms) {
+        r->active_item = 0;
+        pthread_mutex_unlock(&r->lock);
+        close_auction(r->room_id, item_id);
+
+        pthread_mutex_lock(&r->lock);
+        activate_and_publish(r);
+        return;
+    }
+
+    uint64_t remaining = (r->end_ms - now + 999) / 1000;
+    bool warn = !r->warned && remaining <= SCHED_WARNING_SEC;
+    if (warn) r->warned = true;
+    pthread_mutex_unlock(&r->lock);
+    if (warn) publish(EVENT_ITEM_CLOSING, r->room_id, item_id, (int64_t)remaining);
+}
+
+static void* timer_main(void* arg)
+{
+    (void)arg;
+    uint64_t last_flush = 0;
+    while (atomic_load(&running)) {
+        uint64_t now = auction_events_now_ms();
+
+        pthread_mutex_lock(&tick_lock);
+        if (!atomic_load(&paused)) {
+            pthread_mutex_lock(&room_table_lock);
+            RoomSched* head = all_rooms;
+            pthread_mutex_unlock(&room_table_lock);
+            // Rooms are never freed and are pushed at the head, so walking from
+            // a snapshot of the head is safe without the table lock
+            for (RoomSched* r = head; r; r = r->all_next) tick_room(r, now);
+
+            check_expiries(now);
+            if (now - last_flush >= SCHED_FLUSH_MS) {
+                flush_journal();
+                last_flush = now;
+            }
+        }
+        pthread_mutex_unlock(&tick_lock);
+        usleep(SCHED_TICK_MS * 1000);
+    }
+    flush_journal();
+    return NULL;
+}
+
+// === RESTART HANDOFF ===
+ScheduledAuction* item_scheduler_pause(int* count)
+{
+    *count = 0;
+    atomic_store(&paused, true);
+    // Wait out a pass in progress; nothing ticks from here on
+    pthread_mutex_lock(&tick_lock);
+    while (flush_journal() > 0) {}
+
+    pthread_mutex_lock(&room_table_lock);
+    RoomSched* head = all_rooms;
+    int cap = 0;
+    for (RoomSched* r = head; r; r = r->all_next) cap++;
+    pthread_mutex_unlock(&room_table_lock);
+
+    ScheduledAuction* out = cap ? malloc((size_t)cap * sizeof(*out)) : NULL;
+    uint64_t now = auction_events_now_ms();
+    for (RoomSched* r = head; r && out && *count < cap; r = r->all_next) {
+        pthread_mutex_lock(&r->lock);
+        if (r->owned && r->active_item) {
+            out[*count] = (ScheduledAuction){
+                .room_id = r->room_id,
+                .item_id = r->active_item,
+                .remaining_ms = r->end_ms > now ? (uint32_t)(r->end_ms - now) : 0,
+                .warned = r->warned,
+            };
+            (*count)++;
+        }
+        pthread_mutex_unlock(&r->lock);
+    }
+    pthread_mutex_unlock(&tick_lock);
+    if (*count == 0) {
+        free(out);
+        out = NULL;
+    }
+    return out;
+}
+
+void item_scheduler_resume(void)
+{
+    atomic_store(&paused, false);
+}
+
+bool item_scheduler_restore(const ScheduledAuction* auction)
+{
+    RoomSched* r = lock_room(auction->room_id, false);
+    if (!r) return false;
+    // Still queued if the old process could not write the activation
+    QueuedItem* it = item_table_take(auction->item_id, false);
+    if (it && it->room_id == r->room_id) {
+        item_table_take(auction->item_id, true);
+        heap_remove_at(r, it->heap_index);
+        slab_free(&item_slab, it);
+    }
+    r->active_item = auction->item_id;
+    r->end_ms = auction_events_now_ms() + auction->remaining_ms;
+    r->warned = auction->warned;
+    pthread_mutex_unlock(&r->lock);
+    return true;
+}
+
+// Follow the owner node's timer in a room this node does not run
+static void mirror_remote(const AuctionEvent* ev)
+{
+    if (ev->type == EVENT_ITEM_DELETED) {
+        item_scheduler_remove(ev->room_id, ev->item_id);
+        return;
+    }
+    RoomSched* r = lock_room(ev->room_id, false);
+    if (!r) return;
+    if (ev->type == EVENT_ITEM_CREATED) {
+        r->reload = true;
+    } else if (ev->type == EVENT_ITEM_ACTIVATED && !r->owned) {
+        QueuedItem* it = item_table_take(ev->item_id, false);
+        if (it && it->room_id == r->room_id) {
+            item_table_take(ev->item_id, true);
+            heap_remove_at(r, it->heap_index);
+            slab_free(&item_slab, it);
+        }
+        r->active_item = ev->item_id;
+        r->end_ms = auction_events_now_ms() + (uint64_t)ev->amount * 1000;
+        r->warned = false;
+    } else if (ev->type == EVENT_ITEM_UNSOLD && r->active_item == ev->item_id) {
+        r->active_item = 0;
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+// A bid in the last SCHED_WARNING_SEC seconds resets the clock to that value;
+// a buy-now ends the active auction early
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    if (ev->type == EVENT_ITEM_SOLD) expiry_done(ev->item_id);
+    if (ev->remote && ev->type != EVENT_ITEM_BID && ev->type != EVENT_ITEM_SOLD) {
+        mirror_remote(ev);
+        return;
+    }
+    if (ev->type != EVENT_ITEM_BID && ev->type != EVENT_ITEM_SOLD) return;
+
+    RoomSched* r = lock_room(ev->room_id, false);
+    if (!r) return;
+    if (r->active_item != ev->item_id) {
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    if (ev->type == EVENT_ITEM_SOLD) {
+        r->active_item = 0;
+        activate_and_publish(r);
+        return;
+    }
+    uint64_t floor_ms = auction_events_now_ms() + (uint64_t)SCHED_WARNING_SEC * 1000;
+    if (r->end_ms < floor_ms) {
+        r->end_ms = floor_ms;
+        r->warned = true;
+        atomic_fetch_add(&extensions, 1);
+    }
+    pthread_mutex_unlock(&r->lock);
+}
+
+bool item_scheduler_init(void)
+{
+    if (slab_init(&item_slab, sizeof(QueuedItem), 1024) != 0) return false;
+    if (!auction_events_subscribe(on_auction_event, NULL)) return false;
+    atomic_store(&paused, true);
+    atomic_store(&running, true);
+    if (pthread_create(&timer_thread, NULL, timer_main, NULL) != 0) {
+        atomic_store(&running, false);
+        return false;
+    }
+    return true;
+}
+
+void item_scheduler_start(void)
+{
+    atomic_store(&paused, false);
+}
+
+void item_scheduler_shutdown(void)
+{
+    atomic_store(&running, false);
+    pthread_join(timer_thread, NULL);
+}
+
+void item_scheduler_get_stats(ItemSchedulerStats* out)
+{
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&room_table_lock);
+    RoomSched* head = all_rooms;
+    pthread_mutex_unlock(&room_table_lock);
+    for (RoomSched* r = head; r; r = r->all_next) {
+        pthread_mutex_lock(&r->lock);
+        out->rooms++;
+        out->queued_items += (uint32_t)r->heap_len;
+        if (r->active_item) out->active_auctions++;
+        pthread_mutex_unlock(&r->lock);
+    }
+    out->activations = atomic_load(&activations);
+    out->extensions = atomic_load(&extensions);
+    out->flush_batches = atomic_load(&flush_batches);
+    out->journal_stalls = atomic_load(&journal_stalls);
+    out->expiry_timeouts = atomic_load(&expiry_timeouts);
+    out->load_failures = atomic_load(&load_failures);
+    pthread_mutex_lock(&journal_lock);
+    out->journal_pending = journal_count;
+    pthread_mutex_unlock(&journal_lock);
+}
@@ -0,0 +1,93 @@
+#ifndef ITEM_SCHEDULER_H
+#define ITEM_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Per-Room Item Queue Scheduler ==========
+// Each room holds a min-heap of pending items keyed by queue_position and
+// at most one active auction. A timer thread closes the active auction when
+// its time runs out (selling to the leading bidder through bid_service),
+// then activates the next item in the queue and starts its timer.
+// Positions are handed out in memory; status / position changes are
+// written to auction_items in batches. A full journal is written out
+// synchronously by the room that fills it rather than dropping a change.
+//
+// With several nodes (cluster.h) only the room's lease holder runs its
+// timer; the other nodes mirror the active item from relayed events. A node
+// that gains a lease rebuilds the room's queue from the DB. When the leading
+// bid is held on another node, the owner publishes EVENT_ITEM_EXPIRED and
+// waits SCHED_EXPIRY_TIMEOUT_MS for that node's sale; if none comes (node
+// down, hold lost in a restart) it sells to the DB's highest bid itself.
+
+#define SCHED_TICK_MS            250
+#define SCHED_FLUSH_MS           200
+#define SCHED_WARNING_SEC        30     // Warn, and reset to this on a late bid
+#define SCHED_DEFAULT_DURATION   3600   // For items loaded from the DB mid-auction
+#define SCHED_ROOM_BUCKETS       256
+#define SCHED_ITEM_BUCKETS       4096
+#define SCHED_JOURNAL_CAP        4096
+#define SCHED_EXPIRY_TIMEOUT_MS  10000
+#define SCHED_EXPIRY_MAX         256    // Items waiting for another node's sale
+
+// Subscribes to bid events and starts the timer thread, paused: nothing
+// activates or closes until item_scheduler_start (after a takeover, see
+// hot_upgrade.h, so the old process's timer is the only one running)
+bool item_scheduler_init(void);
+void item_scheduler_start(void);
+void item_scheduler_shutdown(void);
+
+// Next free queue position for a new item (loads the room on first use).
+// -1 while the room's queue cannot be read from the DB.
+int32_t item_scheduler_next_position(int32_t room_id);
+// First of `count` consecutive positions, for a bulk insert (-1 as above)
+int32_t item_scheduler_reserve_positions(int32_t room_id, int32_t count);
+
+// Queue a newly created item. The room starts it right away if idle.
+// False if the room is not loaded; the item is picked up from the DB when
+// it is.
+bool item_scheduler_enqueue(int32_t room_id, int32_t item_id, int32_t queue_position,
+                            uint32_t duration_sec);
+
+// Remove a pending item; removing the active item cancels its auction
+// and moves on to the next one. O(log n).
+bool item_scheduler_remove(int32_t room_id, int32_t item_id);
+
+// Move a pending item to `new_position`. O(log n).
+bool item_scheduler_reorder(int32_t room_id, int32_t item_id, int32_t new_position);
+
+// Active auction of a room, if any
+bool item_scheduler_current(int32_t room_id, int32_t* item_id, uint32_t* remaining_sec);
+
+// Zero-downtime restart (hot_upgrade.h). The old process pauses the timer,
+// writes pending queue changes and hands the running clocks over; the new
+// process restores them instead of restarting them at SCHED_DEFAULT_DURATION.
+typedef struct {
+    int32_t room_id;
+    int32_t item_id;
+    uint32_t remaining_ms;
+    bool warned;
+} ScheduledAuction;
+
+// Returns a malloc'd array of the auctions this node runs (free it), NULL
+// with *count = 0 if there are none
+ScheduledAuction* item_scheduler_pause(int* count);
+void item_scheduler_resume(void);      // Handoff aborted
+bool item_scheduler_restore(const ScheduledAuction* auction);
+
+typedef struct {
+    uint32_t rooms;
+    uint32_t queued_items;
+    uint32_t active_auctions;
+    uint64_t activations;
+    uint64_t extensions;        // Late bids that reset the timer
+    uint64_t journal_pending;
+    uint64_t flush_batches;
+    uint64_t journal_stalls;    // Changes that waited for a full journal to be written
+    uint64_t expiry_timeouts;   // Sales settled from the DB after another node stayed silent
+    uint64_t load_failures;     // Room queue reads from the DB that failed (retried)
+} ItemSchedulerStats;
+
+void item_scheduler_get_stats(ItemSchedulerStats* out);
+
+#endif
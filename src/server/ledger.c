@@ -0,0 +1,529 @@
+#include "ledger.h"
+#include "db_adapter.h"
+#include "cluster.h"
+#include "mem_pool.h"
+#include "utils.h"
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+typedef struct Account {
+    struct Account* next;
+    int32_t user_id;
+    int64_t balance;
+    int64_t held;
+} Account;
+
+typedef struct Hold {
+    struct Hold* next;
+    int32_t item_id;
+    int32_t user_id;
+    int64_t amount;
+} Hold;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Account* buckets[LEDGER_BUCKETS];
+    uint32_t count;
+} AccountShard;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Hold* buckets[LEDGER_BUCKETS];
+    uint32_t count;
+} HoldShard;
+
+static AccountShard accounts[LEDGER_SHARDS];
+static HoldShard holds[LEDGER_SHARDS];
+static Slab account_slab;
+static Slab hold_slab;
+
+// Pending balance changes, oldest first (ring buffer)
+static BalanceChange journal[LEDGER_JOURNAL_CAP];
+static uint32_t journal_head;
+static uint32_t journal_count;
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t journal_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t journal_space = PTHREAD_COND_INITIALIZER;
+static pthread_t flusher;
+static bool running;
+static uint64_t flushed_entries, flush_batches, flush_failures;
+
+#define SHARD_OF(id)  ((uint32_t)(id) % LEDGER_SHARDS)
+#define BUCKET_OF(id) (((uint32_t)(id) / LEDGER_SHARDS) % LEDGER_BUCKETS)
+
+static void journal_push(int32_t user_id, int64_t amount, int64_t held, int32_t item_id,
+                         const char* type);
+static int64_t journal_pending(int32_t user_id);
+
+// Nodes sharing the database (cluster.h) can hold the same user's funds:
+// holds are then reserved in users.held as well
+static bool shared_funds(void)
+{
+    return cluster_enabled();
+}
+
+// === LOOKUPS (caller holds the shard lock) ===
+static Account* find_account(AccountShard* shard, int32_t user_id)
+{
+    for (Account* a = shard->buckets[BUCKET_OF(user_id)]; a; a = a->next) {
+        if (a->user_id == user_id) return a;
+    }
+    return NULL;
+}
+
+static Hold* find_hold(HoldShard* shard, int32_t item_id)
+{
+    for (Hold* h = shard->buckets[BUCKET_OF(item_id)]; h; h = h->next) {
+        if (h->item_id == item_id) return h;
+    }
+    return NULL;
+}
+
+static void remove_hold(HoldShard* shard, Hold* hold)
+{
+    Hold** pp = &shard->buckets[BUCKET_OF(hold->item_id)];
+    while (*pp != hold) pp = &(*pp)->next;
+    *pp = hold->next;
+    shard->count--;
+    slab_free(&hold_slab, hold);
+}
+
+// Adjust `held` on a user's account (and users.held with shared funds);
+// returns false if the account is gone
+static bool adjust_held(int32_t user_id, int64_t delta)
+{
+    AccountShard* shard = &accounts[SHARD_OF(user_id)];
+    pthread_mutex_lock(&shard->lock);
+    Account* acc = find_account(shard, user_id);
+    if (acc) acc->held += delta;
+    if (shared_funds()) journal_push(user_id, 0, delta, 0, NULL);
+    pthread_mutex_unlock(&shard->lock);
+    return acc != NULL;
+}
+
+// Give back a users.held reservation that did not become a hold
+static void unreserve(int32_t user_id, int64_t amount)
+{
+    if (amount <= 0) return;
+    AccountShard* shard = &accounts[SHARD_OF(user_id)];
+    pthread_mutex_lock(&shard->lock);
+    journal_push(user_id, 0, -amount, 0, NULL);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+// The DB balance plus what this node has not written yet (caller holds the
+// account's shard lock)
+static void refresh_balance(Account* acc, int64_t db_balance)
+{
+    acc->balance = db_balance + journal_pending(acc->user_id);
+}
+
+// === JOURNAL ===
+// Called with the account's shard lock held so entries stay in balance order
+static void journal_push(int32_t user_id, int64_t amount, int64_t held, int32_t item_id,
+                         const char* type)
+{
+    pthread_mutex_lock(&journal_lock);
+    while (journal_count == LEDGER_JOURNAL_CAP && running) {
+        pthread_cond_signal(&journal_ready);
+        pthread_cond_wait(&journal_space, &journal_lock);
+    }
+    if (journal_count == LEDGER_JOURNAL_CAP) {
+        // Only after shutdown: nobody is left to drain the journal
+        pthread_mutex_unlock(&journal_lock);
+        LOG_ERROR("ledger: journal full, dropped %s of %lld for user %d",
+                  type ? type : "hold", (long long)(type ? amount : held), user_id);
+        return;
+    }
+    BalanceChange* e = &journal[(journal_head + journal_count) % LEDGER_JOURNAL_CAP];
+    e->user_id = user_id;
+    e->amount_vnd = amount;
+    e->held_vnd = held;
+    e->related_item_id = item_id;
+    e->type = type;
+    journal_count++;
+    if (journal_count >= LEDGER_BATCH_MAX) pthread_cond_signal(&journal_ready);
+    pthread_mutex_unlock(&journal_lock);
+}
+
+// Balance change of a user still waiting for the flusher
+static int64_t journal_pending(int32_t user_id)
+{
+    int64_t sum = 0;
+    pthread_mutex_lock(&journal_lock);
+    for (uint32_t i = 0; i < journal_count; i++) {
+        const BalanceChange* e = &journal[(journal_head + i) % LEDGER_JOURNAL_CAP];
+        if (e->user_id == user_id) sum += e->amount_vnd;
+    }
+    pthread_mutex_unlock(&journal_lock);
+    return sum;
+}
+
+// Write out up to LEDGER_BATCH_MAX entries; returns how many were written
+static uint32_t flush_batch(void)
+{
+    BalanceChange batch[LEDGER_BATCH_MAX];
+
+    pthread_mutex_lock(&journal_lock);
+    uint32_t n = journal_count < LEDGER_BATCH_MAX ? journal_count : LEDGER_BATCH_MAX;
+    for (uint32_t i = 0; i < n; i++) {
+        batch[i] = journal[(journal_head + i) % LEDGER_JOURNAL_CAP];
+    }
+    pthread_mutex_unlock(&journal_lock);
+    if (n == 0) return 0;
+
+    // Entries stay queued until the DB accepts them, so a failed batch is retried
+    bool ok = db_apply_balance_changes(batch, (int)n);
+
+    pthread_mutex_lock(&journal_lock);
+    if (ok) {
+        journal_head = (journal_head + n) % LEDGER_JOURNAL_CAP;
+        journal_count -= n;
+        flushed_entries += n;
+        flush_batches++;
+        pthread_cond_broadcast(&journal_space);
+    } else {
+        flush_failures++;
+    }
+    pthread_mutex_unlock(&journal_lock);
+
+    if (!ok) {
+        LOG_ERROR("ledger: failed to persist %u balance changes, will retry", n);
+        return 0;
+    }
+    return n;
+}
+
+static void* flusher_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&journal_lock);
+    while (running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LEDGER_FLUSH_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (running && journal_count < LEDGER_BATCH_MAX) {
+            if (pthread_cond_timedwait(&journal_ready, &journal_lock, &deadline) == ETIMEDOUT) break;
+        }
+        pthread_mutex_unlock(&journal_lock);
+        while (flush_batch() == LEDGER_BATCH_MAX) {
+        }
+        pthread_mutex_lock(&journal_lock);
+    }
+    pthread_mutex_unlock(&journal_lock);
+
+    // Drain whatever is left on shutdown
+    while (flush_batch() > 0) {
+    }
+    return NULL;
+}
+
+// === PUBLIC API ===
+bool ledger_init(void)
+{
+    for (int i = 0; i < LEDGER_SHARDS; i++) {
+        pthread_mutex_init(&accounts[i].lock, NULL);
+        pthread_mutex_init(&holds[i].lock, NULL);
+    }
+    if (slab_init(&account_slab, sizeof(Account), 1024) != 0 ||
+        slab_init(&hold_slab, sizeof(Hold), 1024) != 0) {
+        return false;
+    }
+    running = true;
+    if (pthread_create(&flusher, NULL, flusher_main, NULL) != 0) {
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void ledger_shutdown(void)
+{
+    pthread_mutex_lock(&journal_lock);
+    running = false;
+    pthread_cond_broadcast(&journal_ready);
+    pthread_cond_broadcast(&journal_space);
+    pthread_mutex_unlock(&journal_lock);
+    pthread_join(flusher, NULL);
+}
+
+void ledger_load_user(int32_t user_id, int64_t balance)
+{
+    AccountShard* shard = &accounts[SHARD_OF(user_id)];
+    pthread_mutex_lock(&shard->lock);
+    Account* acc = find_account(shard, user_id);
+    if (!acc) {
+        acc = slab_alloc(&account_slab);
+        if (!acc) {
+            pthread_mutex_unlock(&shard->lock);
+            return;
+        }
+        acc->user_id = user_id;
+        acc->balance = balance;
+        acc->next = shard->buckets[BUCKET_OF(user_id)];
+        shard->buckets[BUCKET_OF(user_id)] = acc;
+        shard->count++;
+    } else if (shared_funds()) {
+        // Deposits and sales on other nodes only show up in the DB
+        refresh_balance(acc, balance);
+    }
+    // On a single node an account that is already loaded is authoritative:
+    // the DB copy may be behind by whatever is still in the journal
+    pthread_mutex_unlock(&shard->lock);
+}
+
+bool ledger_get_balance(int32_t user_id, int64_t* balance, int64_t* held)
+{
+    AccountShard* shard = &accounts[SHARD_OF(user_id)];
+    pthread_mutex_lock(&shard->lock);
+    Account* acc = find_account(shard, user_id);
+    if (acc) {
+        if (balance) *balance = acc->balance;
+        if (held) *held = acc->held;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return acc != NULL;
+}
+
+LedgerStatus ledger_adjust(int32_t user_id, int64_t delta, const char* type, int64_t* new_balance)
+{
+    // Accounts are never unloaded, so the check holds after the DB call
+    if (!ledger_get_balance(user_id, NULL, NULL)) return LEDGER_UNKNOWN_USER;
+
+    // With shared funds a redeem reserves the amount first, so no node can
+    // hold it meanwhile; the debit below releases the reservation
+    bool reserved = delta < 0 && shared_funds();
+    int64_t db_balance = 0;
+    if (reserved) {
+        int r = db_reserve_funds(user_id, -delta, &db_balance);
+        if (r <= 0) return r == 0 ? LEDGER_INSUFFICIENT_FUNDS : LEDGER_DB_ERROR;
+    }
+
+    AccountShard* shard = &accounts[SHARD_OF(user_id)];
+    pthread_mutex_lock(&shard->lock);
+    Account* acc = find_account(shard, user_id);
+    if (reserved) {
+        refresh_balance(acc, db_balance);
+    } else if (acc->balance + delta < acc->held) {
+        pthread_mutex_unlock(&shard->lock);
+        return LEDGER_INSUFFICIENT_FUNDS;
+    }
+    acc->balance += delta;
+    if (new_balance) *new_balance = acc->balance;
+    journal_push(user_id, delta, reserved ? delta : 0, 0, type);
+    pthread_mutex_unlock(&shard->lock);
+    return LEDGER_OK;
+}
+
+static LedgerStatus place_hold(int32_t item_id, int32_t user_id, int64_t amount,
+                               int64_t min_raise, LedgerHold* prev, bool reserve)
+{
+    HoldShard* hshard = &holds[SHARD_OF(item_id)];
+    AccountShard* ashard = &accounts[SHARD_OF(user_id)];
+
+    // Shared funds: reserve in the DB first, outside the locks - the whole
+    // amount, or the raise when the user already leads. The guarded UPDATE
+    // is the funds check; whatever the hold does not use is given back.
+    int64_t reserved = 0;
+    if (reserve) {
+        LedgerHold lead;
+        bool leads = ledger_get_hold(item_id, &lead) && lead.user_id == user_id;
+        reserved = leads ? amount - lead.amount : amount;
+        if (reserved <= 0) return LEDGER_OUTBID;
+        int64_t db_balance;
+        int r = db_reserve_funds(user_id, reserved, &db_balance);
+        if (r <= 0) return r == 0 ? LEDGER_INSUFFICIENT_FUNDS : LEDGER_DB_ERROR;
+        pthread_mutex_lock(&ashard->lock);
+        Account* acc = find_account(ashard, user_id);
+        if (acc) refresh_balance(acc, db_balance);
+        pthread_mutex_unlock(&ashard->lock);
+    }
+
+    // Lock order: item shard, then one account shard at a time
+    pthread_mutex_lock(&hshard->lock);
+    Hold* hold = find_hold(hshard, item_id);
+    LedgerHold old = { 0, 0 };
+    if (hold) {
+        old.user_id = hold->user_id;
+        old.amount = hold->amount;
+    }
+
+    // Raising your own bid only needs the difference
+    int64_t needed = (old.user_id == user_id) ? amount - old.amount : amount;
+
+    LedgerStatus status = LEDGER_OK;
+    if (hold && amount < old.amount + min_raise) status = LEDGER_OUTBID;
+    else if (reserve && needed > reserved) status = LEDGER_OUTBID;     // The lead changed meanwhile
+
+    if (status == LEDGER_OK) {
+        pthread_mutex_lock(&ashard->lock);
+        Account* acc = find_account(ashard, user_id);
+        if (!acc) status = LEDGER_UNKNOWN_USER;
+        else if (!reserve && acc->balance - acc->held < needed) status = LEDGER_INSUFFICIENT_FUNDS;
+        else acc->held += needed;
+        pthread_mutex_unlock(&ashard->lock);
+    }
+
+    if (status != LEDGER_OK) {
+        pthread_mutex_unlock(&hshard->lock);
+        unreserve(user_id, reserved);
+        return status;
+    }
+    unreserve(user_id, reserved - needed);
+
+    if (!hold) {
+        hold = slab_alloc(&hold_slab);
+        if (!hold) {
+            adjust_held(user_id, -needed);
+            pthread_mutex_unlock(&hshard->lock);
+            return LEDGER_NO_HOLD;
+        }
+        hold->item_id = item_id;
+        hold->next = hshard->buckets[BUCKET_OF(item_id)];
+        hshard->buckets[BUCKET_OF(item_id)] = hold;
+        hshard->count++;
+    }
+    if (old.user_id != 0 && old.user_id != user_id) {
+        adjust_held(old.user_id, -old.amount);
+    }
+    hold->user_id = user_id;
+    hold->amount = amount;
+    pthread_mutex_unlock(&hshard->lock);
+
+    if (prev) *prev = old;
+    return LEDGER_OK;
+}
+
+LedgerStatus ledger_place_hold(int32_t item_id, int32_t user_id, int64_t amount,
+                               int64_t min_raise, LedgerHold* prev)
+{
+    return place_hold(item_id, user_id, amount, min_raise, prev, shared_funds());
+}
+
+LedgerStatus ledger_restore_hold(int32_t item_id, int32_t user_id, int64_t amount)
+{
+    return place_hold(item_id, user_id, amount, 0, NULL, false);
+}
+
+void ledger_revert_hold(int32_t item_id, int32_t user_id, int64_t amount, const LedgerHold* prev)
+{
+    HoldShard* hshard = &holds[SHARD_OF(item_id)];
+    pthread_mutex_lock(&hshard->lock);
+    Hold* hold = find_hold(hshard, item_id);
+    if (!hold || hold->user_id != user_id || hold->amount != amount) {
+        pthread_mutex_unlock(&hshard->lock);
+        return;
+    }
+
+    if (prev && prev->user_id == user_id) {
+        adjust_held(user_id, prev->amount - amount);
+        hold->amount = prev->amount;
+    } else {
+        adjust_held(user_id, -amount);
+        if (prev && prev->user_id != 0) {
+            // The previous leader gets their hold back even if it now exceeds
+            // their free balance; the DB still shows them as leading
+            adjust_held(prev->user_id, prev->amount);
+            hold->user_id = prev->user_id;
+            hold->amount = prev->amount;
+        } else {
+            remove_hold(hshard, hold);
+        }
+    }
+    pthread_mutex_unlock(&hshard->lock);
+}
+
+LedgerStatus ledger_settle(int32_t item_id, const char* type, LedgerHold* settled)
+{
+    HoldShard* hshard = &holds[SHARD_OF(item_id)];
+    pthread_mutex_lock(&hshard->lock);
+    Hold* hold = find_hold(hshard, item_id);
+    if (!hold) {
+        pthread_mutex_unlock(&hshard->lock);
+        return LEDGER_NO_HOLD;
+    }
+    int32_t user_id = hold->user_id;
+    int64_t amount = hold->amount;
+    remove_hold(hshard, hold);
+
+    AccountShard* ashard = &accounts[SHARD_OF(user_id)];
+    pthread_mutex_lock(&ashard->lock);
+    Account* acc = find_account(ashard, user_id);
+    if (acc) {
+        acc->held -= amount;
+        acc->balance -= amount;
+    }
+    // Queue the debit even if the account was evicted; the DB is the record.
+    // With shared funds the reservation is released in the same entry.
+    journal_push(user_id, -amount, shared_funds() ? -amount : 0, item_id, type);
+    pthread_mutex_unlock(&ashard->lock);
+    pthread_mutex_unlock(&hshard->lock);
+
+    if (settled) {
+        settled->user_id = user_id;
+        settled->amount = amount;
+    }
+    return LEDGER_OK;
+}
+
+void ledger_release(int32_t item_id)
+{
+    HoldShard* hshard = &holds[SHARD_OF(item_id)];
+    pthread_mutex_lock(&hshard->lock);
+    Hold* hold = find_hold(hshard, item_id);
+    if (hold) {
+        adjust_held(hold->user_id, -hold->amount);
+        remove_hold(hshard, hold);
+    }
+    pthread_mutex_unlock(&hshard->lock);
+}
+
+void ledger_release_below(int32_t item_id, int64_t amount)
+{
+    HoldShard* hshard = &holds[SHARD_OF(item_id)];
+    pthread_mutex_lock(&hshard->lock);
+    Hold* hold = find_hold(hshard, item_id);
+    if (hold && hold->amount < amount) {
+        adjust_held(hold->user_id, -hold->amount);
+        remove_hold(hshard, hold);
+    }
+    pthread_mutex_unlock(&hshard->lock);
+}
+
+bool ledger_get_hold(int32_t item_id, LedgerHold* out)
+{
+    HoldShard* hshard = &holds[SHARD_OF(item_id)];
+    pthread_mutex_lock(&hshard->lock);
+    Hold* hold = find_hold(hshard, item_id);
+    if (hold) {
+        out->user_id = hold->user_id;
+        out->amount = hold->amount;
+    }
+    pthread_mutex_unlock(&hshard->lock);
+    return hold != NULL;
+}
+
+void ledger_get_stats(LedgerStats* out)
+{
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < LEDGER_SHARDS; i++) {
+        pthread_mutex_lock(&accounts[i].lock);
+        out->accounts += accounts[i].count;
+        pthread_mutex_unlock(&accounts[i].lock);
+        pthread_mutex_lock(&holds[i].lock);
+        out->holds += holds[i].count;
+        pthread_mutex_unlock(&holds[i].lock);
+    }
+    pthread_mutex_lock(&journal_lock);
+    out->journal_pending = journal_count;
+    out->flushed_entries = flushed_entries;
+    out->flush_batches = flush_batches;
+    out->flush_failures = flush_failures;
+    pthread_mutex_unlock(&journal_lock);
+}
@@ -0,0 +1,94 @@
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== In-Memory Balance Ledger ==========
+// Per-user balance + funds on hold, sharded by user_id. Every leading bid
+// holds the bid amount on its bidder; being outbid releases the hold, and
+// the hold turns into a debit when the item is sold (or bought outright).
+// Balance changes are queued and written to users.balance / transactions
+// in batches by a flusher thread.
+//
+// On a single node fund checks never touch the database. Nodes sharing a
+// database (cluster.h) could otherwise hold the same balance twice, so
+// there every hold and redeem first reserves its amount in users.held with
+// a guarded UPDATE (db_reserve_funds), which is the funds check; releases
+// and settlements reach users.held through the journal, a debit together
+// with the release of its reservation. A login refreshes the local balance
+// from the DB, picking up deposits and sales made on other nodes.
+
+#define LEDGER_SHARDS        64
+#define LEDGER_BUCKETS       256    // Hash buckets per shard
+#define LEDGER_FLUSH_MS      50     // Max delay before a balance change reaches the DB
+#define LEDGER_BATCH_MAX     256    // Entries per DB round trip
+#define LEDGER_JOURNAL_CAP   8192   // Pending entries before writers wait for the flusher
+
+typedef enum {
+    LEDGER_OK = 0,
+    LEDGER_UNKNOWN_USER = -1,       // Account not loaded (user not logged in)
+    LEDGER_INSUFFICIENT_FUNDS = -2,
+    LEDGER_NO_HOLD = -3,
+    LEDGER_OUTBID = -4,             // Amount does not beat the current hold by min_raise
+    LEDGER_DB_ERROR = -5            // Funds could not be reserved in the DB (shared funds)
+} LedgerStatus;
+
+typedef struct {
+    int32_t user_id;    // 0 if none
+    int64_t amount;
+} LedgerHold;
+
+bool ledger_init(void);
+void ledger_shutdown(void);     // Flushes pending entries
+
+// Load (or, with shared funds, refresh) an account from the balance
+// returned by db_login_user
+void ledger_load_user(int32_t user_id, int64_t balance);
+bool ledger_get_balance(int32_t user_id, int64_t* balance, int64_t* held);
+
+// Deposit (> 0) or redeem (< 0). Redeem cannot dip into held funds.
+LedgerStatus ledger_adjust(int32_t user_id, int64_t delta, const char* type, int64_t* new_balance);
+
+// Make `user_id` the holder for `item_id` at `amount`. The previous holder
+// (returned in `prev`) is released; a user raising their own bid only needs
+// the difference to be available. The amount must be at least the current
+// hold + `min_raise` (checked under the item's lock, so of two racing bids
+// the lower one cannot replace the higher one).
+LedgerStatus ledger_place_hold(int32_t item_id, int32_t user_id, int64_t amount,
+                               int64_t min_raise, LedgerHold* prev);
+
+// Reinstate a hold handed over by the previous process (hot_upgrade.h); its
+// funds are already reserved in the DB
+LedgerStatus ledger_restore_hold(int32_t item_id, int32_t user_id, int64_t amount);
+
+// Undo ledger_place_hold when the bid was rejected afterwards (DB check).
+// No-op if someone else has already taken the hold over.
+void ledger_revert_hold(int32_t item_id, int32_t user_id, int64_t amount, const LedgerHold* prev);
+
+// Turn the item's hold into a debit ("bid_win" or "buy_now") and queue it
+LedgerStatus ledger_settle(int32_t item_id, const char* type, LedgerHold* settled);
+
+// Drop the item's hold without charging (item deleted / auction cancelled)
+void ledger_release(int32_t item_id);
+
+// Another node accepted a bid of `amount` on the item (cluster.h): our
+// leader, if any, has been outbid there
+void ledger_release_below(int32_t item_id, int64_t amount);
+
+// Current leader of an item and their bid; false if nobody bid yet
+bool ledger_get_hold(int32_t item_id, LedgerHold* out);
+
+// Stats
+typedef struct {
+    uint64_t accounts;
+    uint64_t holds;
+    uint64_t journal_pending;
+    uint64_t flushed_entries;
+    uint64_t flush_batches;
+    uint64_t flush_failures;
+} LedgerStats;
+
+void ledger_get_stats(LedgerStats* out);
+
+#endif
@@ -0,0 +1,231 @@
+#include "listing_cache.h"
+#include "auction_events.h"
+#include "mem_pool.h"
+#include "protocol_payloads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct CacheEntry {
+    struct CacheEntry* next;
+    int32_t room_id;
+    uint64_t gen;           // Bumped by every invalidation
+    char* data;             // Encoded payload (pool buffer), NULL if not cached
+    size_t len;
+    uint64_t built_ms;
+} CacheEntry;
+
+static CacheEntry room_list;
+static CacheEntry* item_lists[LISTING_CACHE_BUCKETS];
+static ListingCacheStats stats;
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Caller holds cache_lock; `create` needs it for writing
+static CacheEntry* find_entry(SyncKind kind, int32_t room_id, bool create)
+{
+    if (kind == SYNC_ROOM) return &room_list;
+
+    CacheEntry** pp = &item_lists[(uint32_t)room_id % LISTING_CACHE_BUCKETS];
+    while (*pp && (*pp)->room_id != room_id) pp = &(*pp)->next;
+    if (!*pp && create) {
+        *pp = calloc(1, sizeof(CacheEntry));
+        if (*pp) (*pp)->room_id = room_id;
+    }
+    return *pp;
+}
+
+// Caller holds cache_lock for writing
+static void drop_data(CacheEntry* e)
+{
+    e->gen++;
+    if (!e->data) return;
+    buf_pool_free(e->data);
+    e->data = NULL;
+    e->len = 0;
+    stats.invalidations++;
+    stats.entries--;
+}
+
+int listing_cache_page(SyncKind kind, const char* snapshot, size_t len, uint16_t offset,
+                       char* out, size_t cap)
+{
+    size_t entry_size = (kind == SYNC_ROOM) ? sizeof(RoomInfo) : sizeof(ItemInfo);
+    ListRoomsRes head;
+    if (len < sizeof(head) || cap < sizeof(head)) return -1;
+    memcpy(&head, snapshot, sizeof(head));
+
+    uint16_t total = head.count;
+    if (offset > total) offset = total;
+    size_t fit = (cap - sizeof(head)) / entry_size;
+    size_t n = (size_t)(total - offset) < fit ? (size_t)(total - offset) : fit;
+    if (n == 0 && offset < total) return -1;
+
+    head.count = (uint16_t)n;
+    head.offset = offset;
+    head.next_offset = (offset + n < total) ? (uint16_t)(offset + n) : 0;
+    if (head.next_offset) snprintf(head.message, sizeof(head.message), "Partial list");
+    memcpy(out, &head, sizeof(head));
+    memcpy(out + sizeof(head), snapshot + sizeof(head) + offset * entry_size, n * entry_size);
+    return (int)(sizeof(head) + n * entry_size);
+}
+
+int listing_cache_lookup(SyncKind kind, int32_t room_id, uint64_t version, uint16_t offset,
+                         char* out, size_t cap)
+{
+    int len = -1;
+    uint64_t built_ms = 0, built_version = 0;
+
+    pthread_rwlock_rdlock(&cache_lock);
+    CacheEntry* e = find_entry(kind, room_id, false);
+    if (e && e->data) {
+        memcpy(&built_version, e->data + offsetof(ListRoomsRes, version), sizeof(built_version));
+        if (version == 0 || version == built_version) {
+            len = listing_cache_page(kind, e->data, e->len, offset, out, cap);
+            built_ms = e->built_ms;
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+
+    uint64_t now = auction_events_now_ms();
+    uint64_t current = delta_sync_version();
+
+    pthread_mutex_lock(&stats_lock);
+    if (len < 0) {
+        stats.misses++;
+    } else {
+        stats.hits++;
+        stats.stale_versions += current > built_version ? current - built_version : 0;
+        if (now - built_ms > stats.max_age_ms) stats.max_age_ms = now - built_ms;
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return len;
+}
+
+uint64_t listing_cache_begin(SyncKind kind, int32_t room_id)
+{
+    // Every miss comes through here: readers share the lock, and only the
+    // first miss of a room takes it for writing to add the entry
+    pthread_rwlock_rdlock(&cache_lock);
+    CacheEntry* e = find_entry(kind, room_id, false);
+    uint64_t gen = e ? e->gen : 0;
+    pthread_rwlock_unlock(&cache_lock);
+    if (e) return gen;
+
+    pthread_rwlock_wrlock(&cache_lock);
+    e = find_entry(kind, room_id, true);    // Rechecks: another miss may have added it
+    gen = e ? e->gen : 0;
+    pthread_rwlock_unlock(&cache_lock);
+    return gen;
+}
+
+void listing_cache_store(SyncKind kind, int32_t room_id, uint64_t gen,
+                         const char* payload, size_t len)
+{
+    char* copy = buf_pool_alloc(len);
+    if (!copy) return;
+    memcpy(copy, payload, len);
+
+    pthread_rwlock_wrlock(&cache_lock);
+    CacheEntry* e = find_entry(kind, room_id, false);
+    if (!e || e->gen != gen) {
+        pthread_mutex_lock(&stats_lock);
+        stats.raced_stores++;
+        pthread_mutex_unlock(&stats_lock);
+        pthread_rwlock_unlock(&cache_lock);
+        buf_pool_free(copy);
+        return;
+    }
+    if (e->data) {
+        buf_pool_free(e->data);
+        stats.entries--;
+    }
+    e->data = copy;
+    e->len = len;
+    e->built_ms = auction_events_now_ms();
+    stats.entries++;
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+// === EVENT HANDLING ===
+// Update one ItemInfo inside a cached item list. Returns false when the
+// item is not in the entry (the entry then has to be rebuilt).
+static bool patch_item(CacheEntry* e, int32_t item_id, const int64_t* price, const char* status)
+{
+    e->gen++;   // Also keeps a build that started before this event out
+    if (!e->data) return true;
+
+    ListRoomsRes head;
+    memcpy(&head, e->data, sizeof(head));
+    char* p = e->data + sizeof(head);
+    for (uint16_t i = 0; i < head.count; i++, p += sizeof(ItemInfo)) {
+        uint32_t id;
+        memcpy(&id, p + offsetof(ItemInfo, item_id), sizeof(id));
+        if (id != (uint32_t)item_id) continue;
+
+        if (price) memcpy(p + offsetof(ItemInfo, current_price), price, sizeof(*price));
+        if (status) {
+            char buf[sizeof(((ItemInfo*)0)->status)] = {0};
+            snprintf(buf, sizeof(buf), "%s", status);
+            memcpy(p + offsetof(ItemInfo, status), buf, sizeof(buf));
+        }
+        stats.patches++;
+        return true;
+    }
+    return false;
+}
+
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    pthread_rwlock_wrlock(&cache_lock);
+    CacheEntry* items = find_entry(SYNC_ITEM, ev->room_id, false);
+    bool patched = true;
+
+    switch (ev->type) {
+        case EVENT_ROOM_CREATED:
+            drop_data(&room_list);
+            break;
+        case EVENT_ROOM_CLOSED:
+            drop_data(&room_list);
+            if (items) drop_data(items);
+            break;
+        case EVENT_ITEM_CREATED:
+        case EVENT_ITEM_DELETED:
+            if (items) drop_data(items);
+            break;
+        case EVENT_ITEM_BID:
+            if (items) patched = patch_item(items, ev->item_id, &ev->amount, NULL);
+            break;
+        case EVENT_ITEM_SOLD:
+            if (items) patched = patch_item(items, ev->item_id, &ev->amount, "sold");
+            break;
+        case EVENT_ITEM_ACTIVATED:
+            if (items) patched = patch_item(items, ev->item_id, NULL, "active");
+            break;
+        case EVENT_ITEM_UNSOLD:
+            if (items) patched = patch_item(items, ev->item_id, NULL, "available");
+            break;
+        case EVENT_ITEM_CLOSING:
+        case EVENT_ITEM_EXPIRED:
+            break;
+    }
+    if (!patched) drop_data(items);
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+bool listing_cache_init(void)
+{
+    return auction_events_subscribe(on_auction_event, NULL);
+}
+
+void listing_cache_get_stats(ListingCacheStats* out)
+{
+    pthread_rwlock_rdlock(&cache_lock);
+    pthread_mutex_lock(&stats_lock);
+    *out = stats;
+    pthread_mutex_unlock(&stats_lock);
+    pthread_rwlock_unlock(&cache_lock);
+}
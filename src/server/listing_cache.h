@@ -0,0 +1,62 @@
+#ifndef LISTING_CACHE_H
+#define LISTING_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "delta_sync.h"
+
+// ========== Listing Cache (LIST_ROOMS / VIEW_ITEMS snapshots) ==========
+// Keeps the encoded snapshot payload of the room list and of each room's
+// item list, so repeat snapshot requests are a memcpy instead of a query
+// plus re-encoding. Auction events keep entries fresh: price/status
+// changes are patched into the encoded ItemInfo in place, anything that
+// adds or removes rows drops the entry and the next request rebuilds it.
+//
+// Entries hold the whole snapshot, whatever its size; lookups cut one page
+// that fits the caller's frame out of it (listing_cache_page).
+//
+// Read-through usage (delta_sync):
+//   gen = listing_cache_begin(kind, room_id);
+//   if ((len = listing_cache_lookup(kind, room_id, 0, 0, out, cap)) < 0) {
+//       ...query + encode the full snapshot into snap...
+//       listing_cache_store(kind, room_id, gen, snap, snap_len);
+//       len = listing_cache_page(kind, snap, snap_len, 0, out, cap);
+//   }
+
+#define LISTING_CACHE_BUCKETS   256
+
+// Subscribes to auction events; call once at startup
+bool listing_cache_init(void);
+
+// Copy the page starting at row `offset` of the cached snapshot into `out`.
+// With `version` != 0 only the snapshot built at that version matches (a
+// client paging through it). Returns the page length, or -1 on a miss.
+int listing_cache_lookup(SyncKind kind, int32_t room_id, uint64_t version, uint16_t offset,
+                         char* out, size_t cap);
+
+// Cut rows [offset, ...) of an encoded snapshot into a page that fits
+// `cap`, setting offset / next_offset. Returns the page length or -1.
+int listing_cache_page(SyncKind kind, const char* snapshot, size_t len, uint16_t offset,
+                       char* out, size_t cap);
+
+// Generation to pass to listing_cache_store; take it before querying the DB
+// so an event that lands during the query keeps the stale result out
+uint64_t listing_cache_begin(SyncKind kind, int32_t room_id);
+void listing_cache_store(SyncKind kind, int32_t room_id, uint64_t gen,
+                         const char* payload, size_t len);
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t patches;           // Entries updated in place by an event
+    uint64_t invalidations;     // Entries dropped by an event
+    uint64_t raced_stores;      // Builds discarded because an event beat them
+    uint64_t entries;
+    uint64_t stale_versions;    // Sum over hits of (current version - version built at)
+    uint64_t max_age_ms;        // Oldest entry served so far
+} ListingCacheStats;
+
+void listing_cache_get_stats(ListingCacheStats* out);
+
+#endif
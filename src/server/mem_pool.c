@@ -0,0 +1,334 @@
+#include "mem_pool.h"
+#include "protocol_header.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// === SLAB ALLOCATOR ===
+struct SlabChunk {
+    SlabChunk* next;
+    // objects follow
+};
+
+static size_t slab_stride(size_t obj_size)
+{
+    // Every slot must be able to hold the free-list link; keep 16-byte alignment
+    size_t size = obj_size < sizeof(void*) ? sizeof(void*) : obj_size;
+    return (size + 15) & ~(size_t)15;
+}
+
+// Caller must hold slab->lock
+static int slab_grow(Slab* slab)
+{
+    size_t stride = slab_stride(slab->obj_size);
+    size_t header = (sizeof(SlabChunk) + 15) & ~(size_t)15;
+    SlabChunk* chunk = malloc(header + stride * slab->objs_per_chunk);
+    if (!chunk) return -1;
+
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+
+    char* base = (char*)chunk + header;
+    for (size_t i = 0; i < slab->objs_per_chunk; i++) {
+        void** slot = (void**)(base + i * stride);
+        *slot = slab->free_list;
+        slab->free_list = slot;
+    }
+    slab->capacity += slab->objs_per_chunk;
+    slab->chunk_allocs++;
+    return 0;
+}
+
+int slab_init(Slab* slab, size_t obj_size, size_t objs_per_chunk)
+{
+    if (!slab || obj_size == 0 || objs_per_chunk == 0) return -1;
+    memset(slab, 0, sizeof(*slab));
+    slab->obj_size = obj_size;
+    slab->objs_per_chunk = objs_per_chunk;
+    pthread_mutex_init(&slab->lock, NULL);
+
+    // Preallocate the first chunk so the accept path never grows under normal load
+    pthread_mutex_lock(&slab->lock);
+    int rc = slab_grow(slab);
+    pthread_mutex_unlock(&slab->lock);
+    return rc;
+}
+
+void slab_destroy(Slab* slab)
+{
+    if (!slab) return;
+    pthread_mutex_lock(&slab->lock);
+    SlabChunk* chunk = slab->chunks;
+    while (chunk) {
+        SlabChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    slab->chunks = NULL;
+    slab->free_list = NULL;
+    slab->capacity = 0;
+    slab->in_use = 0;
+    pthread_mutex_unlock(&slab->lock);
+    pthread_mutex_destroy(&slab->lock);
+}
+
+void* slab_alloc(Slab* slab)
+{
+    pthread_mutex_lock(&slab->lock);
+    if (!slab->free_list && slab_grow(slab) != 0) {
+        pthread_mutex_unlock(&slab->lock);
+        return NULL;
+    }
+    void** slot = slab->free_list;
+    slab->free_list = *slot;
+    slab->in_use++;
+    slab->total_allocs++;
+    if (slab->in_use > slab->high_water) slab->high_water = slab->in_use;
+    pthread_mutex_unlock(&slab->lock);
+
+    memset(slot, 0, slab->obj_size);
+    return slot;
+}
+
+void slab_free(Slab* slab, void* obj)
+{
+    if (!obj) return;
+    pthread_mutex_lock(&slab->lock);
+    *(void**)obj = slab->free_list;
+    slab->free_list = obj;
+    slab->in_use--;
+    pthread_mutex_unlock(&slab->lock);
+}
+
+void slab_get_stats(Slab* slab, SlabStats* out)
+{
+    pthread_mutex_lock(&slab->lock);
+    out->in_use = slab->in_use;
+    out->high_water = slab->high_water;
+    out->capacity = slab->capacity;
+    out->total_allocs = slab->total_allocs;
+    out->chunk_allocs = slab->chunk_allocs;
+    pthread_mutex_unlock(&slab->lock);
+}
+
+// === BUFFER POOL ===
+#define BUF_MAGIC 0xB0FFu
+#define BUF_CLASS_NONE 0xFFFFu   // Oversize buffer, straight malloc/free
+
+// Sits in front of every buffer handed out; 16 bytes keeps payloads aligned
+typedef struct BufHdr {
+    struct BufHdr* next;
+    uint16_t cls;
+    uint16_t magic;
+    uint32_t reserved;
+} BufHdr;
+
+static const size_t class_sizes[BUF_CLASS_COUNT] = {
+    256,                // BUF_CLASS_SMALL
+    512,                // BUF_CLASS_MEDIUM
+    BUFF_SIZE,          // BUF_CLASS_PAYLOAD
+    sizeof(Message),    // BUF_CLASS_FRAME
+};
+
+typedef struct {
+    BufHdr* head;
+    size_t count;
+} BufList;
+
+typedef struct {
+    _Atomic uint64_t in_use;
+    _Atomic uint64_t high_water;
+    _Atomic uint64_t pool_hits;
+    _Atomic uint64_t heap_allocs;
+    _Atomic uint64_t oversize;
+} BufCounters;
+
+static BufList depot[BUF_CLASS_COUNT];
+static pthread_mutex_t depot_lock = PTHREAD_MUTEX_INITIALIZER;
+static BufCounters counters[BUF_CLASS_COUNT];
+
+static __thread BufList tls_cache[BUF_CLASS_COUNT];
+
+static int size_to_class(size_t size)
+{
+    for (int i = 0; i < BUF_CLASS_COUNT; i++) {
+        if (size <= class_sizes[i]) return i;
+    }
+    return -1;
+}
+
+static void note_in_use(BufCounters* c)
+{
+    uint64_t now = atomic_fetch_add(&c->in_use, 1) + 1;
+    uint64_t hw = atomic_load(&c->high_water);
+    while (now > hw && !atomic_compare_exchange_weak(&c->high_water, &hw, now)) {
+    }
+}
+
+static BufHdr* buf_new(int cls)
+{
+    BufHdr* hdr = malloc(sizeof(BufHdr) + class_sizes[cls]);
+    if (!hdr) return NULL;
+    hdr->next = NULL;
+    hdr->cls = (uint16_t)cls;
+    hdr->magic = BUF_MAGIC;
+    return hdr;
+}
+
+int buf_pool_prewarm(size_t per_class)
+{
+    for (int cls = 0; cls < BUF_CLASS_COUNT; cls++) {
+        for (size_t i = 0; i < per_class; i++) {
+            BufHdr* hdr = buf_new(cls);
+            if (!hdr) return -1;
+            pthread_mutex_lock(&depot_lock);
+            hdr->next = depot[cls].head;
+            depot[cls].head = hdr;
+            depot[cls].count++;
+            pthread_mutex_unlock(&depot_lock);
+        }
+    }
+    return 0;
+}
+
+// Move up to BUF_POOL_REFILL buffers from the depot into the thread cache.
+// Kept small: a reader thread only allocates, so whatever it takes sits in
+// its cache until it is used.
+static void refill_from_depot(int cls)
+{
+    BufList* cache = &tls_cache[cls];
+    pthread_mutex_lock(&depot_lock);
+    while (depot[cls].head && cache->count < BUF_POOL_REFILL) {
+        BufHdr* hdr = depot[cls].head;
+        depot[cls].head = hdr->next;
+        depot[cls].count--;
+        hdr->next = cache->head;
+        cache->head = hdr;
+        cache->count++;
+    }
+    pthread_mutex_unlock(&depot_lock);
+}
+
+void* buf_pool_alloc(size_t size)
+{
+    int cls = size_to_class(size);
+    if (cls < 0) {
+        // Larger than any frame we expect; don't let it pollute the pool
+        BufHdr* hdr = malloc(sizeof(BufHdr) + size);
+        if (!hdr) return NULL;
+        hdr->cls = BUF_CLASS_NONE;
+        hdr->magic = BUF_MAGIC;
+        atomic_fetch_add(&counters[BUF_CLASS_FRAME].oversize, 1);
+        return hdr + 1;
+    }
+
+    BufList* cache = &tls_cache[cls];
+    if (!cache->head) refill_from_depot(cls);
+
+    BufHdr* hdr = cache->head;
+    if (hdr) {
+        cache->head = hdr->next;
+        cache->count--;
+        atomic_fetch_add(&counters[cls].pool_hits, 1);
+    } else {
+        hdr = buf_new(cls);
+        if (!hdr) return NULL;
+        atomic_fetch_add(&counters[cls].heap_allocs, 1);
+    }
+    note_in_use(&counters[cls]);
+    return hdr + 1;
+}
+
+void buf_pool_free(void* buf)
+{
+    if (!buf) return;
+    BufHdr* hdr = (BufHdr*)buf - 1;
+    if (hdr->magic != BUF_MAGIC) {
+        LOG_ERROR("buf_pool_free: bad buffer %p", buf);
+        return;
+    }
+    if (hdr->cls == BUF_CLASS_NONE) {
+        free(hdr);
+        return;
+    }
+
+    int cls = hdr->cls;
+    atomic_fetch_sub(&counters[cls].in_use, 1);
+
+    BufList* cache = &tls_cache[cls];
+    hdr->next = cache->head;
+    cache->head = hdr;
+    cache->count++;
+    if (cache->count <= BUF_POOL_TLS_MAX) return;
+
+    // Full: hand half of the cache back in one go (workers free what the
+    // readers allocated, so without this their caches only ever grow)
+    pthread_mutex_lock(&depot_lock);
+    while (cache->count > BUF_POOL_TLS_MAX / 2) {
+        BufHdr* spill = cache->head;
+        cache->head = spill->next;
+        cache->count--;
+        spill->next = depot[cls].head;
+        depot[cls].head = spill;
+        depot[cls].count++;
+    }
+    pthread_mutex_unlock(&depot_lock);
+}
+
+void buf_pool_thread_flush(void)
+{
+    pthread_mutex_lock(&depot_lock);
+    for (int cls = 0; cls < BUF_CLASS_COUNT; cls++) {
+        BufList* cache = &tls_cache[cls];
+        while (cache->head) {
+            BufHdr* hdr = cache->head;
+            cache->head = hdr->next;
+            hdr->next = depot[cls].head;
+            depot[cls].head = hdr;
+            depot[cls].count++;
+        }
+        cache->count = 0;
+    }
+    pthread_mutex_unlock(&depot_lock);
+}
+
+void buf_pool_get_stats(BufClass cls, BufPoolStats* out)
+{
+    out->size = class_sizes[cls];
+    out->in_use = atomic_load(&counters[cls].in_use);
+    out->high_water = atomic_load(&counters[cls].high_water);
+    out->pool_hits = atomic_load(&counters[cls].pool_hits);
+    out->heap_allocs = atomic_load(&counters[cls].heap_allocs);
+    out->oversize = atomic_load(&counters[cls].oversize);
+}
+
+uint64_t buf_pool_heap_allocs(void)
+{
+    uint64_t total = 0;
+    for (int cls = 0; cls < BUF_CLASS_COUNT; cls++) {
+        total += atomic_load(&counters[cls].heap_allocs);
+        total += atomic_load(&counters[cls].oversize);
+    }
+    return total;
+}
+
+void mem_pool_log_stats(const char* tag, Slab* slab)
+{
+    if (slab) {
+        SlabStats s;
+        slab_get_stats(slab, &s);
+        LOG_INFO("[%s] slab: in_use=%llu high_water=%llu capacity=%llu allocs=%llu chunks=%llu",
+                 tag, (unsigned long long)s.in_use, (unsigned long long)s.high_water,
+                 (unsigned long long)s.capacity, (unsigned long long)s.total_allocs,
+                 (unsigned long long)s.chunk_allocs);
+    }
+    for (int cls = 0; cls < BUF_CLASS_COUNT; cls++) {
+        BufPoolStats b;
+        buf_pool_get_stats((BufClass)cls, &b);
+        LOG_INFO("[%s] buf[%zu]: in_use=%llu high_water=%llu hits=%llu heap=%llu oversize=%llu",
+                 tag, b.size, (unsigned long long)b.in_use, (unsigned long long)b.high_water,
+                 (unsigned long long)b.pool_hits, (unsigned long long)b.heap_allocs,
+                 (unsigned long long)b.oversize);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// ========== Slab Allocator ==========
+// Fixed-size object cache (client_t and other per-connection state).
+// Objects are carved out of chunks of `objs_per_chunk` and recycled through
+// a free list, so the heap is only touched when the slab has to grow.
+
+typedef struct SlabChunk SlabChunk;
+
+typedef struct {
+    size_t obj_size;
+    size_t objs_per_chunk;
+    void* free_list;
+    SlabChunk* chunks;
+    pthread_mutex_t lock;
+
+    // Stats (protected by lock)
+    uint64_t in_use;
+    uint64_t high_water;
+    uint64_t capacity;
+    uint64_t total_allocs;
+    uint64_t chunk_allocs;   // Heap allocations made by the slab itself
+} Slab;
+
+typedef struct {
+    uint64_t in_use;
+    uint64_t high_water;
+    uint64_t capacity;
+    uint64_t total_allocs;
+    uint64_t chunk_allocs;
+} SlabStats;
+
+int slab_init(Slab* slab, size_t obj_size, size_t objs_per_chunk);
+void slab_destroy(Slab* slab);
+void* slab_alloc(Slab* slab);   // Returns zeroed object or NULL
+void slab_free(Slab* slab, void* obj);
+void slab_get_stats(Slab* slab, SlabStats* out);
+
+// ========== Size-Classed Buffer Pool ==========
+// Buffers for inbound/outbound frames. Each thread keeps a small cache per
+// size class; overflow and refills go through a shared depot. malloc() is
+// only called when both the thread cache and the depot are empty.
+
+typedef enum {
+    BUF_CLASS_SMALL = 0,    // Fixed-size requests/responses (bid, login, ...)
+    BUF_CLASS_MEDIUM,       // Chat, create room/item
+    BUF_CLASS_PAYLOAD,      // Up to BUFF_SIZE (list responses)
+    BUF_CLASS_FRAME,        // Full Message (header + BUFF_SIZE)
+    BUF_CLASS_COUNT
+} BufClass;
+
+#define BUF_POOL_TLS_MAX 32  // Buffers cached per thread per class
+#define BUF_POOL_REFILL  4   // Buffers a thread takes from the depot at once
+
+typedef struct {
+    size_t size;
+    uint64_t in_use;
+    uint64_t high_water;
+    uint64_t pool_hits;     // Served from a thread cache or the depot
+    uint64_t heap_allocs;   // Had to call malloc()
+    uint64_t oversize;      // Requests larger than the biggest class
+} BufPoolStats;
+
+// Fill the depot with `per_class` buffers of each class so steady-state
+// traffic never reaches malloc(). Readers allocate and workers free, so the
+// buffers settle in the thread caches: size it for readers x BUF_POOL_REFILL
+// plus workers x BUF_POOL_TLS_MAX plus the frames in flight.
+int buf_pool_prewarm(size_t per_class);
+
+void* buf_pool_alloc(size_t size);
+void buf_pool_free(void* buf);
+
+// Return the calling thread's cached buffers to the depot (call before a
+// worker thread exits)
+void buf_pool_thread_flush(void);
+
+void buf_pool_get_stats(BufClass cls, BufPoolStats* out);
+uint64_t buf_pool_heap_allocs(void);   // Sum over all classes (for alloc-counting checks)
+
+// Log slab + buffer pool usage at INFO level
+void mem_pool_log_stats(const char* tag, Slab* slab);
+
+#endif
@@ -0,0 +1,138 @@
+#include "message_dispatch.h"
+#include "protocol.h"
+#include "network_utils.h"
+#include "text_validate.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+typedef void (*MessageHandler)(int sockfd, const MessageHeader* header, const char* payload);
+
+typedef struct {
+    MessageHandler handler;     // NULL: not accepted from clients
+    uint32_t min_len;
+    uint32_t max_len;
+} DispatchEntry;
+
+#define DISPATCH_ENTRY_REQ(type, value, body, size, handler) \
+    [type] = { handler, PROTOCOL_MIN_##size(body), PROTOCOL_MAX_##size(body) },
+#define DISPATCH_ENTRY_MSG(type, value, body, size)
+
+static const DispatchEntry dispatch_table[256] = {
+    PROTOCOL_MESSAGES(DISPATCH_ENTRY_REQ, DISPATCH_ENTRY_MSG)
+};
+
+// Char fields of each request, checked by text_sanitize before queueing
+typedef struct {
+    uint16_t offset;
+    uint16_t size;
+    unsigned flags;
+} StringField;
+
+#define STRING_FIELD(body, field, flags) \
+    { offsetof(body, field), sizeof(((body*)0)->field), flags }
+#define STRING_FIELDS_MAX 5
+
+typedef struct {
+    uint8_t count;
+    StringField fields[STRING_FIELDS_MAX];
+} StringFieldSet;
+
+static const StringFieldSet string_fields[256] = {
+    [LOGIN_REQ] = { 2, {
+        STRING_FIELD(LoginReq, username, TEXT_UTF8),
+        STRING_FIELD(LoginReq, password, TEXT_RAW) } },
+    [REGISTER_REQ] = { 5, {
+        STRING_FIELD(RegisterReq, username, TEXT_UTF8),
+        STRING_FIELD(RegisterReq, password, TEXT_RAW),
+        STRING_FIELD(RegisterReq, email, TEXT_UTF8),
+        STRING_FIELD(RegisterReq, bank_account, TEXT_UTF8),
+        STRING_FIELD(RegisterReq, bank_name, TEXT_UTF8) } },
+    [LOGOUT_REQ] = { 1, {
+        STRING_FIELD(LogoutReq, session_token, TEXT_RAW) } },
+    [LIST_ROOMS_REQ] = { 1, {
+        STRING_FIELD(ListRoomsReq, query, TEXT_UTF8) } },
+    [SEARCH_ITEM_REQ] = { 1, {
+        STRING_FIELD(SearchItemReq, query, TEXT_UTF8) } },
+    [CREATE_ROOM_REQ] = { 2, {
+        STRING_FIELD(CreateRoomReq, name, TEXT_UTF8),
+        STRING_FIELD(CreateRoomReq, description, TEXT_UTF8 | TEXT_MULTILINE) } },
+    [CHAT_REQ] = { 1, {
+        STRING_FIELD(ChatReq, text, TEXT_UTF8 | TEXT_MULTILINE) } },
+    [CREATE_ITEM_REQ] = { 2, {
+        STRING_FIELD(CreateItemReq, name, TEXT_UTF8),
+        STRING_FIELD(CreateItemReq, description, TEXT_UTF8 | TEXT_MULTILINE) } },
+};
+
+// VAR requests whose entries must add up to the payload length
+typedef bool (*EntryCheck)(const char* payload, uint32_t len);
+
+static const EntryCheck entry_checks[256] = {
+    [CREATE_ITEMS_REQ] = create_items_rows_valid,
+};
+
+static _Atomic uint64_t dispatched, rejected_type, rejected_length, rejected_text;
+
+static void reject(int sockfd, const MessageHeader* header, const char* reason)
+{
+    BaseResponse res = { .status = STATUS_INVALID };
+    snprintf(res.message, sizeof(res.message), "%s (type 0x%02X, %u bytes)",
+             reason, header->type, header->payload_length);
+    send_response(sockfd, ERROR_RES, header->request_id, &res, sizeof(res));
+}
+
+bool message_accept(int sockfd, const MessageHeader* header, char* payload)
+{
+    const DispatchEntry* e = &dispatch_table[header->type];
+    if (!e->handler) {
+        atomic_fetch_add(&rejected_type, 1);
+        reject(sockfd, header, "Unknown request");
+        return false;
+    }
+    if (header->payload_length < e->min_len || header->payload_length > e->max_len) {
+        atomic_fetch_add(&rejected_length, 1);
+        LOG_WARN("Client %d: bad payload length %u for type 0x%02X",
+                 sockfd, header->payload_length, header->type);
+        reject(sockfd, header, "Malformed request");
+        return false;
+    }
+    EntryCheck check = entry_checks[header->type];
+    if (check && !check(payload, header->payload_length)) {
+        atomic_fetch_add(&rejected_length, 1);
+        LOG_WARN("Client %d: entries do not match payload length %u for type 0x%02X",
+                 sockfd, header->payload_length, header->type);
+        reject(sockfd, header, "Malformed request");
+        return false;
+    }
+    // Rows with string fields are FIXED, so the offsets are in range
+    const StringFieldSet* set = &string_fields[header->type];
+    for (uint8_t i = 0; i < set->count; i++) {
+        const StringField* f = &set->fields[i];
+        if (text_sanitize(payload + f->offset, f->size, f->flags) < 0) {
+            atomic_fetch_add(&rejected_text, 1);
+            LOG_WARN("Client %d: bad text field at offset %u for type 0x%02X",
+                     sockfd, f->offset, header->type);
+            reject(sockfd, header, "Invalid text");
+            return false;
+        }
+    }
+    return true;
+}
+
+void message_dispatch(int sockfd, const MessageHeader* header, const char* payload)
+{
+    // message_accept has run on the reader; only table rows get here
+    MessageHandler handler = dispatch_table[header->type].handler;
+    if (!handler) return;
+    atomic_fetch_add(&dispatched, 1);
+    handler(sockfd, header, payload);
+}
+
+void message_dispatch_get_stats(MessageDispatchStats* out)
+{
+    out->dispatched = atomic_load(&dispatched);
+    out->rejected_type = atomic_load(&rejected_type);
+    out->rejected_length = atomic_load(&rejected_length);
+    out->rejected_text = atomic_load(&rejected_text);
+}
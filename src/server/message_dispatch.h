@@ -0,0 +1,42 @@
+#ifndef MESSAGE_DISPATCH_H
+#define MESSAGE_DISPATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol_header.h"
+
+// ========== Message Dispatch ==========
+// Request handlers in a 256-entry array indexed by MessageHeader.type,
+// generated from PROTOCOL_MESSAGES (protocol_types.h) along with each
+// request's accepted payload length. Frames are checked when they are read:
+// an unknown type, a server-to-client type, a payload length that breaks
+// the row's size rule or VAR entries that do not add up to it is answered
+// with ERROR_RES / STATUS_INVALID and never reaches a handler. The char fields of accepted payloads are then checked
+// and cleaned in place (text_validate.h): unterminated fields and invalid
+// UTF-8 are rejected the same way, control characters are stripped.
+
+// Handler prototypes, one per REQ row (the payload length is already valid)
+#define DISPATCH_DECLARE_REQ(type, value, body, size, handler) \
+    void handler(int sockfd, const MessageHeader* header, const char* payload);
+#define DISPATCH_DECLARE_MSG(type, value, body, size)
+
+PROTOCOL_MESSAGES(DISPATCH_DECLARE_REQ, DISPATCH_DECLARE_MSG)
+
+// Validate a frame before its request is queued; sanitizes the payload's
+// string fields in place. On failure the error response has been sent and
+// the frame must be dropped.
+bool message_accept(int sockfd, const MessageHeader* header, char* payload);
+
+// RequestHandler for the pipeline: O(1) lookup of the header's handler
+void message_dispatch(int sockfd, const MessageHeader* header, const char* payload);
+
+typedef struct {
+    uint64_t dispatched;
+    uint64_t rejected_type;     // Unknown or not a request
+    uint64_t rejected_length;   // Payload length breaks the size rule or the entries
+    uint64_t rejected_text;     // Unterminated string field or invalid UTF-8
+} MessageDispatchStats;
+
+void message_dispatch_get_stats(MessageDispatchStats* out);
+
+#endif
@@ -1,13 +1,64 @@
+#include "network_utils.h"
+#include "mem_pool.h"
+#include "utils.h"
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdio.h>
 
+// One per socket: a client that stops reading only blocks its own senders
+typedef struct {
+    pthread_mutex_t lock;
+    bool stuck;             // A send timed out; dropped until the fd is reopened
+} SendSlot;
+
+static SendHook send_hook = NULL;
+static CloseHook close_hook = NULL;
+static SendSlot send_slots[NET_MAX_FDS] = {
+    [0 ... NET_MAX_FDS - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER }
+};
+
+static SendSlot *slot_of(int sockfd) {
+    return &send_slots[(unsigned)sockfd % NET_MAX_FDS];
+}
+
+void net_set_send_hook(SendHook hook) {
+    send_hook = hook;
+}
+
+void net_set_close_hook(CloseHook hook) {
+    close_hook = hook;
+}
+
+void net_conn_open(int sockfd) {
+    struct timeval tv = {
+        .tv_sec = NET_SEND_TIMEOUT_MS / 1000,
+        .tv_usec = (NET_SEND_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    SendSlot *slot = slot_of(sockfd);
+    pthread_mutex_lock(&slot->lock);
+    slot->stuck = false;
+    pthread_mutex_unlock(&slot->lock);
+}
+
+void net_close(int sockfd) {
+    if (close_hook) close_hook(sockfd);
+    else close(sockfd);
+}
+
 int recv_all(int sockfd, void *buffer, size_t length) {
     size_t bytes_received = 0;
     char *ptr = (char *)buffer;
     while (bytes_received < length) {
         ssize_t n = recv(sockfd, ptr + bytes_received, length - bytes_received, 0);
+        // A signal before the first byte is reported (-1/EINTR); once part of
+        // the buffer has arrived the read is finished
+        if (n < 0 && errno == EINTR && bytes_received > 0) continue;
         if (n <= 0) return n; // 0: stop, -1: error
         bytes_received += n;
     }
@@ -15,12 +66,73 @@ int recv_all(int sockfd, void *buffer, size_t length) {
 }
 
 int send_all(int sockfd, const void *buffer, size_t length) {
+    if (send_hook) return send_hook(sockfd, buffer, length);
+
+    SendSlot *slot = slot_of(sockfd);
+    pthread_mutex_lock(&slot->lock);
+    if (slot->stuck) {
+        pthread_mutex_unlock(&slot->lock);
+        return -1;
+    }
     size_t bytes_sent = 0;
     const char *ptr = (const char *)buffer;
     while (bytes_sent < length) {
-        ssize_t n = send(sockfd, ptr + bytes_sent, length - bytes_sent, 0);
-        if (n == -1) return -1;
+        ssize_t n = send(sockfd, ptr + bytes_sent, length - bytes_sent, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1) {
+            // SO_SNDTIMEO ran out: the client stopped reading. Shut the
+            // socket so its reader sees the end and closes the connection.
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                slot->stuck = true;
+                shutdown(sockfd, SHUT_RDWR);
+                LOG_WARN("Client %d: not reading for %d ms, dropped", sockfd, NET_SEND_TIMEOUT_MS);
+            }
+            pthread_mutex_unlock(&slot->lock);
+            return -1;
+        }
         bytes_sent += n;
     }
+    pthread_mutex_unlock(&slot->lock);
     return bytes_sent;
-}
\ No newline at end of file
+}
+
+// Header + payload in one pooled buffer; caller frees with buf_pool_free()
+static char *build_frame(uint8_t type, uint32_t request_id,
+                         const void *payload, uint32_t payload_length) {
+    char *frame = buf_pool_alloc(sizeof(MessageHeader) + payload_length);
+    if (!frame) return NULL;
+
+    MessageHeader header = {0};
+    header.type = type;
+    header.request_id = request_id;
+    header.payload_length = payload_length;
+    memcpy(frame, &header, sizeof(header));
+    if (payload_length > 0) memcpy(frame + sizeof(header), payload, payload_length);
+    return frame;
+}
+
+int send_response(int sockfd, uint8_t type, uint32_t request_id,
+                  const void *payload, uint32_t payload_length) {
+    char *frame = build_frame(type, request_id, payload, payload_length);
+    if (!frame) return -1;
+    int n = send_all(sockfd, frame, sizeof(MessageHeader) + payload_length);
+    buf_pool_free(frame);
+    return n;
+}
+
+int send_batch(const int *sockfds, int count, const void *buffer, size_t length) {
+    int sent = 0;
+    for (int i = 0; i < count; i++) {
+        if (send_all(sockfds[i], buffer, length) >= 0) sent++;
+    }
+    return sent;
+}
+
+int send_broadcast(const int *sockfds, int count, uint8_t type,
+                   const void *payload, uint32_t payload_length) {
+    char *frame = build_frame(type, 0, payload, payload_length);
+    if (!frame) return 0;
+    int sent = send_batch(sockfds, count, frame, sizeof(MessageHeader) + payload_length);
+    buf_pool_free(frame);
+    return sent;
+}
@@ -0,0 +1,54 @@
+#ifndef NETWORK_UTILS_H
+#define NETWORK_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "protocol_header.h"
+
+// Blocking helpers: loop until `length` bytes are transferred.
+// Return bytes transferred, 0 on orderly shutdown, -1 on error.
+// recv_all() returns -1 with errno EINTR when a signal arrives before the
+// first byte (hot_upgrade.h wakes readers that way); send_all() retries.
+// send_all() holds a per-socket lock, so frames written by different
+// worker threads to the same client never interleave. A send that cannot
+// make progress for NET_SEND_TIMEOUT_MS (the client stopped reading) fails,
+// the socket is shut down so its reader closes the connection, and later
+// sends to it fail at once.
+#define NET_MAX_FDS           65536
+#define NET_SEND_TIMEOUT_MS   2000
+
+int recv_all(int sockfd, void *buffer, size_t length);
+int send_all(int sockfd, const void *buffer, size_t length);
+
+// Build header + payload in one buffer and send it as a single frame.
+// `request_id` is copied from the request so pipelined clients can match
+// responses that complete out of order.
+int send_response(int sockfd, uint8_t type, uint32_t request_id,
+                  const void *payload, uint32_t payload_length);
+
+// Send the same buffer to several sockets (room broadcast). Returns the
+// number of sockets the send was handed to.
+int send_batch(const int *sockfds, int count, const void *buffer, size_t length);
+
+// Build a pushed frame (request_id 0: BID_NOTIFY, CHAT_NOTIFY, ...) in a
+// buf_pool buffer and send_batch() it, so broadcasts do not touch the heap.
+int send_broadcast(const int *sockfds, int count, uint8_t type,
+                   const void *payload, uint32_t payload_length);
+
+// An I/O backend that owns the sockets (io_uring) installs hooks for the
+// whole process before the first connection: send_all()/send_batch() from
+// any thread then queue the frame with the backend instead of calling
+// send(), and net_close() closes the socket after its queued frames.
+typedef int (*SendHook)(int sockfd, const void *buffer, size_t length);
+typedef void (*CloseHook)(int sockfd);
+void net_set_send_hook(SendHook hook);
+void net_set_close_hook(CloseHook hook);
+
+// A new (or adopted) client socket: sets its send timeout and clears the
+// dropped state left by a previous connection on the same fd
+void net_conn_open(int sockfd);
+
+// Close a client socket (through the close hook when one is installed)
+void net_close(int sockfd);
+
+#endif
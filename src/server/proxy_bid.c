@@ -0,0 +1,418 @@
+#include "proxy_bid.h"
+#include "bid_service.h"
+#include "auction_events.h"
+#include "ledger.h"
+#include "cluster.h"
+#include "db_adapter.h"
+#include "protocol.h"
+#include "protocol_helpers.h"
+#include "message_dispatch.h"
+#include "network_utils.h"
+#include "conn_session.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct {
+    int32_t user_id;
+    int64_t max_amount;
+    uint64_t seq;           // Registration order, breaks ties between equal maximums
+} ProxyEntry;
+
+typedef struct ProxyItem {
+    struct ProxyItem* next;
+    int32_t item_id;
+    int32_t room_id;
+    pthread_mutex_t resolve_lock;   // One resolution per item at a time
+    ProxyEntry entries[PROXY_MAX_PER_ITEM];
+    int count;
+    bool queued;
+} ProxyItem;
+
+// Items are kept once created (entries are cleared when the auction ends),
+// so a resolver holding a ProxyItem* never sees it freed
+static ProxyItem* items[PROXY_ITEM_BUCKETS];
+static uint64_t next_seq;
+static ProxyBidStats stats;
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;  // items, entries, queue, stats
+
+static int32_t work_queue[PROXY_QUEUE_CAP];
+static uint32_t queue_head;
+static uint32_t queue_len;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static pthread_t resolver;
+static bool running;
+
+// === TABLE (caller holds table_lock) ===
+static ProxyItem* find_item(int32_t item_id, bool create)
+{
+    ProxyItem** pp = &items[(uint32_t)item_id % PROXY_ITEM_BUCKETS];
+    while (*pp && (*pp)->item_id != item_id) pp = &(*pp)->next;
+    if (!*pp && create) {
+        ProxyItem* pi = calloc(1, sizeof(*pi));
+        if (!pi) return NULL;
+        pi->item_id = item_id;
+        pthread_mutex_init(&pi->resolve_lock, NULL);
+        *pp = pi;
+    }
+    return *pp;
+}
+
+static bool remove_entry(ProxyItem* pi, int32_t user_id)
+{
+    for (int i = 0; i < pi->count; i++) {
+        if (pi->entries[i].user_id != user_id) continue;
+        pi->entries[i] = pi->entries[--pi->count];
+        stats.active_proxies--;
+        return true;
+    }
+    return false;
+}
+
+static void enqueue(ProxyItem* pi)
+{
+    if (pi->queued) return;
+    if (queue_len == PROXY_QUEUE_CAP) {
+        LOG_WARN("proxy: resolver queue full, item %d waits for its next bid", pi->item_id);
+        return;
+    }
+    work_queue[(queue_head + queue_len) % PROXY_QUEUE_CAP] = pi->item_id;
+    queue_len++;
+    pi->queued = true;
+    pthread_cond_signal(&queue_ready);
+}
+
+// === RESOLUTION ===
+// Leader and price from the ledger hold; before the first bid, the item's
+// current (starting) price from the DB
+static bool current_state(int32_t item_id, int64_t* price, int32_t* leader)
+{
+    LedgerHold hold;
+    if (ledger_get_hold(item_id, &hold)) {
+        *price = hold.amount;
+        *leader = hold.user_id;
+        return true;
+    }
+    *leader = 0;
+    PGresult* res = NULL;
+    if (!db_get_item_details(item_id, &res)) {
+        if (res) PQclear(res);
+        return false;
+    }
+    *price = atoll(PQgetvalue(res, 0, 4));
+    PQclear(res);
+    return true;
+}
+
+// Highest maximum first, earlier registration first on equal maximums
+static int compare_entries(const void* a, const void* b)
+{
+    const ProxyEntry* x = a;
+    const ProxyEntry* y = b;
+    if (x->max_amount != y->max_amount) return x->max_amount > y->max_amount ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+// The one bid that settles the sorted proxies against the current state.
+// Returns false when nothing needs to be placed.
+static bool next_bid(const ProxyEntry* sorted, int n, int64_t price, int32_t leader,
+                     int32_t* user_id, int64_t* amount)
+{
+    if (n == 0) return false;
+    const ProxyEntry* top = &sorted[0];
+    int64_t runner_max = (n > 1) ? sorted[1].max_amount : 0;
+    int64_t target;
+
+    if (top->user_id == leader) {
+        // Only respond if the runner-up could still outbid the standing price
+        if (runner_max < price + BID_MIN_INCREMENT_VND) return false;
+        target = runner_max + BID_MIN_INCREMENT_VND;
+        if (target > top->max_amount) target = top->max_amount;
+        if (target <= price) return false;
+    } else {
+        if (top->max_amount < price + BID_MIN_INCREMENT_VND) return false;
+        target = runner_max + BID_MIN_INCREMENT_VND;
+        if (target > top->max_amount) target = top->max_amount;
+        if (target < price + BID_MIN_INCREMENT_VND) target = price + BID_MIN_INCREMENT_VND;
+    }
+    *user_id = top->user_id;
+    *amount = target;
+    return true;
+}
+
+// Caller holds pi->resolve_lock
+static void resolve(ProxyItem* pi)
+{
+    ProxyEntry sorted[PROXY_MAX_PER_ITEM];
+
+    // Each pass either places a bid, drops a proxy, or sees the price move;
+    // a rejection with the price unchanged (DB error, item closed) ends the
+    // resolution instead of placing and reverting the same hold again. The
+    // bound only guards against a livelock with manual bids.
+    for (int pass = 0; pass <= PROXY_MAX_PER_ITEM; pass++) {
+        pthread_mutex_lock(&table_lock);
+        int n = pi->count;
+        int32_t room_id = pi->room_id;
+        memcpy(sorted, pi->entries, (size_t)n * sizeof(ProxyEntry));
+        stats.resolutions += (pass == 0);
+        pthread_mutex_unlock(&table_lock);
+
+        int64_t price;
+        int32_t leader, user_id;
+        int64_t amount;
+        if (n == 0 || !current_state(pi->item_id, &price, &leader)) return;
+        qsort(sorted, (size_t)n, sizeof(ProxyEntry), compare_entries);
+        if (!next_bid(sorted, n, price, leader, &user_id, &amount)) return;
+
+        int64_t new_price;
+        int32_t st = bid_service_place_proxy(room_id, pi->item_id, user_id, amount, &new_price);
+
+        pthread_mutex_lock(&table_lock);
+        if (st == STATUS_SUCCESS) {
+            stats.bids_placed++;
+        } else if (st == STATUS_INSUFFICIENT_FUNDS || st == STATUS_INVALID) {
+            // Cannot pay (or logged out): the proxy is spent
+            if (remove_entry(pi, user_id)) stats.exhausted++;
+        } else {
+            stats.rejected++;
+        }
+        pthread_mutex_unlock(&table_lock);
+        if (st != STATUS_SUCCESS && st != STATUS_INSUFFICIENT_FUNDS && st != STATUS_INVALID) {
+            // Look again only if a manual bid moved the price under us; the
+            // next bid event brings the item back otherwise
+            int64_t now_price;
+            int32_t now_leader;
+            if (!current_state(pi->item_id, &now_price, &now_leader) ||
+                (now_price == price && now_leader == leader)) {
+                return;
+            }
+        }
+    }
+}
+
+static void* resolver_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&table_lock);
+    while (1) {
+        while (running && queue_len == 0) pthread_cond_wait(&queue_ready, &table_lock);
+        if (!running) break;
+
+        int32_t item_id = work_queue[queue_head];
+        queue_head = (queue_head + 1) % PROXY_QUEUE_CAP;
+        queue_len--;
+        ProxyItem* pi = find_item(item_id, false);
+        if (!pi) continue;
+        pi->queued = false;
+        pthread_mutex_unlock(&table_lock);
+
+        pthread_mutex_lock(&pi->resolve_lock);
+        resolve(pi);
+        pthread_mutex_unlock(&pi->resolve_lock);
+
+        pthread_mutex_lock(&table_lock);
+    }
+    pthread_mutex_unlock(&table_lock);
+    return NULL;
+}
+
+// === PUBLIC API ===
+int32_t proxy_bid_register(int32_t room_id, int32_t item_id, int32_t user_id,
+                           int64_t max_amount, int64_t* price, int32_t* leader_id)
+{
+    if (room_id <= 0 || item_id <= 0 || user_id <= 0 || max_amount < 0) return STATUS_INVALID;
+    if (!cluster_owns_room(room_id)) return STATUS_WRONG_NODE;
+
+    pthread_mutex_lock(&table_lock);
+    ProxyItem* pi = find_item(item_id, true);
+    if (pi) pi->room_id = room_id;
+    pthread_mutex_unlock(&table_lock);
+    if (!pi) return STATUS_FAIL;
+
+    int32_t status = STATUS_SUCCESS;
+    int64_t balance, held;
+    pthread_mutex_lock(&pi->resolve_lock);
+    if (!current_state(item_id, price, leader_id)) {
+        status = STATUS_FAIL;
+    } else if (max_amount > 0 && *leader_id != user_id &&
+               max_amount < *price + BID_MIN_INCREMENT_VND) {
+        status = STATUS_INVALID;    // Below the next legal bid
+    } else if (max_amount > 0 && !ledger_get_balance(user_id, &balance, &held)) {
+        status = STATUS_INVALID;    // Not logged in
+    }
+
+    if (status == STATUS_SUCCESS) {
+        pthread_mutex_lock(&table_lock);
+        remove_entry(pi, user_id);
+        if (max_amount > 0) {
+            if (pi->count == PROXY_MAX_PER_ITEM) {
+                status = STATUS_BUSY;
+            } else {
+                ProxyEntry* e = &pi->entries[pi->count++];
+                e->user_id = user_id;
+                e->max_amount = max_amount;
+                e->seq = ++next_seq;
+                stats.active_proxies++;
+                stats.registrations++;
+            }
+        }
+        pthread_mutex_unlock(&table_lock);
+    }
+
+    if (status == STATUS_SUCCESS) {
+        resolve(pi);
+        if (!current_state(item_id, price, leader_id)) status = STATUS_FAIL;
+    }
+    pthread_mutex_unlock(&pi->resolve_lock);
+    return status;
+}
+
+void handle_proxy_bid(int sockfd, const MessageHeader* header, const char* payload)
+{
+    ProxyBidReq req;
+    if (!decode_PROXY_BID_REQ(payload, header->payload_length, &req)) return;
+
+    ProxyBidRes res;
+    memset(&res, 0, sizeof(res));
+    ConnSession session;
+    if (!conn_session_get(sockfd, &session) || session.room_id <= 0) {
+        res.status = STATUS_INVALID;
+        snprintf(res.message, sizeof(res.message), "Join a room first");
+        send_response(sockfd, PROXY_BID_RES, header->request_id, &res, sizeof(res));
+        return;
+    }
+
+    int64_t price = 0;
+    int32_t leader = 0;
+    res.status = proxy_bid_register(session.room_id, (int32_t)req.item_id, session.user_id,
+                                    req.max_amount, &price, &leader);
+    res.current_price = price;
+    res.leader_id = (uint32_t)leader;
+    const char* message;
+    switch (res.status) {
+        case STATUS_SUCCESS:    message = req.max_amount > 0 ? "Proxy bid registered"
+                                                             : "Proxy bid withdrawn"; break;
+        case STATUS_INVALID:    message = "Maximum below the next bid, or item not open"; break;
+        case STATUS_BUSY:       message = "Too many proxy bids on this item"; break;
+        case STATUS_WRONG_NODE: message = "Room is run by another node"; break;
+        default:                message = "Proxy bid failed"; break;
+    }
+    snprintf(res.message, sizeof(res.message), "%s", message);
+    send_response(sockfd, PROXY_BID_RES, header->request_id, &res, sizeof(res));
+}
+
+// === RESTART HANDOFF ===
+ProxyRegistration* proxy_bid_export(int* count)
+{
+    *count = 0;
+    pthread_mutex_lock(&table_lock);
+    int cap = (int)stats.active_proxies;
+    int nitems = 0;
+    for (int b = 0; b < PROXY_ITEM_BUCKETS; b++) {
+        for (ProxyItem* pi = items[b]; pi; pi = pi->next) nitems++;
+    }
+    ProxyItem** list = nitems ? malloc((size_t)nitems * sizeof(*list)) : NULL;
+    nitems = 0;
+    for (int b = 0; list && b < PROXY_ITEM_BUCKETS; b++) {
+        for (ProxyItem* pi = items[b]; pi; pi = pi->next) list[nitems++] = pi;
+    }
+    pthread_mutex_unlock(&table_lock);
+
+    ProxyRegistration* out = cap ? malloc((size_t)cap * sizeof(*out)) : NULL;
+    for (int i = 0; i < nitems && out; i++) {
+        // Items are never freed; the resolve lock lets a bid in flight finish
+        ProxyItem* pi = list[i];
+        pthread_mutex_lock(&pi->resolve_lock);
+        pthread_mutex_lock(&table_lock);
+        for (int k = 0; k < pi->count && *count < cap; k++) {
+            out[(*count)++] = (ProxyRegistration){
+                .room_id = pi->room_id, .item_id = pi->item_id,
+                .user_id = pi->entries[k].user_id,
+                .max_amount = pi->entries[k].max_amount,
+                .seq = pi->entries[k].seq,
+            };
+        }
+        pthread_mutex_unlock(&table_lock);
+        pthread_mutex_unlock(&pi->resolve_lock);
+    }
+    free(list);
+    if (*count == 0) {
+        free(out);
+        out = NULL;
+    }
+    return out;
+}
+
+// Keeps the registration order; the item is queued so a bid the old
+// process did not get to is placed here
+bool proxy_bid_restore(const ProxyRegistration* reg)
+{
+    if (reg->item_id <= 0 || reg->user_id <= 0 || reg->max_amount <= 0) return false;
+    pthread_mutex_lock(&table_lock);
+    ProxyItem* pi = find_item(reg->item_id, true);
+    bool ok = pi && pi->count < PROXY_MAX_PER_ITEM;
+    if (ok) {
+        pi->room_id = reg->room_id;
+        remove_entry(pi, reg->user_id);
+        pi->entries[pi->count++] = (ProxyEntry){
+            .user_id = reg->user_id, .max_amount = reg->max_amount, .seq = reg->seq,
+        };
+        if (reg->seq > next_seq) next_seq = reg->seq;
+        stats.active_proxies++;
+        enqueue(pi);
+    }
+    pthread_mutex_unlock(&table_lock);
+    return ok;
+}
+
+// A bid by someone else wakes the resolver; the end of the auction clears
+// the item's proxies
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    if (ev->type != EVENT_ITEM_BID && ev->type != EVENT_ITEM_SOLD &&
+        ev->type != EVENT_ITEM_UNSOLD && ev->type != EVENT_ITEM_DELETED) {
+        return;
+    }
+
+    pthread_mutex_lock(&table_lock);
+    ProxyItem* pi = find_item(ev->item_id, false);
+    if (pi && pi->count > 0) {
+        if (ev->type == EVENT_ITEM_BID) {
+            enqueue(pi);
+        } else {
+            stats.active_proxies -= (uint32_t)pi->count;
+            pi->count = 0;
+        }
+    }
+    pthread_mutex_unlock(&table_lock);
+}
+
+bool proxy_bid_init(void)
+{
+    if (!auction_events_subscribe(on_auction_event, NULL)) return false;
+    running = true;
+    if (pthread_create(&resolver, NULL, resolver_main, NULL) != 0) {
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void proxy_bid_shutdown(void)
+{
+    pthread_mutex_lock(&table_lock);
+    running = false;
+    pthread_cond_broadcast(&queue_ready);
+    pthread_mutex_unlock(&table_lock);
+    pthread_join(resolver, NULL);
+}
+
+void proxy_bid_get_stats(ProxyBidStats* out)
+{
+    pthread_mutex_lock(&table_lock);
+    *out = stats;
+    pthread_mutex_unlock(&table_lock);
+}
@@ -0,0 +1,63 @@
+#ifndef PROXY_BID_H
+#define PROXY_BID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Proxy (Auto) Bidding ==========
+// A user registers the most they are willing to pay for an item; the server
+// then bids for them, in BID_MIN_INCREMENT_VND steps, whenever someone else
+// takes the lead. Competing proxies are resolved in one step: the highest
+// maximum wins at one increment over the runner-up (capped at its own
+// maximum), equal maximums go to the earlier registration. Only the
+// resulting bid is placed, through bid_service, and recorded in the bids
+// table with is_proxy set.
+//
+// PROXY_BID_REQ registers for the session's user in the room it has
+// joined (conn_session.h). Registration resolves synchronously; bids by
+// others are answered by a resolver thread woken from the auction event
+// bus. Resolution of one item is serialized, so the outcome depends only on
+// the registered maximums, their order, and the bids placed.
+
+#define PROXY_MAX_PER_ITEM   32
+#define PROXY_ITEM_BUCKETS   1024
+#define PROXY_QUEUE_CAP      1024
+
+bool proxy_bid_init(void);      // Starts the resolver thread, subscribes to events
+void proxy_bid_shutdown(void);
+
+// Register, raise or lower (max_amount > 0) or withdraw (max_amount == 0)
+// a user's maximum for an item. On return `price` / `leader_id` hold the
+// item's state after resolution. Returns a STATUS_* code;
+// STATUS_WRONG_NODE when another node runs the room (cluster.h).
+int32_t proxy_bid_register(int32_t room_id, int32_t item_id, int32_t user_id,
+                           int64_t max_amount, int64_t* price, int32_t* leader_id);
+
+// Zero-downtime restart (hot_upgrade.h). Registrations live only in
+// memory, so the old process hands them over with the auctions; the new
+// process restores them and re-resolves each item once.
+typedef struct {
+    int32_t room_id;
+    int32_t item_id;
+    int32_t user_id;
+    int64_t max_amount;
+    uint64_t seq;
+} ProxyRegistration;
+
+// Returns a malloc'd array of every registration (free it), NULL with
+// *count = 0 if there are none. Waits out a resolution in progress.
+ProxyRegistration* proxy_bid_export(int* count);
+bool proxy_bid_restore(const ProxyRegistration* reg);
+
+typedef struct {
+    uint64_t registrations;
+    uint64_t resolutions;
+    uint64_t bids_placed;       // Bids the engine placed for users
+    uint64_t exhausted;         // Proxies dropped for lack of funds
+    uint64_t rejected;          // Engine bids refused by the ledger or the DB
+    uint32_t active_proxies;
+} ProxyBidStats;
+
+void proxy_bid_get_stats(ProxyBidStats* out);
+
+#endif
@@ -0,0 +1,408 @@
+#include "request_pipeline.h"
+#include "protocol_types.h"
+#include "protocol_helpers.h"
+#include "network_utils.h"
+#include "admission.h"
+#include "mem_pool.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#define PIPELINE_MAX_FDS 65536
+
+struct Connection {
+    int sockfd;
+    int refs;               // Owner reference + one per queued/running request
+    uint32_t in_flight;
+    bool closing;
+    bool ordered_busy;      // A stateful request is queued or running
+    struct Job* deferred_head;  // Waiting for it, in arrival order
+    struct Job* deferred_tail;
+    AdmitBuckets limits;    // Protected by lock
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;
+};
+
+typedef struct Job {
+    struct Job* next;
+    Connection* conn;
+    MessageHeader header;
+    char* payload;
+    uint64_t queued_us;     // For the overload detector
+    bool ordered;           // Stateful: runs alone on its connection
+} Job;
+
+typedef struct {
+    Job* head;
+    Job* tail;
+    uint32_t len;
+} JobQueue;
+
+static RequestHandler handler_fn;
+static pthread_t workers[PIPELINE_WORKERS];
+static bool running;
+
+static JobQueue high_q, normal_q;
+static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t q_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;    // completed caught up with submitted
+static PipelineStats stats;     // Protected by q_lock (queue lengths filled on read)
+
+static Slab job_slab;
+static Slab conn_slab;
+static Connection* conn_table[PIPELINE_MAX_FDS];
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// === QUEUES ===
+static void queue_push(JobQueue* q, Job* job)
+{
+    job->next = NULL;
+    if (q->tail) q->tail->next = job;
+    else q->head = job;
+    q->tail = job;
+    q->len++;
+}
+
+static Job* queue_pop(JobQueue* q)
+{
+    Job* job = q->head;
+    if (!job) return NULL;
+    q->head = job->next;
+    if (!q->head) q->tail = NULL;
+    q->len--;
+    return job;
+}
+
+// Reads that do not touch the connection's session state. Everything else
+// is ordered per connection (see request_pipeline.h).
+static bool is_ordered(uint8_t type)
+{
+    switch (type) {
+        case LIST_ROOMS_REQ:
+        case SEARCH_ITEM_REQ:
+        case VIEW_ITEMS_REQ:
+        case VIEW_HISTORY_REQ:
+        case PRICE_HISTORY_REQ:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static void enqueue_job(Job* job)
+{
+    job->queued_us = now_us();
+    pthread_mutex_lock(&q_lock);
+    if (is_high_priority(job->header.flags)) queue_push(&high_q, job);
+    else queue_push(&normal_q, job);
+    pthread_cond_signal(&q_cond);
+    pthread_mutex_unlock(&q_lock);
+}
+
+// An ordered job finished: release the reads queued behind it, up to and
+// including the next ordered job
+static void release_deferred(Connection* conn)
+{
+    Job* ready = NULL;
+    Job** tail = &ready;
+    pthread_mutex_lock(&conn->lock);
+    conn->ordered_busy = false;
+    while (conn->deferred_head && !conn->ordered_busy) {
+        Job* job = conn->deferred_head;
+        conn->deferred_head = job->next;
+        if (!conn->deferred_head) conn->deferred_tail = NULL;
+        if (job->ordered) conn->ordered_busy = true;
+        job->next = NULL;
+        *tail = job;
+        tail = &job->next;
+    }
+    pthread_mutex_unlock(&conn->lock);
+
+    while (ready) {
+        Job* job = ready;
+        ready = job->next;
+        enqueue_job(job);
+    }
+}
+
+// === CONNECTIONS ===
+static void conn_release(Connection* conn)
+{
+    pthread_mutex_lock(&conn->lock);
+    int refs = --conn->refs;
+    pthread_mutex_unlock(&conn->lock);
+    if (refs > 0) return;
+
+    pthread_mutex_lock(&table_lock);
+    if (conn->sockfd < PIPELINE_MAX_FDS && conn_table[conn->sockfd] == conn) {
+        conn_table[conn->sockfd] = NULL;
+    }
+    pthread_mutex_unlock(&table_lock);
+
+    net_close(conn->sockfd);
+    pthread_cond_destroy(&conn->slot_free);
+    pthread_mutex_destroy(&conn->lock);
+    slab_free(&conn_slab, conn);
+}
+
+Connection* pipeline_conn_open(int sockfd)
+{
+    if (sockfd < 0 || sockfd >= PIPELINE_MAX_FDS) return NULL;
+    Connection* conn = slab_alloc(&conn_slab);
+    if (!conn) return NULL;
+
+    conn->sockfd = sockfd;
+    conn->refs = 1;
+    admission_conn_init(&conn->limits);
+    pthread_mutex_init(&conn->lock, NULL);
+    pthread_cond_init(&conn->slot_free, NULL);
+
+    pthread_mutex_lock(&table_lock);
+    conn_table[sockfd] = conn;
+    pthread_mutex_unlock(&table_lock);
+    return conn;
+}
+
+Connection* pipeline_conn_lookup(int sockfd)
+{
+    if (sockfd < 0 || sockfd >= PIPELINE_MAX_FDS) return NULL;
+    pthread_mutex_lock(&table_lock);
+    Connection* conn = conn_table[sockfd];
+    pthread_mutex_unlock(&table_lock);
+    return conn;
+}
+
+void pipeline_conn_close(Connection* conn)
+{
+    if (!conn) return;
+    pthread_mutex_lock(&conn->lock);
+    conn->closing = true;
+    pthread_cond_broadcast(&conn->slot_free);
+    pthread_mutex_unlock(&conn->lock);
+    conn_release(conn);
+}
+
+// === SUBMIT ===
+static void reply_error(int sockfd, uint32_t request_id, int32_t status)
+{
+    BaseResponse res = { .status = status };
+    if (status == STATUS_BUSY) {
+        snprintf(res.message, sizeof(res.message), "Too many outstanding requests (max %d)",
+                 PIPELINE_MAX_IN_FLIGHT);
+    } else if (status == STATUS_RATE_LIMITED) {
+        snprintf(res.message, sizeof(res.message), "Rate limit exceeded, slow down");
+    } else {
+        snprintf(res.message, sizeof(res.message), "Server busy, try again later");
+    }
+    send_response(sockfd, ERROR_RES, request_id, &res, sizeof(res));
+}
+
+int pipeline_submit(Connection* conn, const MessageHeader* header, char* payload, bool block)
+{
+    pthread_mutex_lock(&conn->lock);
+    int32_t admit = conn->closing ? STATUS_SUCCESS : admission_check_conn(&conn->limits, header->type);
+    if (admit != STATUS_SUCCESS) {
+        pthread_mutex_unlock(&conn->lock);
+        reply_error(conn->sockfd, header->request_id, admit);
+        buf_pool_free(payload);
+        return -1;
+    }
+    while (!conn->closing && conn->in_flight >= PIPELINE_MAX_IN_FLIGHT) {
+        if (!block) {
+            pthread_mutex_unlock(&conn->lock);
+            reply_error(conn->sockfd, header->request_id, STATUS_BUSY);
+            buf_pool_free(payload);
+            pthread_mutex_lock(&q_lock);
+            stats.rejected_busy++;
+            pthread_mutex_unlock(&q_lock);
+            return -1;
+        }
+        pthread_cond_wait(&conn->slot_free, &conn->lock);
+    }
+    if (conn->closing) {
+        pthread_mutex_unlock(&conn->lock);
+        buf_pool_free(payload);
+        return -1;
+    }
+    conn->in_flight++;
+    conn->refs++;
+    pthread_mutex_unlock(&conn->lock);
+
+    Job* job = slab_alloc(&job_slab);
+    if (!job) {
+        buf_pool_free(payload);
+        pthread_mutex_lock(&conn->lock);
+        conn->in_flight--;
+        pthread_mutex_unlock(&conn->lock);
+        conn_release(conn);
+        return -1;
+    }
+    // Money-moving requests jump the queue; the client's own priority flag
+    // is not trusted
+    uint16_t flags = header->flags;
+    clear_flag(&flags, FLAG_PRIORITY_HIGH);
+    if (header->type == BID_REQ || header->type == BUY_NOW_REQ || header->type == PROXY_BID_REQ) {
+        set_flag(&flags, FLAG_PRIORITY_HIGH);
+    }
+
+    job->conn = conn;
+    job->header = *header;
+    job->header.flags = flags;
+    job->payload = payload;
+    job->ordered = is_ordered(header->type);
+    job->next = NULL;
+
+    // Counted before the job becomes visible to the workers
+    pthread_mutex_lock(&q_lock);
+    stats.submitted++;
+    if (is_high_priority(flags)) stats.high_priority++;
+    pthread_mutex_unlock(&q_lock);
+
+    // Behind a stateful request still queued or running: wait for it
+    pthread_mutex_lock(&conn->lock);
+    bool defer = conn->ordered_busy;
+    if (defer) {
+        if (conn->deferred_tail) conn->deferred_tail->next = job;
+        else conn->deferred_head = job;
+        conn->deferred_tail = job;
+    } else if (job->ordered) {
+        conn->ordered_busy = true;
+    }
+    pthread_mutex_unlock(&conn->lock);
+
+    if (!defer) {
+        enqueue_job(job);
+    } else {
+        pthread_mutex_lock(&q_lock);
+        stats.deferred++;
+        pthread_mutex_unlock(&q_lock);
+    }
+    return 0;
+}
+
+// === WORKERS ===
+static void* worker_main(void* arg)
+{
+    (void)arg;
+    int high_streak = 0;
+
+    pthread_mutex_lock(&q_lock);
+    while (1) {
+        while (running && !high_q.head && !normal_q.head) {
+            admission_record_queue_idle();
+            pthread_cond_wait(&q_cond, &q_lock);
+        }
+        if (!running) break;
+
+        // High first, but let a normal job through after a burst so list
+        // requests are not starved during a bidding war
+        Job* job;
+        if (high_q.head && (high_streak < PIPELINE_HIGH_BURST || !normal_q.head)) {
+            job = queue_pop(&high_q);
+            high_streak++;
+        } else {
+            job = queue_pop(&normal_q);
+            high_streak = 0;
+        }
+        pthread_mutex_unlock(&q_lock);
+
+        admission_record_queue_wait(now_us() - job->queued_us);
+        Connection* conn = job->conn;
+        AdmitClass cls = admission_classify(job->header.type);
+        if (cls == ADMIT_LOW && admission_overloaded()) {
+            // Queued before overload began: answer it without running it
+            admission_record_shed(cls);
+            reply_error(conn->sockfd, job->header.request_id, STATUS_OVERLOADED);
+        } else {
+            handler_fn(conn->sockfd, &job->header, job->payload);
+        }
+        buf_pool_free(job->payload);
+        bool ordered = job->ordered;
+        slab_free(&job_slab, job);
+        if (ordered) release_deferred(conn);
+
+        pthread_mutex_lock(&conn->lock);
+        conn->in_flight--;
+        pthread_cond_signal(&conn->slot_free);
+        pthread_mutex_unlock(&conn->lock);
+        conn_release(conn);
+
+        pthread_mutex_lock(&q_lock);
+        stats.completed++;
+        if (stats.completed == stats.submitted) pthread_cond_broadcast(&idle_cond);
+    }
+    pthread_mutex_unlock(&q_lock);
+
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+bool pipeline_init(RequestHandler handler)
+{
+    if (!handler) return false;
+    if (slab_init(&job_slab, sizeof(Job), 256) != 0 ||
+        slab_init(&conn_slab, sizeof(Connection), 128) != 0) {
+        return false;
+    }
+
+    handler_fn = handler;
+    running = true;
+    for (int i = 0; i < PIPELINE_WORKERS; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0) {
+            LOG_ERROR("pipeline: failed to start worker %d", i);
+            return false;
+        }
+    }
+    LOG_INFO("pipeline: %d workers, max %d in-flight requests per connection",
+             PIPELINE_WORKERS, PIPELINE_MAX_IN_FLIGHT);
+    return true;
+}
+
+void pipeline_shutdown(void)
+{
+    pthread_mutex_lock(&q_lock);
+    running = false;
+    pthread_cond_broadcast(&q_cond);
+    pthread_mutex_unlock(&q_lock);
+    for (int i = 0; i < PIPELINE_WORKERS; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+bool pipeline_wait_idle(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+
+    pthread_mutex_lock(&q_lock);
+    int rc = 0;
+    while (stats.completed != stats.submitted && rc == 0) {
+        rc = pthread_cond_timedwait(&idle_cond, &q_lock, &deadline);
+    }
+    bool idle = stats.completed == stats.submitted;
+    pthread_mutex_unlock(&q_lock);
+    return idle;
+}
+
+void pipeline_get_stats(PipelineStats* out)
+{
+    pthread_mutex_lock(&q_lock);
+    *out = stats;
+    out->queued_high = high_q.len;
+    out->queued_normal = normal_q.len;
+    pthread_mutex_unlock(&q_lock);
+}
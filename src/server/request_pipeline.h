@@ -0,0 +1,66 @@
+#ifndef REQUEST_PIPELINE_H
+#define REQUEST_PIPELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "protocol_header.h"
+
+// ========== Pipelined Request Execution ==========
+// The connection reader keeps pulling frames off the socket and hands them
+// to a shared worker pool, so a slow VIEW_ITEMS_REQ does not hold up a BID_REQ
+// sent right after it. Responses carry the request's request_id and are
+// written as soon as each handler finishes (possibly out of order).
+//
+// Only reads (room / item lists, search, history) run in parallel. Requests
+// that change or depend on the connection's state (login, room membership,
+// money, bids, chat) run one at a time per connection, in arrival order, and
+// a read waits for the state change queued before it: JOIN_ROOM -> BID or two
+// BIDs from one client never run out of order.
+//
+// BID_REQ, BUY_NOW_REQ and PROXY_BID_REQ get FLAG_PRIORITY_HIGH and go to a
+// separate queue that workers drain first; the flag a client sets itself is
+// cleared.
+
+#define PIPELINE_WORKERS          4
+#define PIPELINE_MAX_IN_FLIGHT    8     // Per connection
+#define PIPELINE_HIGH_BURST       8     // High-priority jobs run before one normal job is let through
+
+typedef void (*RequestHandler)(int sockfd, const MessageHeader* header, const char* payload);
+
+typedef struct Connection Connection;
+
+bool pipeline_init(RequestHandler handler);
+void pipeline_shutdown(void);
+
+// Register a socket. The pipeline owns the fd from here on and closes it
+// once the connection is closed and its last in-flight request is done.
+Connection* pipeline_conn_open(int sockfd);
+Connection* pipeline_conn_lookup(int sockfd);
+void pipeline_conn_close(Connection* conn);
+
+// Queue a frame; the pipeline takes ownership of `payload` (a buf_pool
+// buffer). Frames refused by admission control (admission.h) are answered
+// with ERROR_RES/STATUS_RATE_LIMITED or STATUS_OVERLOADED and -1 is
+// returned. When the connection already has PIPELINE_MAX_IN_FLIGHT requests
+// outstanding, `block` waits for a slot; otherwise the frame is rejected with
+// ERROR_RES/STATUS_BUSY and -1 is returned.
+int pipeline_submit(Connection* conn, const MessageHeader* header, char* payload, bool block);
+
+// Wait until every submitted request has finished (responses written).
+// Only meaningful once the readers have stopped submitting (hot_upgrade.h).
+bool pipeline_wait_idle(uint32_t timeout_ms);
+
+// Stats
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected_busy;
+    uint64_t high_priority;
+    uint64_t deferred;          // Held back behind an earlier stateful request
+    uint32_t queued_high;
+    uint32_t queued_normal;
+} PipelineStats;
+
+void pipeline_get_stats(PipelineStats* out);
+
+#endif
@@ -0,0 +1,145 @@
+#include "room_service.h"
+#include "admission.h"
+#include "auction_events.h"
+#include "ledger.h"
+#include "item_scheduler.h"
+#include "user_stats.h"
+#include "db_adapter.h"
+#include "text_validate.h"
+#include "protocol_helpers.h"
+#include <stdlib.h>
+
+int32_t room_service_create_room(const char* name, const char* desc, int32_t creator_id,
+                                 uint64_t start_time, uint64_t end_time)
+{
+    int32_t room_id = db_create_room(name, desc, creator_id, start_time, end_time);
+    if (room_id > 0) {
+        AuctionEvent ev = { .type = EVENT_ROOM_CREATED, .room_id = room_id, .user_id = creator_id };
+        auction_events_publish(&ev);
+    }
+    return room_id;
+}
+
+int32_t room_service_create_item(int32_t room_id, int32_t seller_id, const char* name,
+                                 const char* desc, int64_t start_price, int64_t buy_now_price,
+                                 uint32_t duration_sec)
+{
+    int32_t position = item_scheduler_next_position(room_id);
+    if (position <= 0) return -1;
+
+    int32_t item_id = db_create_item(room_id, seller_id, name, desc,
+                                     start_price, buy_now_price, duration_sec, position);
+    if (item_id > 0) {
+        AuctionEvent ev = {
+            .type = EVENT_ITEM_CREATED, .room_id = room_id, .item_id = item_id,
+            .user_id = seller_id, .amount = start_price,
+        };
+        user_stats_note_item(item_id, name);
+        auction_events_publish(&ev);
+        // After ITEM_CREATED so listeners see the item before it activates
+        item_scheduler_enqueue(room_id, item_id, position, duration_sec);
+    }
+    return item_id;
+}
+
+// Same rules as the single-item path, plus the text checks message_accept
+// applies to CREATE_ITEM_REQ (entries of a VAR payload are not covered there)
+static bool item_row_valid(CreateItemReq* row)
+{
+    if (text_sanitize(row->name, sizeof(row->name), TEXT_UTF8) <= 0) return false;
+    if (text_sanitize(row->description, sizeof(row->description),
+                      TEXT_UTF8 | TEXT_MULTILINE) < 0) return false;
+    if (row->start_price < 0) return false;
+    if (row->buy_now_price != 0 && row->buy_now_price < row->start_price) return false;
+    return true;
+}
+
+int room_service_create_items(int32_t room_id, int32_t seller_id, CreateItemReq* rows,
+                              int count, CreateItemResult* results)
+{
+    if (room_id <= 0 || seller_id <= 0 || count <= 0) return 0;
+
+    int valid = 0;
+    for (int i = 0; i < count; i++) {
+        results[i].item_id = 0;
+        results[i].status = item_row_valid(&rows[i]) ? STATUS_SUCCESS : STATUS_INVALID;
+        if (results[i].status == STATUS_SUCCESS) valid++;
+    }
+    if (valid == 0) return 0;
+
+    // One reservation for the whole batch instead of a lookup per item
+    int32_t first = item_scheduler_reserve_positions(room_id, valid);
+    ItemInsert* batch = malloc(sizeof(ItemInsert) * DB_ITEM_INSERT_BATCH);
+    int* index = malloc(sizeof(int) * DB_ITEM_INSERT_BATCH);
+    int32_t* ids = malloc(sizeof(int32_t) * DB_ITEM_INSERT_BATCH);
+    if (first <= 0 || !batch || !index || !ids) {
+        free(batch); free(index); free(ids);
+        for (int i = 0; i < count; i++) {
+            if (results[i].status == STATUS_SUCCESS) results[i].status = STATUS_FAIL;
+        }
+        return 0;
+    }
+
+    int created = 0;
+    int32_t position = first;
+    int i = 0;
+    while (i < count) {
+        int n = 0;
+        for (; i < count && n < DB_ITEM_INSERT_BATCH; i++) {
+            if (results[i].status != STATUS_SUCCESS) continue;
+            batch[n] = (ItemInsert){
+                .name = rows[i].name, .description = rows[i].description,
+                .start_price_vnd = rows[i].start_price, .buy_now_price_vnd = rows[i].buy_now_price,
+                .queue_position = position++,
+            };
+            index[n++] = i;
+        }
+        if (n == 0) break;
+
+        if (!db_create_items(room_id, seller_id, batch, n, ids)) {
+            // The positions stay unused; the queue only needs them ordered
+            for (int k = 0; k < n; k++) results[index[k]].status = STATUS_FAIL;
+            continue;
+        }
+        for (int k = 0; k < n; k++) {
+            const CreateItemReq* row = &rows[index[k]];
+            results[index[k]].item_id = (uint32_t)ids[k];
+            AuctionEvent ev = {
+                .type = EVENT_ITEM_CREATED, .room_id = room_id, .item_id = ids[k],
+                .user_id = seller_id, .amount = row->start_price,
+            };
+            user_stats_note_item(ids[k], row->name);
+            auction_events_publish(&ev);
+            item_scheduler_enqueue(room_id, ids[k], batch[k].queue_position, row->duration_sec);
+        }
+        created += n;
+    }
+    free(batch); free(index); free(ids);
+    return created;
+}
+
+bool room_service_delete_item(int32_t room_id, int32_t item_id)
+{
+    if (!db_delete_item(item_id)) return false;
+
+    // Nobody pays for a withdrawn item
+    ledger_release(item_id);
+    item_scheduler_remove(room_id, item_id);
+
+    AuctionEvent ev = { .type = EVENT_ITEM_DELETED, .room_id = room_id, .item_id = item_id };
+    auction_events_publish(&ev);
+    return true;
+}
+
+int32_t room_service_save_chat(int32_t room_id, int32_t user_id, const char* text)
+{
+    // Per user, so a flood spread over several connections is caught too
+    int32_t admit = admission_check_user(user_id, ADMIT_CHAT);
+    if (admit != STATUS_SUCCESS) return admit;
+
+    if (admission_overloaded()) {
+        admission_record_shed(ADMIT_CHAT);
+        return STATUS_OVERLOADED;
+    }
+    return db_save_chat_message(room_id, user_id, text) ? STATUS_SUCCESS : STATUS_FAIL;
+}
@@ -0,0 +1,36 @@
+#ifndef ROOM_SERVICE_H
+#define ROOM_SERVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol_payloads.h"
+
+// ========== Room / Item Catalog Service ==========
+// Writes that change what LIST_ROOMS / VIEW_ITEMS return. Each successful
+// write is published as an auction event so mirrors stay in step.
+
+int32_t room_service_create_room(const char* name, const char* desc, int32_t creator_id,
+                                 uint64_t start_time, uint64_t end_time);
+
+int32_t room_service_create_item(int32_t room_id, int32_t seller_id, const char* name,
+                                 const char* desc, int64_t start_price, int64_t buy_now_price,
+                                 uint32_t duration_sec);
+
+// Create a batch of items for one seller (CREATE_ITEMS_REQ, item_import).
+// Rows are checked first (text fields are sanitized in place); the valid
+// ones get consecutive queue positions and are inserted DB_ITEM_INSERT_BATCH
+// at a time. results[i] gets the outcome of rows[i]. Returns the number of
+// items created.
+int room_service_create_items(int32_t room_id, int32_t seller_id, CreateItemReq* rows,
+                              int count, CreateItemResult* results);
+
+bool room_service_delete_item(int32_t room_id, int32_t item_id);
+
+// Admit a chat line against the user's chat limit (admission.h) and store
+// it for the room's history. STATUS_RATE_LIMITED: over the limit, the line
+// must not be delivered. Otherwise the caller delivers it; storing is
+// skipped while the server is overloaded (STATUS_OVERLOADED) and
+// STATUS_FAIL means the insert failed.
+int32_t room_service_save_chat(int32_t room_id, int32_t user_id, const char* text);
+
+#endif
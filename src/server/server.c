@@ -2,14 +2,38 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include "protocol.h"
 #include "network_utils.h" 
+#include "mem_pool.h"
+#include "uring_backend.h"
+#include "request_pipeline.h"
+#include "message_dispatch.h"
+#include "ledger.h"
+#include "auth_service.h"
+#include "delta_sync.h"
+#include "listing_cache.h"
+#include "user_stats.h"
+#include "bid_series.h"
+#include "item_scheduler.h"
+#include "proxy_bid.h"
+#include "bid_service.h"
+#include "cluster.h"
+#include "item_import.h"
+#include "item_batch.h"
+#include "wire_capture.h"
+#include "conn_session.h"
+#include "hot_upgrade.h"
+#include "db_adapter.h"
+#include "utils.h"
 
-#define PORT 5500
+#define DEFAULT_PORT 5500
 #define MAX_CLIENTS 100
+// Buffer pool per class: reader caches, worker caches, one frame in flight per client
+#define BUF_POOL_PREWARM (MAX_CLIENTS * (BUF_POOL_REFILL + 1) + PIPELINE_WORKERS * BUF_POOL_TLS_MAX)
 
 // Cấu trúc để truyền vào thread
 typedef struct {
@@ -17,109 +41,150 @@ typedef struct {
     struct sockaddr_in address;
 } client_t;
 
+static Slab client_slab;   // client_t objects, MAX_CLIENTS per chunk
 
 void *client_handler(void *arg) {
     client_t *cli = (client_t *)arg;
     int sockfd = cli->sockfd;
-    free(cli); // Giải phóng struct wrapper, chỉ giữ lại sockfd
+    slab_free(&client_slab, cli); // Trả struct wrapper về slab, chỉ giữ lại sockfd
     
     // Detach thread để tự giải phóng tài nguyên khi xong
     pthread_detach(pthread_self());
 
-    PacketHeader header;
+    Connection *conn = pipeline_conn_open(sockfd);
+    if (!conn) {
+        close(sockfd);
+        return NULL;
+    }
+    wire_capture_conn_open(sockfd);
+
+    MessageHeader header;
     
     while (1) {
+        // Đang bàn giao cho process mới (hot_upgrade.h): dừng tại đây, giữa hai frame
+        hot_upgrade_checkpoint(sockfd);
+
         // BƯỚC A: Đọc Header trước
-        int n = recv_all(sockfd, &header, sizeof(PacketHeader));
+        int n = recv_all(sockfd, &header, sizeof(MessageHeader));
+        if (n < 0 && errno == EINTR) continue;  // Bị đánh thức để bàn giao
         if (n <= 0) {
             printf("Client %d disconnected.\n", sockfd);
             break;
         }
 
-        // BƯỚC B: Dựa vào header.type để đọc tiếp Payload
-        switch (header.type) {
-            switch (header.type) {
-            // ==========================================
-            // GROUP 1: AUTHENTICATION (0x01-0x0F)
-            // ==========================================
-            case LOGIN_REQ:
-                handle_login(sockfd);
-                break;
-            case REGISTER_REQ:
-                handle_register(sockfd);
-                break;
-            case LOGOUT_REQ:
-                handle_logout(sockfd);
-                break;
-
-            // ==========================================
-            // GROUP 2: ACCOUNT MANAGEMENT (0x10-0x1F)
-            // ==========================================
-            case MONEY_REQ: // Deposit logic
-                handle_deposit(sockfd); 
-                break;
-            case REDEEM_REQ: // Withdraw logic
-                handle_redeem(sockfd);
-                break;
-            case VIEW_HISTORY_REQ:
-                handle_view_history(sockfd);
-                break;
-
-            // ==========================================
-            // GROUP 3: OUTSIDE-ROOM ACTIONS (0x20-0x3F)
-            // ==========================================
-            case JOIN_ROOM_REQ:
-                handle_join_room(sockfd);
-                break;
-            case LEAVE_ROOM_REQ:
-                handle_leave_room(sockfd);
-                break;
-            case LIST_ROOMS_REQ:
-                handle_list_rooms(sockfd);
-                break;
-            case SEARCH_ITEM_REQ:
-                handle_search_item(sockfd);
-                break;
-            case CREATE_ROOM_REQ:
-                handle_create_room(sockfd);
-                break;
-
-            // ==========================================
-            // GROUP 4: IN-ROOM ACTIONS (0x40-0x5F)
-            // ==========================================
-            case VIEW_ITEMS_REQ:
-                handle_view_items(sockfd);
-                break;
-            case BID_REQ:
-                handle_bid(sockfd);
-                break;
-            case BUY_NOW_REQ:
-                handle_buy_now(sockfd);
-                break;
-            case CHAT_REQ:
-                handle_chat(sockfd);
-                break;
-            case CREATE_ITEM_REQ:
-                handle_create_item(sockfd);
-                break;
-            case DELETE_ITEM_REQ:
-                handle_delete_item(sockfd);
-                break;
-
-            default:
-                printf("Unknown message type\n");
+        // Đọc payload vào buffer lấy từ pool (không malloc trên đường bid/chat)
+        if (header.payload_length > BUFF_SIZE) {
+            printf("Client %d: payload too large (%u)\n", sockfd, header.payload_length);
+            break;
+        }
+        char *payload = buf_pool_alloc(header.payload_length);
+        if (!payload) break;
+        // Frame đã bắt đầu thì đọc cho hết, kể cả khi bị đánh thức
+        n = 1;
+        if (header.payload_length > 0) {
+            do n = recv_all(sockfd, payload, header.payload_length);
+            while (n < 0 && errno == EINTR);
+        }
+        if (n <= 0) {
+            buf_pool_free(payload);
+            printf("Client %d disconnected.\n", sockfd);
+            break;
         }
+
+        // Ghi frame nguyên gốc (trước khi kiểm tra / làm sạch chuỗi)
+        wire_capture_frame(sockfd, &header, payload);
+
+        // Sai type / sai độ dài / chuỗi không hợp lệ: đã trả ERROR_RES, bỏ frame này
+        if (!message_accept(sockfd, &header, payload)) {
+            buf_pool_free(payload);
+            continue;
+        }
+
+        // BƯỚC B: Đưa request vào pipeline rồi đọc tiếp frame sau, không chờ
+        // handler xong. Chặn lại khi đã có PIPELINE_MAX_IN_FLIGHT request.
+        pipeline_submit(conn, &header, payload, true);
     }
 
-    close(sockfd);
+    // Socket được đóng khi request cuối cùng của kết nối chạy xong
+    hot_upgrade_unregister(sockfd);
+    conn_session_clear(sockfd);
+    item_batch_conn_close(sockfd);
+    wire_capture_conn_close(sockfd);
+    pipeline_conn_close(conn);
+    buf_pool_thread_flush();
     return NULL;
 }
 
-int main() {
-    int server_fd, new_socket;
+// Lỗi: reactor tự đóng socket và giải phóng slot, không arm recv
+static int uring_on_open(int sockfd) {
+    conn_session_clear(sockfd);
+    if (!pipeline_conn_open(sockfd)) return -1;
+    wire_capture_conn_open(sockfd);
+    return 0;
+}
+
+// Payload nằm trong buffer ghép frame của reactor: kiểm tra chuỗi ngay tại
+// đó, copy sang buffer pool rồi đưa vào pipeline (không chặn reactor khi
+// vượt giới hạn in-flight)
+static void uring_on_frame(int sockfd, const MessageHeader *header, char *payload) {
+    Connection *conn = pipeline_conn_lookup(sockfd);
+    if (!conn) return;
+    wire_capture_frame(sockfd, header, payload);
+    if (!message_accept(sockfd, header, payload)) return;
+    char *copy = buf_pool_alloc(header->payload_length);
+    if (!copy) return;
+    memcpy(copy, payload, header->payload_length);
+    pipeline_submit(conn, header, copy, false);
+}
+
+static void uring_on_close(int sockfd) {
+    printf("Client %d disconnected.\n", sockfd);
+    conn_session_clear(sockfd);
+    item_batch_conn_close(sockfd);
+    wire_capture_conn_close(sockfd);
+    pipeline_conn_close(pipeline_conn_lookup(sockfd));
+}
+
+static const UringCallbacks uring_callbacks = {
+    .on_open = uring_on_open,
+    .on_frame = uring_on_frame,
+    .on_close = uring_on_close,
+};
+
+// Tạo thread đọc cho một client (mới accept hoặc nhận lại từ process cũ)
+static void start_client(int sockfd, const struct sockaddr_in *addr) {
+    client_t *cli = slab_alloc(&client_slab);
+    if (!cli) {
+        close(sockfd);
+        return;
+    }
+    cli->sockfd = sockfd;
+    cli->address = *addr;
+    net_conn_open(sockfd);     // Timeout gửi: client không đọc thì bị ngắt
+
+    // Đăng ký trước khi thread chạy để lần bàn giao sau không bỏ sót kết nối
+    hot_upgrade_register(sockfd);
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, client_handler, (void*)cli) != 0) {
+        perror("Thread creation failed");
+        hot_upgrade_unregister(sockfd);
+        slab_free(&client_slab, cli);
+        close(sockfd);
+    }
+}
+
+static void adopt_client(int sockfd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    getpeername(sockfd, (struct sockaddr *)&addr, &len);
+    start_client(sockfd, &addr);
+}
+
+static int open_listener(int port) {
+    int server_fd;
     struct sockaddr_in address;
     int opt = 1;
-    int addrlen = sizeof(address);
 
     // 1. Tạo socket
     if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
@@ -136,7 +201,7 @@ int main() {
     // 3. Bind địa chỉ
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+    address.sin_port = htons(port);
 
     if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
         perror("Bind failed");
@@ -148,33 +213,201 @@ int main() {
         perror("Listen failed");
         exit(EXIT_FAILURE);
     }
+    return server_fd;
+}
 
-    printf("Server is listening on port %d...\n", PORT);
+int main(int argc, char *argv[]) {
+    int server_fd = -1, new_socket;
+
+    // Tham số dòng lệnh:
+    //   --io=uring|threads   backend I/O (mặc định threads)
+    //   --db=<conninfo>      chuỗi kết nối PostgreSQL
+    //   --db-read=<conninfo> bản sao chỉ đọc cho danh sách / tìm kiếm / lịch sử
+    //   --read-lag-ms=<n>    độ trễ tối đa cho phép của bản sao (mặc định 1000)
+    //   --node=<id>          bật chế độ nhiều node (cluster.h), id riêng cho mỗi process
+    //   --port=<n>           cổng lắng nghe (mặc định 5500)
+    //   --import-items=<room_id>:<seller_id>:<file.csv>
+    //                        nhập danh sách item từ CSV (item_import.h) khi khởi động
+    //   --capture=<file>     ghi lại mọi frame nhận được để replay (wire_capture.h)
+    //   --upgrade-sock=<path> restart không ngắt kết nối (hot_upgrade.h): process mới
+    //                        chạy cùng path nhận lại socket và client của process cũ
+    IoBackendType backend = IO_BACKEND_THREADS;
+    const char *conninfo = NULL;
+    const char *read_conninfo = NULL;
+    long read_lag_ms = DB_REPLICA_DEFAULT_LAG_MS;
+    const char *node = NULL;
+    int port = DEFAULT_PORT;
+    const char *import_spec = NULL;
+    const char *capture_path = NULL;
+    const char *upgrade_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--io=", 5) == 0) backend = io_backend_parse(argv[i] + 5);
+        else if (strncmp(argv[i], "--db=", 5) == 0) conninfo = argv[i] + 5;
+        else if (strncmp(argv[i], "--db-read=", 10) == 0) read_conninfo = argv[i] + 10;
+        else if (strncmp(argv[i], "--read-lag-ms=", 14) == 0) read_lag_ms = atol(argv[i] + 14);
+        else if (strncmp(argv[i], "--node=", 7) == 0) node = argv[i] + 7;
+        else if (strncmp(argv[i], "--port=", 7) == 0) port = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--import-items=", 15) == 0) import_spec = argv[i] + 15;
+        else if (strncmp(argv[i], "--capture=", 10) == 0) capture_path = argv[i] + 10;
+        else if (strncmp(argv[i], "--upgrade-sock=", 15) == 0) upgrade_path = argv[i] + 15;
+    }
+    if (port <= 0 || port > 65535) {
+        fprintf(stderr, "Invalid port\n");
+        exit(EXIT_FAILURE);
+    }
+    if (upgrade_path && backend == IO_BACKEND_URING) {
+        fprintf(stderr, "--upgrade-sock requires --io=threads\n");
+        exit(EXIT_FAILURE);
+    }
+    if (conninfo && !db_init(conninfo)) {
+        fprintf(stderr, "Database connection failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (node && !conninfo) {
+        fprintf(stderr, "--node requires --db\n");
+        exit(EXIT_FAILURE);
+    }
+    int import_room = 0, import_seller = 0, import_path_at = 0;
+    if (import_spec && (!conninfo ||
+        sscanf(import_spec, "%d:%d:%n", &import_room, &import_seller, &import_path_at) != 2 ||
+        import_path_at == 0 || import_room <= 0 || import_seller <= 0)) {
+        fprintf(stderr, "--import-items needs --db and <room_id>:<seller_id>:<file.csv>\n");
+        exit(EXIT_FAILURE);
+    }
+    // File được đọc sau khi nhận bàn giao; kiểm tra ngay để lỗi dừng trước đó
+    if (import_spec && access(import_spec + import_path_at, R_OK) != 0) {
+        fprintf(stderr, "Cannot read %s\n", import_spec + import_path_at);
+        exit(EXIT_FAILURE);
+    }
+    // Bản sao lỗi không chặn server: mọi lệnh đọc chạy trên primary
+    if (read_conninfo && conninfo && read_lag_ms >= 0 &&
+        !db_init_replica(read_conninfo, (uint32_t)read_lag_ms)) {
+        LOG_WARN("read replica unavailable, serving reads from the primary");
+    }
+
+    // Cấp phát trước slab client_t và buffer pool cho steady state
+    if (slab_init(&client_slab, sizeof(client_t), MAX_CLIENTS) != 0 ||
+        buf_pool_prewarm(BUF_POOL_PREWARM) != 0) {
+        perror("Memory pool init failed");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!pipeline_init(message_dispatch)) {
+        fprintf(stderr, "Request pipeline init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Ledger số dư trong bộ nhớ (kiểm tra tiền khi bid không cần query DB)
+    if (!ledger_init()) {
+        fprintf(stderr, "Ledger init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Change log cho VIEW_ITEMS/LIST_ROOMS delta (đăng ký nhận auction event)
+    if (!delta_sync_init()) {
+        fprintf(stderr, "Delta sync init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!auth_service_init()) {
+        fprintf(stderr, "Auth service init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!user_stats_init()) {
+        fprintf(stderr, "User stats init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // Lịch sử giá theo thời gian của từng item (PRICE_HISTORY), không query DB
+    if (!bid_series_init()) {
+        fprintf(stderr, "Bid series init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!listing_cache_init()) {
+        fprintf(stderr, "Listing cache init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!bid_service_init()) {
+        fprintf(stderr, "Bid service init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!proxy_bid_init()) {
+        fprintf(stderr, "Proxy bidding init failed\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!item_scheduler_init()) {
+        fprintf(stderr, "Item scheduler init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Nhiều process dùng chung một DB: chuyển event qua LISTEN/NOTIFY, mỗi
+    // phòng do node đang giữ lease chạy timer và proxy bid.
+    if (node && !cluster_init(conninfo, node)) {
+        fprintf(stderr, "Cluster init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (capture_path && !wire_capture_open(capture_path)) {
+        fprintf(stderr, "Capture init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Process cũ còn chạy trên upgrade_path: nhận socket lắng nghe và các
+    // client đang kết nối thay vì bind lại cổng
+    if (upgrade_path && !hot_upgrade_takeover(upgrade_path, &server_fd, adopt_client)) {
+        fprintf(stderr, "Takeover failed, the running server keeps serving\n");
+        exit(EXIT_FAILURE);
+    }
+    if (server_fd < 0) server_fd = open_listener(port);
+
+    // Process cũ (nếu có) đã bàn giao: từ đây chỉ timer của process này chạy
+    item_scheduler_start();
+    // Nhập item khi timer đã chạy: item mới vào hàng đợi của phòng như khi
+    // tạo qua CREATE_ITEMS_REQ. Client đã được nhận nên lỗi không dừng server.
+    if (import_spec) {
+        ItemImportReport report;
+        if (!item_import_csv(import_spec + import_path_at, import_room, import_seller, &report)) {
+            LOG_ERROR("Item import failed, serving without it");
+        } else {
+            printf("Imported %u/%u items (%u rejected, %u failed) in %llu ms\n",
+                   report.created, report.rows, report.rejected, report.failed,
+                   (unsigned long long)report.elapsed_ms);
+        }
+    }
+
+    if (upgrade_path && !hot_upgrade_listen(upgrade_path, server_fd)) {
+        fprintf(stderr, "Upgrade socket init failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Server is listening on port %d (io=%s, node=%s)...\n", port,
+           io_backend_name(backend), cluster_node_id());
+
+    if (backend == IO_BACKEND_URING) {
+        if (uring_backend_available()) {
+            uring_server_run(server_fd, &uring_callbacks);
+        }
+        // Kernel/bản build không hỗ trợ io_uring: quay về vòng lặp thread
+        LOG_WARN("io_uring backend unavailable, falling back to threads");
+    }
 
     // 5. Vòng lặp chấp nhận kết nối
+    hot_upgrade_register(server_fd);
     while (1) {
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
         
         // Block tại đây cho đến khi có client kết nối
+        hot_upgrade_checkpoint(server_fd);
         new_socket = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
         if (new_socket < 0) {
-            perror("Accept failed");
+            if (errno != EINTR) perror("Accept failed");
             continue;
         }
 
         printf("New connection: Socket %d\n", new_socket);
 
         // Tạo thread cho client mới
-        client_t *cli = malloc(sizeof(client_t));
-        cli->sockfd = new_socket;
-        cli->address = client_addr;
-
-        pthread_t tid;
-        if (pthread_create(&tid, NULL, client_handler, (void*)cli) != 0) {
-            perror("Thread creation failed");
-            free(cli);
-        }
+        conn_session_clear(new_socket);
+        start_client(new_socket, &client_addr);
     }
     return 0;
 }
\ No newline at end of file
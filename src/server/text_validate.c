@@ -0,0 +1,352 @@
+#include "text_validate.h"
+#include <string.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXT_X86 1
+#endif
+
+static _Atomic int active_impl = -1;   // Resolved on first use
+
+// === SCALAR ===
+// Reference implementation; the vector tiers fall back to it for tails
+static int bounded_len_scalar(const unsigned char* s, size_t cap)
+{
+    for (size_t i = 0; i < cap; i++) {
+        if (s[i] == 0) return (int)i;
+    }
+    return -1;
+}
+
+static bool utf8_valid_scalar(const unsigned char* s, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t need;
+        unsigned char lo = 0x80, hi = 0xBF;    // Allowed range of the first continuation
+        if (c < 0xC2) return false;             // Continuation or overlong 2-byte lead
+        else if (c < 0xE0) need = 1;
+        else if (c < 0xF0) {
+            need = 2;
+            if (c == 0xE0) lo = 0xA0;           // Overlong
+            if (c == 0xED) hi = 0x9F;           // Surrogates
+        } else if (c < 0xF5) {
+            need = 3;
+            if (c == 0xF0) lo = 0x90;           // Overlong
+            if (c == 0xF4) hi = 0x8F;           // Past U+10FFFF
+        } else {
+            return false;
+        }
+        if (len - i <= need) return false;
+        if (s[i + 1] < lo || s[i + 1] > hi) return false;
+        for (size_t k = 2; k <= need; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += need + 1;
+    }
+    return true;
+}
+
+// First byte that may start a control character: C0, DEL, or 0xC2 (lead
+// byte of the C1 range U+0080..U+009F, but also of U+00A0..U+00BF)
+static size_t find_control_scalar(const unsigned char* s, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] <= 0x1F || s[i] == 0x7F || s[i] == 0xC2) return i;
+    }
+    return len;
+}
+
+#ifdef TEXT_X86
+// === SSE2 ===
+__attribute__((target("sse2")))
+static int bounded_len_sse2(const unsigned char* s, size_t cap)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= cap; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+        if (mask) return (int)(i + (size_t)__builtin_ctz((unsigned)mask));
+    }
+    int tail = bounded_len_scalar(s + i, cap - i);
+    return tail < 0 ? -1 : (int)i + tail;
+}
+
+// Skips whole ASCII blocks; the first block with a high bit starts on a
+// character boundary and is finished by the scalar validator (SSE2 has
+// no byte shuffle for the table lookups the AVX2 tier uses)
+__attribute__((target("sse2")))
+static bool utf8_valid_sse2(const unsigned char* s, size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        if (_mm_movemask_epi8(v)) break;
+    }
+    return utf8_valid_scalar(s + i, len - i);
+}
+
+__attribute__((target("sse2")))
+static size_t find_control_sse2(const unsigned char* s, size_t len)
+{
+    const __m128i c0_max = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i c1_lead = _mm_set1_epi8((char)0xC2);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(v, c0_max), v);      // v <= 0x1F
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, del));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, c1_lead));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+    return i + find_control_scalar(s + i, len - i);
+}
+
+// === AVX2 ===
+__attribute__((target("avx2")))
+static int bounded_len_avx2(const unsigned char* s, size_t cap)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= cap; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+        if (mask) return (int)(i + (size_t)__builtin_ctz(mask));
+    }
+    int tail = bounded_len_scalar(s + i, cap - i);
+    return tail < 0 ? -1 : (int)i + tail;
+}
+
+__attribute__((target("avx2")))
+static size_t find_control_avx2(const unsigned char* s, size_t len)
+{
+    const __m256i c0_max = _mm256_set1_epi8(0x1F);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    const __m256i c1_lead = _mm256_set1_epi8((char)0xC2);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(v, c0_max), v);
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, del));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, c1_lead));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + find_control_scalar(s + i, len - i);
+}
+
+// UTF-8 validation by table lookup (Keiser & Lemire, "Validating UTF-8 in
+// less than one instruction per byte"): three 16-entry tables indexed by
+// the nibbles of each byte and the byte before it flag every invalid
+// two-byte pattern; a saturating subtract finds where a third or fourth
+// byte must be a continuation.
+#define TOO_SHORT       (1 << 0)    // Lead byte not followed by a continuation
+#define TOO_LONG        (1 << 1)    // ASCII followed by a continuation
+#define OVERLONG_3      (1 << 2)
+#define TOO_LARGE       (1 << 3)
+#define SURROGATE       (1 << 4)
+#define OVERLONG_2      (1 << 5)
+#define TOO_LARGE_1000  (1 << 6)
+#define OVERLONG_4      (1 << 6)
+#define TWO_CONTS       (1 << 7)    // Continuation after continuation (checked against must23)
+#define CARRY           (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+#define LANES(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+// The 32 bytes ending `n` bytes before the end of `input`, continued from `prev`
+#define PREV_BYTES(input, prev, n) \
+    _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+__attribute__((target("avx2"), always_inline))
+static inline __m256i utf8_block_errors(__m256i input, __m256i prev_input)
+{
+    const __m256i byte_1_high_table = LANES(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m256i byte_1_low_table = LANES(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m256i byte_2_high_table = LANES(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    __m256i prev1 = PREV_BYTES(input, prev_input, 1);
+    __m256i b1h = _mm256_shuffle_epi8(byte_1_high_table,
+                                      _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i b1l = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble));
+    __m256i b2h = _mm256_shuffle_epi8(byte_2_high_table,
+                                      _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+    // Only 111_____ two bytes back / 1111____ three bytes back reach 0x80
+    __m256i prev2 = PREV_BYTES(input, prev_input, 2);
+    __m256i prev3 = PREV_BYTES(input, prev_input, 3);
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+__attribute__((target("avx2")))
+static bool utf8_valid_avx2(const unsigned char* s, size_t len)
+{
+    __m256i prev = _mm256_setzero_si256();
+    __m256i errors = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        errors = _mm256_or_si256(errors, utf8_block_errors(v, prev));
+        prev = v;
+    }
+    if (i < len) {
+        unsigned char tail[32] = {0};
+        memcpy(tail, s + i, len - i);
+        __m256i v = _mm256_loadu_si256((const __m256i*)tail);
+        errors = _mm256_or_si256(errors, utf8_block_errors(v, prev));
+        prev = v;
+    }
+    // A zero block after the input flags a sequence cut off at the end
+    errors = _mm256_or_si256(errors, utf8_block_errors(_mm256_setzero_si256(), prev));
+    return _mm256_testz_si256(errors, errors);
+}
+#endif
+
+// === DISPATCH ===
+TextImpl text_impl_best(void)
+{
+#ifdef TEXT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TEXT_IMPL_AVX2;
+    if (__builtin_cpu_supports("sse2")) return TEXT_IMPL_SSE2;
+#endif
+    return TEXT_IMPL_SCALAR;
+}
+
+static TextImpl current_impl(void)
+{
+    int impl = atomic_load_explicit(&active_impl, memory_order_relaxed);
+    if (impl < 0) {
+        impl = (int)text_impl_best();
+        atomic_store_explicit(&active_impl, impl, memory_order_relaxed);
+    }
+    return (TextImpl)impl;
+}
+
+bool text_set_impl(TextImpl impl)
+{
+    if (impl > text_impl_best()) return false;
+    atomic_store_explicit(&active_impl, (int)impl, memory_order_relaxed);
+    return true;
+}
+
+const char* text_impl_name(TextImpl impl)
+{
+    switch (impl) {
+        case TEXT_IMPL_AVX2: return "avx2";
+        case TEXT_IMPL_SSE2: return "sse2";
+        default:             return "scalar";
+    }
+}
+
+int text_bounded_len(const char* s, size_t cap)
+{
+    const unsigned char* u = (const unsigned char*)s;
+    switch (current_impl()) {
+#ifdef TEXT_X86
+        case TEXT_IMPL_AVX2: return bounded_len_avx2(u, cap);
+        case TEXT_IMPL_SSE2: return bounded_len_sse2(u, cap);
+#endif
+        default:             return bounded_len_scalar(u, cap);
+    }
+}
+
+bool text_utf8_valid(const char* s, size_t len)
+{
+    const unsigned char* u = (const unsigned char*)s;
+    switch (current_impl()) {
+#ifdef TEXT_X86
+        case TEXT_IMPL_AVX2: return utf8_valid_avx2(u, len);
+        case TEXT_IMPL_SSE2: return utf8_valid_sse2(u, len);
+#endif
+        default:             return utf8_valid_scalar(u, len);
+    }
+}
+
+static size_t find_control(const unsigned char* s, size_t len)
+{
+    switch (current_impl()) {
+#ifdef TEXT_X86
+        case TEXT_IMPL_AVX2: return find_control_avx2(s, len);
+        case TEXT_IMPL_SSE2: return find_control_sse2(s, len);
+#endif
+        default:             return find_control_scalar(s, len);
+    }
+}
+
+// Compact the string from `from` on, dropping control characters. The
+// input is valid UTF-8, so a 0xC2 lead is always followed by a continuation.
+static size_t strip_controls(unsigned char* s, size_t from, size_t len, unsigned flags)
+{
+    size_t out = from;
+    for (size_t i = from; i < len; i++) {
+        unsigned char c = s[i];
+        if (c <= 0x1F || c == 0x7F) {
+            if (c == '\n' && (flags & TEXT_MULTILINE)) s[out++] = c;
+            continue;
+        }
+        if (c == 0xC2 && s[i + 1] <= 0x9F) {
+            i++;                    // C1 control, two bytes
+            continue;
+        }
+        s[out++] = c;
+    }
+    return out;
+}
+
+int text_sanitize(char* field, size_t cap, unsigned flags)
+{
+    int len = text_bounded_len(field, cap);
+    if (len < 0) return -1;
+
+    if (flags & TEXT_UTF8) {
+        unsigned char* u = (unsigned char*)field;
+        if (!text_utf8_valid(field, (size_t)len)) return -1;
+        size_t first = find_control(u, (size_t)len);
+        if (first < (size_t)len) len = (int)strip_controls(u, first, (size_t)len, flags);
+    }
+    // Nothing but zeros after the terminator reaches the DB or a broadcast
+    memset(field + len, 0, cap - (size_t)len);
+    return len;
+}
@@ -0,0 +1,45 @@
+#ifndef TEXT_VALIDATE_H
+#define TEXT_VALIDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// ========== Request Text Validation ==========
+// Checks the fixed-size char fields of inbound payloads (usernames, chat
+// text, descriptions, search queries) before they reach SQL or a room
+// broadcast: the field must be NUL-terminated within its size and be
+// valid UTF-8 (strict: no overlongs, surrogates or code points past
+// U+10FFFF). Control characters (C0, DEL, C1) are stripped and the bytes
+// after the terminator are zeroed.
+//
+// Bounded strlen, UTF-8 validation and the control-character scan run on
+// AVX2 (32 bytes per step) or SSE2 (16), picked at runtime, with a scalar
+// fallback; all tiers give identical results.
+
+// Field kinds (text_sanitize flags)
+#define TEXT_RAW        0x00    // NUL-terminated only (passwords, tokens)
+#define TEXT_UTF8       0x01    // Valid UTF-8, control characters stripped
+#define TEXT_MULTILINE  0x02    // With TEXT_UTF8: keep '\n'
+
+typedef enum {
+    TEXT_IMPL_SCALAR,
+    TEXT_IMPL_SSE2,
+    TEXT_IMPL_AVX2
+} TextImpl;
+
+// Length of the string in s[0..cap), or -1 if there is no NUL
+int text_bounded_len(const char* s, size_t cap);
+bool text_utf8_valid(const char* s, size_t len);
+
+// Validate and normalize a field in place. Returns the new length, or -1
+// if the field is not terminated or (TEXT_UTF8) not valid UTF-8.
+int text_sanitize(char* field, size_t cap, unsigned flags);
+
+// Best implementation this CPU supports (the default), or force one for
+// benchmarks; false if the CPU lacks it
+TextImpl text_impl_best(void);
+bool text_set_impl(TextImpl impl);
+const char* text_impl_name(TextImpl impl);
+
+#endif
@@ -0,0 +1,497 @@
+#include "uring_backend.h"
+#include "network_utils.h"
+#include "mem_pool.h"
+#include "utils.h"
+#include <string.h>
+#include <strings.h>
+
+IoBackendType io_backend_parse(const char* name)
+{
+    if (name && strcasecmp(name, "uring") == 0) return IO_BACKEND_URING;
+    return IO_BACKEND_THREADS;
+}
+
+const char* io_backend_name(IoBackendType type)
+{
+    return type == IO_BACKEND_URING ? "uring" : "threads";
+}
+
+#ifdef HAVE_LIBURING
+
+#include <liburing.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#define URING_ENTRIES    1024
+#define URING_BUF_GROUP  0
+#define URING_BUF_COUNT  512         // Must be a power of two
+#define URING_BUF_SIZE   4096
+#define URING_MAX_FDS    65536
+
+// user_data tags; send requests are pooled buffers (16-byte aligned), so the
+// low four bits are free to carry the op
+enum { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_WAKE = 4 };
+#define OP_MASK 0xFull
+
+// Per-connection reassembly buffer (one partially received frame)
+typedef struct {
+    uint32_t len;
+    char buf[sizeof(Message)];
+} UringConn;
+
+#define SEND_CLOSE 0x1  // SendReq flag: no data, close the socket when it reaches the head
+
+// Outbound frame owned by the reactor until its last byte is sent
+typedef struct SendReq {
+    struct SendReq* next;
+    int sockfd;
+    uint32_t len;
+    uint32_t off;
+    uint32_t flags;
+    char data[];
+} SendReq;
+
+// Frames waiting for one socket. Only the head is on the ring, so a short
+// write is finished before the next frame starts and frames never
+// interleave on the wire.
+typedef struct {
+    SendReq* head;
+    SendReq* tail;
+} SendQueue;
+
+static struct io_uring ring;
+static struct io_uring_buf_ring* buf_ring;
+static char* buf_base;
+static int listen_sock = -1;
+static const UringCallbacks* callbacks;
+static UringConn* conns[URING_MAX_FDS];
+static SendQueue send_queues[URING_MAX_FDS];     // Reactor thread only
+
+// Frames (and closes) from worker threads, moved to the send queues by the
+// reactor. The eventfd is only written when the outbox goes from empty to
+// non-empty, so a burst of responses costs one wakeup and one submit.
+static SendReq* outbox_head;
+static SendReq* outbox_tail;
+static pthread_mutex_t outbox_lock = PTHREAD_MUTEX_INITIALIZER;
+static int wake_fd = -1;
+static uint64_t wake_value;
+static __thread bool on_reactor;
+static Slab conn_slab;
+
+static struct io_uring_sqe* get_sqe(void)
+{
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    if (!sqe) {
+        // SQ full: flush what we have and try again
+        io_uring_submit(&ring);
+        sqe = io_uring_get_sqe(&ring);
+    }
+    return sqe;
+}
+
+static void arm_accept(void)
+{
+    struct io_uring_sqe* sqe = get_sqe();
+    io_uring_prep_multishot_accept(sqe, listen_sock, NULL, NULL, 0);
+    io_uring_sqe_set_data64(sqe, OP_ACCEPT);
+}
+
+static void arm_recv(int sockfd)
+{
+    struct io_uring_sqe* sqe = get_sqe();
+    io_uring_prep_recv_multishot(sqe, sockfd, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    io_uring_sqe_set_data64(sqe, ((uint64_t)sockfd << 4) | OP_RECV);
+}
+
+static void arm_wake(void)
+{
+    struct io_uring_sqe* sqe = get_sqe();
+    io_uring_prep_read(sqe, wake_fd, &wake_value, sizeof(wake_value), 0);
+    io_uring_sqe_set_data64(sqe, OP_WAKE);
+}
+
+static void submit_send(SendReq* req)
+{
+    struct io_uring_sqe* sqe = get_sqe();
+    io_uring_prep_send(sqe, req->sockfd, req->data + req->off, req->len - req->off, MSG_NOSIGNAL);
+    io_uring_sqe_set_data64(sqe, (uint64_t)(uintptr_t)req | OP_SEND);
+}
+
+// Start the head of a socket's queue: submit the frame, or run a queued
+// close now that every frame before it is out
+static void start_head(SendQueue* q)
+{
+    while (q->head && (q->head->flags & SEND_CLOSE)) {
+        SendReq* req = q->head;
+        q->head = req->next;
+        if (!q->head) q->tail = NULL;
+        close(req->sockfd);
+        buf_pool_free(req);
+    }
+    if (q->head) submit_send(q->head);
+}
+
+// Reactor thread: append to the socket's queue
+static void enqueue_send(SendReq* req)
+{
+    SendQueue* q = &send_queues[req->sockfd];
+    req->next = NULL;
+    if (q->tail) {
+        q->tail->next = req;
+        q->tail = req;
+    } else {
+        q->head = q->tail = req;
+        start_head(q);
+    }
+}
+
+// Any thread: enqueue directly on the reactor, through the outbox elsewhere
+static void post_send(SendReq* req)
+{
+    if (on_reactor) {
+        enqueue_send(req);
+        return;
+    }
+    req->next = NULL;
+    pthread_mutex_lock(&outbox_lock);
+    bool was_empty = outbox_head == NULL;
+    if (outbox_tail) outbox_tail->next = req;
+    else outbox_head = req;
+    outbox_tail = req;
+    pthread_mutex_unlock(&outbox_lock);
+    if (was_empty) {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) LOG_WARN("uring: wakeup failed: %s", strerror(errno));
+    }
+}
+
+static void drain_outbox(void)
+{
+    pthread_mutex_lock(&outbox_lock);
+    SendReq* req = outbox_head;
+    outbox_head = outbox_tail = NULL;
+    pthread_mutex_unlock(&outbox_lock);
+    while (req) {
+        SendReq* next = req->next;
+        enqueue_send(req);
+        req = next;
+    }
+}
+
+// SendHook: copy the frame into a pooled buffer and queue it behind the
+// socket's earlier frames. The SQEs go out with the reactor's next submit,
+// so a broadcast to N sockets costs one syscall.
+static int uring_queue_send(int sockfd, const void* buffer, size_t length)
+{
+    if (sockfd < 0 || sockfd >= URING_MAX_FDS) return -1;
+    SendReq* req = buf_pool_alloc(sizeof(SendReq) + length);
+    if (!req) return -1;
+    req->sockfd = sockfd;
+    req->len = (uint32_t)length;
+    req->off = 0;
+    req->flags = 0;
+    memcpy(req->data, buffer, length);
+    post_send(req);
+    return (int)length;
+}
+
+// CloseHook: the socket is closed once the frames queued before it are
+// sent, so the fd number cannot be reused while they are pending
+static void uring_queue_close(int sockfd)
+{
+    SendReq* req = (sockfd >= 0 && sockfd < URING_MAX_FDS) ? buf_pool_alloc(sizeof(SendReq)) : NULL;
+    if (!req) {
+        close(sockfd);
+        return;
+    }
+    req->sockfd = sockfd;
+    req->len = req->off = 0;
+    req->flags = SEND_CLOSE;
+    post_send(req);
+}
+
+// Free the frames queued behind the one on the ring (socket closed or
+// failed); the head is freed by its own completion. Queued closes stay.
+static void drop_queued_sends(int sockfd)
+{
+    SendQueue* q = &send_queues[sockfd];
+    if (!q->head) return;
+    SendReq* keep = q->head;
+    SendReq* req = keep->next;
+    while (req) {
+        SendReq* next = req->next;
+        if (req->flags & SEND_CLOSE) {
+            keep->next = req;
+            keep = req;
+        } else {
+            buf_pool_free(req);
+        }
+        req = next;
+    }
+    keep->next = NULL;
+    q->tail = keep;
+}
+
+static void recycle_buffer(int bid)
+{
+    io_uring_buf_ring_add(buf_ring, buf_base + (size_t)bid * URING_BUF_SIZE, URING_BUF_SIZE,
+                          bid, io_uring_buf_ring_mask(URING_BUF_COUNT), 0);
+    io_uring_buf_ring_advance(buf_ring, 1);
+}
+
+static void close_conn(int sockfd)
+{
+    if (sockfd < 0 || sockfd >= URING_MAX_FDS || !conns[sockfd]) return;
+    slab_free(&conn_slab, conns[sockfd]);
+    conns[sockfd] = NULL;
+    if (callbacks->on_close) {
+        callbacks->on_close(sockfd);
+    } else {
+        // The fd number can be reused by the next accept
+        drop_queued_sends(sockfd);
+        close(sockfd);
+    }
+}
+
+// Append received bytes and hand every complete frame to on_frame
+static int feed_conn(int sockfd, const char* data, size_t n)
+{
+    UringConn* conn = conns[sockfd];
+    while (n > 0) {
+        size_t room = sizeof(conn->buf) - conn->len;
+        size_t take = n < room ? n : room;
+        memcpy(conn->buf + conn->len, data, take);
+        conn->len += take;
+        data += take;
+        n -= take;
+
+        size_t off = 0;
+        while (conn->len - off >= sizeof(MessageHeader)) {
+            MessageHeader header;
+            memcpy(&header, conn->buf + off, sizeof(header));
+            if (header.payload_length > BUFF_SIZE) {
+                LOG_WARN("uring: socket %d sent oversized payload (%u)", sockfd, header.payload_length);
+                return -1;
+            }
+            size_t frame_len = sizeof(MessageHeader) + header.payload_length;
+            if (conn->len - off < frame_len) break;
+            callbacks->on_frame(sockfd, &header, conn->buf + off + sizeof(MessageHeader));
+            off += frame_len;
+        }
+        if (off > 0) {
+            memmove(conn->buf, conn->buf + off, conn->len - off);
+            conn->len -= off;
+        }
+    }
+    return 0;
+}
+
+static void handle_accept(struct io_uring_cqe* cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE)) arm_accept();
+    if (cqe->res < 0) {
+        LOG_WARN("uring: accept failed: %s", strerror(-cqe->res));
+        return;
+    }
+
+    int sockfd = cqe->res;
+    if (sockfd >= URING_MAX_FDS || !(conns[sockfd] = slab_alloc(&conn_slab))) {
+        close(sockfd);
+        return;
+    }
+    if (callbacks->on_open && callbacks->on_open(sockfd) != 0) {
+        slab_free(&conn_slab, conns[sockfd]);
+        conns[sockfd] = NULL;
+        close(sockfd);
+        return;
+    }
+    LOG_INFO("New connection: Socket %d (uring)", sockfd);
+    arm_recv(sockfd);
+}
+
+static void handle_recv(struct io_uring_cqe* cqe, int sockfd)
+{
+    if (cqe->res == -ENOBUFS) {
+        // Provided buffers ran dry; the multishot was cancelled, re-arm it
+        arm_recv(sockfd);
+        return;
+    }
+    if (cqe->res <= 0) {
+        close_conn(sockfd);
+        return;
+    }
+
+    int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    int rc = conns[sockfd] ? feed_conn(sockfd, buf_base + (size_t)bid * URING_BUF_SIZE, cqe->res) : -1;
+    recycle_buffer(bid);
+
+    if (rc != 0) {
+        close_conn(sockfd);
+    } else if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        arm_recv(sockfd);
+    }
+}
+
+static void handle_send(struct io_uring_cqe* cqe, SendReq* req)
+{
+    if (cqe->res > 0 && req->off + (uint32_t)cqe->res < req->len) {
+        // Short write: resubmit the tail from the same buffer; the frames
+        // behind it wait
+        req->off += cqe->res;
+        submit_send(req);
+        return;
+    }
+
+    // A failed send leaves the stream mid-frame: nothing after it can be
+    // delivered either
+    if (cqe->res < 0) drop_queued_sends(req->sockfd);
+
+    SendQueue* q = &send_queues[req->sockfd];
+    q->head = req->next;
+    if (!q->head) q->tail = NULL;
+    buf_pool_free(req);
+    start_head(q);
+}
+
+static void handle_wake(struct io_uring_cqe* cqe)
+{
+    if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+        LOG_ERROR("uring: wakeup read failed: %s", strerror(-cqe->res));
+    }
+    arm_wake();
+    drain_outbox();
+}
+
+static int setup_ring(void)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SUBMIT_ALL;
+    int ret = io_uring_queue_init_params(URING_ENTRIES, &ring, &params);
+    if (ret < 0) {
+        LOG_WARN("uring: io_uring_queue_init failed: %s", strerror(-ret));
+        return -1;
+    }
+
+    buf_ring = io_uring_setup_buf_ring(&ring, URING_BUF_COUNT, URING_BUF_GROUP, 0, &ret);
+    if (!buf_ring) {
+        LOG_WARN("uring: provided buffer ring unsupported: %s", strerror(-ret));
+        io_uring_queue_exit(&ring);
+        return -1;
+    }
+    return 0;
+}
+
+static void teardown_ring(void)
+{
+    io_uring_free_buf_ring(&ring, buf_ring, URING_BUF_COUNT, URING_BUF_GROUP);
+    io_uring_queue_exit(&ring);
+    buf_ring = NULL;
+}
+
+bool uring_backend_available(void)
+{
+    if (setup_ring() != 0) return false;
+    teardown_ring();
+    return true;
+}
+
+int uring_server_run(int listen_fd, const UringCallbacks* cb)
+{
+    if (setup_ring() != 0) return -1;
+
+    buf_base = malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (!buf_base || slab_init(&conn_slab, sizeof(UringConn), 128) != 0) {
+        free(buf_base);
+        teardown_ring();
+        return -1;
+    }
+    for (int bid = 0; bid < URING_BUF_COUNT; bid++) {
+        io_uring_buf_ring_add(buf_ring, buf_base + (size_t)bid * URING_BUF_SIZE, URING_BUF_SIZE,
+                              bid, io_uring_buf_ring_mask(URING_BUF_COUNT), bid);
+    }
+    io_uring_buf_ring_advance(buf_ring, URING_BUF_COUNT);
+
+    wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        LOG_WARN("uring: eventfd failed: %s", strerror(errno));
+        free(buf_base);
+        slab_destroy(&conn_slab);
+        teardown_ring();
+        return -1;
+    }
+
+    listen_sock = listen_fd;
+    callbacks = cb;
+    on_reactor = true;
+    // Workers send too: every frame goes through the reactor's queues
+    net_set_send_hook(uring_queue_send);
+    net_set_close_hook(uring_queue_close);
+    arm_wake();
+    arm_accept();
+    LOG_INFO("uring: reactor started (%d entries, %d x %d B provided buffers)",
+             URING_ENTRIES, URING_BUF_COUNT, URING_BUF_SIZE);
+
+    for (;;) {
+        int ret = io_uring_submit_and_wait(&ring, 1);
+        if (ret < 0 && ret != -EINTR) {
+            LOG_ERROR("uring: submit_and_wait failed: %s", strerror(-ret));
+            break;
+        }
+
+        struct io_uring_cqe* cqe;
+        unsigned head, count = 0;
+        io_uring_for_each_cqe(&ring, head, cqe) {
+            uint64_t data = io_uring_cqe_get_data64(cqe);
+            switch (data & OP_MASK) {
+                case OP_ACCEPT:
+                    handle_accept(cqe);
+                    break;
+                case OP_RECV:
+                    handle_recv(cqe, (int)(data >> 4));
+                    break;
+                case OP_SEND:
+                    handle_send(cqe, (SendReq*)(uintptr_t)(data & ~OP_MASK));
+                    break;
+                case OP_WAKE:
+                    handle_wake(cqe);
+                    break;
+            }
+            count++;
+        }
+        io_uring_cq_advance(&ring, count);
+    }
+
+    net_set_send_hook(NULL);
+    net_set_close_hook(NULL);
+    close(wake_fd);
+    wake_fd = -1;
+    teardown_ring();
+    free(buf_base);
+    slab_destroy(&conn_slab);
+    return -1;
+}
+
+#else  // !HAVE_LIBURING
+
+bool uring_backend_available(void)
+{
+    return false;
+}
+
+int uring_server_run(int listen_fd, const UringCallbacks* cb)
+{
+    (void)listen_fd;
+    (void)cb;
+    LOG_WARN("uring: server built without liburing");
+    return -1;
+}
+
+#endif
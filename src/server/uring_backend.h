@@ -0,0 +1,35 @@
+#ifndef URING_BACKEND_H
+#define URING_BACKEND_H
+
+#include <stdbool.h>
+#include "protocol_header.h"
+
+// Socket I/O backend selection (chosen at startup with --io=threads|uring)
+typedef enum {
+    IO_BACKEND_THREADS = 0,   // Blocking recv_all/send_all, one thread per client
+    IO_BACKEND_URING          // Single reactor on io_uring (needs liburing)
+} IoBackendType;
+
+IoBackendType io_backend_parse(const char* name);
+const char* io_backend_name(IoBackendType type);
+
+// Called on the reactor thread. `payload` is only valid during on_frame.
+// on_open returns 0 to accept the connection; on failure the reactor closes
+// the socket without arming a recv on it.
+// When on_close is set it takes ownership of the socket and closes it
+// (requests may still be in flight on it); otherwise the reactor closes it.
+typedef struct {
+    int (*on_open)(int sockfd);
+    void (*on_frame)(int sockfd, const MessageHeader* header, char* payload);
+    void (*on_close)(int sockfd);
+} UringCallbacks;
+
+// True when the binary was built with liburing and the kernel accepts
+// a ring with multishot accept/recv and provided buffer rings
+bool uring_backend_available(void);
+
+// Run the accept/recv loop on `listen_fd`. Only returns on fatal error
+// (-1); callers fall back to the threaded loop when it fails at startup.
+int uring_server_run(int listen_fd, const UringCallbacks* cb);
+
+#endif
@@ -0,0 +1,297 @@
+#include "user_stats.h"
+#include "auction_events.h"
+#include "db_adapter.h"
+#include "protocol_payloads.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct UserRecord {
+    struct UserRecord* next;
+    int32_t user_id;
+    uint32_t auctions_joined;
+    uint32_t bids_placed;
+    uint32_t items_won;
+    int64_t total_spent;
+    HistoryEntry ring[USER_HISTORY_CAP];    // Oldest at ring_head
+    uint32_t ring_head;
+    uint32_t ring_count;
+    // Every item the user took part in (the ring only keeps the recent
+    // ones): open addressing on item_id, 0 = free slot
+    int32_t* joined;
+    uint32_t joined_cap;                    // Power of two
+    uint32_t joined_len;
+} UserRecord;
+
+typedef struct {
+    pthread_mutex_t lock;
+    UserRecord* buckets[USER_STATS_BUCKETS];
+} UserShard;
+
+typedef struct ItemName {
+    struct ItemName* next;
+    int32_t item_id;
+    char name[100];
+} ItemName;
+
+static UserShard shards[USER_STATS_SHARDS];
+static ItemName* item_names[ITEM_NAME_BUCKETS];
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define SHARD_OF(id)  (&shards[(uint32_t)(id) % USER_STATS_SHARDS])
+#define BUCKET_OF(id) (((uint32_t)(id) / USER_STATS_SHARDS) % USER_STATS_BUCKETS)
+
+// === ITEM NAMES ===
+void user_stats_note_item(int32_t item_id, const char* name)
+{
+    if (item_id <= 0 || !name) return;
+    uint32_t b = (uint32_t)item_id % ITEM_NAME_BUCKETS;
+
+    pthread_mutex_lock(&names_lock);
+    ItemName* n = item_names[b];
+    while (n && n->item_id != item_id) n = n->next;
+    if (!n && (n = calloc(1, sizeof(*n)))) {
+        n->item_id = item_id;
+        n->next = item_names[b];
+        item_names[b] = n;
+    }
+    if (n) snprintf(n->name, sizeof(n->name), "%s", name);
+    pthread_mutex_unlock(&names_lock);
+}
+
+static void lookup_item_name(int32_t item_id, char* out, size_t cap)
+{
+    pthread_mutex_lock(&names_lock);
+    ItemName* n = item_names[(uint32_t)item_id % ITEM_NAME_BUCKETS];
+    while (n && n->item_id != item_id) n = n->next;
+    if (n) snprintf(out, cap, "%s", n->name);
+    else snprintf(out, cap, "Item #%d", item_id);
+    pthread_mutex_unlock(&names_lock);
+}
+
+// === RECORDS (caller holds the shard lock) ===
+static UserRecord* find_user(UserShard* shard, int32_t user_id)
+{
+    for (UserRecord* u = shard->buckets[BUCKET_OF(user_id)]; u; u = u->next) {
+        if (u->user_id == user_id) return u;
+    }
+    return NULL;
+}
+
+// Bounded scan: the ring holds at most USER_HISTORY_CAP entries
+static HistoryEntry* find_entry(UserRecord* u, int32_t item_id)
+{
+    for (uint32_t i = 0; i < u->ring_count; i++) {
+        HistoryEntry* e = &u->ring[(u->ring_head + i) % USER_HISTORY_CAP];
+        if (e->item_id == (uint32_t)item_id) return e;
+    }
+    return NULL;
+}
+
+static bool joined_add_slot(int32_t* set, uint32_t cap, int32_t item_id)
+{
+    uint32_t i = ((uint32_t)item_id * 2654435761u) & (cap - 1);
+    while (set[i] && set[i] != item_id) i = (i + 1) & (cap - 1);
+    if (set[i]) return false;
+    set[i] = item_id;
+    return true;
+}
+
+// Record that the user joined the item's auction. Returns true the first
+// time; false if already recorded (or out of memory: better to undercount
+// than to count an auction twice).
+static bool joined_add(UserRecord* u, int32_t item_id)
+{
+    if ((u->joined_len + 1) * 4 > u->joined_cap * 3) {
+        uint32_t cap = u->joined_cap ? u->joined_cap * 2 : 16;
+        int32_t* grown = calloc(cap, sizeof(*grown));
+        if (!grown) return false;
+        for (uint32_t i = 0; i < u->joined_cap; i++) {
+            if (u->joined[i]) joined_add_slot(grown, cap, u->joined[i]);
+        }
+        free(u->joined);
+        u->joined = grown;
+        u->joined_cap = cap;
+    }
+    if (!joined_add_slot(u->joined, u->joined_cap, item_id)) return false;
+    u->joined_len++;
+    return true;
+}
+
+static HistoryEntry* push_entry(UserRecord* u, int32_t item_id)
+{
+    HistoryEntry* e;
+    if (u->ring_count == USER_HISTORY_CAP) {
+        e = &u->ring[u->ring_head];
+        u->ring_head = (u->ring_head + 1) % USER_HISTORY_CAP;
+    } else {
+        e = &u->ring[(u->ring_head + u->ring_count) % USER_HISTORY_CAP];
+        u->ring_count++;
+    }
+    memset(e, 0, sizeof(*e));
+    e->auction_id = (uint32_t)item_id;
+    e->item_id = (uint32_t)item_id;
+    return e;
+}
+
+bool user_stats_load(int32_t user_id)
+{
+    if (user_id <= 0) return false;
+    UserShard* shard = SHARD_OF(user_id);
+
+    pthread_mutex_lock(&shard->lock);
+    bool loaded = find_user(shard, user_id) != NULL;
+    pthread_mutex_unlock(&shard->lock);
+    if (loaded) return true;
+
+    PGresult* res = NULL;
+    if (!db_get_user_participation(user_id, &res)) {
+        if (res) PQclear(res);
+        return false;
+    }
+    UserRecord* u = calloc(1, sizeof(*u));
+    if (!u) {
+        PQclear(res);
+        return false;
+    }
+    u->user_id = user_id;
+
+    // Rows are newest first; the ring wants oldest first
+    int rows = PQntuples(res);
+    for (int r = rows - 1; r >= 0; r--) {
+        int32_t item_id = atoi(PQgetvalue(res, r, 0));
+        int64_t amount = atoll(PQgetvalue(res, r, 2));
+        bool won = PQgetvalue(res, r, 4)[0] == 't';
+
+        if (joined_add(u, item_id)) u->auctions_joined++;
+        u->bids_placed += (uint32_t)atoi(PQgetvalue(res, r, 3));
+        if (won) {
+            u->items_won++;
+            u->total_spent += amount;
+        }
+        user_stats_note_item(item_id, PQgetvalue(res, r, 1));
+        if (r >= USER_HISTORY_CAP) continue;
+
+        HistoryEntry* e = push_entry(u, item_id);
+        snprintf(e->item_name, sizeof(e->item_name), "%s", PQgetvalue(res, r, 1));
+        e->bid_amount = amount;
+        e->won = won;
+        e->timestamp = (uint64_t)atoll(PQgetvalue(res, r, 5));
+    }
+    PQclear(res);
+
+    pthread_mutex_lock(&shard->lock);
+    if (find_user(shard, user_id)) {
+        // Another login of the same user got there first
+        pthread_mutex_unlock(&shard->lock);
+        free(u->joined);
+        free(u);
+        return true;
+    }
+    u->next = shard->buckets[BUCKET_OF(user_id)];
+    shard->buckets[BUCKET_OF(user_id)] = u;
+    pthread_mutex_unlock(&shard->lock);
+    return true;
+}
+
+// === EVENTS ===
+static void on_auction_event(const AuctionEvent* ev, void* ctx)
+{
+    (void)ctx;
+    if (ev->type != EVENT_ITEM_BID && ev->type != EVENT_ITEM_SOLD) return;
+    if (ev->user_id <= 0) return;
+
+    UserShard* shard = SHARD_OF(ev->user_id);
+    pthread_mutex_lock(&shard->lock);
+    UserRecord* u = find_user(shard, ev->user_id);
+    if (!u) {
+        pthread_mutex_unlock(&shard->lock);
+        return;
+    }
+
+    // First bid on this item, or a buy-now without a prior bid. Not the
+    // same as a missing ring entry: older auctions drop out of the ring.
+    if (joined_add(u, ev->item_id)) u->auctions_joined++;
+    HistoryEntry* e = find_entry(u, ev->item_id);
+    if (!e) {
+        e = push_entry(u, ev->item_id);
+        lookup_item_name(ev->item_id, e->item_name, sizeof(e->item_name));
+    }
+    e->bid_amount = ev->amount;
+    e->timestamp = ev->timestamp_ms / 1000;
+    if (ev->type == EVENT_ITEM_BID) {
+        u->bids_placed++;
+    } else {
+        e->won = 1;
+        u->items_won++;
+        u->total_spent += ev->amount;
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+bool user_stats_init(void)
+{
+    for (int i = 0; i < USER_STATS_SHARDS; i++) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+    return auction_events_subscribe(on_auction_event, NULL);
+}
+
+// === QUERIES ===
+static void fill_summary(const UserRecord* u, AuctionStatsSummary* out)
+{
+    out->auctions_joined = u->auctions_joined;
+    out->bids_placed = u->bids_placed;
+    out->items_won = u->items_won;
+    out->total_spent = u->total_spent;
+    out->win_rate_bp = u->auctions_joined
+        ? (uint16_t)((uint64_t)u->items_won * 10000 / u->auctions_joined) : 0;
+}
+
+bool user_stats_get(int32_t user_id, AuctionStatsSummary* out)
+{
+    UserShard* shard = SHARD_OF(user_id);
+    pthread_mutex_lock(&shard->lock);
+    UserRecord* u = find_user(shard, user_id);
+    if (u) fill_summary(u, out);
+    pthread_mutex_unlock(&shard->lock);
+    return u != NULL;
+}
+
+int user_stats_build_history(int32_t user_id, uint16_t offset, uint16_t limit,
+                             char* out, size_t cap)
+{
+    if (cap < sizeof(ViewHistoryRes)) return -1;
+    size_t fit = (cap - sizeof(ViewHistoryRes)) / sizeof(HistoryEntry);
+    if (limit == 0 || limit > fit) limit = (uint16_t)fit;
+
+    ViewHistoryRes head;
+    memset(&head, 0, sizeof(head));
+
+    UserShard* shard = SHARD_OF(user_id);
+    pthread_mutex_lock(&shard->lock);
+    UserRecord* u = find_user(shard, user_id);
+    if (!u) {
+        pthread_mutex_unlock(&shard->lock);
+        return -1;
+    }
+    fill_summary(u, &head.summary);
+    head.total = (uint16_t)u->ring_count;
+
+    size_t len = sizeof(head);
+    for (uint32_t i = offset; i < u->ring_count && head.count < limit; i++) {
+        // Newest is the last slot of the ring
+        uint32_t slot = (u->ring_head + u->ring_count - 1 - i) % USER_HISTORY_CAP;
+        memcpy(out + len, &u->ring[slot], sizeof(HistoryEntry));
+        len += sizeof(HistoryEntry);
+        head.count++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    head.status = STATUS_SUCCESS;
+    snprintf(head.message, sizeof(head.message), "OK");
+    memcpy(out, &head, sizeof(head));
+    return (int)len;
+}
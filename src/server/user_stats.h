@@ -0,0 +1,42 @@
+#ifndef USER_STATS_H
+#define USER_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "protocol_helpers.h"
+
+// ========== Per-User Auction Statistics ==========
+// Aggregates (auctions joined, bids, wins, total spent) and a ring of the
+// user's USER_HISTORY_CAP most recent auctions, kept in memory from the
+// moment the user logs in and updated from bid / sold events. VIEW_HISTORY
+// is answered from here without touching the database.
+//
+// A user's record is loaded once, at login, from bids and won items. Events
+// for users that are not loaded are skipped: the DB has them and the next
+// load picks them up.
+
+#define USER_STATS_SHARDS    32
+#define USER_STATS_BUCKETS   128    // Hash buckets per shard
+#define USER_HISTORY_CAP     64     // Auctions kept per user
+#define ITEM_NAME_BUCKETS    4096
+
+// Subscribes to auction events; call once at startup
+bool user_stats_init(void);
+
+// Load a user's history from the DB (no-op if already loaded). Slow: call
+// from the login path, not a request worker.
+bool user_stats_load(int32_t user_id);
+
+// Remember an item's name for history entries created by later events
+void user_stats_note_item(int32_t item_id, const char* name);
+
+bool user_stats_get(int32_t user_id, AuctionStatsSummary* out);
+
+// Build a VIEW_HISTORY_RES payload (summary + one page, newest first) into
+// `out`. Returns the payload length, or -1 if the user is not loaded or
+// `cap` cannot hold the header.
+int user_stats_build_history(int32_t user_id, uint16_t offset, uint16_t limit,
+                             char* out, size_t cap);
+
+#endif
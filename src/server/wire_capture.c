@@ -0,0 +1,228 @@
+#include "wire_capture.h"
+#include "capture_format.h"
+#include "protocol.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+static atomic_bool enabled;
+static FILE* out;
+static uint64_t start_us;
+
+// Records go into `fill`; the writer swaps it with `drain` and writes that
+static char* fill;
+static char* drain;
+static size_t fill_len;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;
+static pthread_t writer_thread;
+static bool running;
+
+// Capture connection number of each open fd (0 = not open)
+static uint32_t conn_of_fd[WIRE_CAPTURE_MAX_FDS];
+static uint32_t next_conn_id = 1;
+
+static uint64_t records, bytes, dropped;
+static uint32_t connections;
+
+static uint64_t mono_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Blank the password of a recorded LOGIN / REGISTER frame in place
+static void scrub_password(uint8_t type, char* payload, uint32_t len)
+{
+    size_t offset, size;
+    if (type == LOGIN_REQ) {
+        offset = offsetof(LoginReq, password);
+        size = sizeof(((LoginReq*)0)->password);
+    } else if (type == REGISTER_REQ) {
+        offset = offsetof(RegisterReq, password);
+        size = sizeof(((RegisterReq*)0)->password);
+    } else {
+        return;
+    }
+    if (len <= offset) return;
+    memset(payload + offset, 0, len - offset < size ? len - offset : size);
+}
+
+// Caller holds the lock
+static void append(uint32_t conn_id, CaptureRecordKind kind,
+                   const MessageHeader* header, const char* payload)
+{
+    if (!fill) return;      // Closed while the caller waited for the lock
+    uint32_t payload_len = header ? header->payload_length : 0;
+    size_t len = sizeof(CaptureRecord) + (header ? sizeof(MessageHeader) + payload_len : 0);
+    if (fill_len + len > WIRE_CAPTURE_BUFFER) {
+        dropped++;
+        return;
+    }
+    CaptureRecord rec = {
+        .offset_us = mono_us() - start_us, .conn_id = conn_id, .kind = (uint8_t)kind,
+    };
+    memcpy(fill + fill_len, &rec, sizeof(rec));
+    fill_len += sizeof(rec);
+    if (header) {
+        memcpy(fill + fill_len, header, sizeof(*header));
+        fill_len += sizeof(*header);
+        if (payload_len) {
+            memcpy(fill + fill_len, payload, payload_len);
+            scrub_password(header->type, fill + fill_len, payload_len);
+        }
+        fill_len += payload_len;
+    }
+    records++;
+    bytes += len;
+    if (fill_len > WIRE_CAPTURE_BUFFER / 2) pthread_cond_signal(&wake);
+}
+
+static void* writer_main(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        if (fill_len == 0 && running) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)WIRE_CAPTURE_FLUSH_MS * 1000000;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000;
+            deadline.tv_nsec %= 1000000000;
+            pthread_cond_timedwait(&wake, &lock, &deadline);
+        }
+        if (fill_len == 0) {
+            if (!running) break;
+            continue;
+        }
+        char* buf = fill;
+        size_t len = fill_len;
+        fill = drain;
+        fill_len = 0;
+        drain = buf;
+        pthread_mutex_unlock(&lock);
+
+        bool ok = fwrite(buf, 1, len, out) == len && fflush(out) == 0;
+
+        pthread_mutex_lock(&lock);
+        if (!ok) {
+            LOG_ERROR("capture: write failed: %s", strerror(errno));
+            dropped++;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+bool wire_capture_open(const char* path)
+{
+    if (atomic_load(&enabled)) return false;
+    fill = malloc(WIRE_CAPTURE_BUFFER);
+    drain = malloc(WIRE_CAPTURE_BUFFER);
+    // Owner-only, and never over an existing file: the capture holds
+    // everything clients send
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    out = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    if (!fill || !drain || !out) {
+        LOG_ERROR("capture: cannot create %s: %s", path, strerror(errno));
+        free(fill); free(drain);
+        if (out) fclose(out);
+        else if (fd >= 0) close(fd);
+        fill = drain = NULL;
+        out = NULL;
+        return false;
+    }
+
+    CaptureFileHeader fh = { .version = CAPTURE_VERSION };
+    memcpy(fh.magic, CAPTURE_MAGIC, sizeof(fh.magic));
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    fh.start_unix_us = (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+    start_us = mono_us();
+    running = true;
+    if (fwrite(&fh, sizeof(fh), 1, out) != 1 ||
+        pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+        LOG_ERROR("capture: cannot write %s", path);
+        running = false;
+        fclose(out);
+        free(fill); free(drain);
+        fill = drain = NULL;
+        out = NULL;
+        return false;
+    }
+    atomic_store(&enabled, true);
+    LOG_INFO("capture: recording inbound traffic to %s", path);
+    return true;
+}
+
+void wire_capture_close(void)
+{
+    if (!atomic_exchange(&enabled, false)) return;
+    pthread_mutex_lock(&lock);
+    running = false;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&lock);
+    pthread_join(writer_thread, NULL);
+
+    pthread_mutex_lock(&lock);
+    fclose(out);
+    free(fill); free(drain);
+    out = NULL;
+    fill = drain = NULL;
+    fill_len = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+bool wire_capture_enabled(void)
+{
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+void wire_capture_conn_open(int sockfd)
+{
+    if (!wire_capture_enabled() || sockfd < 0 || sockfd >= WIRE_CAPTURE_MAX_FDS) return;
+    pthread_mutex_lock(&lock);
+    conn_of_fd[sockfd] = next_conn_id++;
+    connections++;
+    append(conn_of_fd[sockfd], CAPTURE_OPEN, NULL, NULL);
+    pthread_mutex_unlock(&lock);
+}
+
+void wire_capture_conn_close(int sockfd)
+{
+    if (!wire_capture_enabled() || sockfd < 0 || sockfd >= WIRE_CAPTURE_MAX_FDS) return;
+    pthread_mutex_lock(&lock);
+    if (conn_of_fd[sockfd]) {
+        append(conn_of_fd[sockfd], CAPTURE_CLOSE, NULL, NULL);
+        conn_of_fd[sockfd] = 0;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void wire_capture_frame(int sockfd, const MessageHeader* header, const char* payload)
+{
+    if (!wire_capture_enabled() || sockfd < 0 || sockfd >= WIRE_CAPTURE_MAX_FDS) return;
+    pthread_mutex_lock(&lock);
+    // Connections accepted before the capture started are not recorded
+    if (conn_of_fd[sockfd]) append(conn_of_fd[sockfd], CAPTURE_REQUEST, header, payload);
+    pthread_mutex_unlock(&lock);
+}
+
+void wire_capture_get_stats(WireCaptureStats* out_stats)
+{
+    pthread_mutex_lock(&lock);
+    out_stats->records = records;
+    out_stats->bytes = bytes;
+    out_stats->dropped = dropped;
+    out_stats->connections = connections;
+    pthread_mutex_unlock(&lock);
+}
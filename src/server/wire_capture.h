@@ -0,0 +1,47 @@
+#ifndef WIRE_CAPTURE_H
+#define WIRE_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol_header.h"
+
+// ========== Inbound Traffic Recorder ==========
+// With --capture=<file> the server records every connection open / close
+// and every inbound frame (header, payload, arrival time) into a binary
+// capture (capture_format.h). tools/wire_replay.c plays a capture back
+// against a server and diffs the responses, so a busy auction can be
+// re-run as a regression test.
+//
+// Frames are recorded as read, before message_accept, so rejected frames
+// are replayed too. The password of LOGIN_REQ / REGISTER_REQ is blanked
+// in the record (a replay brings its own logins), and the file is created
+// owner-only (0600). Records are appended to an in-memory buffer under a
+// lock and written out by a background thread; when the writer falls
+// WIRE_CAPTURE_BUFFER bytes behind, records are dropped (and counted), the
+// request path never waits on the disk.
+
+#define WIRE_CAPTURE_BUFFER     (1 << 20)   // Bytes per buffer (two are used)
+#define WIRE_CAPTURE_FLUSH_MS   200
+#define WIRE_CAPTURE_MAX_FDS    65536
+
+// Create the capture file (it must not exist yet) and start the writer thread
+bool wire_capture_open(const char* path);
+// Write what is buffered and close the file
+void wire_capture_close(void);
+bool wire_capture_enabled(void);
+
+// No-ops unless a capture is open
+void wire_capture_conn_open(int sockfd);
+void wire_capture_conn_close(int sockfd);
+void wire_capture_frame(int sockfd, const MessageHeader* header, const char* payload);
+
+typedef struct {
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t dropped;           // Buffer full or write error
+    uint32_t connections;
+} WireCaptureStats;
+
+void wire_capture_get_stats(WireCaptureStats* out);
+
+#endif
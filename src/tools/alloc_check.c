@@ -0,0 +1,260 @@
+// ========== Steady-State Allocation Check ==========
+// Drives BID_REQ and CHAT_REQ frames through the server's request path and
+// fails if the steady state calls malloc(). The path is the real one: the
+// reader reads each frame into a buf_pool buffer and submits it to the
+// request pipeline, a worker runs the handler, the handler answers with
+// send_response() and fans a BID_NOTIFY / CHAT_NOTIFY out to the room with
+// send_broadcast(). Only the service layer (ledger, DB) is left out.
+//
+// Sockets are socketpairs; every malloc/calloc/realloc in the process is
+// counted by wrapping the glibc allocator.
+//
+//   alloc_check [--conns=32] [--room=16] [--rounds=10]
+//
+// The first round warms the thread caches and is not counted. Exit status
+// is 0 when the measured rounds made no heap allocation, 1 otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "protocol.h"
+#include "mem_pool.h"
+#include "network_utils.h"
+#include "request_pipeline.h"
+#include "text_validate.h"
+
+#define MAX_CONNS       256
+#define MAX_ROOM        64
+#define BIDS_PER_ROUND  4       // Per connection; stays under the per-connection rate
+#define ROUND_MS        250
+
+// === ALLOCATION COUNTER ===
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static atomic_bool counting;
+static atomic_uint_fast64_t heap_calls;
+
+void* malloc(size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed)) atomic_fetch_add(&heap_calls, 1);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed)) atomic_fetch_add(&heap_calls, 1);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed)) atomic_fetch_add(&heap_calls, 1);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+// === SERVER SIDE ===
+static int client_fds[MAX_CONNS];   // Test end of each connection
+static int server_fds[MAX_CONNS];
+static int room_fds[MAX_ROOM];      // Server end of each room member
+static int room_peer_fds[MAX_ROOM];
+static int conn_count = 32, room_size = 16;
+static atomic_uint_fast64_t handled;
+
+static void handler(int sockfd, const MessageHeader* header, const char* payload)
+{
+    if (header->type == BID_REQ) {
+        const BidReq* req = (const BidReq*)payload;
+        BidRes res = { .status = STATUS_SUCCESS };
+        snprintf(res.message, sizeof(res.message), "Bid accepted");
+        send_response(sockfd, BID_RES, header->request_id, &res, sizeof(res));
+
+        BidNotify notify = { .item_id = req->item_id, .new_price = req->bid_amount,
+                             .winner_id = (uint32_t)sockfd };
+        send_broadcast(room_fds, room_size, BID_NOTIFY, &notify, sizeof(notify));
+    } else if (header->type == CHAT_REQ) {
+        ChatReq req;
+        memcpy(&req, payload, sizeof(req));
+        if (text_sanitize(req.text, sizeof(req.text), TEXT_UTF8) >= 0) {
+            ChatNotify notify = { .sender_id = req.user_id };
+            memcpy(notify.text, req.text, sizeof(notify.text));
+            send_broadcast(room_fds, room_size, CHAT_NOTIFY, &notify, sizeof(notify));
+        }
+    }
+    atomic_fetch_add(&handled, 1);
+}
+
+// Same loop as server.c client_handler
+static void* reader_main(void* arg)
+{
+    int sockfd = (int)(intptr_t)arg;
+    Connection* conn = pipeline_conn_lookup(sockfd);
+    MessageHeader header;
+    while (recv_all(sockfd, &header, sizeof(header)) > 0) {
+        char* payload = buf_pool_alloc(header.payload_length);
+        if (!payload) break;
+        if (header.payload_length > 0 &&
+            recv_all(sockfd, payload, header.payload_length) <= 0) {
+            buf_pool_free(payload);
+            break;
+        }
+        pipeline_submit(conn, &header, payload, true);
+    }
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+// Discards everything the server writes to the test ends
+static atomic_bool draining = true;
+
+static void* drain_main(void* arg)
+{
+    (void)arg;
+    static char sink[65536];
+    struct pollfd pfds[MAX_CONNS + MAX_ROOM];
+    int n = 0;
+    for (int i = 0; i < conn_count; i++) pfds[n++] = (struct pollfd){ .fd = client_fds[i], .events = POLLIN };
+    for (int i = 0; i < room_size; i++) pfds[n++] = (struct pollfd){ .fd = room_peer_fds[i], .events = POLLIN };
+    while (atomic_load(&draining)) {
+        if (poll(pfds, n, 50) <= 0) continue;
+        for (int i = 0; i < n; i++) {
+            if (pfds[i].revents & POLLIN) (void)recv(pfds[i].fd, sink, sizeof(sink), MSG_DONTWAIT);
+        }
+    }
+    return NULL;
+}
+
+// === CLIENT SIDE ===
+static bool send_frame(int fd, uint8_t type, uint32_t request_id, const void* payload, uint32_t len)
+{
+    char frame[sizeof(MessageHeader) + BUFF_SIZE];
+    MessageHeader header = { .type = type, .request_id = request_id, .payload_length = len };
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), payload, len);
+    return send_all(fd, frame, sizeof(header) + len) >= 0;
+}
+
+static uint64_t run_round(int round)
+{
+    static uint32_t request_id = 1;
+    uint64_t sent = 0;
+    for (int c = 0; c < conn_count; c++) {
+        for (int b = 0; b < BIDS_PER_ROUND; b++) {
+            BidReq bid = { .item_id = 1 + c % 8, .bid_amount = 100000 + round * 1000 + b };
+            sent += send_frame(client_fds[c], BID_REQ, request_id++, &bid, sizeof(bid));
+        }
+        ChatReq chat = { .user_id = (uint32_t)c, .room_id = 1 };
+        snprintf(chat.text, sizeof(chat.text), "round %d: gi\xc3\xa1 bao nhi\xc3\xaau?", round);
+        sent += send_frame(client_fds[c], CHAT_REQ, request_id++, &chat, sizeof(chat));
+    }
+    return sent;
+}
+
+static void wait_handled(uint64_t target)
+{
+    for (int i = 0; i < 5000 && atomic_load(&handled) < target; i++) usleep(1000);
+    pipeline_wait_idle(5000);
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = 10;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--conns=", 8) == 0) conn_count = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "--room=", 7) == 0) room_size = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--rounds=", 9) == 0) rounds = atoi(argv[i] + 9);
+        else {
+            fprintf(stderr, "usage: alloc_check [--conns=32] [--room=16] [--rounds=10]\n");
+            return 2;
+        }
+    }
+    if (conn_count < 1 || conn_count > MAX_CONNS || room_size < 1 || room_size > MAX_ROOM || rounds < 2) {
+        fprintf(stderr, "alloc_check: conns 1..%d, room 1..%d, rounds >= 2\n", MAX_CONNS, MAX_ROOM);
+        return 2;
+    }
+
+    // Same setup and pool sizing as server.c, for conn_count clients
+    size_t prewarm = (size_t)conn_count * (BUF_POOL_REFILL + 1) + PIPELINE_WORKERS * BUF_POOL_TLS_MAX;
+    if (buf_pool_prewarm(prewarm) != 0 || !pipeline_init(handler)) {
+        fprintf(stderr, "alloc_check: init failed\n");
+        return 1;
+    }
+
+    pthread_t readers[MAX_CONNS], drainer;
+    for (int i = 0; i < room_size; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return 1;
+        room_fds[i] = sv[0];
+        room_peer_fds[i] = sv[1];
+    }
+    for (int i = 0; i < conn_count; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return 1;
+        client_fds[i] = sv[0];
+        server_fds[i] = sv[1];
+        if (!pipeline_conn_open(server_fds[i])) return 1;
+        pthread_create(&readers[i], NULL, reader_main, (void*)(intptr_t)server_fds[i]);
+    }
+    pthread_create(&drainer, NULL, drain_main, NULL);
+
+    // Warm-up round: fills the per-thread caches of readers and workers
+    uint64_t expected = run_round(0);
+    wait_handled(expected);
+    uint64_t pool_heap_before = buf_pool_heap_allocs();
+
+    atomic_store(&counting, true);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t t0 = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    for (int r = 1; r < rounds; r++) {
+        usleep(ROUND_MS * 1000);    // Refill the per-connection token buckets
+        expected += run_round(r);
+    }
+    wait_handled(expected);
+    atomic_store(&counting, false);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t elapsed_ms = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000 - t0;
+
+    uint64_t heap = atomic_load(&heap_calls);
+    uint64_t pool_heap = buf_pool_heap_allocs() - pool_heap_before;
+    PipelineStats ps;
+    pipeline_get_stats(&ps);
+    printf("frames sent     %" PRIu64 " (%d rounds, %d conns, room of %d)\n",
+           expected, rounds, conn_count, room_size);
+    printf("handled         %" PRIu64 " (rejected busy %" PRIu64 ")\n",
+           (uint64_t)atomic_load(&handled), ps.rejected_busy);
+    printf("measured        %" PRIu64 " ms\n", elapsed_ms);
+    printf("heap calls      %" PRIu64 "\n", heap);
+    printf("pool heap fills %" PRIu64 "\n", pool_heap);
+
+    atomic_store(&draining, false);
+    for (int i = 0; i < conn_count; i++) shutdown(client_fds[i], SHUT_WR);
+    for (int i = 0; i < conn_count; i++) pthread_join(readers[i], NULL);
+    pthread_join(drainer, NULL);
+    pipeline_shutdown();
+
+    if (atomic_load(&handled) != expected) {
+        printf("FAIL: %" PRIu64 " frames not handled\n", expected - (uint64_t)atomic_load(&handled));
+        return 1;
+    }
+    if (heap != 0 || pool_heap != 0) {
+        printf("FAIL: steady state reached the heap\n");
+        return 1;
+    }
+    printf("OK: no heap allocation on the bid/chat path\n");
+    return 0;
+}
@@ -0,0 +1,150 @@
+// ========== Bid Series Size Check ==========
+// Memory per item of the PRICE_HISTORY series (bid_series.h). Synthetic
+// auctions of --bids bids, 50-1550 ms apart, are published as
+// EVENT_ITEM_BID and closed with EVENT_ITEM_SOLD (which trims the columns),
+// under three price patterns:
+//   minimum     every bid one BID_MIN_INCREMENT_VND over the last
+//   round       4 in 5 bids at the minimum, the rest 2-10 increments
+//   odd         as round, with 1% of the bids off by 1-999 VND
+// Each series is then read back through bid_series_build_history at
+// 1-second buckets and compared with the same buckets built from the raw
+// bids.
+//
+//   bid_series_bench [--bids=10000] [--seed=1]
+//
+// Exit status is 0 when every history matches, 1 otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "protocol.h"
+#include "network_utils.h"
+#include "auction_events.h"
+#include "bid_series.h"
+#include "db_adapter.h"
+
+// Not sent by this check
+int send_response(int sockfd, uint8_t type, uint32_t request_id, const void* payload,
+                  uint32_t payload_length)
+{
+    (void)sockfd; (void)type; (void)request_id; (void)payload; (void)payload_length;
+    return 0;
+}
+
+typedef enum { PATTERN_MINIMUM, PATTERN_ROUND, PATTERN_ODD } PricePattern;
+
+static const char* pattern_names[] = { "minimum", "round", "odd" };
+
+static int64_t next_step(PricePattern pattern)
+{
+    int64_t step = BID_MIN_INCREMENT_VND;
+    if (pattern != PATTERN_MINIMUM && rand() % 5 == 0) step *= 2 + rand() % 9;
+    if (pattern == PATTERN_ODD && rand() % 100 == 0) step += 1 + rand() % 999;
+    return step;
+}
+
+// Buckets the way bid_series_build_history does, from the raw bids
+static int reference_history(const uint64_t* ts, const int64_t* price, int n,
+                             uint32_t resolution, PricePoint* out)
+{
+    int count = 0;
+    uint64_t bucket = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t tick_ms = ts[i] / BID_SERIES_TICK_MS * BID_SERIES_TICK_MS;
+        uint64_t offset = i == 0 || tick_ms < ts[0] ? 0 : tick_ms - ts[0];
+        uint64_t b = offset / resolution;
+        if (count == 0 || b != bucket) {
+            memset(&out[count++], 0, sizeof(PricePoint));
+        }
+        bucket = b;
+        out[count - 1].offset_ms = (uint32_t)(b * resolution);
+        out[count - 1].price = price[i];
+        out[count - 1].bids++;
+    }
+    return count;
+}
+
+static bool run_pattern(PricePattern pattern, int32_t item_id, int bids)
+{
+    uint64_t* ts = malloc(sizeof(*ts) * (size_t)bids);
+    int64_t* price = malloc(sizeof(*price) * (size_t)bids);
+    size_t cap = sizeof(PriceHistoryRes) + sizeof(PricePoint) * (size_t)bids;
+    char* out = malloc(cap);
+    PricePoint* expect = malloc(sizeof(PricePoint) * (size_t)bids);
+    if (!ts || !price || !out || !expect) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    BidSeriesStats before, after;
+    bid_series_get_stats(&before);
+
+    uint64_t now = 1700000000000ULL;
+    int64_t amount = 1000000;
+    for (int i = 0; i < bids; i++) {
+        now += 50 + (uint64_t)(rand() % 1501);
+        amount += next_step(pattern);
+        ts[i] = now;
+        price[i] = amount;
+        AuctionEvent ev = { .type = EVENT_ITEM_BID, .room_id = 1, .item_id = item_id,
+                            .user_id = 2 + i % 7, .amount = amount, .timestamp_ms = now };
+        auction_events_publish(&ev);
+    }
+    AuctionEvent sold = { .type = EVENT_ITEM_SOLD, .room_id = 1, .item_id = item_id,
+                          .amount = amount, .timestamp_ms = now };
+    auction_events_publish(&sold);
+    bid_series_get_stats(&after);
+
+    uint64_t bytes = after.bytes - before.bytes;
+    printf("%-8s %6d bids  %7" PRIu64 " bytes  %.2f B/bid\n", pattern_names[pattern], bids,
+           bytes, (double)bytes / bids);
+
+    bool ok = true;
+    int len = bid_series_build_history(item_id, BID_SERIES_TICK_MS, out, cap);
+    PriceHistoryRes head;
+    if (len < (int)sizeof(head)) {
+        printf("  no history\n");
+        ok = false;
+    } else {
+        memcpy(&head, out, sizeof(head));
+        int n = reference_history(ts, price, bids, head.resolution_ms, expect);
+        if (head.total_bids != (uint32_t)bids || head.count != n ||
+            memcmp(out + sizeof(head), expect, sizeof(PricePoint) * (size_t)n) != 0) {
+            printf("  history mismatch: %u points, expected %d\n", head.count, n);
+            ok = false;
+        }
+    }
+    free(ts);
+    free(price);
+    free(out);
+    free(expect);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    int bids = 10000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--bids=", 7) == 0) bids = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--seed=", 7) == 0) seed = (unsigned)strtoul(argv[i] + 7, NULL, 10);
+        else {
+            fprintf(stderr, "usage: bid_series_bench [--bids=10000] [--seed=1]\n");
+            return 2;
+        }
+    }
+    if (bids <= 0) bids = 1;
+    srand(seed);
+
+    if (!bid_series_init()) {
+        fprintf(stderr, "bid_series_init failed\n");
+        return 1;
+    }
+    bool ok = true;
+    for (int p = PATTERN_MINIMUM; p <= PATTERN_ODD; p++) {
+        ok &= run_pattern((PricePattern)p, 100 + p, bids);
+    }
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,321 @@
+// ========== Bulk Item Create Bench ==========
+// Items per second for listing a catalogue. The bulk path is the server's:
+// CREATE_ITEMS_REQ frames of packed rows go over a socketpair to a reader
+// running server.c's loop (message_accept, request pipeline), the worker
+// runs handle_create_items (item_batch.c) and room_service_create_items,
+// and the results come back paged in CREATE_ITEMS_RES. For comparison the
+// same items are then created one at a time with room_service_create_item,
+// the work behind CREATE_ITEM_REQ (the frames themselves are left out: at
+// the per-connection write rate they would take minutes).
+//
+// No Postgres is needed: each INSERT statement sleeps --rtt-us, plus
+// --row-us per row, to stand in for the round trip and the per-row cost.
+// The scheduler, events and stats are stubbed out.
+//
+//   item_bulk_bench [--items=1000] [--rtt-us=300] [--row-us=10]
+//
+// Exit status is 0 when every item was created on both paths, 1 otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "protocol.h"
+#include "mem_pool.h"
+#include "network_utils.h"
+#include "request_pipeline.h"
+#include "message_dispatch.h"
+#include "conn_session.h"
+#include "room_service.h"
+#include "item_batch.h"
+#include "item_scheduler.h"
+#include "auction_events.h"
+#include "user_stats.h"
+#include "ledger.h"
+#include "db_adapter.h"
+
+#define MAX_ITEMS   CREATE_ITEMS_MAX
+
+static int rtt_us = 300, row_us = 10;
+static atomic_uint_fast64_t statements, rows_inserted;
+static atomic_int next_item_id = 1;
+
+// === STUBS ===
+// Every other request handler: not sent by this bench
+#define BENCH_STUB_REQ(type, value, body, size, handler) \
+    void handler(int sockfd, const MessageHeader* header, const char* payload) __attribute__((weak)); \
+    void handler(int sockfd, const MessageHeader* header, const char* payload) \
+    { (void)sockfd; (void)header; (void)payload; }
+#define BENCH_STUB_MSG(type, value, body, size)
+
+PROTOCOL_MESSAGES(BENCH_STUB_REQ, BENCH_STUB_MSG)
+
+static void db_statement(int rows)
+{
+    usleep((useconds_t)(rtt_us + row_us * rows));
+    atomic_fetch_add(&statements, 1);
+    atomic_fetch_add(&rows_inserted, (uint64_t)rows);
+}
+
+int32_t db_create_item(int32_t room_id, int32_t seller_id, const char* name, const char* desc,
+                       int64_t start_price_vnd, int64_t buy_now_price_vnd, uint32_t duration_sec,
+                       int32_t queue_position)
+{
+    (void)room_id; (void)seller_id; (void)name; (void)desc; (void)start_price_vnd;
+    (void)buy_now_price_vnd; (void)duration_sec; (void)queue_position;
+    db_statement(1);
+    return atomic_fetch_add(&next_item_id, 1);
+}
+
+bool db_create_items(int32_t room_id, int32_t seller_id, const ItemInsert* rows, int count,
+                     int32_t* item_ids_out)
+{
+    (void)room_id; (void)seller_id; (void)rows;
+    db_statement(count);
+    for (int i = 0; i < count; i++) item_ids_out[i] = atomic_fetch_add(&next_item_id, 1);
+    return true;
+}
+
+int32_t db_create_room(const char* name, const char* desc, int32_t creator_id,
+                       uint64_t start_time, uint64_t end_time)
+{
+    (void)name; (void)desc; (void)creator_id; (void)start_time; (void)end_time;
+    return -1;
+}
+
+bool db_delete_item(int32_t item_id) { (void)item_id; return false; }
+
+bool db_save_chat_message(int32_t room_id, int32_t user_id, const char* text)
+{
+    (void)room_id; (void)user_id; (void)text;
+    return true;
+}
+
+static atomic_int next_position = 1;
+
+int32_t item_scheduler_next_position(int32_t room_id)
+{
+    (void)room_id;
+    return atomic_fetch_add(&next_position, 1);
+}
+
+int32_t item_scheduler_reserve_positions(int32_t room_id, int32_t count)
+{
+    (void)room_id;
+    return atomic_fetch_add(&next_position, count);
+}
+
+bool item_scheduler_enqueue(int32_t room_id, int32_t item_id, int32_t queue_position,
+                            uint32_t duration_sec)
+{
+    (void)room_id; (void)item_id; (void)queue_position; (void)duration_sec;
+    return true;
+}
+
+bool item_scheduler_remove(int32_t room_id, int32_t item_id)
+{
+    (void)room_id; (void)item_id;
+    return false;
+}
+
+void auction_events_publish(const AuctionEvent* ev) { (void)ev; }
+
+uint64_t auction_events_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void user_stats_note_item(int32_t item_id, const char* name) { (void)item_id; (void)name; }
+void ledger_release(int32_t item_id) { (void)item_id; }
+
+// === SERVER SIDE ===
+// Same loop as server.c client_handler
+static void* reader_main(void* arg)
+{
+    int sockfd = (int)(intptr_t)arg;
+    Connection* conn = pipeline_conn_lookup(sockfd);
+    MessageHeader header;
+    while (recv_all(sockfd, &header, sizeof(header)) > 0) {
+        if (header.payload_length > BUFF_SIZE) break;
+        char* payload = buf_pool_alloc(header.payload_length);
+        if (!payload) break;
+        if (header.payload_length > 0 &&
+            recv_all(sockfd, payload, header.payload_length) <= 0) {
+            buf_pool_free(payload);
+            break;
+        }
+        if (!message_accept(sockfd, &header, payload)) {
+            buf_pool_free(payload);
+            continue;
+        }
+        pipeline_submit(conn, &header, payload, true);
+    }
+    item_batch_conn_close(sockfd);
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+// === CLIENT SIDE ===
+static atomic_int items_answered, items_created, frames_rejected;
+
+// Counts the per-row results of the final CREATE_ITEMS_RES pages
+static void* receiver_main(void* arg)
+{
+    int fd = (int)(intptr_t)arg;
+    MessageHeader header;
+    static char payload[BUFF_SIZE];
+    while (recv_all(fd, &header, sizeof(header)) > 0) {
+        if (header.payload_length > BUFF_SIZE ||
+            recv_all(fd, payload, header.payload_length) <= 0) break;
+        CreateItemsRes res;
+        if (header.type != CREATE_ITEMS_RES ||
+            !decode_CREATE_ITEMS_RES(payload, header.payload_length, &res)) {
+            atomic_fetch_add(&frames_rejected, 1);
+            continue;
+        }
+        if (res.status == STATUS_INVALID) atomic_fetch_add(&frames_rejected, 1);
+        for (uint16_t i = 0; i < res.count; i++) {
+            CreateItemResult r;
+            memcpy(&r, payload + sizeof(res) + i * sizeof(r), sizeof(r));
+            if (r.status == STATUS_SUCCESS) atomic_fetch_add(&items_created, 1);
+            atomic_fetch_add(&items_answered, 1);
+        }
+    }
+    return NULL;
+}
+
+static void make_item(int i, CreateItemReq* item)
+{
+    memset(item, 0, sizeof(*item));
+    snprintf(item->name, sizeof(item->name), "Estate lot %04d - oak side table", i);
+    snprintf(item->description, sizeof(item->description),
+             "Solid oak, 1960s, minor wear on the top. Pickup in District %d.", 1 + i % 12);
+    item->start_price = 100000 + i * 1000;
+    item->buy_now_price = i % 3 ? 0 : 500000 + i * 1000;
+    item->duration_sec = 60;
+}
+
+// Pack all items into as few CREATE_ITEMS_REQ frames as they fit
+static int send_items(int fd, int items, uint32_t batch_id, uint64_t* bytes)
+{
+    static uint32_t request_id = 1;
+    char frame[sizeof(MessageHeader) + BUFF_SIZE];
+    int frames = 0, i = 0;
+    while (i < items) {
+        char* payload = frame + sizeof(MessageHeader);
+        uint32_t len = sizeof(CreateItemsReq);
+        CreateItemsReq head = { .batch_id = batch_id, .seq = (uint16_t)frames };
+        for (; i < items; i++) {
+            CreateItemReq item;
+            make_item(i, &item);
+            uint32_t n = encode_create_items_row(&item, payload + len, BUFF_SIZE - len);
+            if (n == 0) break;
+            len += n;
+            head.count++;
+        }
+        head.last = i == items;
+        memcpy(payload, &head, sizeof(head));
+        MessageHeader header = { .type = CREATE_ITEMS_REQ, .request_id = request_id++,
+                                 .payload_length = len };
+        memcpy(frame, &header, sizeof(header));
+        if (send_all(fd, frame, sizeof(header) + len) < 0) return -1;
+        *bytes += sizeof(header) + len;
+        frames++;
+    }
+    return frames;
+}
+
+static uint64_t mono_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int main(int argc, char* argv[])
+{
+    int items = 1000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--items=", 8) == 0) items = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "--rtt-us=", 9) == 0) rtt_us = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "--row-us=", 9) == 0) row_us = atoi(argv[i] + 9);
+        else {
+            fprintf(stderr, "usage: item_bulk_bench [--items=1000] [--rtt-us=300] [--row-us=10]\n");
+            return 2;
+        }
+    }
+    if (items < 1 || items > MAX_ITEMS || rtt_us < 0 || row_us < 0) {
+        fprintf(stderr, "item_bulk_bench: items 1..%d, delays >= 0\n", MAX_ITEMS);
+        return 2;
+    }
+
+    if (buf_pool_prewarm(64) != 0 || !pipeline_init(message_dispatch)) {
+        fprintf(stderr, "item_bulk_bench: init failed\n");
+        return 1;
+    }
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return 1;
+    if (!pipeline_conn_open(sv[1])) return 1;
+    conn_session_login(sv[1], 7, "bench");
+    conn_session_join_room(sv[1], 3);
+
+    pthread_t reader, receiver;
+    pthread_create(&reader, NULL, reader_main, (void*)(intptr_t)sv[1]);
+    pthread_create(&receiver, NULL, receiver_main, (void*)(intptr_t)sv[0]);
+
+    // Bulk: one batch over as many frames as it takes
+    uint64_t bytes = 0;
+    uint64_t t0 = mono_us();
+    int frames = send_items(sv[0], items, 1, &bytes);
+    while (atomic_load(&items_answered) < items && atomic_load(&frames_rejected) == 0 &&
+           mono_us() - t0 < 30000000) {
+        usleep(100);
+    }
+    uint64_t bulk_us = mono_us() - t0;
+    uint64_t bulk_statements = atomic_load(&statements);
+    int bulk_created = atomic_load(&items_created);
+
+    // One at a time: the work of `items` CREATE_ITEM_REQ
+    uint64_t t1 = mono_us();
+    int single_created = 0;
+    for (int i = 0; i < items; i++) {
+        CreateItemReq item;
+        make_item(i, &item);
+        single_created += room_service_create_item(3, 7, item.name, item.description,
+                                                   item.start_price, item.buy_now_price,
+                                                   item.duration_sec) > 0;
+    }
+    uint64_t single_us = mono_us() - t1;
+
+    printf("items           %d (DB model: %d us per statement + %d us per row)\n",
+           items, rtt_us, row_us);
+    printf("bulk            %d frames, %" PRIu64 " bytes (%.0f bytes/item), %" PRIu64 " statements\n",
+           frames, bytes, (double)bytes / items, bulk_statements);
+    printf("                %d created in %.1f ms: %.0f items/s\n",
+           bulk_created, bulk_us / 1000.0, items * 1e6 / (double)bulk_us);
+    printf("one at a time   %d created in %.1f ms: %.0f items/s\n",
+           single_created, single_us / 1000.0, items * 1e6 / (double)single_us);
+
+    shutdown(sv[0], SHUT_WR);
+    pthread_join(reader, NULL);
+    pipeline_conn_close(pipeline_conn_lookup(sv[1]));
+    pipeline_wait_idle(5000);
+    shutdown(sv[0], SHUT_RDWR);
+    pthread_join(receiver, NULL);
+    pipeline_shutdown();
+
+    if (bulk_created != items || single_created != items) {
+        printf("FAIL: not every item was created (%d rejected frames)\n",
+               atomic_load(&frames_rejected));
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
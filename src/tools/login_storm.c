@@ -0,0 +1,314 @@
+// ========== Login Storm Bench ==========
+// Measures BID_REQ round-trip latency while a burst of logins hashes
+// passwords. Bids and logins take the server's path: readers submit frames
+// to the request pipeline, a worker answers the bid or queues the login to
+// auth_service, whose hashing threads verify a real bcrypt hash (cost
+// AUTH_BCRYPT_COST) and answer from there. The DB, ledger and stats loads
+// are stubbed out, so what is left is CPU contention between hashing and
+// the bid path.
+//
+//   login_storm [--bidders=16] [--storm=64] [--secs=5]
+//
+// Runs two phases of --secs each, bids alone then bids during the storm,
+// and prints the bid latency percentiles of both. Half of the storm logins
+// use unknown usernames (verified against the dummy hash).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "protocol.h"
+#include "mem_pool.h"
+#include "network_utils.h"
+#include "request_pipeline.h"
+#include "auth_service.h"
+#include "db_adapter.h"
+#include "ledger.h"
+#include "user_stats.h"
+
+#define MAX_BIDDERS     64
+#define MAX_STORM       256
+#define BID_INTERVAL_MS 100     // 10 bids/s per bidder, under the per-connection rate
+#define LOGIN_INTERVAL_MS 500   // The per-connection auth rate
+#define MAX_SAMPLES     (1 << 16)
+
+// === STUBS ===
+static char user_hash[AUTH_HASH_MAX];
+
+bool db_get_user_credentials(const char* username, char* hash_out, size_t hash_cap,
+                             int32_t* user_id, int64_t* balance_vnd)
+{
+    if (strncmp(username, "user", 4) != 0) return false;
+    snprintf(hash_out, hash_cap, "%s", user_hash);
+    *user_id = atoi(username + 4) + 1;
+    *balance_vnd = 0;
+    return true;
+}
+
+bool db_set_password_hash(int32_t user_id, const char* password_hash)
+{
+    (void)user_id; (void)password_hash;
+    return true;
+}
+
+int32_t db_register_user(const char* username, const char* password_hash, const char* email)
+{
+    (void)username; (void)password_hash; (void)email;
+    return -1;
+}
+
+void ledger_load_user(int32_t user_id, int64_t balance)
+{
+    (void)user_id; (void)balance;
+}
+
+bool user_stats_load(int32_t user_id)
+{
+    (void)user_id;
+    return true;
+}
+
+// === SERVER SIDE ===
+typedef struct {
+    int sockfd;
+    uint32_t request_id;
+} LoginCtx;
+
+static void login_done(const AuthResult* result, void* ctx)
+{
+    LoginCtx* lc = ctx;
+    LoginRes res = { .status = result->status, .user_id = (uint32_t)result->user_id };
+    send_response(lc->sockfd, LOGIN_RES, lc->request_id, &res, sizeof(res));
+    free(lc);
+}
+
+static void handler(int sockfd, const MessageHeader* header, const char* payload)
+{
+    if (header->type == BID_REQ) {
+        BidRes res = { .status = STATUS_SUCCESS };
+        snprintf(res.message, sizeof(res.message), "Bid accepted");
+        send_response(sockfd, BID_RES, header->request_id, &res, sizeof(res));
+    } else if (header->type == LOGIN_REQ) {
+        const LoginReq* req = (const LoginReq*)payload;
+        LoginCtx* lc = malloc(sizeof(*lc));
+        if (lc) *lc = (LoginCtx){ .sockfd = sockfd, .request_id = header->request_id };
+        if (!lc || !auth_service_login(req->username, req->password, login_done, lc)) {
+            free(lc);
+            LoginRes res = { .status = STATUS_BUSY };
+            send_response(sockfd, LOGIN_RES, header->request_id, &res, sizeof(res));
+        }
+    }
+}
+
+// Same loop as server.c client_handler
+static void* reader_main(void* arg)
+{
+    int sockfd = (int)(intptr_t)arg;
+    Connection* conn = pipeline_conn_lookup(sockfd);
+    MessageHeader header;
+    while (recv_all(sockfd, &header, sizeof(header)) > 0) {
+        char* payload = buf_pool_alloc(header.payload_length);
+        if (!payload) break;
+        if (header.payload_length > 0 &&
+            recv_all(sockfd, payload, header.payload_length) <= 0) {
+            buf_pool_free(payload);
+            break;
+        }
+        pipeline_submit(conn, &header, payload, true);
+    }
+    buf_pool_thread_flush();
+    return NULL;
+}
+
+// === CLIENT SIDE ===
+static atomic_bool storming;
+static atomic_bool stopping;
+static int bidder_count = 16, storm_count = 64, secs = 5;
+
+typedef struct {
+    uint32_t us[MAX_SAMPLES];
+    uint32_t n;
+} Samples;
+
+static Samples phase_samples[2];
+static pthread_mutex_t samples_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int phase;
+static atomic_uint_fast64_t logins_sent, logins_ok, logins_failed, logins_busy;
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static bool send_frame(int fd, uint8_t type, uint32_t request_id, const void* payload, uint32_t len)
+{
+    char frame[sizeof(MessageHeader) + BUFF_SIZE];
+    MessageHeader header = { .type = type, .request_id = request_id, .payload_length = len };
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), payload, len);
+    return send_all(fd, frame, sizeof(header) + len) >= 0;
+}
+
+static bool recv_frame(int fd, MessageHeader* header, char* payload, size_t cap)
+{
+    if (recv_all(fd, header, sizeof(*header)) <= 0) return false;
+    if (header->payload_length > cap) return false;
+    return header->payload_length == 0 || recv_all(fd, payload, header->payload_length) > 0;
+}
+
+static void* bidder_main(void* arg)
+{
+    int fd = (int)(intptr_t)arg;
+    uint32_t request_id = 1;
+    char payload[BUFF_SIZE];
+    while (!atomic_load(&stopping)) {
+        BidReq bid = { .item_id = 1, .bid_amount = 100000 + request_id };
+        uint64_t t0 = now_us();
+        if (!send_frame(fd, BID_REQ, request_id++, &bid, sizeof(bid))) break;
+        MessageHeader header;
+        if (!recv_frame(fd, &header, payload, sizeof(payload))) break;
+        uint64_t rtt = now_us() - t0;
+
+        if (header.type == BID_RES) {
+            Samples* s = &phase_samples[atomic_load(&phase)];
+            pthread_mutex_lock(&samples_lock);
+            if (s->n < MAX_SAMPLES) s->us[s->n++] = (uint32_t)rtt;
+            pthread_mutex_unlock(&samples_lock);
+        }
+        usleep(BID_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+static void* storm_main(void* arg)
+{
+    int fd = (int)(intptr_t)arg;
+    static atomic_uint next_user;
+    uint32_t request_id = 1;
+    char payload[BUFF_SIZE];
+    while (!atomic_load(&stopping)) {
+        if (!atomic_load(&storming)) {
+            usleep(10000);
+            continue;
+        }
+        unsigned n = atomic_fetch_add(&next_user, 1);
+        LoginReq req;
+        memset(&req, 0, sizeof(req));
+        snprintf(req.username, sizeof(req.username), "%s%u", (n & 1) ? "ghost" : "user", n);
+        snprintf(req.password, sizeof(req.password), "secret");
+        if (!send_frame(fd, LOGIN_REQ, request_id++, &req, sizeof(req))) break;
+        atomic_fetch_add(&logins_sent, 1);
+
+        MessageHeader header;
+        if (!recv_frame(fd, &header, payload, sizeof(payload))) break;
+        int32_t status;
+        memcpy(&status, payload, sizeof(status));
+        if (header.type != LOGIN_RES) atomic_fetch_add(&logins_busy, 1);   // ERROR_RES: rate limited
+        else if (status == STATUS_SUCCESS) atomic_fetch_add(&logins_ok, 1);
+        else if (status == STATUS_BUSY) atomic_fetch_add(&logins_busy, 1);
+        else atomic_fetch_add(&logins_failed, 1);
+        usleep(LOGIN_INTERVAL_MS * 1000);
+    }
+    return NULL;
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* name, Samples* s)
+{
+    if (s->n == 0) {
+        printf("%-12s no samples\n", name);
+        return;
+    }
+    qsort(s->us, s->n, sizeof(s->us[0]), cmp_u32);
+    printf("%-12s bids %6u  p50 %6u us  p99 %6u us  max %6u us\n", name, s->n,
+           s->us[s->n / 2], s->us[(uint64_t)s->n * 99 / 100], s->us[s->n - 1]);
+}
+
+static int open_conn(int* client_fd, pthread_t* reader)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return -1;
+    if (!pipeline_conn_open(sv[1])) return -1;
+    pthread_create(reader, NULL, reader_main, (void*)(intptr_t)sv[1]);
+    *client_fd = sv[0];
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--bidders=", 10) == 0) bidder_count = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--storm=", 8) == 0) storm_count = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "--secs=", 7) == 0) secs = atoi(argv[i] + 7);
+        else {
+            fprintf(stderr, "usage: login_storm [--bidders=16] [--storm=64] [--secs=5]\n");
+            return 2;
+        }
+    }
+    if (bidder_count < 1 || bidder_count > MAX_BIDDERS || storm_count < 0 ||
+        storm_count > MAX_STORM || secs < 1) {
+        fprintf(stderr, "login_storm: bidders 1..%d, storm 0..%d, secs >= 1\n", MAX_BIDDERS, MAX_STORM);
+        return 2;
+    }
+
+    size_t prewarm = (size_t)(bidder_count + storm_count) * (BUF_POOL_REFILL + 1) +
+                     PIPELINE_WORKERS * BUF_POOL_TLS_MAX;
+    if (!auth_hash_password("secret", user_hash, sizeof(user_hash)) ||
+        buf_pool_prewarm(prewarm) != 0 || !pipeline_init(handler) || !auth_service_init()) {
+        fprintf(stderr, "login_storm: init failed\n");
+        return 1;
+    }
+
+    int bidder_fds[MAX_BIDDERS], storm_fds[MAX_STORM];
+    pthread_t readers[MAX_BIDDERS + MAX_STORM], bidders[MAX_BIDDERS], storms[MAX_STORM];
+    int nreaders = 0;
+    for (int i = 0; i < bidder_count; i++) {
+        if (open_conn(&bidder_fds[i], &readers[nreaders++]) != 0) return 1;
+        pthread_create(&bidders[i], NULL, bidder_main, (void*)(intptr_t)bidder_fds[i]);
+    }
+    for (int i = 0; i < storm_count; i++) {
+        if (open_conn(&storm_fds[i], &readers[nreaders++]) != 0) return 1;
+        pthread_create(&storms[i], NULL, storm_main, (void*)(intptr_t)storm_fds[i]);
+    }
+
+    sleep((unsigned)secs);
+    atomic_store(&phase, 1);
+    atomic_store(&storming, true);
+    sleep((unsigned)secs);
+    atomic_store(&stopping, true);
+
+    for (int i = 0; i < bidder_count; i++) pthread_join(bidders[i], NULL);
+    for (int i = 0; i < storm_count; i++) pthread_join(storms[i], NULL);
+    auth_service_wait_idle(5000);
+    for (int i = 0; i < bidder_count; i++) shutdown(bidder_fds[i], SHUT_WR);
+    for (int i = 0; i < storm_count; i++) shutdown(storm_fds[i], SHUT_WR);
+    for (int i = 0; i < nreaders; i++) pthread_join(readers[i], NULL);
+    auth_service_shutdown();
+    pipeline_shutdown();
+
+    AuthStats as;
+    auth_service_get_stats(&as);
+    printf("%d bidders, %d storm connections, %d s per phase, bcrypt cost %d\n",
+           bidder_count, storm_count, secs, AUTH_BCRYPT_COST);
+    report("idle", &phase_samples[0]);
+    report("login storm", &phase_samples[1]);
+    printf("logins sent %" PRIu64 ": ok %" PRIu64 ", failed %" PRIu64 ", refused %" PRIu64
+           " (max auth queue wait %" PRIu64 " ms)\n",
+           (uint64_t)atomic_load(&logins_sent), (uint64_t)atomic_load(&logins_ok),
+           (uint64_t)atomic_load(&logins_failed), (uint64_t)atomic_load(&logins_busy),
+           as.max_queue_wait_us / 1000);
+    return 0;
+}
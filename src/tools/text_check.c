@@ -0,0 +1,251 @@
+// ========== Text Validation Check ==========
+// Safety net for the vectorized text_validate.c: feeds random fields to
+// every implementation this CPU supports (scalar, SSE2, AVX2) and fails if
+// any of them disagrees with the others, or with a plain code-point decoder
+// written here from the UTF-8 definition. Fields are built from pieces that
+// sit on the interesting edges: multi-byte characters, overlongs,
+// surrogates, values past U+10FFFF, truncated sequences, C0 / C1 controls,
+// DEL and embedded NULs, spread across the 16 / 32-byte block boundaries.
+//
+// Then times text_sanitize per implementation for the field sizes the
+// protocol uses (50-byte names, 100-byte messages, 256-byte chat text).
+//
+//   text_check [--iterations=2000000] [--bench=5000000]
+//
+// Exit status is 0 when all implementations agree, 1 otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "text_validate.h"
+
+#define FIELD_MAX   300
+
+// === REFERENCE ===
+// Strict UTF-8 by decoding each code point (RFC 3629)
+static bool reference_utf8_valid(const unsigned char* s, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        unsigned char c = s[i];
+        uint32_t cp;
+        size_t n;
+        if (c < 0x80) { i++; continue; }
+        else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; n = 1; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; n = 2; }
+        else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; n = 3; }
+        else return false;
+        if (i + n >= len) return false;                     // Truncated
+        for (size_t k = 1; k <= n; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+        }
+        static const uint32_t min_cp[4] = { 0, 0x80, 0x800, 0x10000 };
+        if (cp < min_cp[n]) return false;                   // Overlong
+        if (cp >= 0xD800 && cp <= 0xDFFF) return false;     // Surrogate
+        if (cp > 0x10FFFF) return false;
+        i += n + 1;
+    }
+    return true;
+}
+
+// === RANDOM FIELDS ===
+static uint64_t rng_state = 88172645463325252ull;
+
+static uint32_t rnd(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+// Length-prefixed byte sequences; the first four are valid characters
+static const unsigned char pieces[][5] = {
+    { 1, 'a' },
+    { 2, 0xC3, 0xA9 },                  // é
+    { 3, 0xE2, 0x82, 0xAC },            // €
+    { 4, 0xF0, 0x9F, 0x98, 0x80 },      // U+1F600
+    { 1, 0x80 },                        // Stray continuation
+    { 1, 0xC0 },                        // Truncated / overlong lead
+    { 2, 0xE0, 0x80 },                  // Overlong 3-byte, truncated
+    { 3, 0xED, 0xA0, 0x80 },            // Surrogate U+D800
+    { 4, 0xF4, 0x90, 0x80, 0x80 },      // U+110000
+    { 2, 0xC2, 0x85 },                  // C1 control (NEL)
+    { 2, 0xC2, 0xA0 },                  // NBSP
+    { 1, '\n' },
+    { 1, 0x7F },                        // DEL
+    { 1, 0x01 },                        // C0 control
+    { 1, 0xFF },
+    { 3, 0xE0, 0xA0, 0x80 },            // Smallest 3-byte
+    { 4, 0xF0, 0x90, 0x80, 0x80 },      // Smallest 4-byte
+    { 2, 0xC3, 0x28 },                  // Lead followed by ASCII
+    { 3, 0xEF, 0xBF, 0xBF },            // U+FFFF
+    { 1, 0xF0 },                        // Truncated 4-byte lead
+};
+#define PIECE_COUNT (sizeof(pieces) / sizeof(pieces[0]))
+
+static size_t random_field(char* buf)
+{
+    size_t cap = 1 + rnd() % 256;
+    size_t n = 0;
+    int mode = rnd() % 4;       // 0: ASCII, 1: mostly valid, else anything
+    while (n < cap) {
+        const unsigned char* p = (mode == 0) ? pieces[0] : pieces[rnd() % PIECE_COUNT];
+        if (mode == 1 && rnd() % 8) p = pieces[rnd() % 4];
+        if (n + p[0] > cap) break;
+        memcpy(buf + n, p + 1, p[0]);
+        n += p[0];
+        if (rnd() % 64 == 0) break;
+    }
+    memset(buf + n, 'z', cap - n);
+    if (rnd() % 3) buf[rnd() % cap] = '\0';
+    return cap;
+}
+
+// === EQUIVALENCE ===
+static TextImpl impls[3];
+static int impl_count;
+
+static uint64_t fuzz(uint64_t iterations)
+{
+    char field[FIELD_MAX], work[FIELD_MAX], first[FIELD_MAX];
+    uint64_t mismatches = 0, valid = 0;
+
+    for (uint64_t it = 0; it < iterations; it++) {
+        size_t cap = random_field(field);
+        unsigned flags = (rnd() % 3 == 0) ? TEXT_RAW
+                       : (rnd() % 2) ? TEXT_UTF8 : (TEXT_UTF8 | TEXT_MULTILINE);
+
+        int first_len = 0, first_res = 0;
+        bool first_valid = false, bad = false;
+        for (int k = 0; k < impl_count; k++) {
+            text_set_impl(impls[k]);
+            int len = text_bounded_len(field, cap);
+            size_t n = len < 0 ? cap : (size_t)len;
+            bool ok = text_utf8_valid(field, n);
+            memcpy(work, field, cap);
+            int res = text_sanitize(work, cap, flags);
+
+            if (k == 0) {
+                first_len = len;
+                first_valid = ok;
+                first_res = res;
+                memcpy(first, work, cap);
+                if (ok != reference_utf8_valid((const unsigned char*)field, n)) bad = true;
+                if (ok) valid++;
+            } else if (len != first_len || ok != first_valid || res != first_res ||
+                       memcmp(work, first, cap) != 0) {
+                bad = true;
+            }
+        }
+        if (bad && mismatches++ < 5) {
+            printf("MISMATCH (cap %zu, flags %u):", cap, flags);
+            for (size_t i = 0; i < cap && i < 48; i++) printf(" %02X", (unsigned char)field[i]);
+            printf("\n");
+        }
+    }
+    printf("fuzz            %" PRIu64 " fields, %" PRIu64 " valid UTF-8, %" PRIu64 " mismatches\n",
+           iterations, valid, mismatches);
+    return mismatches;
+}
+
+// Fixed cases every implementation must get right
+static uint64_t known_vectors(void)
+{
+    static const char* invalid[] = {
+        "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF8", "\xE2\x82", "abc\xC3",
+    };
+    static const char* valid[] = {
+        "gi\xC3\xA1 bao nhi\xC3\xAAu?", "\xE2\x82\xAC" "100", "\xF0\x9F\x98\x80", "\xEF\xBF\xBF",
+    };
+    uint64_t failures = 0;
+    for (int k = 0; k < impl_count; k++) {
+        text_set_impl(impls[k]);
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            if (text_utf8_valid(invalid[i], strlen(invalid[i]))) {
+                printf("FAIL %s accepts invalid vector %zu\n", text_impl_name(impls[k]), i);
+                failures++;
+            }
+        }
+        for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+            if (!text_utf8_valid(valid[i], strlen(valid[i]))) {
+                printf("FAIL %s rejects valid vector %zu\n", text_impl_name(impls[k]), i);
+                failures++;
+            }
+        }
+        // Controls stripped, newline kept, NBSP kept
+        char s[64] = "h\x01i\xC2\x85 \xC2\xA0x\n\x7Fy";
+        int len = text_sanitize(s, sizeof(s), TEXT_UTF8 | TEXT_MULTILINE);
+        if (len != 8 || strcmp(s, "hi \xC2\xA0x\ny") != 0) {
+            printf("FAIL %s sanitize gave %d [%s]\n", text_impl_name(impls[k]), len, s);
+            failures++;
+        }
+    }
+    printf("known vectors   %s\n", failures ? "FAILED" : "ok");
+    return failures;
+}
+
+// === BENCHMARK ===
+static void bench(uint64_t rounds)
+{
+    static const size_t sizes[] = { 50, 100, 256 };
+    printf("\nsanitize, ns per field (mostly ASCII, one 2-byte character)\n");
+    printf("%-8s", "size");
+    for (int k = 0; k < impl_count; k++) printf("%10s", text_impl_name(impls[k]));
+    printf("\n");
+
+    for (size_t si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++) {
+        size_t cap = sizes[si];
+        char field[FIELD_MAX];
+        memset(field, 'a', cap);
+        memcpy(field + 10, "\xC3\xA9", 2);
+        field[cap - 3] = '\0';
+        printf("%-8zu", cap);
+        for (int k = 0; k < impl_count; k++) {
+            text_set_impl(impls[k]);
+            struct timespec a, b;
+            volatile int sink = 0;
+            clock_gettime(CLOCK_MONOTONIC, &a);
+            for (uint64_t r = 0; r < rounds; r++) sink += text_sanitize(field, cap, TEXT_UTF8);
+            clock_gettime(CLOCK_MONOTONIC, &b);
+            double ns = ((double)(b.tv_sec - a.tv_sec) * 1e9 + (double)(b.tv_nsec - a.tv_nsec)) / (double)rounds;
+            printf("%10.1f", ns);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t iterations = 2000000, rounds = 5000000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0) iterations = strtoull(argv[i] + 13, NULL, 10);
+        else if (strncmp(argv[i], "--bench=", 8) == 0) rounds = strtoull(argv[i] + 8, NULL, 10);
+        else {
+            fprintf(stderr, "usage: text_check [--iterations=2000000] [--bench=5000000]\n");
+            return 2;
+        }
+    }
+
+    const TextImpl all[] = { TEXT_IMPL_SCALAR, TEXT_IMPL_SSE2, TEXT_IMPL_AVX2 };
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        if (text_set_impl(all[i])) impls[impl_count++] = all[i];
+    }
+    printf("implementations");
+    for (int k = 0; k < impl_count; k++) printf(" %s", text_impl_name(impls[k]));
+    printf(" (best: %s)\n", text_impl_name(text_impl_best()));
+
+    uint64_t failures = fuzz(iterations) + known_vectors();
+    if (rounds > 0) bench(rounds);
+    text_set_impl(text_impl_best());
+
+    if (failures) {
+        printf("FAIL: implementations disagree\n");
+        return 1;
+    }
+    printf("OK: all implementations agree with each other and the reference\n");
+    return 0;
+}
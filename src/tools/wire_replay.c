@@ -0,0 +1,563 @@
+// ========== Wire Capture Replay ==========
+// Plays a capture recorded with the server's --capture option back against
+// a running server, one socket per recorded connection, and records what
+// the server answers. Two response files can then be diffed, e.g. the same
+// capture replayed against the build before and after a change:
+//
+//   wire_replay <capture> [--host=127.0.0.1] [--port=5500]
+//               [--speed=<N>|max] [--out=<responses>] [--drain-ms=2000]
+//   wire_replay --diff <responses-a> <responses-b> [--exact]
+//
+// --speed=1 keeps the recorded timing, N compresses it N times, max sends
+// every frame as soon as the previous one is written. The replay prints
+// throughput and request latency (request_id matched to its response).
+//
+// The diff pairs responses by connection and request_id and compares the
+// message type and status (--exact: the whole payload). Pushed frames
+// (request_id 0: BID_NOTIFY, TIMER_UPDATE, ...) depend on timing and are
+// only compared by count per connection and type.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "protocol.h"
+#include "capture_format.h"
+
+#define DEFAULT_DRAIN_MS    2000
+#define FRAME_MAX           (sizeof(MessageHeader) + BUFF_SIZE)
+
+typedef struct {
+    uint32_t request_id;
+    uint64_t sent_us;
+} Pending;
+
+typedef struct {
+    int fd;                     // -1: not open / done
+    bool closing;               // Capture closed it; waiting for EOF
+    char rbuf[FRAME_MAX];
+    size_t rlen;
+    Pending* pending;
+    size_t pending_len, pending_cap;
+} ReplayConn;
+
+static ReplayConn* conns;
+static uint32_t conn_cap;
+static FILE* resp_out;
+static uint64_t t0_us;
+
+static uint64_t sent_frames, recv_frames, sent_bytes;
+static uint64_t* latencies;
+static size_t lat_len, lat_cap;
+
+static uint64_t mono_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static const char* type_name(uint8_t type)
+{
+#define TYPE_NAME_REQ(type, value, body, size, handler) case type: return #type;
+#define TYPE_NAME_MSG(type, value, body, size) case type: return #type;
+    switch ((MessageType)type) {
+        PROTOCOL_MESSAGES(TYPE_NAME_REQ, TYPE_NAME_MSG)
+    }
+    return "UNKNOWN";
+}
+
+static bool read_file_header(FILE* f, const char* path, CaptureFileHeader* fh)
+{
+    if (fread(fh, sizeof(*fh), 1, f) != 1 ||
+        memcmp(fh->magic, CAPTURE_MAGIC, sizeof(fh->magic)) != 0 ||
+        fh->version != CAPTURE_VERSION) {
+        fprintf(stderr, "%s: not a capture file (version %d)\n", path, CAPTURE_VERSION);
+        return false;
+    }
+    return true;
+}
+
+// Next record; frame records also fill header and payload (BUFF_SIZE bytes)
+static bool read_record(FILE* f, CaptureRecord* rec, MessageHeader* header, char* payload)
+{
+    if (fread(rec, sizeof(*rec), 1, f) != 1) return false;
+    if (rec->kind != CAPTURE_REQUEST && rec->kind != CAPTURE_RESPONSE) return true;
+    if (fread(header, sizeof(*header), 1, f) != 1) return false;
+    if (header->payload_length > BUFF_SIZE) return false;
+    return header->payload_length == 0 ||
+           fread(payload, header->payload_length, 1, f) == 1;
+}
+
+// === REPLAY ===
+static ReplayConn* conn_get(uint32_t id)
+{
+    if (id >= conn_cap) {
+        uint32_t cap = conn_cap ? conn_cap : 64;
+        while (cap <= id) cap *= 2;
+        ReplayConn* grown = realloc(conns, sizeof(ReplayConn) * cap);
+        if (!grown) return NULL;
+        for (uint32_t i = conn_cap; i < cap; i++) {
+            memset(&grown[i], 0, sizeof(grown[i]));
+            grown[i].fd = -1;
+        }
+        conns = grown;
+        conn_cap = cap;
+    }
+    return &conns[id];
+}
+
+static int connect_to(const char* host, int port)
+{
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* res;
+    if (getaddrinfo(host, service, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static bool send_frame(int fd, const MessageHeader* header, const char* payload)
+{
+    char frame[FRAME_MAX];
+    size_t len = sizeof(*header) + header->payload_length;
+    memcpy(frame, header, sizeof(*header));
+    memcpy(frame + sizeof(*header), payload, header->payload_length);
+    for (size_t off = 0; off < len; ) {
+        ssize_t n = send(fd, frame + off, len - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += (size_t)n;
+    }
+    return true;
+}
+
+static void note_sent(ReplayConn* c, uint32_t request_id)
+{
+    if (request_id == 0) return;
+    if (c->pending_len == c->pending_cap) {
+        size_t cap = c->pending_cap ? c->pending_cap * 2 : 16;
+        Pending* grown = realloc(c->pending, sizeof(Pending) * cap);
+        if (!grown) return;
+        c->pending = grown;
+        c->pending_cap = cap;
+    }
+    c->pending[c->pending_len++] = (Pending){ request_id, mono_us() };
+}
+
+static void note_response(ReplayConn* c, uint32_t request_id, uint64_t now)
+{
+    if (request_id == 0) return;
+    for (size_t i = 0; i < c->pending_len; i++) {
+        if (c->pending[i].request_id != request_id) continue;
+        if (lat_len == lat_cap) {
+            size_t cap = lat_cap ? lat_cap * 2 : 1024;
+            uint64_t* grown = realloc(latencies, sizeof(uint64_t) * cap);
+            if (!grown) return;
+            latencies = grown;
+            lat_cap = cap;
+        }
+        latencies[lat_len++] = now - c->pending[i].sent_us;
+        c->pending[i] = c->pending[--c->pending_len];
+        return;
+    }
+}
+
+static void write_response(uint32_t conn_id, const char* frame, uint64_t now)
+{
+    const MessageHeader* header = (const MessageHeader*)frame;
+    if (!resp_out) return;
+    CaptureRecord rec = { .offset_us = now - t0_us, .conn_id = conn_id, .kind = CAPTURE_RESPONSE };
+    fwrite(&rec, sizeof(rec), 1, resp_out);
+    fwrite(frame, sizeof(*header) + header->payload_length, 1, resp_out);
+}
+
+// Read what is available and split it into frames; false on EOF / error
+static bool conn_read(uint32_t id, ReplayConn* c)
+{
+    ssize_t n = recv(c->fd, c->rbuf + c->rlen, sizeof(c->rbuf) - c->rlen, MSG_DONTWAIT);
+    if (n == 0) return false;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    c->rlen += (size_t)n;
+
+    uint64_t now = mono_us();
+    size_t off = 0;
+    while (c->rlen - off >= sizeof(MessageHeader)) {
+        MessageHeader header;
+        memcpy(&header, c->rbuf + off, sizeof(header));
+        if (header.payload_length > BUFF_SIZE) return false;
+        size_t len = sizeof(header) + header.payload_length;
+        if (c->rlen - off < len) break;
+        write_response(id, c->rbuf + off, now);
+        note_response(c, header.request_id, now);
+        recv_frames++;
+        off += len;
+    }
+    memmove(c->rbuf, c->rbuf + off, c->rlen - off);
+    c->rlen -= off;
+    return true;
+}
+
+static void conn_finish(ReplayConn* c)
+{
+    close(c->fd);
+    c->fd = -1;
+    c->closing = false;
+}
+
+// Read responses until `until_us` (0: return once nothing is pending)
+static void pump(uint64_t until_us)
+{
+    static struct pollfd* fds;
+    static uint32_t* ids;
+    static uint32_t fds_cap;
+    if (fds_cap < conn_cap) {
+        free(fds); free(ids);
+        fds = malloc(sizeof(*fds) * conn_cap);
+        ids = malloc(sizeof(*ids) * conn_cap);
+        fds_cap = fds ? conn_cap : 0;
+    }
+
+    for (;;) {
+        nfds_t nfds = 0;
+        for (uint32_t i = 0; i < conn_cap; i++) {
+            if (conns[i].fd < 0) continue;
+            fds[nfds] = (struct pollfd){ .fd = conns[i].fd, .events = POLLIN };
+            ids[nfds++] = i;
+        }
+        uint64_t now = mono_us();
+        int timeout = until_us > now ? (int)((until_us - now + 999) / 1000) : 0;
+        if (nfds == 0) {
+            if (timeout > 0) usleep((useconds_t)(until_us - now));
+            return;
+        }
+        int ready = poll(fds, nfds, timeout);
+        if (ready <= 0) return;
+        for (nfds_t k = 0; k < nfds; k++) {
+            if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ReplayConn* c = &conns[ids[k]];
+            if (!conn_read(ids[k], c)) conn_finish(c);
+        }
+        if (mono_us() >= until_us && until_us != 0) return;
+    }
+}
+
+static bool any_open(void)
+{
+    for (uint32_t i = 0; i < conn_cap; i++) {
+        if (conns[i].fd >= 0) return true;
+    }
+    return false;
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int replay(const char* path, const char* host, int port, double speed,
+                  const char* out_path, int drain_ms)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    CaptureFileHeader fh;
+    if (!read_file_header(f, path, &fh)) {
+        fclose(f);
+        return 1;
+    }
+    if (out_path) {
+        resp_out = fopen(out_path, "wb");
+        if (!resp_out) {
+            perror(out_path);
+            fclose(f);
+            return 1;
+        }
+        memcpy(fh.magic, CAPTURE_MAGIC, sizeof(fh.magic));
+        fwrite(&fh, sizeof(fh), 1, resp_out);
+    }
+
+    static char payload[BUFF_SIZE];
+    CaptureRecord rec;
+    MessageHeader header;
+    uint64_t connect_failures = 0;
+    t0_us = mono_us();
+
+    while (read_record(f, &rec, &header, payload)) {
+        if (speed > 0) pump(t0_us + (uint64_t)(rec.offset_us / speed));
+        ReplayConn* c = conn_get(rec.conn_id);
+        if (!c) break;
+
+        switch (rec.kind) {
+            case CAPTURE_OPEN:
+                c->fd = connect_to(host, port);
+                if (c->fd < 0) connect_failures++;
+                break;
+            case CAPTURE_REQUEST:
+                if (c->fd < 0 || c->closing) break;
+                note_sent(c, header.request_id);
+                if (!send_frame(c->fd, &header, payload)) {
+                    conn_finish(c);
+                    break;
+                }
+                sent_frames++;
+                sent_bytes += sizeof(header) + header.payload_length;
+                break;
+            case CAPTURE_CLOSE:
+                // Half-close: the server finishes in-flight requests first
+                if (c->fd >= 0) {
+                    shutdown(c->fd, SHUT_WR);
+                    c->closing = true;
+                }
+                break;
+        }
+        if (speed <= 0) pump(mono_us());
+    }
+    fclose(f);
+    uint64_t send_done_us = mono_us();
+
+    // Let outstanding responses arrive
+    uint64_t drain_until = send_done_us + (uint64_t)drain_ms * 1000;
+    while (any_open() && mono_us() < drain_until) pump(drain_until);
+
+    uint64_t elapsed_us = send_done_us - t0_us;
+    printf("sent %" PRIu64 " frames (%" PRIu64 " bytes) in %.3f s, %.0f frames/s\n",
+           sent_frames, sent_bytes, elapsed_us / 1e6,
+           elapsed_us ? sent_frames * 1e6 / elapsed_us : 0.0);
+    printf("received %" PRIu64 " frames, %zu matched responses\n", recv_frames, lat_len);
+    if (connect_failures) printf("%" PRIu64 " connections failed to open\n", connect_failures);
+    if (lat_len) {
+        qsort(latencies, lat_len, sizeof(uint64_t), cmp_u64);
+        printf("latency us: p50 %" PRIu64 "  p90 %" PRIu64 "  p99 %" PRIu64 "  max %" PRIu64 "\n",
+               latencies[lat_len / 2], latencies[lat_len * 9 / 10],
+               latencies[lat_len * 99 / 100], latencies[lat_len - 1]);
+    }
+
+    uint64_t unanswered = 0;
+    for (uint32_t i = 0; i < conn_cap; i++) {
+        unanswered += conns[i].pending_len;
+        if (conns[i].fd >= 0) close(conns[i].fd);
+        free(conns[i].pending);
+    }
+    if (unanswered) printf("%" PRIu64 " requests got no response\n", unanswered);
+    if (resp_out) fclose(resp_out);
+    free(conns);
+    free(latencies);
+    return 0;
+}
+
+// === DIFF ===
+typedef struct {
+    uint32_t conn_id;
+    uint32_t request_id;
+    uint8_t type;
+    uint32_t seq;               // Arrival order in its file
+    char* payload;
+    uint32_t len;
+} Response;
+
+typedef struct {
+    Response* items;
+    size_t len, cap;
+} ResponseSet;
+
+// Responses to a request pair up by request id; pushed frames by type
+static int cmp_response(const void* a, const void* b)
+{
+    const Response* x = a;
+    const Response* y = b;
+    if (x->conn_id != y->conn_id) return x->conn_id < y->conn_id ? -1 : 1;
+    if (x->request_id != y->request_id) return x->request_id < y->request_id ? -1 : 1;
+    if (x->request_id == 0 && x->type != y->type) return x->type < y->type ? -1 : 1;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+// Order of the groups of x and y (0: same group)
+static int same_group(const Response* x, const Response* y)
+{
+    Response kx = *x, ky = *y;
+    kx.seq = ky.seq = 0;
+    return cmp_response(&kx, &ky);
+}
+
+static bool load_responses(const char* path, ResponseSet* set)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    CaptureFileHeader fh;
+    if (!read_file_header(f, path, &fh)) {
+        fclose(f);
+        return false;
+    }
+    static char payload[BUFF_SIZE];
+    CaptureRecord rec;
+    MessageHeader header;
+    uint32_t seq = 0;
+    while (read_record(f, &rec, &header, payload)) {
+        if (rec.kind != CAPTURE_RESPONSE) continue;
+        if (set->len == set->cap) {
+            size_t cap = set->cap ? set->cap * 2 : 1024;
+            Response* grown = realloc(set->items, sizeof(Response) * cap);
+            if (!grown) break;
+            set->items = grown;
+            set->cap = cap;
+        }
+        Response* r = &set->items[set->len++];
+        r->conn_id = rec.conn_id;
+        r->request_id = header.request_id;
+        r->type = header.type;
+        r->seq = seq++;
+        r->len = header.payload_length;
+        r->payload = malloc(r->len ? r->len : 1);
+        if (r->len) memcpy(r->payload, payload, r->len);
+    }
+    fclose(f);
+    qsort(set->items, set->len, sizeof(Response), cmp_response);
+    return true;
+}
+
+static int32_t response_status(const Response* r)
+{
+    int32_t status = 0;
+    if (r->len >= sizeof(status)) memcpy(&status, r->payload, sizeof(status));
+    return status;
+}
+
+static bool responses_differ(const Response* a, const Response* b, bool exact)
+{
+    if (a->type != b->type) return true;
+    if (exact) return a->len != b->len || memcmp(a->payload, b->payload, a->len) != 0;
+    return response_status(a) != response_status(b);
+}
+
+static int diff(const char* path_a, const char* path_b, bool exact)
+{
+    ResponseSet a = {0}, b = {0};
+    if (!load_responses(path_a, &a) || !load_responses(path_b, &b)) return 2;
+
+    uint64_t compared = 0, differences = 0;
+    size_t i = 0, j = 0;
+    while (i < a.len || j < b.len) {
+        int order = i == a.len ? 1 : j == b.len ? -1 : same_group(&a.items[i], &b.items[j]);
+        const Response* x = i < a.len ? &a.items[i] : NULL;
+        const Response* y = j < b.len ? &b.items[j] : NULL;
+
+        // Walk one group (same connection and request id / pushed type) on each side
+        size_t gi = i, gj = j;
+        if (order <= 0) while (gi < a.len && same_group(&a.items[gi], x) == 0) gi++;
+        if (order >= 0) while (gj < b.len && same_group(&b.items[gj], y) == 0) gj++;
+        size_t na = gi - i, nb = gj - j;
+        const Response* key = order <= 0 ? x : y;
+
+        if (key->request_id == 0) {
+            if (na != nb) {
+                differences++;
+                printf("conn %u: %zu vs %zu %s\n", key->conn_id, na, nb, type_name(key->type));
+            }
+        } else {
+            size_t n = na < nb ? na : nb;
+            for (size_t k = 0; k < n; k++) {
+                const Response* ra = &a.items[i + k];
+                const Response* rb = &b.items[j + k];
+                compared++;
+                if (!responses_differ(ra, rb, exact)) continue;
+                differences++;
+                printf("conn %u req %u: %s status %d vs %s status %d\n",
+                       key->conn_id, key->request_id,
+                       type_name(ra->type), response_status(ra),
+                       type_name(rb->type), response_status(rb));
+            }
+            for (size_t k = n; k < na; k++, differences++) {
+                printf("conn %u req %u: %s only in %s\n", key->conn_id, key->request_id,
+                       type_name(a.items[i + k].type), path_a);
+            }
+            for (size_t k = n; k < nb; k++, differences++) {
+                printf("conn %u req %u: %s only in %s\n", key->conn_id, key->request_id,
+                       type_name(b.items[j + k].type), path_b);
+            }
+        }
+        i = gi;
+        j = gj;
+    }
+    printf("%" PRIu64 " responses compared, %" PRIu64 " differences\n", compared, differences);
+
+    for (size_t k = 0; k < a.len; k++) free(a.items[k].payload);
+    for (size_t k = 0; k < b.len; k++) free(b.items[k].payload);
+    free(a.items);
+    free(b.items);
+    return differences ? 1 : 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: wire_replay <capture> [--host=H] [--port=P] [--speed=N|max]\n"
+        "                   [--out=<responses>] [--drain-ms=N]\n"
+        "       wire_replay --diff <responses-a> <responses-b> [--exact]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 4 && strcmp(argv[1], "--diff") == 0) {
+        bool exact = argc >= 5 && strcmp(argv[4], "--exact") == 0;
+        return diff(argv[2], argv[3], exact);
+    }
+    if (argc < 2 || argv[1][0] == '-') {
+        usage();
+        return 2;
+    }
+
+    const char* host = "127.0.0.1";
+    int port = PORT;
+    double speed = 1.0;
+    const char* out_path = NULL;
+    int drain_ms = DEFAULT_DRAIN_MS;
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "--host=", 7) == 0) host = argv[i] + 7;
+        else if (strncmp(argv[i], "--port=", 7) == 0) port = atoi(argv[i] + 7);
+        else if (strcmp(argv[i], "--speed=max") == 0) speed = 0;
+        else if (strncmp(argv[i], "--speed=", 8) == 0) speed = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--out=", 6) == 0) out_path = argv[i] + 6;
+        else if (strncmp(argv[i], "--drain-ms=", 11) == 0) drain_ms = atoi(argv[i] + 11);
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (speed < 0 || port <= 0 || port > 65535) {
+        usage();
+        return 2;
+    }
+    return replay(argv[1], host, port, speed, out_path, drain_ms);
+}